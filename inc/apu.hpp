@@ -0,0 +1,142 @@
+#ifndef APU_HPP_
+#define APU_HPP_
+
+#include "blip_buffer.hpp"
+#include "constants.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Forward declarations
+class Scheduler;
+class AudioRing;
+class StateWriter;
+class StateReader;
+
+// Four-channel DMG sound. Nothing runs per instruction: the APU remembers the
+// time it was last brought up to date and catches up when a sound register is
+// touched or when the scheduler's flush event fires. Catching up jumps from one
+// waveform step to the next, and output is synthesized as band-limited steps
+// only when the mixed amplitude changes.
+class APU {
+public:
+    explicit APU(Scheduler* scheduler);
+
+    uint8_t read_register(uint16_t address);
+    void write_register(uint16_t address, uint8_t value);
+
+    // Samples go to `ring` (nullptr = no output). Output can be muted without
+    // losing sync, e.g. while run-ahead executes speculative frames.
+    void set_output(AudioRing* ring);
+    void set_output_enabled(bool enabled);
+    uint64_t samples_produced() const { return samples_produced_; }
+
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
+
+private:
+    struct Envelope {
+        uint8_t initial_volume;
+        bool increase;
+        uint8_t period;
+        uint8_t volume;
+        uint8_t timer;
+    };
+
+    struct SquareChannel {
+        bool enabled;
+        bool dac_enabled;
+        uint8_t duty;
+        uint8_t duty_step;
+        uint16_t frequency;
+        uint32_t timer;
+        uint16_t length_counter;
+        bool length_enabled;
+        Envelope envelope;
+
+        // Channel 1 only
+        uint8_t sweep_period;
+        bool sweep_negate;
+        uint8_t sweep_shift;
+        uint8_t sweep_timer;
+        bool sweep_enabled;
+        uint16_t shadow_frequency;
+    };
+
+    struct WaveChannel {
+        bool enabled;
+        bool dac_enabled;
+        uint16_t frequency;
+        uint32_t timer;
+        uint8_t position;
+        uint8_t sample;
+        uint16_t length_counter;
+        bool length_enabled;
+        uint8_t volume_code;
+    };
+
+    struct NoiseChannel {
+        bool enabled;
+        bool dac_enabled;
+        uint16_t lfsr;
+        uint8_t clock_shift;
+        bool narrow;
+        uint8_t divisor_code;
+        uint32_t timer;
+        uint16_t length_counter;
+        bool length_enabled;
+        Envelope envelope;
+    };
+
+    void run_until(uint64_t time);
+    void flush();
+    void clock_frame_sequencer();
+    void update_output(uint64_t time);
+    void restart_output();
+    void power_off();
+
+    void trigger_square(SquareChannel& channel, bool has_sweep);
+    void trigger_wave();
+    void trigger_noise();
+    void clock_sweep();
+    uint16_t sweep_target();
+    static void clock_envelope(Envelope& envelope);
+    static void load_envelope(Envelope& envelope, uint8_t value);
+    template <typename Channel>
+    static void clock_length(Channel& channel);
+
+    static uint32_t square_period(uint16_t frequency) { return (2048 - frequency) * 4; }
+    static uint32_t wave_period(uint16_t frequency) { return (2048 - frequency) * 2; }
+    uint32_t noise_period() const;
+
+    uint8_t square_level(const SquareChannel& channel) const;
+    uint8_t wave_level() const;
+    uint8_t noise_level() const;
+
+    Scheduler* scheduler_;
+
+    // Emulated state
+    std::array<uint8_t, 0x20> registers_{};  // Raw writes to FF10-FF2F for read-back
+    std::array<uint8_t, 0x10> wave_ram_{};
+    bool powered_ = true;
+    SquareChannel square1_{};
+    SquareChannel square2_{};
+    WaveChannel wave_{};
+    NoiseChannel noise_{};
+    uint8_t frame_sequencer_step_ = 0;
+    uint32_t frame_sequencer_timer_ = FRAME_SEQUENCER_CYCLES;
+    uint64_t current_time_ = 0;
+
+    // Host output, not part of save state
+    AudioRing* ring_ = nullptr;
+    bool output_enabled_ = true;
+    BlipBuffer left_;
+    BlipBuffer right_;
+    uint64_t output_start_time_ = 0;  // Clock time of the open blip frame
+    int32_t emitted_left_ = 0;
+    int32_t emitted_right_ = 0;
+    std::vector<int16_t> mix_buffer_;
+    uint64_t samples_produced_ = 0;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef AUDIO_OUTPUT_HPP_
+#define AUDIO_OUTPUT_HPP_
+
+#include "audio_ring.hpp"
+#include "resampler.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Destination for interleaved stereo int16 frames at the output rate
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+    virtual void write(const int16_t* frames, size_t count) = 0;
+    virtual void close() {}
+};
+
+// Drains the audio ring on its own thread and resamples it to the output rate,
+// so a slow sink never stalls emulation. In real-time mode the thread acts as
+// the device clock: it releases output at the host rate and steers the
+// resampling ratio by ring fill level, so a producer running slightly fast or
+// slow neither underruns nor drifts. Offline mode converts everything as fast
+// as the sink accepts it.
+class AudioOutput {
+public:
+    AudioOutput(AudioRing* ring, std::unique_ptr<AudioSink> sink, uint32_t output_rate, bool realtime);
+    ~AudioOutput();
+
+    AudioOutput(const AudioOutput&) = delete;
+    AudioOutput& operator=(const AudioOutput&) = delete;
+
+    void start();
+    // Drains what is left in the ring, then closes the sink
+    void stop();
+
+    bool realtime() const { return realtime_; }
+    // Ring fill, in input frames, that rate control steers towards
+    size_t target_fill() const { return target_fill_; }
+
+    uint64_t frames_written() const { return frames_written_.load(std::memory_order_relaxed); }
+    uint64_t underruns() const { return underruns_.load(std::memory_order_relaxed); }
+    double rate_adjust() const { return rate_adjust_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void run_realtime();
+    size_t convert(size_t output_frames, bool pad);
+
+    AudioRing* ring_;
+    std::unique_ptr<AudioSink> sink_;
+    uint32_t output_rate_;
+    bool realtime_;
+    size_t target_fill_;
+    Resampler resampler_;
+
+    std::vector<int16_t> input_block_;
+    std::vector<int16_t> output_block_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> frames_written_{0};
+    std::atomic<uint64_t> underruns_{0};
+    std::atomic<double> rate_adjust_{1.0};
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef AUDIO_RING_HPP_
+#define AUDIO_RING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Lock-free single-producer/single-consumer ring of interleaved stereo int16
+// frames. The emulation thread pushes and never blocks: frames that do not fit
+// are dropped and counted. The audio thread pops.
+class AudioRing {
+public:
+    explicit AudioRing(size_t capacity_frames)
+        : buffer_(capacity_frames * 2)
+        , mask_(capacity_frames - 1) {
+        if (capacity_frames == 0 || (capacity_frames & mask_) != 0) {
+            throw std::runtime_error("Audio ring capacity must be a power of two");
+        }
+    }
+
+    // Producer side
+    size_t push(const int16_t* frames, size_t count) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t space = capacity() - (head - tail);
+        size_t written = count < space ? count : space;
+        for (size_t i = 0; i < written; i++) {
+            size_t slot = ((head + i) & mask_) * 2;
+            buffer_[slot] = frames[i * 2];
+            buffer_[slot + 1] = frames[i * 2 + 1];
+        }
+        head_.store(head + written, std::memory_order_release);
+        if (written < count) {
+            dropped_frames_.fetch_add(count - written, std::memory_order_relaxed);
+        }
+        return written;
+    }
+
+    // Consumer side
+    size_t pop(int16_t* frames, size_t count) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t available = head - tail;
+        size_t read = count < available ? count : available;
+        for (size_t i = 0; i < read; i++) {
+            size_t slot = ((tail + i) & mask_) * 2;
+            frames[i * 2] = buffer_[slot];
+            frames[i * 2 + 1] = buffer_[slot + 1];
+        }
+        tail_.store(tail + read, std::memory_order_release);
+        return read;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    uint64_t dropped_frames() const { return dropped_frames_.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<int16_t> buffer_;
+    size_t mask_;
+
+    // Producer and consumer indices live on separate cache lines
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) std::atomic<uint64_t> dropped_frames_{0};
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef BLIP_BUFFER_HPP_
+#define BLIP_BUFFER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Band-limited step synthesis. Instead of sampling a waveform every clock, the
+// caller reports each amplitude change as a delta at its clock time; the delta is
+// spread over a few output samples with a windowed-sinc kernel and the samples
+// are integrated when read. Work is proportional to the number of changes.
+class BlipBuffer {
+public:
+    static const int PHASE_BITS = 5;
+    static const int PHASES = 1 << PHASE_BITS;
+    static const int KERNEL_WIDTH = 16;
+
+    BlipBuffer(uint32_t clock_rate, uint32_t sample_rate, size_t max_samples);
+
+    // clock_offset is relative to the start of the current frame
+    void add_delta(uint32_t clock_offset, int32_t delta) {
+        uint64_t position = offset_ + clock_offset * factor_;
+        size_t index = avail_ + static_cast<size_t>(position >> FRAC_BITS);
+        const int16_t* kernel = kernel_[(position >> (FRAC_BITS - PHASE_BITS)) & (PHASES - 1)];
+        int32_t* out = &buffer_[index];
+        for (int i = 0; i < KERNEL_WIDTH; i++) {
+            out[i] += kernel[i] * delta;
+        }
+    }
+
+    // Close the frame after `clock_duration` clocks; its samples become readable
+    void end_frame(uint32_t clock_duration);
+
+    // Integrate up to `count` samples into out[0], out[stride], ...
+    size_t read_samples(int16_t* out, size_t count, size_t stride);
+
+    size_t samples_available() const { return avail_; }
+    uint32_t max_frame_clocks() const;
+    void clear();
+
+private:
+    static const int FRAC_BITS = 32;
+    static const int BASS_SHIFT = 9;  // Leaky integrator doubles as the DC-blocking high-pass
+
+    static void build_kernel();
+
+    uint64_t factor_;   // Output samples per clock, 32.32 fixed point
+    uint64_t offset_ = 0;  // Fractional sample position of the frame start
+    size_t max_samples_;
+    size_t avail_ = 0;
+    int32_t integrator_ = 0;
+    std::vector<int32_t> buffer_;
+
+    // Shared by all instances, built once by the first (thread-safe)
+    static int16_t kernel_[PHASES][KERNEL_WIDTH];
+};
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef BLOCK_CACHE_HPP_
+#define BLOCK_CACHE_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Forward declarations
+class CPU;
+class Jit;
+class MMU;
+
+// Pre-decoded basic blocks. A block is a straight-line run of instructions
+// ending at the first control-flow instruction (or HALT/STOP, a region edge or
+// BLOCK_MAX_OPS); each instruction is stored once as (handler, opcode,
+// operands) so executing it needs neither MMU fetches nor pattern dispatch.
+//
+// ROM blocks are keyed by their offset in the ROM image, i.e. by (bank, PC),
+// and live for the whole session. Blocks in work RAM and high RAM are keyed
+// by address and registered in a page bitmap; the MMU checks the bitmap on
+// RAM writes and a write to a code page drops the blocks covering it. Code
+// anywhere else (VRAM, cartridge RAM, I/O) is not cached and runs through the
+// regular fetch/decode path.
+class BlockCache {
+public:
+    using Handler = uint8_t (CPU::*)();
+
+    struct DecodedOp {
+        Handler handler;
+        uint8_t opcode;       // Base opcode, or the second byte of a CB instruction
+        uint8_t length;       // Instruction length in bytes
+        uint8_t prefix;       // Bytes consumed before the operands (2 for CB)
+        uint8_t operands[2];
+    };
+
+    static const size_t BLOCK_MAX_OPS = 32;
+    static const int PAGE_SHIFT = 8;
+    static const uint16_t RAM_BASE = 0x8000;
+
+    BlockCache(CPU* cpu, MMU* mmu);
+
+    // The next instruction at pc, or nullptr if pc is not in cacheable memory.
+    // Successive calls walk a block without any lookup as long as pc follows
+    // straight-line execution.
+    const DecodedOp* next(uint16_t pc) {
+        if (pc != cursor_pc_ || cursor_ == cursor_end_) {
+            if (!enter_block(pc)) {
+                return nullptr;
+            }
+        }
+        const DecodedOp* op = cursor_++;
+        cursor_pc_ = static_cast<uint16_t>(pc + op->length);
+        return op;
+    }
+
+    // Called by the MMU for every RAM write; true if the page holds cached code
+    bool is_code_page(uint16_t addr) const {
+        uint8_t page = addr >> PAGE_SHIFT;
+        return (code_pages_[page >> 6] >> (page & 63)) & 1;
+    }
+    void invalidate(uint16_t addr);
+    const uint64_t* code_page_bitmap() const { return code_pages_.data(); }
+
+    // True if a live RAM block starts at pc; translated RAM code is only built
+    // for such blocks so that it is covered by the same page bitmap
+    bool has_ram_block(uint16_t pc) const { return pc >= RAM_BASE && ram_index_[pc - RAM_BASE] != 0; }
+
+    // Dropped RAM blocks are passed on so their translations go too
+    void set_jit(Jit* jit) { jit_ = jit; }
+
+    // ROM bank mapping changed; the current block may no longer be mapped
+    void mapping_changed() { cursor_ = cursor_end_ = nullptr; }
+
+    // True while next(pc) would continue the current block rather than enter one
+    bool inside_block(uint16_t pc) const { return pc == cursor_pc_ && cursor_ != cursor_end_; }
+
+    // Drop all RAM blocks (e.g. after RAM contents were replaced by a state load)
+    void flush_ram();
+    // Drop every block (e.g. the CPU switched to other handlers)
+    void flush();
+
+    // Debugger breakpoints, one bit per address. A flagged address always
+    // starts a block and is checked when a block is entered there: next()
+    // returns nullptr and take_breakpoint_hit() is true, unless resume_at()
+    // let that entry through. Changing a breakpoint drops every block.
+    void set_breakpoint(uint16_t addr, bool enabled);
+    bool is_breakpoint(uint16_t addr) const { return (breakpoints_[addr >> 6] >> (addr & 63)) & 1; }
+    bool has_breakpoints() const { return breakpoint_count_ != 0; }
+    void resume_at(uint16_t pc) { resume_pc_ = pc; }
+    // The next block entry stops as if at a breakpoint, wherever it is
+    void request_stop() {
+        stop_requested_ = true;
+        cursor_ = cursor_end_ = nullptr;
+    }
+    void cancel_stop() { stop_requested_ = false; }
+    bool take_breakpoint_hit() {
+        bool hit = breakpoint_hit_;
+        breakpoint_hit_ = false;
+        return hit;
+    }
+
+    size_t rom_blocks() const { return rom_blocks_.size(); }
+    size_t ram_blocks() const { return ram_live_blocks_; }
+    uint64_t invalidations() const { return invalidations_; }
+    // Block entries, and those that had to decode or could not be cached
+    uint64_t lookups() const { return lookups_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    struct Block {
+        uint32_t first_op;
+        uint16_t op_count;
+        uint16_t start;
+        uint16_t end;  // One past the last byte
+    };
+
+    bool enter_block(uint16_t pc);
+    bool decode_block(uint16_t pc, uint16_t limit, std::vector<DecodedOp>& ops, Block& block);
+    void mark_code_pages(uint16_t start, uint16_t end, uint32_t block_id);
+
+    CPU* cpu_;
+    MMU* mmu_;
+    Jit* jit_ = nullptr;
+
+    const DecodedOp* cursor_ = nullptr;
+    const DecodedOp* cursor_end_ = nullptr;
+    uint16_t cursor_pc_ = 0;
+
+    // ROM: index by ROM offset, entries are block id + 1
+    std::vector<uint32_t> rom_index_;
+    std::vector<Block> rom_blocks_;
+    std::vector<DecodedOp> rom_ops_;
+
+    // RAM: index by address - 0x8000, entries are block id + 1
+    std::vector<uint32_t> ram_index_;
+    std::vector<Block> ram_blocks_;
+    std::vector<DecodedOp> ram_ops_;
+    std::array<std::vector<uint32_t>, 256> page_blocks_;
+    std::array<uint64_t, 4> code_pages_ = {};
+    size_t ram_live_blocks_ = 0;
+    uint64_t invalidations_ = 0;
+    uint64_t lookups_ = 0;
+    uint64_t misses_ = 0;
+
+    static const uint32_t NO_RESUME = 0x10000;
+    std::array<uint64_t, 1024> breakpoints_ = {};
+    size_t breakpoint_count_ = 0;
+    uint32_t resume_pc_ = NO_RESUME;
+    bool breakpoint_hit_ = false;
+    bool stop_requested_ = false;
+};
+
+#endif
@@ -14,15 +14,30 @@ using namespace std;
 
 class Cartridge {
 public:
+    // Both throw std::runtime_error unless the image is_supported()
     Cartridge(std::string path);
+    explicit Cartridge(vector<uint8_t> image);
+
+    // The whole file, or an empty image if it cannot be read
+    static vector<uint8_t> read_rom_file(const string& path);
+    // True if the image holds at least the two fixed banks and its cartridge
+    // type is one of the emulated MBCs
+    static bool is_supported(const uint8_t* image, size_t size);
 
-    bool load_rom(string path);
     void print_rom();
 
     void parse_header(); // TODO
 
     uint8_t read8(uint16_t addr) const;
     void write8(uint16_t addr, uint8_t val);
+    size_t rom_offset(uint16_t addr) const { return mbc->rom_offset(addr); }
+    size_t rom_size() const { return rom.size(); }
+    const uint8_t* rom_data() const { return rom.data(); }
+
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
+
+    uint64_t rom_hash() const { return hash; }
 private:
     vector<uint8_t> rom;
     int rom_banks;
@@ -31,6 +46,7 @@ private:
     int ram_banks;
 
     uint8_t cartridge_type;
+    uint64_t hash = 0;
     unique_ptr<MBC> mbc;
 };
 
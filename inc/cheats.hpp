@@ -0,0 +1,89 @@
+#ifndef CHEATS_HPP_
+#define CHEATS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Forward declarations
+class CPU;
+class Disassembler;
+class MMU;
+
+// Game Genie ROM patches and GameShark RAM writes.
+//
+// A Game Genie code replaces the byte at a ROM address, in every bank unless
+// it carries a compare value, in which case only where the original byte
+// matches it. Patches are applied once, when codes change: each affected
+// 256-byte ROM page is copied and patched, and the MMU maps the copy in place
+// of the ROM page whenever that bank is selected. Reads never check the code
+// list, so patched games run at the same speed.
+//
+// GameShark codes write their value to RAM at the start of every frame.
+//
+// Formats (hex digits):
+//   ABC-DEF      Game Genie: value AB at address (F ^ F)CDE
+//   ABC-DEF-GHI  Game Genie: as above, if the ROM holds ror(GI, 2) ^ BA there
+//   TTVVLLHH     GameShark: value VV at address HHLL (type TT, 00/01 or the
+//                80-9F bank forms; DMG has no RAM banks to select). HHLL
+//                must be 8000 or above and outside the FF00-FF7F I/O range.
+class Cheats {
+public:
+    struct RomPatch {
+        uint16_t address;
+        uint8_t value;
+        int16_t compare;  // -1 = none
+        std::string code;
+    };
+
+    struct RamWrite {
+        uint16_t address;
+        uint8_t value;
+        std::string code;
+    };
+
+    Cheats(CPU* cpu, MMU* mmu, Disassembler* disassembler);
+    ~Cheats();
+
+    Cheats(const Cheats&) = delete;
+    Cheats& operator=(const Cheats&) = delete;
+
+    // False if the code is neither a valid Game Genie nor GameShark code
+    bool add(const std::string& code);
+    // An empty code removes all of them; false if there was no such code
+    bool remove(const std::string& code);
+
+    const std::vector<RomPatch>& rom_patches() const { return rom_patches_; }
+    const std::vector<RamWrite>& ram_writes() const { return ram_writes_; }
+    size_t patched_page_count() const { return pages_.size(); }
+
+    // The patched copy of ROM page `page` (ROM offset / 256), or nullptr if
+    // no code touches it; called by the MMU when it maps ROM pages
+    const uint8_t* patched_page(size_t page) const {
+        if (page >= patched_pages_.size() * 64 || !((patched_pages_[page >> 6] >> (page & 63)) & 1)) {
+            return nullptr;
+        }
+        return pages_.find(page)->second.data();
+    }
+
+    // Called once per frame
+    void apply_ram_writes();
+
+private:
+    void update_pages();
+
+    CPU* cpu_;
+    MMU* mmu_;
+    Disassembler* disassembler_;
+
+    std::vector<RomPatch> rom_patches_;
+    std::vector<RamWrite> ram_writes_;
+
+    // Bit per ROM page, and the patched copies of those pages
+    std::vector<uint64_t> patched_pages_;
+    std::unordered_map<size_t, std::vector<uint8_t>> pages_;
+};
+
+#endif
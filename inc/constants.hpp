@@ -1,8 +1,12 @@
 #ifndef CONSTANTS_H_
 #define CONSTANTS_H_
 
+#include <cstddef>
 #include <cstdint>
 
+// Emulator version, recorded in input movies
+static const char* const EMULATOR_VERSION = "0.1.0";
+
 // CPU Constants
 static const uint16_t PROGRAM_COUNTER_START = 0x0100;
 
@@ -11,12 +15,107 @@ static const uint16_t PROGRAM_COUNTER_START = 0x0100;
 // 1 M-cycle = 4 T-cycles
 static const uint32_t DMG_CLOCK_SPEED = 4194304;  // 4.194304 MHz
 
+// Frame timing
+static const uint32_t CYCLES_PER_FRAME = 70224;   // 154 lines * 456 cycles, ~59.73 Hz
+static const uint32_t FRAMES_PER_SECOND = 60;
+
+// Save states
+static const uint32_t SAVE_STATE_MAGIC = 0x53534247;  // "GBSS"
+static const uint32_t SAVE_STATE_VERSION = 6;
+
+// Rewind defaults
+static const uint32_t REWIND_SECONDS = 60;
+static const size_t REWIND_ARENA_BYTES = 64 * 1024 * 1024;
+static const uint32_t REWIND_KEYFRAME_INTERVAL = 60;  // One full snapshot per second
+
+// Serial port
+static const uint16_t SB_REGISTER_LOCATION = 0xFF01;  // Serial transfer data
+static const uint16_t SC_REGISTER_LOCATION = 0xFF02;  // Serial transfer control
+static const uint8_t SERIAL_TRANSFER_START = 0x80;
+static const uint8_t SERIAL_INTERNAL_CLOCK = 0x01;
+static const uint32_t SERIAL_TRANSFER_CYCLES = 8 * 512;  // 8 bits at 8192 Hz
+static const uint32_t LINK_POLL_CYCLES = 512;           // A waiting external-clock side checks the cable every serial bit
+static const uint64_t LINK_MAX_SKEW_CYCLES = 2 * CYCLES_PER_FRAME;  // Linked instances never drift further apart
+
 // Timer register locations
 static const uint16_t DIV_REGISTER_LOCATION = 0xFF04; // Divider register, incremented by 1 every 16384 Hz
 static const uint16_t TIMA_REGISTER_LOCATION = 0xFF05; // Value in this register is incremented by 1 at the frequency specified by the TAC register
 static const uint16_t TMA_REGISTER_LOCATION = 0xFF06; // Value in this register is loaded into TIMA when it overflows
 static const uint16_t TAC_REGISTER_LOCATION = 0xFF07; // Timer control register
 
+// Joypad register location and layout
+static const uint16_t JOYPAD_REGISTER_LOCATION = 0xFF00;
+static const uint8_t JOYPAD_SELECT_DIRECTIONS = 0x10;  // P14
+static const uint8_t JOYPAD_SELECT_ACTIONS = 0x20;     // P15
+static const uint8_t JOYPAD_BUTTON_RIGHT = 0x01;
+static const uint8_t JOYPAD_BUTTON_LEFT = 0x02;
+static const uint8_t JOYPAD_BUTTON_UP = 0x04;
+static const uint8_t JOYPAD_BUTTON_DOWN = 0x08;
+static const uint8_t JOYPAD_BUTTON_A = 0x10;
+static const uint8_t JOYPAD_BUTTON_B = 0x20;
+static const uint8_t JOYPAD_BUTTON_SELECT = 0x40;
+static const uint8_t JOYPAD_BUTTON_START = 0x80;
+
+// PPU register locations
+static const uint16_t LCDC_REGISTER_LOCATION = 0xFF40; // LCD control
+static const uint16_t STAT_REGISTER_LOCATION = 0xFF41; // LCD status
+static const uint16_t SCY_REGISTER_LOCATION = 0xFF42;
+static const uint16_t SCX_REGISTER_LOCATION = 0xFF43;
+static const uint16_t LY_REGISTER_LOCATION = 0xFF44;   // Current scanline, read only
+static const uint16_t LYC_REGISTER_LOCATION = 0xFF45;
+static const uint16_t DMA_REGISTER_LOCATION = 0xFF46;  // OAM DMA source page
+static const uint16_t BGP_REGISTER_LOCATION = 0xFF47;
+static const uint16_t OBP0_REGISTER_LOCATION = 0xFF48;
+static const uint16_t OBP1_REGISTER_LOCATION = 0xFF49;
+static const uint16_t WY_REGISTER_LOCATION = 0xFF4A;
+static const uint16_t WX_REGISTER_LOCATION = 0xFF4B;
+
+// LCD geometry and timing (T-cycles)
+static const uint32_t SCREEN_WIDTH = 160;
+static const uint32_t SCREEN_HEIGHT = 144;
+static const uint32_t LINE_CYCLES = 456;
+static const uint32_t OAM_SCAN_CYCLES = 80;
+static const uint32_t PIXEL_TRANSFER_MIN_CYCLES = 172;
+static const uint32_t SPRITE_PENALTY_CYCLES = 6;
+static const uint32_t WINDOW_PENALTY_CYCLES = 6;
+static const uint8_t VBLANK_START_LINE = 144;
+static const uint8_t LINES_PER_FRAME = 154;
+static const uint8_t MAX_SPRITES_PER_LINE = 10;
+
+// Sound register locations
+static const uint16_t NR10_REGISTER_LOCATION = 0xFF10; // Channel 1 sweep
+static const uint16_t NR11_REGISTER_LOCATION = 0xFF11; // Channel 1 duty and length
+static const uint16_t NR12_REGISTER_LOCATION = 0xFF12; // Channel 1 envelope
+static const uint16_t NR13_REGISTER_LOCATION = 0xFF13; // Channel 1 period low
+static const uint16_t NR14_REGISTER_LOCATION = 0xFF14; // Channel 1 trigger, length enable, period high
+static const uint16_t NR21_REGISTER_LOCATION = 0xFF16;
+static const uint16_t NR22_REGISTER_LOCATION = 0xFF17;
+static const uint16_t NR23_REGISTER_LOCATION = 0xFF18;
+static const uint16_t NR24_REGISTER_LOCATION = 0xFF19;
+static const uint16_t NR30_REGISTER_LOCATION = 0xFF1A; // Channel 3 DAC enable
+static const uint16_t NR31_REGISTER_LOCATION = 0xFF1B;
+static const uint16_t NR32_REGISTER_LOCATION = 0xFF1C; // Channel 3 output level
+static const uint16_t NR33_REGISTER_LOCATION = 0xFF1D;
+static const uint16_t NR34_REGISTER_LOCATION = 0xFF1E;
+static const uint16_t NR41_REGISTER_LOCATION = 0xFF20;
+static const uint16_t NR42_REGISTER_LOCATION = 0xFF21;
+static const uint16_t NR43_REGISTER_LOCATION = 0xFF22; // Channel 4 LFSR clock and width
+static const uint16_t NR44_REGISTER_LOCATION = 0xFF23;
+static const uint16_t NR50_REGISTER_LOCATION = 0xFF24; // Master volume
+static const uint16_t NR51_REGISTER_LOCATION = 0xFF25; // Panning
+static const uint16_t NR52_REGISTER_LOCATION = 0xFF26; // Power and channel status
+static const uint16_t SOUND_REGISTERS_START = 0xFF10;
+static const uint16_t WAVE_RAM_START = 0xFF30;
+static const uint16_t WAVE_RAM_END = 0xFF3F;
+
+// Sound timing (T-cycles) and output
+static const uint32_t FRAME_SEQUENCER_CYCLES = 8192;  // 512 Hz
+static const uint32_t APU_SAMPLE_RATE = 65536;        // CPU clock / 64
+static const uint32_t APU_FLUSH_CYCLES = 8192;        // Samples reach the audio ring every ~2 ms
+static const size_t AUDIO_RING_FRAMES = 16384;        // ~250 ms of stereo frames
+static const size_t AUDIO_LATENCY_FRAMES = 4096;      // Ring fill targeted in real time, ~62 ms
+static const uint32_t HOST_SAMPLE_RATE = 48000;
+
 // Interrupts bit locations
 static const uint8_t INTERRUPT_VBLANK_BIT = 0;
 static const uint8_t INTERRUPT_LCD_STAT_BIT = 1;
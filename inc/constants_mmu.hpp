@@ -44,6 +44,7 @@
 #define BANKING_MODE_START 0x6000
 #define BANKING_MODE_END 0x7fff
 
+#define HEADER_CARTRIDGE_TYPE_ADDR 0x0147
 #define HEADER_ROM_SIZE_ADDR 0x0148
 #define HEADER_RAM_SIZE_ADDR 0x0149
 
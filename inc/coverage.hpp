@@ -0,0 +1,81 @@
+#ifndef COVERAGE_HPP_
+#define COVERAGE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per-byte ROM coverage: one bitmap each for bytes executed as an opcode,
+// executed as an operand and read as data, preallocated to the ROM size, so
+// recording an access is a single OR. Offsets are into the ROM image, so
+// every bank is covered separately.
+//
+// File layout (little endian):
+//   uint32  magic "GBCV"
+//   uint16  format version
+//   uint64  FNV-1a hash of the ROM
+//   uint32  ROM size in bytes
+//   uint8[] opcode, operand and data bitmaps, (size + 7) / 8 bytes each;
+//           byte offset / 8, bit offset % 8
+//
+// Files of the same ROM merge by OR-ing the bitmaps. The CDL log holds one
+// byte per ROM byte with 0x01 for code and 0x02 for data, as the code/data
+// loggers of other emulators and disassemblers expect.
+class Coverage {
+public:
+    enum Kind {
+        OPCODE,
+        OPERAND,
+        DATA,
+        KIND_COUNT
+    };
+
+    static constexpr uint32_t MAGIC = 0x56434247;  // "GBCV"
+    static constexpr uint16_t FORMAT_VERSION = 1;
+    static constexpr uint8_t CDL_CODE = 0x01;
+    static constexpr uint8_t CDL_DATA = 0x02;
+
+    Coverage() = default;
+    Coverage(size_t rom_size, uint64_t rom_hash);
+
+    // Offsets past the end of the ROM are ignored
+    void mark(Kind kind, size_t offset) {
+        if (offset < rom_size_) {
+            bits_[kind][offset >> 6] |= 1ULL << (offset & 63);
+        }
+    }
+    void mark_instruction(size_t offset, uint8_t length) {
+        if (offset >= rom_size_) {
+            return;
+        }
+        mark(OPCODE, offset);
+        for (uint8_t i = 1; i < length; i++) {
+            mark(OPERAND, offset + i);
+        }
+    }
+
+    bool test(Kind kind, size_t offset) const { return (bits_[kind][offset >> 6] >> (offset & 63)) & 1; }
+    size_t count(Kind kind) const;
+    // Bytes executed (as opcode or operand)
+    size_t code_bytes() const;
+    size_t rom_size() const { return rom_size_; }
+    uint64_t rom_hash() const { return rom_hash_; }
+
+    // Loading into a Coverage that already holds a ROM's bitmaps OR-s the
+    // file in; it has to be of the same ROM
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+    bool write_cdl(const std::string& path) const;
+
+    // Reads each input once and writes their union; a ".cdl" output is
+    // written as a CDL log
+    static bool merge_files(const std::string& output, const std::vector<std::string>& inputs);
+
+private:
+    size_t rom_size_ = 0;
+    uint64_t rom_hash_ = 0;
+    std::vector<uint64_t> bits_[KIND_COUNT];
+};
+
+#endif
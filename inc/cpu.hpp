@@ -1,27 +1,158 @@
 #ifndef CPU_HPP_
 #define CPU_HPP_
 
+#include "block_cache.hpp"
 #include "constants.hpp"
+#ifdef CPU_STATS
+#include "cpu_stats.hpp"
+#endif
 #include "instruction_decoder.hpp"
+#include "jit.hpp"
+#include "logger.hpp"
+#include <array>
 #include <cstdint>
 #include <string>
-#include <unordered_map>
 
 // Forward declarations
 class MMU;
 class InterruptController;
+class Coverage;
+class Profiler;
+class StateWriter;
+class StateReader;
+
+// Advances the rest of the machine for the CPU. tick() follows every
+// instruction CPU::run() executes, interrupt dispatch included, and returning
+// false ends the run; advance() is called for each M-cycle with exact timing.
+class InstructionClock {
+public:
+    virtual ~InstructionClock() = default;
+    virtual bool tick(uint32_t cycles) = 0;
+    virtual void advance(uint32_t cycles) = 0;
+};
+
+// Bus timing policies the instruction handlers are compiled for. Fast: the
+// caller applies an instruction's cycles to the other components once it has
+// retired. Exact: every memory access and internal delay first advances them
+// by one M-cycle, so accesses land on the right cycle relative to the timer
+// and PPU; the caller only applies what is left (see take_bus_cycles()).
+struct FastTiming {
+    static constexpr bool EXACT = false;
+};
+struct ExactTiming {
+    static constexpr bool EXACT = true;
+};
 
 class CPU {
-    friend class InstructionDecoder;
+    friend class BlockCache;
+    friend class Jit;
+    template <typename Timing> friend struct OpcodeTable;
 
 public:
     CPU(MMU* mmu, InterruptController* interrupt_controller);
     
     uint8_t execute_next_instruction();
     uint8_t handle_interrupts();
+
+    // Same as calling execute_next_instruction() and handle_interrupts() until
+    // `clock` returns false. Built with THREADED_DISPATCH on GCC/Clang, every
+    // opcode is a label ending in its own computed-goto dispatch.
+    void run(InstructionClock& clock);
+
+    // M-cycle exact memory timing through `clock` (off = fast batch timing);
+    // the JIT is turned off as it only implements the fast policy
+    void set_exact_timing(bool exact, InstructionClock* clock);
+    bool exact_timing() const { return exact_timing_; }
+
+    // Cycles already applied through the clock since the last call
+    uint32_t take_bus_cycles() {
+        uint32_t cycles = bus_cycles_;
+        bus_cycles_ = 0;
+        return cycles;
+    }
     
     bool getIME() const { return ime_; }
     void setIME(bool value) { ime_ = value; }
+    uint16_t pc() const { return pc_; }
+
+    struct Registers {
+        uint16_t af;
+        uint16_t bc;
+        uint16_t de;
+        uint16_t hl;
+        uint16_t sp;
+        uint16_t pc;
+        bool ime;
+        bool halted;
+    };
+    Registers registers() const { return {af(), bc_, de_, hl_, sp_, pc_, ime_, halted_}; }
+
+    // Cycles spent idling in HALT, a host-side total not part of the state
+    uint64_t halted_cycles() const { return halted_cycles_; }
+    // Opcodes the interpreter has run, also host-side; HALT idle steps and
+    // interrupt dispatch are not counted
+    uint64_t instructions() const { return instructions_; }
+
+    // Pre-decoded block execution; off = fetch and decode every instruction
+    void set_block_cache_enabled(bool enabled) { block_cache_enabled_ = enabled; }
+    const BlockCache& block_cache() const { return block_cache_; }
+
+    // Native execution of hot blocks; false if the host has no JIT backend
+    // (jit().available()), in CPU_STATS builds, with exact timing, call stack
+    // profiling, coverage or breakpoints. With verify on, every native run is
+    // checked against the interpreter.
+    bool set_jit_enabled(bool enabled, bool verify = false);
+    bool jit_enabled() const { return jit_enabled_; }
+    const Jit& jit() const { return jit_; }
+
+    // Drop every pre-decoded block and translation (e.g. ROM bytes were patched)
+    void flush_code() {
+        block_cache_.flush();
+        jit_.flush();
+    }
+
+    // Runs one translated block if it ends before `budget` cycles and no
+    // interrupt is due; returns 0 when the interpreter must step. Only called
+    // when native_ready(): at a block entry, not halted and no EI pending.
+    bool native_ready() const {
+        return jit_enabled_ && !halted_ && !ime_pending_
+            && !(block_cache_enabled_ && block_cache_.inside_block(pc_));
+    }
+    uint32_t execute_native(uint32_t budget);
+
+    // Report CALL, RST, interrupt entry and RET/RETI to a profiler tracking
+    // call stacks (nullptr = off). Native code does not report them, so the
+    // JIT is turned off meanwhile.
+    void set_call_profiler(Profiler* profiler);
+
+    // Mark the ROM bytes of every instruction executed from ROM as opcode and
+    // operands (nullptr = off); the JIT is turned off meanwhile
+    void set_coverage(Coverage* coverage);
+
+    // PC breakpoints for a debugger, checked by the block cache on block entry
+    // only. Execution stops in front of a flagged address and
+    // execute_next_instruction() returns 0 instead of running it. Setting one
+    // turns the JIT off and pre-decoded blocks on.
+    void set_breakpoint(uint16_t addr, bool enabled);
+    bool has_breakpoint(uint16_t addr) const { return block_cache_.is_breakpoint(addr); }
+    // Lets the instruction at PC run once even if it is flagged
+    void resume_from_breakpoint() { block_cache_.resume_at(pc_); }
+    // Stops as at a breakpoint once the running instruction has completed
+    // (watchpoints break this way); cancel_stop() withdraws a pending request
+    void request_stop();
+    void cancel_stop() { block_cache_.cancel_stop(); }
+
+    // Address of the instruction running now, or of the last one to run
+    uint16_t instruction_address() const { return instruction_pc_; }
+
+#ifdef CPU_STATS
+    // Instruction, memory and interrupt counters (every instruction has to be
+    // interpreted to be counted, so the JIT is unavailable in these builds)
+    const CpuStats& stats() const { return stats_; }
+#endif
+
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
 
 private:
     // Dependencies
@@ -31,23 +162,72 @@ private:
     // State
     uint8_t current_opcode_ = 0;
     bool ime_ = false;  // Interrupt Master Enable
+    bool ime_pending_ = false;  // EI takes effect after the following instruction
+    bool halted_ = false;
+    uint64_t halted_cycles_ = 0;
+    uint64_t instructions_ = 0;
 
     // Registers
-    uint16_t af_ = 0;
+    uint8_t a_ = 0;
     uint16_t bc_ = 0;
     uint16_t de_ = 0;
     uint16_t hl_ = 0;
     uint16_t sp_ = 0;
     uint16_t pc_ = PROGRAM_COUNTER_START;
+    uint16_t instruction_pc_ = PROGRAM_COUNTER_START;
+
+    // Flags as the last instruction to write them left them; they are only
+    // packed into F when F itself is read (PUSH AF, DAA, logging, state export)
+    uint8_t flag_z_result_ = 0;  // Z is set when this is zero
+    uint8_t flag_h_bits_ = 0;    // H is bit 4, e.g. of operand ^ operand ^ result
+    bool flag_n_ = false;
+    bool flag_c_ = false;
 
     // Instruction handlers
-    using HandlerMap = std::unordered_map<InstructionDecoder::Op, uint8_t (CPU::*)(), InstructionDecoder::OpHash>;
-    HandlerMap op_handlers_;
-    HandlerMap cb_handlers_;
+    using Handler = uint8_t (CPU::*)();
+
+    // Dispatch tables resolved from the OpcodeTable patterns, indexed by opcode
+    std::array<Handler, 256> op_table_ = {};
+    std::array<Handler, 256> cb_table_ = {};
+
+    BlockCache block_cache_;
+    bool block_cache_enabled_ = true;
+    const uint8_t* operands_ = nullptr;  // Pre-decoded operands of the running instruction
+
+    Profiler* profiler_ = nullptr;
+    Coverage* coverage_ = nullptr;
+
+#ifdef CPU_STATS
+    CpuStats stats_;
+#endif
+
+    Jit jit_;
+    bool jit_enabled_ = false;
+
+    bool exact_timing_ = false;
+    InstructionClock* clock_ = nullptr;
+    uint32_t bus_cycles_ = 0;
+
+    template <typename Timing> void load_dispatch_tables();
+    template <typename Timing> uint8_t execute();
+    template <typename Timing> uint8_t dispatch_interrupt();
+    void cover_instruction();
+
+    // One M-cycle of bus activity: free in fast timing
+    template <typename Timing> void m_cycle() {
+        if constexpr (Timing::EXACT) {
+            clock_->advance(4);
+            bus_cycles_ += 4;
+        }
+    }
+    template <typename Timing> uint8_t read_memory(uint16_t addr);
+    template <typename Timing> void write_memory(uint16_t addr, uint8_t value);
 
     // Register access helpers - 8-bit
-    uint8_t getA() const { return (af_ >> 8) & 0xFF; }
-    uint8_t getF() const { return af_ & 0xF0; }
+    uint8_t getA() const { return a_; }
+    uint8_t getF() const {
+        return static_cast<uint8_t>(getFlagZ() << 7 | flag_n_ << 6 | getFlagH() << 5 | flag_c_ << 4);
+    }
     uint8_t getB() const { return (bc_ >> 8) & 0xFF; }
     uint8_t getC() const { return bc_ & 0xFF; }
     uint8_t getD() const { return (de_ >> 8) & 0xFF; }
@@ -55,8 +235,8 @@ private:
     uint8_t getH() const { return (hl_ >> 8) & 0xFF; }
     uint8_t getL() const { return hl_ & 0xFF; }
     
-    void setA(uint8_t value) { af_ = (af_ & 0x00F0) | (value << 8); }
-    void setF(uint8_t value) { af_ = (af_ & 0xFF00) | (value & 0xF0); }
+    void setA(uint8_t value) { a_ = value; }
+    void setF(uint8_t value) { set_flags(value & 0x80, value & 0x40, value & 0x20, value & 0x10); }
     void setB(uint8_t value) { bc_ = (bc_ & 0x00FF) | (value << 8); }
     void setC(uint8_t value) { bc_ = (bc_ & 0xFF00) | value; }
     void setD(uint8_t value) { de_ = (de_ & 0x00FF) | (value << 8); }
@@ -64,15 +244,36 @@ private:
     void setH(uint8_t value) { hl_ = (hl_ & 0x00FF) | (value << 8); }
     void setL(uint8_t value) { hl_ = (hl_ & 0xFF00) | value; }
 
+    uint16_t af() const { return static_cast<uint16_t>(a_ << 8 | getF()); }
+    void set_af(uint16_t value) {
+        a_ = value >> 8;
+        setF(value & 0xFF);  // Low nibble of F is always zero
+    }
+
     // Flag access helpers
-    uint8_t getFlagZ() const { return af_ & 0x80; }
-    uint8_t getFlagN() const { return af_ & 0x40; }
-    uint8_t getFlagH() const { return af_ & 0x20; }
-    uint8_t getFlagC() const { return af_ & 0x10; }
-    void setFlagZ(uint8_t value) { af_ = (af_ & 0xFF7F) | (value << 7); }
-    void setFlagN(uint8_t value) { af_ = (af_ & 0xFFBF) | (value << 6); }
-    void setFlagH(uint8_t value) { af_ = (af_ & 0xFFDF) | (value << 5); }
-    void setFlagC(uint8_t value) { af_ = (af_ & 0xFFEF) | (value << 4); }
+    // Flags read as 0/1 so they can be used directly in arithmetic
+    uint8_t getFlagZ() const { return flag_z_result_ == 0; }
+    uint8_t getFlagN() const { return flag_n_; }
+    uint8_t getFlagH() const { return (flag_h_bits_ >> 4) & 0x01; }
+    uint8_t getFlagC() const { return flag_c_; }
+    void setFlagZ(uint8_t value) { flag_z_result_ = value == 0; }
+    void setFlagN(uint8_t value) { flag_n_ = value != 0; }
+    void setFlagH(uint8_t value) { flag_h_bits_ = value != 0 ? 0x10 : 0x00; }
+    void setFlagC(uint8_t value) { flag_c_ = value != 0; }
+    void set_flags(bool z, bool n, bool h, bool c) {
+        flag_z_result_ = !z;
+        flag_n_ = n;
+        flag_h_bits_ = h ? 0x10 : 0x00;
+        flag_c_ = c;
+    }
+    // Records an ALU result: Z is derived from `result` and H from bit 4 of
+    // `half_carry_bits` (operand ^ operand ^ result for additions/subtractions)
+    void record_flags(uint8_t result, bool n, uint8_t half_carry_bits, bool carry) {
+        flag_z_result_ = result;
+        flag_n_ = n;
+        flag_h_bits_ = half_carry_bits;
+        flag_c_ = carry;
+    }
 
     // Opcode parameter decoding
     uint8_t read_first_register_8_bit_parameter() const;
@@ -93,135 +294,143 @@ private:
     void write_register_16_bit_memory(uint8_t reg_num, uint16_t value);
 
     // Utility
-    uint8_t fetchOpcode();
+    template <typename Timing> uint8_t fetchOpcode();
+    template <typename Timing> uint16_t fetch_imm16();
     uint16_t endian_swap(uint8_t low, uint8_t high) const;
-    void log(const std::string& func_name, const std::string& details = "");
+    uint16_t add_sp_offset(uint8_t offset);
+    // Handlers call this on every instruction, so nothing is built unless logging is on
+    void log(const char* func_name, const char* details = "") {
+        if (Logger::isEnabled()) {
+            write_log(func_name, details);
+        }
+    }
+    void write_log(const char* func_name, const char* details);
     
     // Stack operations
-    void push_to_stack(uint16_t value);
-    uint16_t pop_from_stack();
+    template <typename Timing> void push_to_stack(uint16_t value);
+    template <typename Timing> uint16_t pop_from_stack();
     
     // CB prefix handler
-    uint8_t cb_ins_handler();
+    template <typename Timing> uint8_t cb_ins_handler();
     
     // 8-bit load instructions
-    uint8_t op_ld_r_r();
-    uint8_t op_ld_r_imm();
-    uint8_t op_ld_r_hl_ind();
-    uint8_t op_ld_hl_ind_r();
-    uint8_t op_ld_hl_ind_imm();
-    uint8_t op_ld_a_bc_ind();
-    uint8_t op_ld_a_de_ind();
-    uint8_t op_ld_bc_ind_a();
-    uint8_t op_ld_de_ind_a();
-    uint8_t op_ld_a_imm_ind();
-    uint8_t op_ld_imm_ind_a();
-    uint8_t op_ldh_a_c_ind();
-    uint8_t op_ldh_c_ind_a();
-    uint8_t op_ldh_a_imm_ind();
-    uint8_t op_ldh_imm_ind_a();
-    uint8_t op_ld_a_hl_ind_dec();
-    uint8_t op_ld_hl_ind_dec_a();
-    uint8_t op_ld_a_hl_ind_inc();
-    uint8_t op_ld_hl_ind_inc_a();
+    template <typename Timing> uint8_t op_ld_r_r();
+    template <typename Timing> uint8_t op_ld_r_imm();
+    template <typename Timing> uint8_t op_ld_r_hl_ind();
+    template <typename Timing> uint8_t op_ld_hl_ind_r();
+    template <typename Timing> uint8_t op_ld_hl_ind_imm();
+    template <typename Timing> uint8_t op_ld_a_bc_ind();
+    template <typename Timing> uint8_t op_ld_a_de_ind();
+    template <typename Timing> uint8_t op_ld_bc_ind_a();
+    template <typename Timing> uint8_t op_ld_de_ind_a();
+    template <typename Timing> uint8_t op_ld_a_imm_ind();
+    template <typename Timing> uint8_t op_ld_imm_ind_a();
+    template <typename Timing> uint8_t op_ldh_a_c_ind();
+    template <typename Timing> uint8_t op_ldh_c_ind_a();
+    template <typename Timing> uint8_t op_ldh_a_imm_ind();
+    template <typename Timing> uint8_t op_ldh_imm_ind_a();
+    template <typename Timing> uint8_t op_ld_a_hl_ind_dec();
+    template <typename Timing> uint8_t op_ld_hl_ind_dec_a();
+    template <typename Timing> uint8_t op_ld_a_hl_ind_inc();
+    template <typename Timing> uint8_t op_ld_hl_ind_inc_a();
     
     // 16-bit load instructions
-    uint8_t op_ld_rr_imm();
-    uint8_t op_ld_imm_ind_sp();
-    uint8_t op_ld_sp_hl();
-    uint8_t op_push_rr();
-    uint8_t op_pop_rr();
-    uint8_t op_ld_hl_sp_e();
+    template <typename Timing> uint8_t op_ld_rr_imm();
+    template <typename Timing> uint8_t op_ld_imm_ind_sp();
+    template <typename Timing> uint8_t op_ld_sp_hl();
+    template <typename Timing> uint8_t op_push_rr();
+    template <typename Timing> uint8_t op_pop_rr();
+    template <typename Timing> uint8_t op_ld_hl_sp_e();
     
     // 8-bit arithmetic/logic
-    uint8_t op_add_r();
-    uint8_t op_add_hl_ind();
-    uint8_t op_add_imm();
-    uint8_t op_adc_r();
-    uint8_t op_adc_hl_ind();
-    uint8_t op_adc_imm();
-    uint8_t op_sub_r();
-    uint8_t op_sub_hl_ind();
-    uint8_t op_sub_imm();
-    uint8_t op_sbc_r();
-    uint8_t op_sbc_hl_ind();
-    uint8_t op_sbc_imm();
-    uint8_t op_cp_r();
-    uint8_t op_cp_hl_ind();
-    uint8_t op_cp_imm();
-    uint8_t op_inc_r();
-    uint8_t op_inc_hl_ind();
-    uint8_t op_dec_r();
-    uint8_t op_dec_hl_ind();
-    uint8_t op_and_r();
-    uint8_t op_and_hl_ind();
-    uint8_t op_and_imm();
-    uint8_t op_or_r();
-    uint8_t op_or_hl_ind();
-    uint8_t op_or_imm();
-    uint8_t op_xor_r();
-    uint8_t op_xor_hl_ind();
-    uint8_t op_xor_imm();
-    uint8_t op_ccf();
-    uint8_t op_scf();
-    uint8_t op_daa();
-    uint8_t op_cpl();
+    template <typename Timing> uint8_t op_add_r();
+    template <typename Timing> uint8_t op_add_hl_ind();
+    template <typename Timing> uint8_t op_add_imm();
+    template <typename Timing> uint8_t op_adc_r();
+    template <typename Timing> uint8_t op_adc_hl_ind();
+    template <typename Timing> uint8_t op_adc_imm();
+    template <typename Timing> uint8_t op_sub_r();
+    template <typename Timing> uint8_t op_sub_hl_ind();
+    template <typename Timing> uint8_t op_sub_imm();
+    template <typename Timing> uint8_t op_sbc_r();
+    template <typename Timing> uint8_t op_sbc_hl_ind();
+    template <typename Timing> uint8_t op_sbc_imm();
+    template <typename Timing> uint8_t op_cp_r();
+    template <typename Timing> uint8_t op_cp_hl_ind();
+    template <typename Timing> uint8_t op_cp_imm();
+    template <typename Timing> uint8_t op_inc_r();
+    template <typename Timing> uint8_t op_inc_hl_ind();
+    template <typename Timing> uint8_t op_dec_r();
+    template <typename Timing> uint8_t op_dec_hl_ind();
+    template <typename Timing> uint8_t op_and_r();
+    template <typename Timing> uint8_t op_and_hl_ind();
+    template <typename Timing> uint8_t op_and_imm();
+    template <typename Timing> uint8_t op_or_r();
+    template <typename Timing> uint8_t op_or_hl_ind();
+    template <typename Timing> uint8_t op_or_imm();
+    template <typename Timing> uint8_t op_xor_r();
+    template <typename Timing> uint8_t op_xor_hl_ind();
+    template <typename Timing> uint8_t op_xor_imm();
+    template <typename Timing> uint8_t op_ccf();
+    template <typename Timing> uint8_t op_scf();
+    template <typename Timing> uint8_t op_daa();
+    template <typename Timing> uint8_t op_cpl();
     
     // 16-bit arithmetic
-    uint8_t op_inc_rr();
-    uint8_t op_dec_rr();
-    uint8_t op_add_hl_rr();
-    uint8_t op_add_sp_e();
+    template <typename Timing> uint8_t op_inc_rr();
+    template <typename Timing> uint8_t op_dec_rr();
+    template <typename Timing> uint8_t op_add_hl_rr();
+    template <typename Timing> uint8_t op_add_sp_e();
     
     // Rotate/shift (non-CB)
-    uint8_t op_rlca();
-    uint8_t op_rrca();
-    uint8_t op_rla();
-    uint8_t op_rra();
+    template <typename Timing> uint8_t op_rlca();
+    template <typename Timing> uint8_t op_rrca();
+    template <typename Timing> uint8_t op_rla();
+    template <typename Timing> uint8_t op_rra();
 
     // CB prefix instructions
-    uint8_t op_rlc_r();
-    uint8_t op_rlc_hl_ind();
-    uint8_t op_rrc_r();
-    uint8_t op_rrc_hl_ind();
-    uint8_t op_rl_r();
-    uint8_t op_rl_hl_ind();
-    uint8_t op_rr_r();
-    uint8_t op_rr_hl_ind();
-    uint8_t op_sla_r();
-    uint8_t op_sla_hl_ind();
-    uint8_t op_sra_r();
-    uint8_t op_sra_hl_ind();
-    uint8_t op_swap_r();
-    uint8_t op_swap_hl_ind();
-    uint8_t op_srl_r();
-    uint8_t op_srl_hl_ind();
-    uint8_t op_bit_b_r();
-    uint8_t op_bit_b_hl_ind();
-    uint8_t op_res_b_r();
-    uint8_t op_res_b_hl_ind();
-    uint8_t op_set_b_r();
-    uint8_t op_set_b_hl_ind();
+    template <typename Timing> uint8_t op_rlc_r();
+    template <typename Timing> uint8_t op_rlc_hl_ind();
+    template <typename Timing> uint8_t op_rrc_r();
+    template <typename Timing> uint8_t op_rrc_hl_ind();
+    template <typename Timing> uint8_t op_rl_r();
+    template <typename Timing> uint8_t op_rl_hl_ind();
+    template <typename Timing> uint8_t op_rr_r();
+    template <typename Timing> uint8_t op_rr_hl_ind();
+    template <typename Timing> uint8_t op_sla_r();
+    template <typename Timing> uint8_t op_sla_hl_ind();
+    template <typename Timing> uint8_t op_sra_r();
+    template <typename Timing> uint8_t op_sra_hl_ind();
+    template <typename Timing> uint8_t op_swap_r();
+    template <typename Timing> uint8_t op_swap_hl_ind();
+    template <typename Timing> uint8_t op_srl_r();
+    template <typename Timing> uint8_t op_srl_hl_ind();
+    template <typename Timing> uint8_t op_bit_b_r();
+    template <typename Timing> uint8_t op_bit_b_hl_ind();
+    template <typename Timing> uint8_t op_res_b_r();
+    template <typename Timing> uint8_t op_res_b_hl_ind();
+    template <typename Timing> uint8_t op_set_b_r();
+    template <typename Timing> uint8_t op_set_b_hl_ind();
     
     // Control flow
-    uint8_t op_jp_imm();
-    uint8_t op_jp_hl();
-    uint8_t op_jp_cc_imm();
-    uint8_t op_jr_e();
-    uint8_t op_jr_cc_e();
-    uint8_t op_call_imm();
-    uint8_t op_call_cc_imm();
-    uint8_t op_ret();
-    uint8_t op_ret_cc();
-    uint8_t op_reti();
-    uint8_t op_rst_imm();
+    template <typename Timing> uint8_t op_jp_imm();
+    template <typename Timing> uint8_t op_jp_hl();
+    template <typename Timing> uint8_t op_jp_cc_imm();
+    template <typename Timing> uint8_t op_jr_e();
+    template <typename Timing> uint8_t op_jr_cc_e();
+    template <typename Timing> uint8_t op_call_imm();
+    template <typename Timing> uint8_t op_call_cc_imm();
+    template <typename Timing> uint8_t op_ret();
+    template <typename Timing> uint8_t op_ret_cc();
+    template <typename Timing> uint8_t op_reti();
+    template <typename Timing> uint8_t op_rst_imm();
     
     // Miscellaneous
-    uint8_t op_halt();
-    uint8_t op_stop();
-    uint8_t op_di();
-    uint8_t op_ei();
-    uint8_t op_nop();
+    template <typename Timing> uint8_t op_halt();
+    template <typename Timing> uint8_t op_stop();
+    template <typename Timing> uint8_t op_di();
+    template <typename Timing> uint8_t op_ei();
+    template <typename Timing> uint8_t op_nop();
 };
 
 #endif
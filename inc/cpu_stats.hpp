@@ -0,0 +1,85 @@
+#ifndef CPU_STATS_HPP_
+#define CPU_STATS_HPP_
+
+#include "constants.hpp"
+#include "constants_mmu.hpp"
+#include <csignal>
+#include <cstdint>
+#include <ostream>
+
+// Interpreter instrumentation, compiled in with `make STATS=on` (CPU_STATS).
+// Counts executions and T-cycles per base and CB opcode, data reads and
+// writes per memory region (instruction fetches are not included) and
+// serviced interrupts per source. Without CPU_STATS the CPU holds no
+// counters and none of the counting code exists.
+class CpuStats {
+public:
+    enum Region : uint8_t {
+        REGION_ROM0,
+        REGION_ROMX,
+        REGION_VRAM,
+        REGION_CART_RAM,
+        REGION_WRAM,
+        REGION_UNUSABLE,  // Echo RAM and 0xFEA0-0xFEFF
+        REGION_OAM,
+        REGION_IO,
+        REGION_HRAM,
+        REGION_IE,
+        REGION_COUNT
+    };
+    static const uint8_t INTERRUPT_SOURCES = 5;
+
+    void count_instruction(bool cb, uint8_t opcode, uint32_t cycles) {
+        executions_[cb][opcode]++;
+        cycles_[cb][opcode] += cycles;
+    }
+    void count_access(uint16_t addr, bool write) { accesses_[write][region(addr)]++; }
+    void count_interrupt(uint16_t vector) {
+        interrupts_[(vector - INTERRUPT_HANDLER_VBLANK_ADDRESS) / 8]++;
+    }
+
+    void write_report(std::ostream& out) const;
+    void reset() { *this = CpuStats(); }
+
+    // Async-signal-safe; the emulator prints a report between frames
+    static void request_report() { report_requested_ = 1; }
+    static bool take_report_request() {
+        bool requested = report_requested_ != 0;
+        report_requested_ = 0;
+        return requested;
+    }
+
+    static Region region(uint16_t addr) {
+        static const struct {
+            uint16_t last;
+            Region region;
+        } REGIONS[] = {
+            {STATIC_ROM_END, REGION_ROM0},
+            {SWITCHABLE_ROM_END, REGION_ROMX},
+            {VRAM_END, REGION_VRAM},
+            {SWITCHABLE_RAM_END, REGION_CART_RAM},
+            {INTERNAL_RAM_END, REGION_WRAM},
+            {SPRITE_ATTRIBUTES_START - 1, REGION_UNUSABLE},
+            {SPRITE_ATTRIBUTES_END, REGION_OAM},
+            {I_O_START - 1, REGION_UNUSABLE},
+            {HIGH_RAM_START - 1, REGION_IO},
+            {HIGH_RAM_END, REGION_HRAM},
+        };
+        for (const auto& entry : REGIONS) {
+            if (addr <= entry.last) {
+                return entry.region;
+            }
+        }
+        return REGION_IE;
+    }
+
+private:
+    uint64_t executions_[2][256] = {};
+    uint64_t cycles_[2][256] = {};
+    uint64_t accesses_[2][REGION_COUNT] = {};
+    uint64_t interrupts_[INTERRUPT_SOURCES] = {};
+
+    static volatile std::sig_atomic_t report_requested_;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef DEBUGGER_HPP_
+#define DEBUGGER_HPP_
+
+#include "disassembler.hpp"
+#include <csignal>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Forward declarations
+class CPU;
+class MMU;
+class SymbolTable;
+class Watchpoints;
+
+// Interactive debugger with a line-based console on stdin/stdout or on a
+// local UNIX socket (one client; not on Windows). It runs on the emulation
+// thread: the emulator hands over control between frames, or mid-frame when
+// the CPU stops at a breakpoint, and resumes when a command lets the machine
+// run again.
+//
+// Breakpoints are flagged in the CPU's block cache, so a run without any
+// costs nothing and one with them only pays a bit test per block entry.
+// Breakpoints given as BB:AAAA or as a banked symbol only stop in that bank.
+// Watchpoints stop after the instruction that accessed the watched memory.
+class Debugger {
+public:
+    // Runs one instruction with the emulator's frame bookkeeping; false once
+    // the session has ended (frame limit, test result)
+    using StepFunction = std::function<bool()>;
+    // Restores the machine as it was `frames` frames back; false if there is
+    // no such snapshot
+    using RewindFunction = std::function<bool(uint32_t frames)>;
+
+    // Listings come from `disassembler`, which takes over set_symbols() as well
+    Debugger(CPU* cpu, const MMU* mmu, Disassembler* disassembler, StepFunction step);
+    ~Debugger();
+
+    Debugger(const Debugger&) = delete;
+    Debugger& operator=(const Debugger&) = delete;
+
+    // Console on stdin/stdout, or on a socket at `path` (blocks until a client connects)
+    bool open_console();
+    bool listen(const std::string& path);
+    void set_symbols(const SymbolTable* symbols);
+    void set_watchpoints(Watchpoints* watchpoints) { watchpoints_ = watchpoints; }
+    void set_rewind(RewindFunction rewind) { rewind_ = std::move(rewind); }
+
+    // Called by the emulator between frames: true if it should hand over
+    // (stopped, Ctrl-C, or input from a socket client)
+    bool poll();
+    // The CPU stopped in front of a flagged address or after a watchpoint
+    // hit; a breakpoint for another bank lets it run on instead
+    void on_breakpoint();
+    // Reads commands until one resumes execution; false to end emulation
+    bool run_commands();
+
+    // Async-signal-safe (SIGINT); stops at the next frame
+    static void request_break() { break_requested_ = 1; }
+
+private:
+    struct Breakpoint {
+        uint32_t number;
+        uint16_t address;
+        int32_t bank;  // -1 = any bank
+    };
+
+    enum class Action {
+        Stay,
+        Resume,
+        Quit
+    };
+
+    bool read_line(std::string& line);
+    void write(const std::string& text);
+
+    Action execute(const std::string& line);
+    void detach();
+    bool run_instruction();
+    void step(uint32_t count);
+    void next();
+    void finish();
+    bool stop_requested();
+
+    void add_breakpoint(const std::string& argument);
+    void delete_breakpoint(const std::string& argument);
+    void list_breakpoints();
+    bool breakpoint_matches(uint16_t pc) const;
+
+    void add_watchpoint(const std::string& range, const std::vector<std::string>& options);
+    void delete_watchpoint(const std::string& argument);
+    void show_hits(const std::string& count);
+    bool watch_hit();
+    void rewind(const std::string& count);
+
+    void show_stop(const char* reason);
+    void show_registers();
+    void show_memory(const std::string& argument, const std::string& count);
+    void show_disassembly(const std::string& argument, const std::string& count);
+    std::string format_line(const Disassembler::Line& line, bool current) const;
+    std::string describe(uint16_t address) const;
+
+    // Address forms: hex (1234, $1234, 0x1234), BB:AAAA, register names and symbols
+    bool parse_location(const std::string& text, uint16_t& address, int32_t& bank) const;
+
+    CPU* cpu_;
+    const MMU* mmu_;
+    Disassembler* disassembler_;
+    StepFunction step_;
+    const SymbolTable* symbols_ = nullptr;
+    Watchpoints* watchpoints_ = nullptr;
+    RewindFunction rewind_;
+
+    int input_ = -1;
+    int output_ = -1;
+    bool socket_ = false;
+    std::string buffer_;  // Input not yet consumed as a line
+
+    std::vector<Breakpoint> breakpoints_;
+    uint32_t next_breakpoint_ = 1;
+    uint32_t steps_since_check_ = 0;
+    bool stopped_ = true;  // Sessions start stopped so breakpoints can be set first
+    bool attached_ = true;  // Off once the console is closed; the run then continues freely
+    bool session_over_ = false;
+    std::string last_command_;
+
+    static volatile std::sig_atomic_t break_requested_;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef DISASSEMBLER_HPP_
+#define DISASSEMBLER_HPP_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Forward declarations
+class MMU;
+class SymbolTable;
+
+// SM83 instructions as text, e.g. "LD A,($C0A0)" or "JR NZ,$0158" (relative
+// jumps show their target), rendered from the InstructionDecoder opcode
+// table. Undefined opcodes come out as "DB $D3". With a symbol table, jump,
+// call and memory operands that hit a symbol exactly show its name instead.
+//
+// Instructions are addressed by (bank, address) as symbol files number them.
+// ROM lines are decoded from the ROM image, so any bank can be listed
+// whatever is mapped now, and are cached per bank; lines anywhere else are
+// decoded from memory as it is now on every call.
+class Disassembler {
+public:
+    struct Line {
+        uint16_t bank;
+        uint16_t address;
+        uint8_t length;
+        uint8_t bytes[3];
+        std::string text;
+    };
+
+    explicit Disassembler(const MMU* mmu, const SymbolTable* symbols = nullptr);
+
+    // Changing the symbols drops the cached lines, as does flush() (e.g.
+    // after ROM bytes were patched)
+    void set_symbols(const SymbolTable* symbols);
+    void flush();
+
+    // The instruction at address as the CPU would fetch it now
+    Line decode(uint16_t address);
+    Line decode(uint16_t bank, uint16_t address);
+
+    // The name of the symbol at exactly (bank, address), or nullptr
+    const std::string* label(uint16_t bank, uint16_t address) const;
+
+    // `bytes` holds at least the instruction's length
+    std::string text(const uint8_t* bytes, uint16_t bank, uint16_t address) const;
+    static uint8_t length(uint8_t opcode);
+
+    size_t cached_lines() const { return cached_lines_; }
+
+private:
+    Line decode_line(uint16_t bank, uint16_t address) const;
+    std::string operand(char placeholder, const uint8_t* bytes, uint16_t bank, uint16_t address) const;
+    std::string address_operand(uint16_t target, uint16_t bank, uint16_t address) const;
+
+    const MMU* mmu_;
+    const SymbolTable* symbols_;
+
+    // Per ROM bank, by address
+    std::vector<std::unordered_map<uint16_t, Line>> rom_lines_;
+    size_t cached_lines_ = 0;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef FRAME_PACER_HPP_
+#define FRAME_PACER_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+enum class PacingMode {
+    RealTime,   // 59.73 Hz, matching DMG hardware
+    Multiplier, // N times real time
+    Uncapped,   // As fast as the host allows
+    Audio       // Real time as measured by the audio output clock
+};
+
+// Paces host frames against wall-clock time and keeps a frame-time histogram.
+// Waiting sleeps until shortly before the deadline and spins the rest, which
+// keeps jitter well under a millisecond without burning a full core.
+class FramePacer {
+public:
+    FramePacer();
+
+    void configure(PacingMode mode, double speed = 1.0);
+    PacingMode mode() const { return mode_; }
+
+    // Frames are only worth presenting when someone can see them at this speed
+    bool presents_frames() const {
+        return mode_ == PacingMode::RealTime || mode_ == PacingMode::Audio
+            || (mode_ == PacingMode::Multiplier && speed_ <= 1.0);
+    }
+
+    void start();
+    void frame_done();
+    // Continue from now after a pause instead of rushing to catch up
+    void resync();
+    void print_report(uint64_t emulated_frames) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr uint32_t HISTOGRAM_BUCKET_US = 10;
+    static constexpr uint32_t HISTOGRAM_BUCKETS = 20000; // 0-200 ms, last bucket is overflow
+
+    void wait_until(Clock::time_point deadline) const;
+    double percentile_us(double fraction) const;
+
+    PacingMode mode_ = PacingMode::RealTime;
+    double speed_ = 1.0;
+    Clock::duration frame_period_;
+
+    Clock::time_point start_time_;
+    Clock::time_point last_frame_;
+    Clock::time_point next_deadline_;
+
+    std::vector<uint32_t> histogram_;
+    uint64_t frames_ = 0;
+    double max_frame_us_ = 0.0;
+};
+
+#endif
@@ -1,16 +1,43 @@
 #ifndef GAME_BOY_EMULATOR_HPP_
 #define GAME_BOY_EMULATOR_HPP_
 
+#include "apu.hpp"
+#include "audio_output.hpp"
+#include "audio_ring.hpp"
+#include "cheats.hpp"
+#include "coverage.hpp"
 #include "cpu.hpp"
+#include "debugger.hpp"
+#include "disassembler.hpp"
+#include "frame_pacer.hpp"
+#include "metrics.hpp"
 #include "mmu.hpp"
+#include "ppu.hpp"
+#include "profiler.hpp"
 #include "timer.hpp"
+#include "watchpoints.hpp"
 #include "interrupt_controller.hpp"
+#include "joypad.hpp"
+#include "movie.hpp"
+#include "rewind_buffer.hpp"
+#include "scheduler.hpp"
+#include "serial.hpp"
 #include <cstdint>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
-class GameBoyEmulator {
+enum class TestResult {
+    None,
+    Passed,
+    Failed
+};
+
+class GameBoyEmulator : private InstructionClock {
 public:
-    GameBoyEmulator();
+    // Throws std::runtime_error unless `rom` passes Cartridge::is_supported()
+    explicit GameBoyEmulator(std::vector<uint8_t> rom);
     
     // Disable copy and move
     GameBoyEmulator(const GameBoyEmulator&) = delete;
@@ -18,25 +45,231 @@ public:
     GameBoyEmulator(GameBoyEmulator&&) = delete;
     GameBoyEmulator& operator=(GameBoyEmulator&&) = delete;
     
+    // Paced session on the calling thread until stopped, with the end-of-run reports
     void emulate();
-    static void setFilepath(const std::string& filepath);
-    
-    static GameBoyEmulator* getInstance();
+    // Unpaced stepping for embedders: the rest of the current frame, or at
+    // least `cycles` cycles (returns those run; fewer only if stopped, e.g.
+    // at a breakpoint). Frames started either way get their input and cheats.
+    void run_frame();
+    uint64_t run_cycles(uint64_t cycles);
+
+    // Save states
+    void save_state(std::vector<uint8_t>& buffer) const;
+    void load_state(const std::vector<uint8_t>& buffer);
+
+    // Rewind keeps one snapshot per frame for the last `seconds` seconds;
+    // rewind() returns to the start of the frame `frames` frames back, or the
+    // oldest one kept, and is false if there is none
+    void enable_rewind(uint32_t seconds = REWIND_SECONDS, size_t arena_bytes = REWIND_ARENA_BYTES);
+    void disable_rewind();
+    bool rewind(uint32_t frames);
+
+    // Run-ahead: each host frame runs `frames` speculative frames before the real one
+    void set_run_ahead(uint32_t frames);
+    void run_host_frame();
+    void print_run_ahead_stats() const;
+    void print_rewind_stats() const;
+
+    // Input, JOYPAD_BUTTON_* mask with 1 = pressed
+    void set_buttons(uint8_t buttons);
+    // Hold `buttons` from the start of frame `frame` (counted from power-on)
+    // until a later scheduled change; a recording movie sees them
+    void schedule_buttons(uint64_t frame, uint8_t buttons) { scheduled_buttons_[frame] = buttons; }
+
+    // Memory as the CPU sees it, without reporting to watchpoints; writes go
+    // where a CPU write would (ROM addresses reach the MBC)
+    uint8_t peek_memory(uint16_t addr) const { return mmu_.peek_memory_8(addr); }
+    void poke_memory(uint16_t addr, uint8_t val) { mmu_.poke_memory_8(addr, val); }
+
+    // Movies record or replay one input mask per frame from power-on
+    bool start_movie_recording(const std::string& path);
+    bool start_movie_playback(const std::string& path);
+    void set_frame_limit(uint64_t frames) { frame_limit_ = frames; }
+    uint64_t state_hash() const;
+
+    // Host-side totals, not part of the saved state. Instructions exclude HALT
+    // idle steps; the cycle counter wraps at 2^32.
+    uint64_t instructions_executed() const { return cpu_.instructions() + cpu_.jit().native_instructions(); }
+    uint32_t cycles_executed() const { return cycles_executed_; }
+
+    // Live counters for a MetricsPublisher, updated by emulate() once per frame
+    // and with the current phase only while enabled
+    void set_metrics_enabled(bool enabled) { metrics_enabled_ = enabled; }
+    const ThreadMetrics& metrics() const { return metrics_; }
+
+    // Execute from pre-decoded blocks (default) or decode every instruction
+    void set_block_cache(bool enabled) { cpu_.set_block_cache_enabled(enabled); }
+
+    // Translate hot blocks to native code; verify replays each native run
+    // in the interpreter and stops on the first difference
+    bool set_jit(bool enabled, bool verify = false) {
+        return (!enabled || !watchpoints_) && cpu_.set_jit_enabled(enabled, verify);
+    }
+    // False if the host has no JIT backend at all, whatever the configuration
+    bool jit_available() const { return cpu_.jit().available(); }
+
+    // Advance timer, PPU and scheduler at every memory access instead of after
+    // each instruction (slower; needed by the mem_timing style tests)
+    void set_exact_timing(bool exact) { cpu_.set_exact_timing(exact, this); }
+
+#ifdef CPU_STATS
+    const CpuStats& cpu_stats() const { return cpu_.stats(); }
+#endif
+
+    // Sample the guest PC every `interval` cycles; with call stacks, CALL/RET
+    // are tracked too and the JIT is turned off
+    void start_profiler(uint32_t interval, bool call_stacks);
+    const Profiler* profiler() const { return profiler_.get(); }
+
+    // Per-byte ROM coverage (executed as opcode/operand, read as data) from
+    // now on; the JIT is turned off
+    void start_coverage();
+    const Coverage* coverage() const { return coverage_.get(); }
+
+    // Shared by the debugger and reports, so each ROM line is decoded once
+    Disassembler& disassembler() { return disassembler_; }
+
+    // Interactive debugger on stdin/stdout, or on UNIX socket `socket_path`
+    // (waits for a client). Emulation starts stopped; while it is attached the
+    // JIT and the threaded frame loop are off. `symbols` has to outlive it.
+    bool start_debugger(const std::string& socket_path, const SymbolTable* symbols);
+
+    // Memory watchpoints, created on first use. Translated code accesses RAM
+    // directly, so the JIT stays off from then on.
+    Watchpoints& watchpoints();
+    bool has_watchpoints() const { return watchpoints_ != nullptr; }
+
+    // Game Genie and GameShark codes, created on first use. RAM writes are
+    // applied at the start of every frame, speculative ones included.
+    Cheats& cheats();
+
+    // Wall-clock pacing of host frames
+    void set_pacing(PacingMode mode, double speed = 1.0);
+    bool presents_frames() const { return present_frames_ && !speculative_; }
+
+    // Compose every `interval`th frame while presenting (0 = only on demand)
+    void set_render_interval(uint32_t interval);
+    const uint8_t* framebuffer() const { return ppu_.framebuffer(); }
+    uint64_t frame_hash() const;
+
+    // Bytes sent over the link port; with stop-on-result the run ends as soon
+    // as a blargg-style "Passed" or "Failed" appears
+    const std::string& serial_output() const { return serial_.output(); }
+    void set_stop_on_test_result(bool stop) { stop_on_test_result_ = stop; }
+    TestResult test_result() const { return test_result_; }
+
+    // Plug one end of a link cable into the serial port. Each linked emulator
+    // runs emulate() on its own thread; when either session ends the cable
+    // disconnects and the other one stops at its next frame. Run-ahead and
+    // rewind are not supported while linked.
+    void connect_link(LinkPort* link) { serial_.connect_link(link); }
+
+    // Audio is produced only while a sink is attached; the sink runs on its own
+    // thread at HOST_SAMPLE_RATE. A real-time sink is clocked like a sound device
+    // (and can pace emulation with PacingMode::Audio); an offline sink receives
+    // every sample and emulation waits for it instead of dropping audio.
+    void start_audio(std::unique_ptr<AudioSink> sink, bool realtime);
+    void stop_audio();
+    // Without a sink the caller drains the APU's stereo frames itself, at
+    // APU_SAMPLE_RATE; up to AUDIO_RING_FRAMES are kept, later ones dropped.
+    // stop_audio() ends either.
+    void start_audio_capture();
+    size_t read_audio(int16_t* frames, size_t count) { return audio_ring_.pop(frames, count); }
 
 private:
+    void apply_frame_input();
+    void update_render_interval();
+    void finish_session();
+    void wait_for_audio();
+    void check_test_result();
+    void end_frame();
+    bool debug_step();
+    void enter_debugger();
+
+    void record_frame_metrics(std::chrono::steady_clock::duration time);
+    void set_phase(ThreadMetrics::Phase phase) {
+        if (metrics_enabled_) {
+            metrics_.set_phase(phase);
+        }
+    }
+
+    uint32_t step();
+    uint32_t native_budget() const;
+
+    // Threaded builds run whole frames inside CPU::run(), which calls tick()
+    // after each instruction; exact timing advances the components per M-cycle
+    bool tick(uint32_t cycles) override;
+    void advance(uint32_t cycles) override;
+    bool frame_complete_ = false;
+
     // Components (order matters for initialization!)
     InterruptController interrupt_controller_;
+    Scheduler scheduler_;
+    Timer timer_;
+    Joypad joypad_;
+    Serial serial_;
+    PPU ppu_;
+    APU apu_;
     MMU mmu_;
     CPU cpu_;
-    Timer timer_;
     
     // State
     bool stop_cpu_ = false;
-    bool stop_gpu_ = false;
     uint32_t cycles_executed_ = 0;
-    static std::string filepath_;
-    
-    static GameBoyEmulator* instance_;
+    uint32_t frame_cycles_ = 0;
+    uint64_t frames_executed_ = 0;
+    uint64_t frame_limit_ = 0;  // 0 = run until stopped
+    uint64_t total_cycles_ = 0;  // Completed frames, never restored by a state load
+
+    // Rewind
+    std::unique_ptr<RewindBuffer> rewind_buffer_;
+    std::vector<uint8_t> rewind_state_;
+    uint64_t rewind_captures_ = 0;
+    double rewind_total_us_ = 0.0;
+    double rewind_max_us_ = 0.0;
+
+    // Pacing
+    FramePacer pacer_;
+    bool present_frames_ = true;  // Off when frames go by too fast to be seen
+    uint32_t render_interval_ = 1;
+
+    // Run-ahead
+    uint32_t run_ahead_frames_ = 0;
+    bool speculative_ = false;  // Suppresses rewind capture and presentation side effects
+    std::vector<uint8_t> run_ahead_state_;
+    uint64_t run_ahead_host_frames_ = 0;
+    double run_ahead_total_us_ = 0.0;
+    double run_ahead_max_us_ = 0.0;
+
+    // Test harness
+    bool stop_on_test_result_ = false;
+    TestResult test_result_ = TestResult::None;
+    size_t serial_scanned_ = 0;
+
+    // Audio
+    AudioRing audio_ring_;
+    std::unique_ptr<AudioOutput> audio_output_;
+
+    // Host metrics
+    ThreadMetrics metrics_;
+    bool metrics_enabled_ = false;
+
+    // Profiling
+    std::unique_ptr<Profiler> profiler_;
+    uint32_t profiler_interval_ = Profiler::DEFAULT_INTERVAL;
+    std::unique_ptr<Coverage> coverage_;
+
+    // Debugging
+    Disassembler disassembler_{&mmu_};
+    std::unique_ptr<Debugger> debugger_;
+    std::unique_ptr<Watchpoints> watchpoints_;
+    std::unique_ptr<Cheats> cheats_;
+
+    // Input movie and scripted input, by first frame
+    std::map<uint64_t, uint8_t> scheduled_buttons_;
+    std::unique_ptr<Movie> movie_;
+    std::string movie_path_;
+    bool movie_recording_ = false;
 };
 
 #endif
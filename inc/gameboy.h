@@ -0,0 +1,71 @@
+#ifndef GAMEBOY_H_
+#define GAMEBOY_H_
+
+/* C interface of libgameboy, for callers that are not C++ or need a stable
+ * ABI; the same operations as the GameBoy class in gameboy.hpp. Functions
+ * that return int give 0 on success and -1 on failure, those returning a
+ * count give 0 on failure; either way the reason is in gb_error(). The const
+ * accessors cannot fail. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GB_SCREEN_WIDTH 160
+#define GB_SCREEN_HEIGHT 144
+#define GB_CYCLES_PER_FRAME 70224
+#define GB_AUDIO_SAMPLE_RATE 65536
+
+#define GB_BUTTON_RIGHT 0x01
+#define GB_BUTTON_LEFT 0x02
+#define GB_BUTTON_UP 0x04
+#define GB_BUTTON_DOWN 0x08
+#define GB_BUTTON_A 0x10
+#define GB_BUTTON_B 0x20
+#define GB_BUTTON_SELECT 0x40
+#define GB_BUTTON_START 0x80
+
+typedef struct gb_instance gb_instance;
+
+/* Copies the ROM; NULL if it is too small, needs an MBC this core lacks or
+ * memory runs out */
+gb_instance* gb_create(const uint8_t* rom, size_t size);
+void gb_destroy(gb_instance* gb);
+
+/* Why the last call on gb failed, or NULL */
+const char* gb_error(const gb_instance* gb);
+
+/* A game executing an undefined opcode fails them; load a state to go on.
+ * gb_run_cycles returns the cycles run, at least `cycles` unless it failed. */
+int gb_run_frame(gb_instance* gb);
+uint64_t gb_run_cycles(gb_instance* gb, uint64_t cycles);
+
+int gb_set_buttons(gb_instance* gb, uint8_t buttons);
+
+/* GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT shades, 0 (white) to 3 (black) */
+const uint8_t* gb_framebuffer(const gb_instance* gb);
+
+/* Interleaved stereo frames at GB_AUDIO_SAMPLE_RATE, off until enabled */
+int gb_set_audio_enabled(gb_instance* gb, int enabled);
+size_t gb_read_audio(gb_instance* gb, int16_t* frames, size_t max_frames);
+
+/* Returns the state's size, and copies it only if it fits in `size` bytes */
+size_t gb_save_state(gb_instance* gb, uint8_t* buffer, size_t size);
+int gb_load_state(gb_instance* gb, const uint8_t* data, size_t size);
+
+/* Per-frame snapshots of the last `seconds` seconds (0 = off); gb_rewind goes
+ * back `frames` frames, or as far as it can, and fails if it cannot at all */
+int gb_set_rewind(gb_instance* gb, uint32_t seconds);
+int gb_rewind(gb_instance* gb, uint32_t frames);
+
+uint8_t gb_peek(const gb_instance* gb, uint16_t address);
+int gb_poke(gb_instance* gb, uint16_t address, uint8_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef GAMEBOY_HPP_
+#define GAMEBOY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Forward declarations
+class AudioSink;
+class Cheats;
+class Coverage;
+class CpuStats;
+class Disassembler;
+class GameBoyEmulator;
+class LinkPort;
+class Profiler;
+class SymbolTable;
+class ThreadMetrics;
+class Watchpoints;
+enum class PacingMode;
+
+// Embedding API of libgameboy: one emulated DMG that the caller steps on its
+// own thread, with no pacing, no threads of its own and no console output.
+// Instances share nothing, so a service can run many of them in one process,
+// each on one thread at a time.
+//
+// Front ends get the rest of the machine here too (paced sessions, debugger,
+// profiler, coverage, cheats, movies, link cable), as the gameboy CLI does.
+class GameBoy {
+public:
+    static const uint32_t SCREEN_WIDTH = 160;
+    static const uint32_t SCREEN_HEIGHT = 144;
+    static const uint32_t CYCLES_PER_FRAME = 70224;
+    static const uint32_t AUDIO_SAMPLE_RATE = 65536;
+
+    // set_buttons() bits, 1 = pressed
+    enum Button : uint8_t {
+        BUTTON_RIGHT = 0x01,
+        BUTTON_LEFT = 0x02,
+        BUTTON_UP = 0x04,
+        BUTTON_DOWN = 0x08,
+        BUTTON_A = 0x10,
+        BUTTON_B = 0x20,
+        BUTTON_SELECT = 0x40,
+        BUTTON_START = 0x80
+    };
+
+    // test_result() of a blargg-style test ROM
+    enum TestResult : uint8_t {
+        TEST_NONE,
+        TEST_PASSED,
+        TEST_FAILED
+    };
+
+    // nullptr if the image is too small or needs an MBC this core lacks
+    static std::unique_ptr<GameBoy> create(const uint8_t* rom, size_t size);
+    static std::unique_ptr<GameBoy> create(std::vector<uint8_t> rom);
+    ~GameBoy();
+
+    GameBoy(const GameBoy&) = delete;
+    GameBoy& operator=(const GameBoy&) = delete;
+
+    // The rest of the current frame, or at least `cycles` cycles (returns
+    // the cycles run). A game executing an undefined opcode throws
+    // std::runtime_error; load a state to go on.
+    void run_frame();
+    uint64_t run_cycles(uint64_t cycles);
+
+    // Read by the game from the next frame on
+    void set_buttons(uint8_t buttons);
+    // Hold `buttons` from the start of frame `frame` (counted from power-on)
+    // until a later scheduled change
+    void schedule_buttons(uint64_t frame, uint8_t buttons);
+
+    // One shade per pixel, 0 (white) to 3 (black), row by row; the pointer
+    // stays valid for the lifetime of the instance
+    const uint8_t* framebuffer() const;
+
+    // Audio is off until enabled. Stereo int16 frames, interleaved, at
+    // AUDIO_SAMPLE_RATE; about a quarter second is kept between reads and
+    // anything beyond it is dropped.
+    void set_audio_enabled(bool enabled);
+    size_t read_audio(int16_t* frames, size_t max_frames);
+
+    void save_state(std::vector<uint8_t>& state) const;
+    // False, with the machine unchanged, if the state is truncated, has bytes
+    // left over or is from another version
+    bool load_state(const uint8_t* data, size_t size);
+
+    // Keep a snapshot of every frame for the last `seconds` seconds (0 = off).
+    // rewind() goes back to the start of the frame `frames` frames ago, or the
+    // oldest one kept; false if there is none.
+    void set_rewind(uint32_t seconds);
+    bool rewind(uint32_t frames);
+
+    // As the CPU sees memory, bypassing watchpoints; ROM writes reach the MBC
+    uint8_t peek(uint16_t address) const;
+    void poke(uint16_t address, uint8_t value);
+
+    // Front-end sessions: emulate() runs paced frames on the calling thread
+    // until the frame limit, the test result, the debugger or the link cable
+    // ends it, then prints its reports. Configure before starting it.
+    void emulate();
+    void set_pacing(PacingMode mode, double speed = 1.0);
+    void set_frame_limit(uint64_t frames);
+    void set_run_ahead(uint32_t frames);
+    // Compose every `interval`th frame while presenting (0 = only on demand)
+    void set_render_interval(uint32_t interval);
+
+    // Audio through a sink on its own thread instead of read_audio(); a
+    // real-time sink can pace emulation with PacingMode::Audio
+    void start_audio(std::unique_ptr<AudioSink> sink, bool realtime);
+
+    // Execution engines. set_jit() is false, interpreting, when the host,
+    // the build or the tools in use rule the JIT out.
+    void set_block_cache(bool enabled);
+    void set_exact_timing(bool exact);
+    bool set_jit(bool enabled, bool verify = false);
+    bool jit_available() const;
+
+    // Tools, see GameBoyEmulator for what each one costs
+    bool start_debugger(const std::string& socket_path, const SymbolTable* symbols);
+    void start_profiler(uint32_t interval, bool call_stacks);
+    const Profiler* profiler() const;
+    void start_coverage();
+    const Coverage* coverage() const;
+    Disassembler& disassembler();
+    Watchpoints& watchpoints();
+    Cheats& cheats();
+#ifdef CPU_STATS
+    const CpuStats& cpu_stats() const;
+#endif
+
+    // Movies record or replay one input mask per frame from power-on
+    bool start_movie_recording(const std::string& path);
+    bool start_movie_playback(const std::string& path);
+
+    // Host counters for a MetricsPublisher, kept only while enabled
+    void set_metrics_enabled(bool enabled);
+    const ThreadMetrics& metrics() const;
+
+    // Plug one end of a link cable into the serial port; each linked
+    // instance runs emulate() on its own thread
+    void connect_link(LinkPort* link);
+
+    // Bytes sent over the link port; with stop-on-result the session ends as
+    // soon as a test ROM reports
+    const std::string& serial_output() const;
+    void set_stop_on_test_result(bool stop);
+    TestResult test_result() const;
+
+private:
+    explicit GameBoy(std::unique_ptr<GameBoyEmulator> emulator);
+
+    std::unique_ptr<GameBoyEmulator> emulator_;
+};
+
+#endif
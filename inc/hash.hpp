@@ -0,0 +1,19 @@
+#ifndef HASH_HPP_
+#define HASH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+static const uint64_t FNV1A_64_OFFSET = 0xCBF29CE484222325ULL;
+static const uint64_t FNV1A_64_PRIME = 0x00000100000001B3ULL;
+
+// 64-bit FNV-1a, chainable by passing the previous hash as the seed
+inline uint64_t fnv1a_64(const uint8_t* data, size_t size, uint64_t hash = FNV1A_64_OFFSET) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= FNV1A_64_PRIME;
+    }
+    return hash;
+}
+
+#endif
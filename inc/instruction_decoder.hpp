@@ -1,39 +1,32 @@
 #ifndef INSTRUCTION_DECODER_HPP_
 #define INSTRUCTION_DECODER_HPP_
 
-#include <cstddef>
 #include <cstdint>
 
-// Forward declaration
-class CPU;
-
 class InstructionDecoder {
 public:
-    // Op struct for instruction pattern matching
-    struct Op {
-        uint8_t mask;
-        uint8_t pattern;
-
-        Op(uint8_t m, uint8_t p) : mask(m), pattern(p) {}
-
-        bool operator==(const Op& other) const {
-            return mask == other.mask && pattern == other.pattern;
-        }
+    // One entry per base opcode, built at compile time from its assembler
+    // format; the lengths and block ends below are derived from the formats,
+    // so decoding and disassembly cannot disagree. Placeholders:
+    //   %b byte  %w word  %h $FF00+byte  %r relative jump target  %s signed byte
+    //   %d / %z  register from bits 3-5 / 0-2 (B C D E H L (HL) A)
+    //   %n       bit number from bits 3-5
+    //   %p       padding byte, not shown (STOP)
+    //   %c       CB-prefixed instruction, see cbFormat()
+    struct Opcode {
+        const char* format;  // nullptr = undefined opcode
+        uint8_t operand_bytes;
+        bool ends_block;
     };
 
-    // Hash function for Op struct (for use in unordered_map)
-    struct OpHash {
-        std::size_t operator()(const Op& op) const {
-            return (static_cast<std::size_t>(op.mask) << 8) | op.pattern;
-        }
-    };
+    static const Opcode& info(uint8_t opcode);
+    // Format of the instruction CB `opcode`, with %d/%z/%n taken from `opcode`
+    static const char* cbFormat(uint8_t opcode);
 
-    // Initialize and register all instruction handlers
-    static void initializeHandlers(CPU* cpu);
-    
-private:
-    static void registerInstructions(CPU* cpu);
-    static void registerCbInstructions(CPU* cpu);
+    // Static properties of base opcodes, used when pre-decoding blocks
+    static uint8_t operandBytes(uint8_t opcode) { return info(opcode).operand_bytes; }
+    static bool endsBlock(uint8_t opcode) { return info(opcode).ends_block; }  // Control flow, HALT/STOP and undefined opcodes
+    static bool isDefined(uint8_t opcode) { return info(opcode).format != nullptr; }
 };
 
 #endif
@@ -4,6 +4,9 @@
 #include "constants.hpp"
 #include <cstdint>
 
+class StateWriter;
+class StateReader;
+
 class InterruptController {
 public:
     InterruptController();
@@ -13,6 +16,10 @@ public:
     void write_interrupt(uint16_t address, uint8_t value);
     uint8_t read_interrupt(uint16_t address) const;
     uint16_t get_address_of_highest_priority_interrupt();
+    bool has_pending_interrupt() const { return (ie_ & if_ & 0x1F) != 0; }
+
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
 
 private:
     uint8_t ie_ = 0;  // Interrupt Enable register
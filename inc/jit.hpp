@@ -0,0 +1,130 @@
+#ifndef JIT_HPP_
+#define JIT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Forward declarations
+class CPU;
+class MMU;
+
+// Optional x86-64 translator for hot blocks. A block (same boundaries as the
+// BlockCache's, or a prefix of one) is compiled once it has been entered
+// JIT_HOT_THRESHOLD times; A, BC, DE, HL and SP live in host registers while
+// it runs and each flag is only computed when a later instruction, an exit or
+// the block end can observe it.
+//
+// ROM blocks are keyed by ROM offset like the BlockCache's. Work and high RAM
+// blocks are only translated where the BlockCache holds a block, so the same
+// code-page bitmap guards them and the cache drops their translations along
+// with its own blocks.
+//
+// Native code touches work RAM and high RAM directly and reads ROM through the
+// MMU. Any other access (I/O, VRAM, cartridge RAM, OAM, a write to a cached
+// code page or to the MBC) leaves the block before that instruction, with the
+// CPU state exact, and the interpreter takes over. EI, DI, RETI, HALT, STOP,
+// DAA and the SP-relative arithmetic are never compiled.
+//
+// The caller passes the number of cycles until the next event any component
+// could raise; a block only runs if all of its instructions start before that
+// deadline, so timer, PPU and scheduler events land exactly where the
+// interpreter would put them.
+//
+// In verify mode every native run is replayed by the interpreter from the
+// same starting state and the two results must match.
+//
+// Nothing is allocated until the JIT is first enabled. The code buffer is
+// never writable and executable at once: the pages a block is emitted into
+// are made writable for the copy and executable again before it runs.
+class Jit {
+public:
+    static const uint8_t JIT_HOT_THRESHOLD = 32;
+
+    Jit(CPU* cpu, MMU* mmu);
+    ~Jit();
+
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    // False when the host has no backend
+    bool available() const;
+    // Maps the code buffer and block indexes on first use; false if the host
+    // has no backend or executable memory is unavailable
+    bool allocate();
+
+    // Runs native code at the CPU's PC; returns the cycles taken, 0 if nothing ran
+    uint32_t run(uint32_t budget);
+
+    // Drop all compiled code (e.g. ROM contents changed)
+    void flush();
+
+    // Called by the BlockCache when it drops RAM blocks
+    void invalidate_ram(uint16_t start);
+    void flush_ram();
+
+    void set_verify(bool verify) { verify_ = verify; }
+
+    size_t compiled_blocks() const { return blocks_.size(); }
+    uint64_t native_runs() const { return native_runs_; }
+    uint64_t native_instructions() const { return native_instructions_; }
+    uint64_t side_exits() const { return side_exits_; }
+
+    // Register file and memory handles shared with native code
+    struct Context {
+        uint32_t a;
+        uint32_t f;
+        uint32_t bc;
+        uint32_t de;
+        uint32_t hl;
+        uint32_t sp;
+        uint32_t pc;
+        uint32_t instructions;  // Completed by the last run
+        uint32_t side_exit;     // The last run left before a memory access it cannot do
+        uint8_t* wram;
+        uint8_t* hram;
+        const uint64_t* code_pages;
+        MMU* mmu;
+        uint8_t (*read)(MMU* mmu, uint32_t addr);
+        uint8_t flag_table[256];  // LAHF image (SF ZF 0 AF 0 PF 1 CF) -> Z H C
+    };
+
+private:
+    using NativeBlock = uint32_t (*)(Context* context);
+
+    struct Block {
+        NativeBlock entry;
+        uint16_t last_start;  // Cycles before the last instruction starts
+    };
+
+    uint32_t compile(uint16_t pc, uint32_t limit);
+    uint32_t verify(uint32_t cycles);
+
+    CPU* cpu_;
+    MMU* mmu_;
+    Context context_ = {};
+    bool verify_ = false;
+
+    // Index by ROM offset or by address - 0x8000 for RAM; entries are block
+    // id + 1, or NOT_COMPILABLE
+    std::vector<uint32_t> index_;
+    std::vector<uint8_t> heat_;
+    std::vector<uint32_t> ram_index_;
+    std::vector<uint8_t> ram_heat_;
+    std::vector<Block> blocks_;
+
+    uint8_t* code_ = nullptr;
+    size_t code_used_ = 0;
+
+    uint64_t native_runs_ = 0;
+    uint64_t native_instructions_ = 0;
+    uint64_t side_exits_ = 0;
+
+    // Interpreter snapshot for verify mode
+    std::vector<uint8_t> saved_wram_;
+    std::vector<uint8_t> saved_hram_;
+    std::vector<uint8_t> native_wram_;
+    std::vector<uint8_t> native_hram_;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef JOYPAD_HPP_
+#define JOYPAD_HPP_
+
+#include "constants.hpp"
+#include <cstdint>
+
+// Forward declaration
+class InterruptController;
+class StateWriter;
+class StateReader;
+
+class Joypad {
+public:
+    explicit Joypad(InterruptController* interrupt_controller);
+
+    // Buttons use the JOYPAD_BUTTON_* bit layout, 1 = pressed
+    void set_buttons(uint8_t buttons);
+    uint8_t get_buttons() const { return buttons_; }
+
+    void write_joypad(uint8_t value);
+    uint8_t read_joypad() const;
+
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
+
+private:
+    uint8_t selected_lines() const;
+
+    InterruptController* interrupt_controller_;
+
+    uint8_t select_ = 0x30;  // P14/P15, active low
+    uint8_t buttons_ = 0x00;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef LINK_PORT_HPP_
+#define LINK_PORT_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+// One end of a link cable between two emulators that run on their own threads
+// (or in separate processes). The two sides never lock per cycle: each one
+// publishes its scheduler clock at sync points (frame ends and serial transfer
+// boundaries) and only waits when it would otherwise get more than
+// LINK_MAX_SKEW_CYCLES ahead of its partner. A transfer is the one exact
+// barrier: the clocking side waits until its partner has reached the transfer
+// time and has processed every earlier transfer before it reads the partner's
+// outgoing byte. The clock is published together with a count of transfers
+// received, so a partner that ran ahead cannot be mistaken for one that has
+// already reacted to the previous byte.
+//
+// All public calls are made from the owning emulator's thread. Transports only
+// implement the send_* hooks and feed the partner's messages to the on_peer_*
+// functions, from any thread.
+class LinkPort {
+public:
+    static const int NOT_READY = -1;
+
+    virtual ~LinkPort() = default;
+
+    // Publish the local clock and throttle if too far ahead of the partner
+    void sync(uint64_t now);
+
+    // Internal-clock side: shift `byte` out at time `now` and return the byte
+    // shifted in (0xFF if the partner was not waiting for a transfer)
+    uint8_t clock_out(uint8_t byte, uint64_t now);
+
+    // External-clock side: offer `byte` to the partner's next transfer, or
+    // NOT_READY to withdraw it
+    void set_ready(int byte);
+
+    // External-clock side: true once the partner has clocked a transfer
+    // that is due by `now`; `byte` is what it shifted in
+    bool receive(uint64_t now, uint8_t& byte);
+
+    void disconnect();
+    bool connected() const { return connected_.load(std::memory_order_acquire); }
+
+    uint64_t transfers() const { return transfers_; }
+    uint64_t waits() const { return waits_; }
+    double wait_ms() const { return wait_us_ / 1000.0; }
+
+protected:
+    LinkPort() = default;
+
+    // Stamps are clock << 16 | transfers received (mod 2^16)
+    virtual void send_clock(uint64_t stamp) = 0;
+    virtual void send_ready(int byte) = 0;
+    virtual void send_data(uint8_t byte, uint64_t time) = 0;
+    virtual void send_disconnect() = 0;
+
+    void on_peer_clock(uint64_t stamp) { peer_stamp_.store(stamp, std::memory_order_release); }
+    void on_peer_ready(int byte) { peer_ready_.store(byte, std::memory_order_release); }
+    void on_peer_data(uint8_t byte, uint64_t time);
+    void on_peer_disconnect() { connected_.store(false, std::memory_order_release); }
+
+private:
+    template <typename Ready>
+    void wait_until(uint64_t now, Ready ready);
+    void publish_clock(uint64_t now);
+    bool discard_unwanted_data();
+
+    // Partner state as last published
+    std::atomic<uint64_t> peer_stamp_{0};
+    std::atomic<int> peer_ready_{NOT_READY};
+    std::atomic<uint64_t> inbox_{0};  // time << 9 | valid << 8 | byte, 0 = empty
+    std::atomic<bool> connected_{true};
+
+    // Local state, owning thread only
+    uint64_t published_stamp_ = UINT64_MAX;
+    int ready_ = NOT_READY;
+    uint16_t received_count_ = 0;
+    uint16_t sent_count_ = 0;
+    uint64_t transfers_ = 0;
+    uint64_t waits_ = 0;
+    double wait_us_ = 0.0;
+};
+
+// Two linked ports for emulators in the same process
+class LinkCable {
+public:
+    LinkCable();
+
+    LinkCable(const LinkCable&) = delete;
+    LinkCable& operator=(const LinkCable&) = delete;
+
+    LinkPort* port(int side) { return &ends_[side]; }
+
+private:
+    class End : public LinkPort {
+    public:
+        End* peer = nullptr;
+
+    protected:
+        void send_clock(uint64_t stamp) override { peer->on_peer_clock(stamp); }
+        void send_ready(int byte) override { peer->on_peer_ready(byte); }
+        void send_data(uint8_t byte, uint64_t time) override { peer->on_peer_data(byte, time); }
+        void send_disconnect() override { peer->on_peer_disconnect(); }
+    };
+
+    End ends_[2];
+};
+
+#endif
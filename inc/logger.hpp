@@ -13,7 +13,7 @@ private:
 public:
     static void init(bool enable, const std::string& filename = "cpu_log.txt");
     static void close();
-    static bool isEnabled();
+    static bool isEnabled() { return enabled; }
     static void log(const std::string& func_name, uint8_t opcode,
                     uint16_t AF, uint16_t BC, uint16_t DE, uint16_t HL,
                     uint16_t SP, uint16_t PC, bool IME,
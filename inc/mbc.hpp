@@ -1,6 +1,7 @@
 #ifndef _MBC_HPP_
 #define _MBC_HPP_
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <iostream>
@@ -8,11 +9,19 @@
 
 using namespace std;
 
+class StateWriter;
+class StateReader;
+
 class MBC {
 public:
     virtual ~MBC() = default;
     virtual uint8_t read(uint16_t addr) = 0;
     virtual void write(uint16_t addr, uint8_t val) = 0;
+    // Offset into the ROM image currently mapped at addr (0x0000-0x7FFF),
+    // or SIZE_MAX if it lies past the end of the image
+    virtual size_t rom_offset(uint16_t addr) const = 0;
+    virtual void save_state(StateWriter& writer) const = 0;
+    virtual void load_state(StateReader& reader) = 0;
 };
 
 class MBC0 : public MBC {
@@ -20,6 +29,9 @@ public:
     MBC0(vector<uint8_t>& rom, vector<uint8_t>& ram);
     uint8_t read(uint16_t addr);
     void write(uint16_t addr, uint8_t val);
+    size_t rom_offset(uint16_t addr) const;
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
 private:
     vector<uint8_t> rom;
     vector<uint8_t> ram;
@@ -30,6 +42,9 @@ public:
     MBC1(vector<uint8_t>& rom, vector<uint8_t>& ram);
     uint8_t read(uint16_t addr);
     void write(uint16_t addr, uint8_t val);
+    size_t rom_offset(uint16_t addr) const;
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
 private:
     vector<uint8_t> rom;
     vector<uint8_t> ram;
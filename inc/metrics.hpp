@@ -0,0 +1,125 @@
+#ifndef METRICS_HPP_
+#define METRICS_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Counters one emulator thread keeps for the MetricsPublisher. Only the owning
+// thread writes them, with relaxed stores and no read-modify-write, and the
+// publisher only reads them, so neither side ever waits for the other.
+//
+// The phase says which part of the machine the thread is running right now;
+// the publisher samples it to split wall time between components without any
+// timing code on the emulation path.
+class ThreadMetrics {
+public:
+    enum Phase : uint8_t {
+        PHASE_HOST,       // Pacing, audio waits, presentation
+        PHASE_CPU,        // Instructions, including I/O they perform
+        PHASE_TIMER,
+        PHASE_PPU,
+        PHASE_APU,        // Scheduled APU catch-up
+        PHASE_SCHEDULER,  // Other scheduled events
+        PHASE_COUNT
+    };
+
+    // Host frame time buckets: upper bounds in microseconds, the last one open
+    static constexpr std::array<uint32_t, 9> FRAME_TIME_BOUNDS_US = {
+        500, 1000, 2000, 4000, 8000, 16000, 33000, 66000, UINT32_MAX
+    };
+
+    struct Totals {
+        uint64_t instructions;
+        uint64_t cycles;
+        uint64_t halted_cycles;
+        uint64_t native_instructions;
+        uint64_t block_lookups;
+        uint64_t block_misses;
+        uint64_t jit_side_exits;
+    };
+
+    void set_phase(Phase phase) { phase_.store(phase, std::memory_order_relaxed); }
+    Phase phase() const { return static_cast<Phase>(phase_.load(std::memory_order_relaxed)); }
+
+    void record_frame(std::chrono::steady_clock::duration time, const Totals& totals);
+
+    uint64_t frames() const { return frames_.load(std::memory_order_acquire); }
+    uint64_t frame_time_us() const { return frame_time_us_.load(std::memory_order_relaxed); }
+    uint64_t frame_time_bucket(size_t bucket) const { return frame_times_[bucket].load(std::memory_order_relaxed); }
+    Totals totals() const;
+
+private:
+    static void bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint8_t> phase_{PHASE_HOST};
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> frame_time_us_{0};
+    std::array<std::atomic<uint64_t>, FRAME_TIME_BOUNDS_US.size()> frame_times_ = {};
+
+    std::atomic<uint64_t> instructions_{0};
+    std::atomic<uint64_t> cycles_{0};
+    std::atomic<uint64_t> halted_cycles_{0};
+    std::atomic<uint64_t> native_instructions_{0};
+    std::atomic<uint64_t> block_lookups_{0};
+    std::atomic<uint64_t> block_misses_{0};
+    std::atomic<uint64_t> jit_side_exits_{0};
+};
+
+// Aggregates the ThreadMetrics of every attached emulator on its own thread
+// and publishes a JSON snapshot every second, either by rewriting a file
+// (replaced atomically) or on a UNIX socket that sends the latest snapshot to
+// each client that connects.
+class MetricsPublisher {
+public:
+    enum class Sink {
+        File,
+        Socket
+    };
+
+    static constexpr auto PUBLISH_INTERVAL = std::chrono::seconds(1);
+    static constexpr auto PHASE_SAMPLE_INTERVAL = std::chrono::milliseconds(1);
+
+    MetricsPublisher(const std::string& path, Sink sink);
+    ~MetricsPublisher();
+
+    MetricsPublisher(const MetricsPublisher&) = delete;
+    MetricsPublisher& operator=(const MetricsPublisher&) = delete;
+
+    bool is_open() const { return sink_ == Sink::File || socket_ >= 0; }
+
+    // All threads must be attached before start(); they have to outlive the publisher
+    void attach(const ThreadMetrics* metrics);
+    void start();
+
+private:
+    struct Source {
+        const ThreadMetrics* metrics;
+        ThreadMetrics::Totals last_totals;
+        uint64_t last_frames;
+        uint64_t last_frame_time_us;
+        std::array<uint64_t, ThreadMetrics::FRAME_TIME_BOUNDS_US.size()> last_buckets;
+        std::array<uint64_t, ThreadMetrics::PHASE_COUNT> phase_samples;
+    };
+
+    void run();
+    std::string snapshot(double seconds);
+    void publish(const std::string& json);
+    void serve_clients(const std::string& json);
+
+    std::string path_;
+    Sink sink_;
+    int socket_ = -1;
+
+    std::vector<Source> sources_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+};
+
+#endif
@@ -2,21 +2,147 @@
 #define MMU_HPP_
 
 #include "constants_mmu.hpp"
+#include "block_cache.hpp"
 #include "cartridge.hpp"
+#include "coverage.hpp"
+#include <array>
 #include <cstdint>
 
+// Forward declarations
+class InterruptController;
+class Timer;
+class Joypad;
+class Serial;
+class PPU;
+class APU;
+class Watchpoints;
+class Cheats;
+
 class MMU {
 public:
-    MMU(std::string file_path);
+    MMU(std::vector<uint8_t> rom, InterruptController* interrupt_controller, Timer* timer, Joypad* joypad, Serial* serial, PPU* ppu, APU* apu);
+
+    static const int PAGE_SHIFT = 8;
+    static const uint16_t PAGE_SIZE = 1 << PAGE_SHIFT;
+    static const size_t PAGE_COUNT = 0x10000 >> PAGE_SHIFT;
+
+    // Accesses go through page tables first: the mapped ROM banks and work
+    // RAM are read (and work RAM written) straight from their buffers, and
+    // everything else takes the slow path, where HRAM is checked first
+    uint8_t read_memory_8(uint16_t addr) const {
+        if (const uint8_t* page = read_pages[addr >> PAGE_SHIFT]) {
+            return page[addr & (PAGE_SIZE - 1)];
+        }
+        return read_slow(addr);
+    }
+    void write_memory_8(uint16_t addr, uint8_t val) {
+        if (uint8_t* page = write_pages[addr >> PAGE_SHIFT]) {
+            page[addr & (PAGE_SIZE - 1)] = val;
+            if (block_cache && block_cache->is_code_page(addr)) {
+                block_cache->invalidate(addr);
+            }
+            return;
+        }
+        write_slow(addr, val);
+    }
+    // Same as read_memory_8() without reporting to watchpoints; for
+    // instruction fetch and decoding, and for debugger views
+    uint8_t peek_memory_8(uint16_t addr) const {
+        if (const uint8_t* page = read_pages[addr >> PAGE_SHIFT]) {
+            return page[addr & (PAGE_SIZE - 1)];
+        }
+        return read_mapped(addr);
+    }
+    // Same as write_memory_8() without reporting to watchpoints; for cheats
+    void poke_memory_8(uint16_t addr, uint8_t val) {
+        if (write_pages[addr >> PAGE_SHIFT]) {
+            write_memory_8(addr, val);
+        } else {
+            write_mapped(addr, val);
+        }
+    }
+
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
+
+    uint64_t rom_hash() const { return cartridge.rom_hash(); }
+    size_t rom_offset(uint16_t addr) const { return cartridge.rom_offset(addr); }
+    size_t rom_size() const { return cartridge.rom_size(); }
+    const uint8_t* rom_data() const { return cartridge.rom_data(); }
+    // Byte at offset in the ROM image as the CPU sees it, cheat patches included
+    uint8_t rom_byte(size_t offset) const;
+
+    // Bank of addr as symbol files number it: the ROM bank mapped there, 1 for
+    // the upper half of work RAM and 0 for everything else
+    uint16_t bank_of(uint16_t addr) const;
+    // Offset in the ROM image of ROM address addr as mapped now, SIZE_MAX if none
+    size_t mapped_rom_offset(uint16_t addr) const {
+        size_t base = addr <= SWITCHABLE_ROM_END ? mapped_rom_offsets[addr >> 14] : SIZE_MAX;
+        return base == SIZE_MAX ? SIZE_MAX : base + (addr & (SWITCHABLE_ROM_SIZE - 1));
+    }
+
+    // RAM writes to pages holding cached code invalidate those blocks
+    void set_block_cache(BlockCache* block_cache) { this->block_cache = block_cache; }
 
-    uint8_t read_memory_8(uint16_t addr) const; // will separate based on address scope
-    void write_memory_8(uint16_t addr, uint8_t val); // will separate based on address scope
+    // Direct access for translated code, which does its own range and code-page checks
+    uint8_t* wram_data() { return wram.data(); }
+    uint8_t* hram_data() { return hram.data(); }
+
+    // Pages holding a watched byte (bit per page) leave the page tables, and
+    // every access to them is reported to `watchpoints` (nullptr = none)
+    void set_watchpoints(Watchpoints* watchpoints, const std::array<uint64_t, 4>& pages);
+    // While recording, ROM pages leave the page tables too, and data reads
+    // from ROM (CPU and OAM DMA) are marked in `coverage`
+    void set_coverage(Coverage* coverage);
+    // ROM pages with cheat patches are mapped from their patched copies
+    // (nullptr = none)
+    void set_cheats(const Cheats* cheats);
 private:
+    uint8_t read_slow(uint16_t addr) const;
+    void write_slow(uint16_t addr, uint8_t val);
+    // VRAM and OAM stay accessible in every PPU mode; the hardware's lockout
+    // during the OAM scan and pixel transfer is not emulated
+    uint8_t read_mapped(uint16_t addr) const;
+    void write_mapped(uint16_t addr, uint8_t val);
+    bool is_watched(uint16_t addr) const {
+        uint8_t page = addr >> PAGE_SHIFT;
+        return (watched_pages[page >> 6] >> (page & 63)) & 1;
+    }
+
+    void map_pages();
+    // Points the ROM pages at the banks now selected; only halves whose bank
+    // changed are rewritten unless `all`
+    void map_rom_pages(bool all);
+
+    // Addresses between the registers of the emulated components are unused
+    // on the DMG: they read 0xFF and ignore writes
+    uint8_t read_io(uint16_t addr) const;
+    void write_io(uint16_t addr, uint8_t val);
+    // Copies all 160 bytes at once, where the hardware takes 160 M-cycles
+    // and blocks the CPU from everything but HRAM meanwhile
+    void oam_dma(uint8_t page);
+
+    InterruptController* interrupt_controller;
+    Timer* timer;
+    Joypad* joypad;
+    Serial* serial;
+    PPU* ppu;
+    APU* apu;
+    BlockCache* block_cache = nullptr;
+
     Cartridge cartridge;
-    vector<uint8_t> vram;
     vector<uint8_t> wram;
-    vector<uint8_t> oam;
     vector<uint8_t> hram;
+    uint8_t dma_register = 0xFF;
+
+    std::array<const uint8_t*, PAGE_COUNT> read_pages = {};
+    std::array<uint8_t*, PAGE_COUNT> write_pages = {};
+    std::array<size_t, 2> mapped_rom_offsets = {SIZE_MAX, SIZE_MAX};  // Of the two ROM halves
+
+    Watchpoints* watchpoints = nullptr;
+    Coverage* coverage = nullptr;
+    const Cheats* cheats = nullptr;
+    std::array<uint64_t, 4> watched_pages = {};
 };
 
 
@@ -0,0 +1,43 @@
+#ifndef MOVIE_HPP_
+#define MOVIE_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Input movie: one joypad bitmask per emulated frame, recorded from power-on.
+//
+// File layout (little endian):
+//   uint32  magic "GBMV"
+//   uint16  format version
+//   char[16] emulator version, zero padded
+//   uint64  FNV-1a hash of the ROM
+//   uint32  frame count
+//   uint8[] one JOYPAD_BUTTON_* mask per frame
+class Movie {
+public:
+    static constexpr uint32_t MAGIC = 0x564D4247;  // "GBMV"
+    static constexpr uint16_t FORMAT_VERSION = 1;
+    static constexpr size_t VERSION_FIELD_SIZE = 16;
+
+    Movie() = default;
+    explicit Movie(uint64_t rom_hash);
+
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    // Frames past the end of the movie read as no buttons pressed
+    uint8_t input_for_frame(uint64_t frame) const;
+    void record_frame(uint64_t frame, uint8_t buttons);
+
+    uint64_t frame_count() const { return inputs_.size(); }
+    uint64_t rom_hash() const { return rom_hash_; }
+    const std::string& emulator_version() const { return emulator_version_; }
+
+private:
+    uint64_t rom_hash_ = 0;
+    std::string emulator_version_;
+    std::vector<uint8_t> inputs_;
+};
+
+#endif
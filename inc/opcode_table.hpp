@@ -0,0 +1,171 @@
+#ifndef OPCODE_TABLE_HPP_
+#define OPCODE_TABLE_HPP_
+
+#include "cpu.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Opcode patterns and their handlers for one bus timing policy. The dispatch
+// tables are built from these at startup and the threaded interpreter resolves
+// them at compile time, so every engine runs the same handler for an opcode.
+template <typename Timing>
+struct OpcodeTable {
+    struct Entry {
+        uint8_t mask;
+        uint8_t pattern;
+        CPU::Handler handler;
+    };
+
+    static constexpr Entry BASE[] = {
+        // 8-bit load instructions
+        {0xC0, 0x40, &CPU::op_ld_r_r<Timing>},
+        {0xC7, 0x06, &CPU::op_ld_r_imm<Timing>},
+        {0xC7, 0x46, &CPU::op_ld_r_hl_ind<Timing>},
+        {0xF8, 0x70, &CPU::op_ld_hl_ind_r<Timing>},
+        {0xFF, 0x36, &CPU::op_ld_hl_ind_imm<Timing>},
+        {0xFF, 0x0A, &CPU::op_ld_a_bc_ind<Timing>},
+        {0xFF, 0x1A, &CPU::op_ld_a_de_ind<Timing>},
+        {0xFF, 0x02, &CPU::op_ld_bc_ind_a<Timing>},
+        {0xFF, 0x12, &CPU::op_ld_de_ind_a<Timing>},
+        {0xFF, 0xFA, &CPU::op_ld_a_imm_ind<Timing>},
+        {0xFF, 0xEA, &CPU::op_ld_imm_ind_a<Timing>},
+        {0xFF, 0xF2, &CPU::op_ldh_a_c_ind<Timing>},
+        {0xFF, 0xE2, &CPU::op_ldh_c_ind_a<Timing>},
+        {0xFF, 0xF0, &CPU::op_ldh_a_imm_ind<Timing>},
+        {0xFF, 0xE0, &CPU::op_ldh_imm_ind_a<Timing>},
+        {0xFF, 0x3A, &CPU::op_ld_a_hl_ind_dec<Timing>},
+        {0xFF, 0x32, &CPU::op_ld_hl_ind_dec_a<Timing>},
+        {0xFF, 0x2A, &CPU::op_ld_a_hl_ind_inc<Timing>},
+        {0xFF, 0x22, &CPU::op_ld_hl_ind_inc_a<Timing>},
+
+        // 16-bit load instructions
+        {0xCF, 0x01, &CPU::op_ld_rr_imm<Timing>},
+        {0xFF, 0x08, &CPU::op_ld_imm_ind_sp<Timing>},
+        {0xFF, 0xF9, &CPU::op_ld_sp_hl<Timing>},
+        {0xCF, 0xC5, &CPU::op_push_rr<Timing>},
+        {0xCF, 0xC1, &CPU::op_pop_rr<Timing>},
+        {0xFF, 0xF8, &CPU::op_ld_hl_sp_e<Timing>},
+
+        // 8-bit arithmetic/logic
+        {0xF8, 0x80, &CPU::op_add_r<Timing>},
+        {0xFF, 0x86, &CPU::op_add_hl_ind<Timing>},
+        {0xFF, 0xC6, &CPU::op_add_imm<Timing>},
+        {0xF8, 0x88, &CPU::op_adc_r<Timing>},
+        {0xFF, 0x8E, &CPU::op_adc_hl_ind<Timing>},
+        {0xFF, 0xCE, &CPU::op_adc_imm<Timing>},
+        {0xF8, 0x90, &CPU::op_sub_r<Timing>},
+        {0xFF, 0x96, &CPU::op_sub_hl_ind<Timing>},
+        {0xFF, 0xD6, &CPU::op_sub_imm<Timing>},
+        {0xF8, 0x98, &CPU::op_sbc_r<Timing>},
+        {0xFF, 0x9E, &CPU::op_sbc_hl_ind<Timing>},
+        {0xFF, 0xDE, &CPU::op_sbc_imm<Timing>},
+        {0xF8, 0xB8, &CPU::op_cp_r<Timing>},
+        {0xFF, 0xBE, &CPU::op_cp_hl_ind<Timing>},
+        {0xFF, 0xFE, &CPU::op_cp_imm<Timing>},
+        {0xC7, 0x04, &CPU::op_inc_r<Timing>},
+        {0xFF, 0x34, &CPU::op_inc_hl_ind<Timing>},
+        {0xC7, 0x05, &CPU::op_dec_r<Timing>},
+        {0xFF, 0x35, &CPU::op_dec_hl_ind<Timing>},
+        {0xF8, 0xA0, &CPU::op_and_r<Timing>},
+        {0xFF, 0xA6, &CPU::op_and_hl_ind<Timing>},
+        {0xFF, 0xE6, &CPU::op_and_imm<Timing>},
+        {0xF8, 0xB0, &CPU::op_or_r<Timing>},
+        {0xFF, 0xB6, &CPU::op_or_hl_ind<Timing>},
+        {0xFF, 0xF6, &CPU::op_or_imm<Timing>},
+        {0xF8, 0xA8, &CPU::op_xor_r<Timing>},
+        {0xFF, 0xAE, &CPU::op_xor_hl_ind<Timing>},
+        {0xFF, 0xEE, &CPU::op_xor_imm<Timing>},
+        {0xFF, 0x3F, &CPU::op_ccf<Timing>},
+        {0xFF, 0x37, &CPU::op_scf<Timing>},
+        {0xFF, 0x27, &CPU::op_daa<Timing>},
+        {0xFF, 0x2F, &CPU::op_cpl<Timing>},
+
+        // 16-bit arithmetic
+        {0xCF, 0x03, &CPU::op_inc_rr<Timing>},
+        {0xCF, 0x0B, &CPU::op_dec_rr<Timing>},
+        {0xCF, 0x09, &CPU::op_add_hl_rr<Timing>},
+        {0xFF, 0xE8, &CPU::op_add_sp_e<Timing>},
+
+        // Rotate/shift (non-CB)
+        {0xFF, 0x07, &CPU::op_rlca<Timing>},
+        {0xFF, 0x0F, &CPU::op_rrca<Timing>},
+        {0xFF, 0x17, &CPU::op_rla<Timing>},
+        {0xFF, 0x1F, &CPU::op_rra<Timing>},
+        {0xFF, 0xCB, &CPU::cb_ins_handler<Timing>},
+
+        // Control flow
+        {0xFF, 0xC3, &CPU::op_jp_imm<Timing>},
+        {0xFF, 0xE9, &CPU::op_jp_hl<Timing>},
+        {0xE7, 0xC2, &CPU::op_jp_cc_imm<Timing>},
+        {0xFF, 0x18, &CPU::op_jr_e<Timing>},
+        {0xE7, 0x20, &CPU::op_jr_cc_e<Timing>},
+        {0xFF, 0xCD, &CPU::op_call_imm<Timing>},
+        {0xE7, 0xC4, &CPU::op_call_cc_imm<Timing>},
+        {0xFF, 0xC9, &CPU::op_ret<Timing>},
+        {0xE7, 0xC0, &CPU::op_ret_cc<Timing>},
+        {0xFF, 0xD9, &CPU::op_reti<Timing>},
+        {0xC7, 0xC7, &CPU::op_rst_imm<Timing>},
+
+        // Miscellaneous
+        {0xFF, 0x76, &CPU::op_halt<Timing>},
+        {0xFF, 0x10, &CPU::op_stop<Timing>},
+        {0xFF, 0xF3, &CPU::op_di<Timing>},
+        {0xFF, 0xFB, &CPU::op_ei<Timing>},
+        {0xFF, 0x00, &CPU::op_nop<Timing>},
+    };
+
+    static constexpr Entry CB[] = {
+        {0xF8, 0x00, &CPU::op_rlc_r<Timing>},
+        {0xFF, 0x06, &CPU::op_rlc_hl_ind<Timing>},
+        {0xF8, 0x08, &CPU::op_rrc_r<Timing>},
+        {0xFF, 0x0E, &CPU::op_rrc_hl_ind<Timing>},
+        {0xF8, 0x10, &CPU::op_rl_r<Timing>},
+        {0xFF, 0x16, &CPU::op_rl_hl_ind<Timing>},
+        {0xF8, 0x18, &CPU::op_rr_r<Timing>},
+        {0xFF, 0x1E, &CPU::op_rr_hl_ind<Timing>},
+        {0xF8, 0x20, &CPU::op_sla_r<Timing>},
+        {0xFF, 0x26, &CPU::op_sla_hl_ind<Timing>},
+        {0xF8, 0x28, &CPU::op_sra_r<Timing>},
+        {0xFF, 0x2E, &CPU::op_sra_hl_ind<Timing>},
+        {0xF8, 0x30, &CPU::op_swap_r<Timing>},
+        {0xFF, 0x36, &CPU::op_swap_hl_ind<Timing>},
+        {0xF8, 0x38, &CPU::op_srl_r<Timing>},
+        {0xFF, 0x3E, &CPU::op_srl_hl_ind<Timing>},
+        {0xC0, 0x40, &CPU::op_bit_b_r<Timing>},
+        {0xC7, 0x46, &CPU::op_bit_b_hl_ind<Timing>},
+        {0xC0, 0x80, &CPU::op_res_b_r<Timing>},
+        {0xC7, 0x86, &CPU::op_res_b_hl_ind<Timing>},
+        {0xC0, 0xC0, &CPU::op_set_b_r<Timing>},
+        {0xC7, 0xC6, &CPU::op_set_b_hl_ind<Timing>},
+    };
+
+    // Patterns overlap (e.g. HALT inside the LD r,r block), so the match with
+    // the most specific mask wins
+    template <size_t N>
+    static constexpr CPU::Handler resolve(const Entry (&table)[N], uint8_t opcode) {
+        CPU::Handler best = nullptr;
+        int best_bits = -1;
+        for (const Entry& entry : table) {
+            int bits = mask_bits(entry.mask);
+            if ((opcode & entry.mask) == entry.pattern && bits > best_bits) {
+                best = entry.handler;
+                best_bits = bits;
+            }
+        }
+        return best;
+    }
+
+    static constexpr CPU::Handler base(uint8_t opcode) { return resolve(BASE, opcode); }
+    static constexpr CPU::Handler cb(uint8_t opcode) { return resolve(CB, opcode); }
+
+private:
+    static constexpr int mask_bits(uint8_t mask) {
+        int bits = 0;
+        for (; mask != 0; mask &= mask - 1) {
+            bits++;
+        }
+        return bits;
+    }
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef PCM_FILE_SINK_HPP_
+#define PCM_FILE_SINK_HPP_
+
+#include "audio_output.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Headless audio sink. Frames are copied into one of a fixed set of
+// preallocated blocks and a writer thread puts full blocks on disk (WAV or raw
+// 16-bit stereo PCM, including named pipes) while hashing every second of
+// audio. With no path it only hashes, which is enough for regression runs.
+class PcmFileSink : public AudioSink {
+public:
+    enum class Format {
+        Wav,
+        Raw,
+        HashOnly
+    };
+
+    PcmFileSink(const std::string& path, Format format, uint32_t sample_rate, bool print_hashes);
+    ~PcmFileSink() override;
+
+    // WAV for *.wav, raw PCM otherwise
+    static Format format_for_path(const std::string& path);
+
+    bool is_open() const { return format_ == Format::HashOnly || file_.is_open(); }
+
+    void write(const int16_t* frames, size_t count) override;
+    void close() override;
+
+    // FNV-1a of each second of PCM; the last entry may cover a partial second
+    const std::vector<uint64_t>& second_hashes() const { return second_hashes_; }
+    uint64_t total_hash() const { return total_hash_; }
+
+private:
+    static const size_t BLOCK_FRAMES = 16384;
+    static const size_t BLOCK_COUNT = 8;
+
+    struct Block {
+        std::vector<int16_t> samples;
+        size_t frames;
+    };
+
+    // Fixed-capacity FIFO of block indices
+    struct BlockQueue {
+        size_t slots[BLOCK_COUNT];
+        size_t head = 0;
+        size_t size = 0;
+
+        void push(size_t index) { slots[(head + size++) % BLOCK_COUNT] = index; }
+        size_t pop() {
+            size_t index = slots[head];
+            head = (head + 1) % BLOCK_COUNT;
+            size--;
+            return index;
+        }
+    };
+
+    void write_wav_header(uint32_t data_bytes);
+    void submit_current();
+    void writer_loop();
+    void consume(const Block& block);
+
+    Format format_;
+    uint32_t sample_rate_;
+    bool print_hashes_;
+    std::ofstream file_;
+    uint64_t data_bytes_ = 0;
+
+    std::vector<Block> blocks_;
+    size_t current_ = 0;
+    bool have_current_ = false;
+    BlockQueue free_blocks_;
+    BlockQueue full_blocks_;
+    std::mutex mutex_;
+    std::condition_variable block_freed_;
+    std::condition_variable block_filled_;
+    bool closing_ = false;
+    bool closed_ = false;
+    std::thread writer_;
+
+    // Touched only by the writer thread until it is joined
+    uint64_t second_hash_;
+    uint64_t total_hash_;
+    size_t frames_in_second_ = 0;
+    std::vector<uint64_t> second_hashes_;
+};
+
+#endif
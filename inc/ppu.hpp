@@ -1,8 +1,107 @@
 #ifndef _PPU_HPP_
 #define _PPU_HPP_
 
+#include "constants.hpp"
+#include "constants_mmu.hpp"
+#include <cstdint>
+#include <vector>
+
+// Forward declarations
+class InterruptController;
+class StateWriter;
+class StateReader;
+
 class PPU {
+public:
+    enum Mode : uint8_t {
+        MODE_HBLANK = 0,
+        MODE_VBLANK = 1,
+        MODE_OAM_SCAN = 2,
+        MODE_TRANSFER = 3
+    };
+
+    explicit PPU(InterruptController* interrupt_controller);
+
+    void step(uint32_t cycles);
+
+    // Cycles until the next mode change that can raise an interrupt (UINT32_MAX
+    // with the LCD off); the others are only visible through STAT reads
+    uint32_t cycles_until_event() const;
+
+    uint8_t read_vram(uint16_t addr) const { return vram_[addr - VRAM_START]; }
+    void write_vram(uint16_t addr, uint8_t value) { vram_[addr - VRAM_START] = value; }
+    uint8_t read_oam(uint16_t addr) const { return oam_[addr - SPRITE_ATTRIBUTES_START]; }
+    void write_oam(uint16_t addr, uint8_t value) { oam_[addr - SPRITE_ATTRIBUTES_START] = value; }
+
+    uint8_t read_register(uint16_t address) const;
+    void write_register(uint16_t address, uint8_t value);
+
+    // Render skipping: timing, LY and STAT interrupts are always exact, but
+    // background/window/sprite composition only runs on every `interval`th
+    // frame (0 = never) or on a frame requested with request_render()
+    void set_render_interval(uint32_t interval) { render_interval_ = interval; }
+    void request_render() { render_requested_ = true; }
+
+    // True once per frame when the PPU enters VBlank
+    bool take_frame_complete();
+    bool last_frame_rendered() const { return last_frame_rendered_; }
+
+    // One shade (0-3) per pixel, SCREEN_WIDTH * SCREEN_HEIGHT
+    const uint8_t* framebuffer() const { return framebuffer_.data(); }
+
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
+
+private:
+    void set_mode(Mode mode);
+    void update_stat_line();
+    void start_frame();
+    void scan_oam();
+    uint32_t transfer_cycles() const;
+    bool window_visible() const;
+
+    void render_scanline();
+    void render_background(uint8_t* line, uint8_t* color_ids);
+    void render_window(uint8_t* line, uint8_t* color_ids);
+    void render_sprites(uint8_t* line, const uint8_t* color_ids);
+    uint16_t tile_row(uint16_t tile_data_base, uint8_t tile_index, uint8_t row) const;
+
+    InterruptController* interrupt_controller_;
+
+    std::vector<uint8_t> vram_;
+    std::vector<uint8_t> oam_;
+
+    // Registers
+    uint8_t lcdc_ = 0x91;
+    uint8_t stat_ = 0x00;  // Interrupt select bits only, mode and LYC flag are derived
+    uint8_t scy_ = 0x00;
+    uint8_t scx_ = 0x00;
+    uint8_t ly_ = 0x00;
+    uint8_t lyc_ = 0x00;
+    uint8_t bgp_ = 0xFC;
+    uint8_t obp0_ = 0xFF;
+    uint8_t obp1_ = 0xFF;
+    uint8_t wy_ = 0x00;
+    uint8_t wx_ = 0x00;
+
+    // Timing state
+    Mode mode_ = MODE_OAM_SCAN;
+    uint32_t line_cycles_ = 0;
+    uint32_t transfer_length_ = PIXEL_TRANSFER_MIN_CYCLES;
+    bool stat_line_ = false;
+    bool window_triggered_ = false;  // WY matched LY at some point this frame
+    uint8_t window_line_ = 0;
+    uint8_t line_sprites_[MAX_SPRITES_PER_LINE] = {};
+    uint8_t line_sprite_count_ = 0;
+    bool frame_complete_ = false;
 
+    // Host-side render control, not part of the emulated state
+    uint32_t render_interval_ = 1;
+    bool render_requested_ = false;
+    bool rendering_ = true;
+    bool last_frame_rendered_ = false;
+    uint64_t frame_counter_ = 0;
+    std::vector<uint8_t> framebuffer_;
 };
 
-#endif
\ No newline at end of file
+#endif
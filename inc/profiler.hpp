@@ -0,0 +1,91 @@
+#ifndef PROFILER_HPP_
+#define PROFILER_HPP_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Forward declarations
+class Disassembler;
+class MMU;
+class SymbolTable;
+
+// Sampling profiler for guest code. The emulator calls sample() every
+// interval cycles from a scheduler event, so nothing runs between samples and
+// a disabled profiler costs nothing. Samples are counted per (bank, PC).
+//
+// With call stacks on, the CPU also reports CALL, RST and interrupt entries
+// and RET/RETI. Frames are kept on a shadow stack tagged with the guest SP, and
+// a return drops every frame pushed below the new SP, so code that discards or
+// fakes return addresses does not leave stale frames behind. Stacks are
+// interned into a call tree when they are first sampled.
+class Profiler {
+public:
+    static const uint32_t DEFAULT_INTERVAL = 4096;  // ~1000 samples per emulated second
+    static const size_t MAX_DEPTH = 256;
+
+    Profiler(const MMU* mmu, bool call_stacks);
+
+    bool call_stacks() const { return call_stacks_; }
+    uint64_t samples() const { return samples_; }
+
+    void sample(uint16_t pc);
+
+    // `sp` is the guest SP after the return address was pushed or popped
+    void on_call(uint16_t target, uint16_t sp) {
+        if (frames_.size() < MAX_DEPTH) {
+            frames_.push_back({location(target), sp, UNRESOLVED});
+        }
+    }
+    void on_return(uint16_t sp) {
+        while (!frames_.empty() && frames_.back().sp < sp) {
+            frames_.pop_back();
+        }
+    }
+
+    // Per-function self (and, with call stacks, total) samples, then the
+    // `hot_spots` most sampled addresses with their instructions
+    void write_report(std::ostream& out, const SymbolTable& symbols, Disassembler& disassembler,
+                      size_t hot_spots = 20) const;
+
+    // "caller;callee;function count" lines for flame graph tools
+    void write_folded(std::ostream& out, const SymbolTable& symbols) const;
+
+private:
+    static const uint32_t UNRESOLVED = UINT32_MAX;
+    static const uint32_t ROOT = 0;
+
+    struct Frame {
+        uint32_t location;  // Bank << 16 | address of the callee
+        uint16_t sp;
+        uint32_t node;      // Call tree node, once sampled
+    };
+    struct Node {
+        uint32_t parent;
+        uint32_t location;
+    };
+
+    uint32_t location(uint16_t address) const;
+    uint32_t resolve_stack();
+
+    // Function a sample is attributed to: the symbol covering the PC, else
+    // the innermost frame's callee, else the PC itself
+    std::string function_name(uint32_t node, uint32_t pc, const SymbolTable& symbols) const;
+    std::string frame_name(uint32_t location, const SymbolTable& symbols) const;
+    std::vector<std::string> stack_names(uint32_t node, uint32_t pc, const SymbolTable& symbols) const;
+
+    const MMU* mmu_;
+    bool call_stacks_;
+    uint64_t samples_ = 0;
+
+    std::unordered_map<uint32_t, uint64_t> pc_samples_;
+
+    std::vector<Frame> frames_;
+    std::vector<Node> nodes_;
+    std::unordered_map<uint64_t, uint32_t> children_;     // Parent << 32 | location -> node
+    std::unordered_map<uint64_t, uint64_t> stack_samples_;  // Node << 32 | PC location -> count
+};
+
+#endif
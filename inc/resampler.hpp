@@ -0,0 +1,49 @@
+#ifndef RESAMPLER_HPP_
+#define RESAMPLER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Stereo polyphase windowed-sinc resampler. The kernel is tabulated at PHASES
+// sub-sample offsets and neighbouring phases are interpolated, so the ratio can
+// change continuously (dynamic rate control) without rebuilding anything. The
+// inner loop is a contiguous float dot product over TAPS taps, vectorized with
+// SSE where available.
+class Resampler {
+public:
+    static const int TAPS = 32;
+    static const int PHASE_BITS = 8;
+    static const int PHASES = 1 << PHASE_BITS;
+
+    Resampler(uint32_t input_rate, uint32_t output_rate);
+
+    // Input frames consumed per output frame are scaled by `adjust` (around 1.0)
+    void set_rate_adjust(double adjust);
+    double rate_adjust() const { return adjust_; }
+
+    // Interleaved stereo int16 in, interleaved stereo int16 out
+    void push(const int16_t* frames, size_t count);
+    size_t pull(int16_t* out, size_t max_frames);
+
+    // Input frames still needed before `output_frames` more can be pulled
+    size_t input_needed(size_t output_frames) const;
+    void reset();
+
+private:
+    static const int FRAC_BITS = 32;
+
+    void compact();
+
+    uint64_t nominal_step_;  // Input frames per output frame, 32.32 fixed point
+    uint64_t step_;
+    double adjust_ = 1.0;
+    uint64_t position_ = 0;  // Read position into the input history, 32.32
+
+    // Phase p's taps start at kernel_[p * TAPS]; PHASES + 1 rows for interpolation
+    std::vector<float> kernel_;
+    std::vector<float> left_;
+    std::vector<float> right_;
+};
+
+#endif
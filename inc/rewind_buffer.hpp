@@ -0,0 +1,60 @@
+#ifndef REWIND_BUFFER_HPP_
+#define REWIND_BUFFER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-size ring of per-frame save states. Every snapshot is XORed against the
+// most recent keyframe and run-length compressed, so unchanged bytes cost almost
+// nothing. All memory is allocated up front; capturing never allocates once the
+// snapshot size is known.
+class RewindBuffer {
+public:
+    RewindBuffer(size_t arena_bytes, size_t max_frames, uint32_t keyframe_interval);
+
+    // Store one snapshot, evicting the oldest keyframe group if the arena is full
+    void capture(const std::vector<uint8_t>& state);
+
+    // Restore the newest snapshot into state and drop it from the ring
+    bool rewind(std::vector<uint8_t>& state);
+
+    size_t frames() const { return count_; }
+    size_t used_bytes() const { return used_bytes_; }
+    size_t capacity_bytes() const { return arena_.size(); }
+    void clear();
+
+    // Self-contained zero-run/literal codec used for snapshots; decompress
+    // throws std::runtime_error unless the input fills exactly dst_size bytes
+    static size_t compress(const uint8_t* src, size_t size, uint8_t* dst);
+    static void decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dst_size);
+    static size_t max_compressed_size(size_t size);
+
+private:
+    struct Entry {
+        size_t offset;
+        size_t size;
+        bool keyframe;
+    };
+
+    Entry& entry_at(size_t index) { return entries_[(head_ + index) % entries_.size()]; }
+    size_t find_keyframe(size_t index);
+    bool has_room(size_t size, size_t& offset) const;
+    void evict_oldest_group();
+    void push_entry(const uint8_t* data, size_t size, bool keyframe);
+
+    std::vector<uint8_t> arena_;
+    std::vector<Entry> entries_;
+    size_t head_ = 0;        // Index of the oldest entry
+    size_t count_ = 0;
+    size_t used_bytes_ = 0;
+
+    uint32_t keyframe_interval_;
+    uint32_t frames_since_keyframe_ = 0;
+
+    std::vector<uint8_t> keyframe_;   // Raw state of the current keyframe
+    std::vector<uint8_t> scratch_;    // XOR delta of the frame being captured
+    std::vector<uint8_t> packed_;     // Compressed output before it enters the arena
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SAVE_STATE_HPP_
+#define SAVE_STATE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Appends raw component state to a byte buffer. The buffer is cleared but keeps
+// its capacity, so repeated captures into the same buffer do not allocate.
+class StateWriter {
+public:
+    explicit StateWriter(std::vector<uint8_t>& buffer) : buffer_(buffer) {
+        buffer_.clear();
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "State values must be trivially copyable");
+        write_bytes(reinterpret_cast<const uint8_t*>(&value), sizeof(T));
+    }
+
+    void write_bytes(const uint8_t* data, size_t size) {
+        buffer_.insert(buffer_.end(), data, data + size);
+    }
+
+    void write_vector(const std::vector<uint8_t>& data) {
+        write_bytes(data.data(), data.size());
+    }
+
+private:
+    std::vector<uint8_t>& buffer_;
+};
+
+// Reads component state back in the same order it was written.
+class StateReader {
+public:
+    StateReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+    explicit StateReader(const std::vector<uint8_t>& buffer) : StateReader(buffer.data(), buffer.size()) {}
+
+    template <typename T>
+    void read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "State values must be trivially copyable");
+        read_bytes(reinterpret_cast<uint8_t*>(&value), sizeof(T));
+    }
+
+    void read_bytes(uint8_t* data, size_t size) {
+        if (offset_ + size > size_) {
+            throw std::runtime_error("Save state is truncated");
+        }
+        std::memcpy(data, data_ + offset_, size);
+        offset_ += size;
+    }
+
+    void read_vector(std::vector<uint8_t>& data) {
+        read_bytes(data.data(), data.size());
+    }
+
+    // True once every byte has been read
+    bool at_end() const { return offset_ == size_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_ = 0;
+};
+
+#endif
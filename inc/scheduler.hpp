@@ -0,0 +1,67 @@
+#ifndef SCHEDULER_HPP_
+#define SCHEDULER_HPP_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+class StateWriter;
+class StateReader;
+
+// One slot per event source; a source has at most one pending event. Host
+// events (tools observing the machine) follow the emulated ones and are not
+// part of the saved state.
+enum SchedulerEvent : uint8_t {
+    EVENT_APU_FLUSH = 0,
+    EVENT_SERIAL_TRANSFER,
+    EVENT_HOST_FIRST,
+    EVENT_PROFILER_SAMPLE = EVENT_HOST_FIRST,
+    EVENT_COUNT
+};
+
+// Master T-cycle clock plus a small fixed event table. Components that can be
+// emulated lazily read now() when touched and only schedule an event for work
+// that has to happen at a specific time.
+class Scheduler {
+public:
+    using Handler = std::function<void()>;
+
+    Scheduler();
+
+    uint64_t now() const { return now_; }
+
+    void advance(uint32_t cycles) {
+        now_ += cycles;
+        if (now_ >= next_event_time_) {
+            run_due_events();
+        }
+    }
+
+    void set_handler(SchedulerEvent event, Handler handler);
+    const Handler& handler(SchedulerEvent event) const { return handlers_[event]; }
+    void schedule(SchedulerEvent event, uint64_t delay);
+    void schedule_at(SchedulerEvent event, uint64_t time);
+    void cancel(SchedulerEvent event);
+    bool is_scheduled(SchedulerEvent event) const { return events_[event].active; }
+    uint64_t event_time(SchedulerEvent event) const { return events_[event].time; }
+    uint64_t cycles_until_next_event() const { return next_event_time_ > now_ ? next_event_time_ - now_ : 0; }
+
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
+
+private:
+    struct Event {
+        uint64_t time;
+        bool active;
+    };
+
+    void run_due_events();
+    void update_next_event();
+
+    uint64_t now_ = 0;
+    uint64_t next_event_time_ = UINT64_MAX;
+    std::array<Event, EVENT_COUNT> events_;
+    std::array<Handler, EVENT_COUNT> handlers_;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SERIAL_HPP_
+#define SERIAL_HPP_
+
+#include "constants.hpp"
+#include <cstdint>
+#include <string>
+
+// Forward declarations
+class InterruptController;
+class LinkPort;
+class Scheduler;
+class StateWriter;
+class StateReader;
+
+// Link port (SB/SC). A transfer started with the internal clock completes on a
+// scheduler event 8 serial clocks later; every byte shifted out is appended to
+// an output buffer that test harnesses poll (blargg ROMs print results here).
+// With the external clock a transfer waits for a partner on a LinkPort to
+// supply the clock; without a cable it never completes, as on hardware.
+class Serial {
+public:
+    Serial(InterruptController* interrupt_controller, Scheduler* scheduler);
+
+    uint8_t read_register(uint16_t address) const;
+    void write_register(uint16_t address, uint8_t value);
+
+    // Everything sent so far. Its length is part of save state, so bytes sent
+    // by speculative or rewound frames are discarded on load.
+    const std::string& output() const { return output_; }
+
+    // Attach a link cable (nullptr to unplug). Link traffic is not part of
+    // save states, so linked emulators should not rewind or run ahead.
+    void connect_link(LinkPort* link);
+    LinkPort* link() const { return link_; }
+
+    // Frame-end sync point for the link cable
+    void sync();
+
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
+
+private:
+    void on_transfer_event();
+    void complete_transfer(uint8_t received);
+    bool waiting_for_partner() const;
+
+    InterruptController* interrupt_controller_;
+    Scheduler* scheduler_;
+    LinkPort* link_ = nullptr;
+
+    uint8_t sb_ = 0x00;
+    uint8_t sc_ = 0x00;  // Bit 7 transfer in progress, bit 0 internal clock
+    std::string output_;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef SYMBOL_TABLE_HPP_
+#define SYMBOL_TABLE_HPP_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+// Labels from an RGBDS or no$gmb symbol file, one "BB:AAAA Name" per line
+// (bank and address in hex, ';' starts a comment). Banks are numbered as
+// MMU::bank_of() reports them.
+class SymbolTable {
+public:
+    struct Symbol {
+        uint16_t bank;
+        uint16_t address;
+        std::string name;
+    };
+
+    bool load(const std::string& path);
+    bool empty() const { return symbols_.empty(); }
+    size_t size() const { return symbols_.size(); }
+
+    // The closest symbol at or before `address` in the same bank and memory
+    // region (ROM0, ROMX, VRAM, cartridge RAM, each WRAM half, HRAM), if any
+    const Symbol* lookup(uint16_t bank, uint16_t address) const;
+    const Symbol* find(const std::string& name) const;
+
+    // "Name", "Name+0x1A" or "BB:AAAA" when no symbol covers the address
+    std::string describe(uint16_t bank, uint16_t address) const;
+    static std::string location(uint16_t bank, uint16_t address);
+
+private:
+    static uint32_t key(uint16_t bank, uint16_t address) { return static_cast<uint32_t>(bank) << 16 | address; }
+
+    std::map<uint32_t, Symbol> symbols_;
+    std::unordered_map<std::string, uint32_t> by_name_;
+};
+
+#endif
@@ -6,6 +6,8 @@
 
 // Forward declaration
 class InterruptController;
+class StateWriter;
+class StateReader;
 
 class Timer {
 public:
@@ -15,6 +17,12 @@ public:
     void write_timer(uint16_t address, uint8_t value);
     uint8_t read_timer(uint16_t address) const;
 
+    // Cycles until TIMA overflows and requests an interrupt (UINT32_MAX if stopped)
+    uint32_t cycles_until_interrupt() const;
+
+    void save_state(StateWriter& writer) const;
+    void load_state(StateReader& reader);
+
 private:
     bool has_enough_cycles_passed_tima() const;
     bool has_enough_cycles_passed_div() const;
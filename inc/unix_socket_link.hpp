@@ -0,0 +1,48 @@
+#ifndef UNIX_SOCKET_LINK_HPP_
+#define UNIX_SOCKET_LINK_HPP_
+
+#include "link_port.hpp"
+#include <string>
+#include <thread>
+
+// Link cable to an emulator in another process over a local UNIX stream
+// socket. One side listens on a path, the other connects to it; a reader
+// thread applies the partner's messages to the shared LinkPort state. On
+// Windows the link reports that it is unsupported and never opens.
+class UnixSocketLink : public LinkPort {
+public:
+    enum class Mode {
+        Listen,
+        Connect
+    };
+
+    // Blocks until the partner is connected (or the connect attempt times out)
+    UnixSocketLink(const std::string& path, Mode mode);
+    ~UnixSocketLink() override;
+
+    bool is_open() const { return socket_ >= 0; }
+
+protected:
+    void send_clock(uint64_t stamp) override;
+    void send_ready(int byte) override;
+    void send_data(uint8_t byte, uint64_t time) override;
+    void send_disconnect() override;
+
+private:
+    struct Message {
+        uint8_t type;
+        uint8_t byte;
+        uint8_t padding[6];
+        uint64_t value;
+    };
+
+    void send_message(uint8_t type, uint8_t byte, uint64_t value);
+    void reader_loop();
+
+    std::string path_;
+    Mode mode_;
+    int socket_ = -1;
+    std::thread reader_;
+};
+
+#endif
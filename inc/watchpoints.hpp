@@ -0,0 +1,97 @@
+#ifndef WATCHPOINTS_HPP_
+#define WATCHPOINTS_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Forward declarations
+class CPU;
+class MMU;
+class Scheduler;
+class SymbolTable;
+
+// Read/write watchpoints on address ranges. The MMU takes every page holding
+// a watched byte out of its page tables, so accesses to other pages stay on
+// the fast path and only those to watched pages are checked here.
+//
+// Hits go into a ring of the last HIT_LOG_SIZE with the accessing
+// instruction's PC and bank, the value and the cycle. A watchpoint that
+// breaks also stops the CPU once the accessing instruction has completed;
+// the debugger then picks the hit up with take_break(). Instruction fetches
+// and debugger views do not count as reads.
+class Watchpoints {
+public:
+    enum Access : uint8_t {
+        READ = 1,
+        WRITE = 2
+    };
+
+    struct Watchpoint {
+        uint32_t number;
+        uint16_t first;
+        uint16_t last;
+        uint8_t access;  // Access bits
+        bool stop;       // Break into the debugger, otherwise only log
+    };
+
+    struct Hit {
+        uint32_t number;  // Of the watchpoint
+        uint16_t pc;
+        uint16_t bank;    // Of the PC, as symbol files number it
+        uint16_t address;
+        uint8_t value;    // Read, or about to be written
+        bool write;
+        uint64_t cycle;
+    };
+
+    static const size_t HIT_LOG_SIZE = 4096;
+
+    Watchpoints(CPU* cpu, MMU* mmu, const Scheduler* scheduler);
+    ~Watchpoints();
+
+    Watchpoints(const Watchpoints&) = delete;
+    Watchpoints& operator=(const Watchpoints&) = delete;
+
+    // Returns the watchpoint's number; breaking needs an attached debugger
+    uint32_t add(uint16_t first, uint16_t last, uint8_t access, bool stop);
+    // 0 removes all of them; false if there was no such watchpoint
+    bool remove(uint32_t number);
+    const std::vector<Watchpoint>& watchpoints() const { return watchpoints_; }
+
+    // Called by the MMU for every access to a watched page
+    void on_access(uint16_t address, uint8_t value, bool write);
+
+    // The hit that stopped the CPU, if any; clears it and any stop still pending
+    bool take_break(Hit& hit);
+
+    uint64_t hit_count() const { return hit_count_; }
+    // The last `count` hits kept (0 = all), oldest first
+    std::vector<Hit> hits(size_t count = 0) const;
+
+    // "#1 write C0A0 <- 05 by 01:4A3C (Main+0x12), cycle 123456"
+    static std::string describe(const Hit& hit, const SymbolTable* symbols);
+    void write_log(std::ostream& out, const SymbolTable* symbols, size_t count = 0) const;
+
+private:
+    void update_pages();
+
+    CPU* cpu_;
+    MMU* mmu_;
+    const Scheduler* scheduler_;
+
+    std::vector<Watchpoint> watchpoints_;
+    uint32_t next_number_ = 1;
+
+    std::vector<Hit> log_;  // Ring, HIT_LOG_SIZE once full
+    size_t log_next_ = 0;
+    uint64_t hit_count_ = 0;
+
+    Hit break_hit_ = {};
+    bool break_pending_ = false;
+};
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef X86_EMITTER_HPP_
+#define X86_EMITTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+// Minimal x86-64 assembler for the JIT: just the instructions it emits, always
+// in their long (disp32/rel32) forms. Code is built in a byte vector and copied
+// to executable memory once complete, so labels are patched in place.
+class X86Emitter {
+public:
+    enum Reg : uint8_t {
+        RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+        R8, R9, R10, R11, R12, R13, R14, R15
+    };
+
+    enum Alu : uint8_t {
+        ADD = 0, OR = 1, ADC = 2, SBB = 3, AND = 4, SUB = 5, XOR = 6, CMP = 7
+    };
+
+    enum Shift : uint8_t {
+        ROL = 0, ROR = 1, RCL = 2, RCR = 3, SHL = 4, SHR = 5, SAR = 7
+    };
+
+    enum Cond : uint8_t {
+        CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5
+    };
+
+    // [base + index + disp]
+    struct Mem {
+        Reg base;
+        int32_t disp;
+        bool has_index;
+        Reg index;
+    };
+    static Mem mem(Reg base, int32_t disp = 0) { return {base, disp, false, RAX}; }
+    static Mem mem(Reg base, Reg index, int32_t disp) { return {base, disp, true, index}; }
+
+    using Label = size_t;
+
+    const std::vector<uint8_t>& code() const { return code_; }
+    size_t size() const { return code_.size(); }
+    void clear() {
+        code_.clear();
+        labels_.clear();
+        fixups_.clear();
+    }
+
+    Label new_label() {
+        labels_.push_back(SIZE_MAX);
+        return labels_.size() - 1;
+    }
+    void bind(Label label) { labels_[label] = code_.size(); }
+
+    // Resolves all jumps; every used label must be bound
+    void finish() {
+        for (auto& [at, label] : fixups_) {
+            int32_t rel = static_cast<int32_t>(labels_[label] - (at + 4));
+            std::memcpy(&code_[at], &rel, 4);
+        }
+        fixups_.clear();
+    }
+
+    // Register/register and register/memory ALU ops; size is 8, 16 or 32
+    void alu(Alu op, int size, Reg dst, Reg src) { rr(size, {static_cast<uint8_t>(op * 8 + (size == 8 ? 0 : 1))}, src, dst); }
+    void alu(Alu op, int size, Reg dst, Mem src) { rm(size, {static_cast<uint8_t>(op * 8 + (size == 8 ? 2 : 3))}, dst, src); }
+    void alu(Alu op, int size, Reg dst, int32_t imm) {
+        rr(size, {static_cast<uint8_t>(size == 8 ? 0x80 : 0x81)}, static_cast<Reg>(op), dst);
+        immediate(size, imm);
+    }
+    void alu(Alu op, int size, Mem dst, int32_t imm) {
+        rm(size, {static_cast<uint8_t>(size == 8 ? 0x80 : 0x81)}, static_cast<Reg>(op), dst);
+        immediate(size, imm);
+    }
+
+    void mov(int size, Reg dst, Reg src) { rr(size, {static_cast<uint8_t>(size == 8 ? 0x88 : 0x89)}, src, dst); }
+    void mov(int size, Reg dst, Mem src) { rm(size, {static_cast<uint8_t>(size == 8 ? 0x8A : 0x8B)}, dst, src); }
+    void mov(int size, Mem dst, Reg src) { rm(size, {static_cast<uint8_t>(size == 8 ? 0x88 : 0x89)}, src, dst); }
+    void mov(int size, Mem dst, int32_t imm) {
+        rm(size, {static_cast<uint8_t>(size == 8 ? 0xC6 : 0xC7)}, RAX, dst);
+        immediate(size, imm);
+    }
+    void mov(Reg dst, uint32_t imm) {
+        rex(false, 0, 0, dst, false);
+        byte(0xB8 + (dst & 7));
+        dword(imm);
+    }
+    void mov64(Reg dst, Mem src) { rm(64, {0x8B}, dst, src); }
+    void add64(Reg dst, Reg src) { rr(64, {0x01}, src, dst); }
+
+    // Zero-extending loads: movzx r32, r/m8 and r/m16
+    void movzx8(Reg dst, Reg src) { rr(32, {0x0F, 0xB6}, dst, src, src >= RSP && src <= RDI); }
+    void movzx8(Reg dst, Mem src) { rm(32, {0x0F, 0xB6}, dst, src); }
+    void movzx16(Reg dst, Reg src) { rr(32, {0x0F, 0xB7}, dst, src); }
+    // movzx r32, ah (never takes a REX prefix)
+    void movzx_ah(Reg dst) {
+        byte(0x0F);
+        byte(0xB6);
+        byte(0xC0 | (dst & 7) << 3 | 4);
+    }
+
+    void lea(Reg dst, Mem src) { rm(32, {0x8D}, dst, src); }
+
+    void inc(int size, Reg reg) { rr(size, {static_cast<uint8_t>(size == 8 ? 0xFE : 0xFF)}, RAX, reg); }
+    void dec(int size, Reg reg) { rr(size, {static_cast<uint8_t>(size == 8 ? 0xFE : 0xFF)}, RCX, reg); }
+
+    void shift(Shift op, int size, Reg reg, uint8_t count) {
+        if (count == 1) {
+            rr(size, {static_cast<uint8_t>(size == 8 ? 0xD0 : 0xD1)}, static_cast<Reg>(op), reg);
+        } else {
+            rr(size, {static_cast<uint8_t>(size == 8 ? 0xC0 : 0xC1)}, static_cast<Reg>(op), reg);
+            byte(count);
+        }
+    }
+
+    void test(int size, Reg a, Reg b) { rr(size, {static_cast<uint8_t>(size == 8 ? 0x84 : 0x85)}, b, a); }
+    void test(int size, Reg reg, int32_t imm) {
+        rr(size, {static_cast<uint8_t>(size == 8 ? 0xF6 : 0xF7)}, RAX, reg);
+        immediate(size, imm);
+    }
+    void test8(Mem mem, uint8_t imm) {
+        rm(8, {0xF6}, RAX, mem);
+        byte(imm);
+    }
+
+    // bt m32, imm8 / bt m32, r32
+    void bt(Mem mem, uint8_t bit) {
+        rm(32, {0x0F, 0xBA}, RSP, mem);
+        byte(bit);
+    }
+    void bt(Mem mem, Reg bit) { rm(32, {0x0F, 0xA3}, bit, mem); }
+
+    void setcc(Cond cond, Reg reg) { rr(8, {0x0F, static_cast<uint8_t>(0x90 | cond)}, RAX, reg); }
+    void lahf() { byte(0x9F); }
+
+    void jcc(Cond cond, Label label) {
+        byte(0x0F);
+        byte(0x80 | cond);
+        fixup(label);
+    }
+    void jmp(Label label) {
+        byte(0xE9);
+        fixup(label);
+    }
+    void call(Mem target) { rm(32, {0xFF}, RDX, target); }
+
+    void push(Reg reg) {
+        rex(false, 0, 0, reg, false);
+        byte(0x50 + (reg & 7));
+    }
+    void pop(Reg reg) {
+        rex(false, 0, 0, reg, false);
+        byte(0x58 + (reg & 7));
+    }
+    void ret() { byte(0xC3); }
+
+private:
+    void byte(uint8_t value) { code_.push_back(value); }
+    void dword(uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            byte(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+    void immediate(int size, int32_t imm) {
+        if (size == 8) {
+            byte(static_cast<uint8_t>(imm));
+        } else if (size == 16) {
+            byte(static_cast<uint8_t>(imm));
+            byte(static_cast<uint8_t>(imm >> 8));
+        } else {
+            dword(static_cast<uint32_t>(imm));
+        }
+    }
+    void fixup(Label label) {
+        fixups_.emplace_back(code_.size(), label);
+        dword(0);
+    }
+
+    // A REX prefix is needed for r8-r15, 64-bit operands and the low byte of
+    // rsp/rbp/rsi/rdi (which would otherwise encode ah/ch/dh/bh)
+    void rex(bool wide, int reg, int index, int base, bool byte_regs) {
+        uint8_t value = 0x40 | (wide << 3) | ((reg >> 3) & 1) << 2 | ((index >> 3) & 1) << 1 | ((base >> 3) & 1);
+        if (value != 0x40 || byte_regs) {
+            byte(value);
+        }
+    }
+    static bool needs_byte_rex(int size, Reg reg) { return size == 8 && reg >= RSP && reg <= RDI; }
+
+    void prefix(int size) {
+        if (size == 16) {
+            byte(0x66);
+        }
+    }
+    void opcode(std::initializer_list<uint8_t> bytes) {
+        for (uint8_t b : bytes) {
+            byte(b);
+        }
+    }
+
+    // ModRM with a register operand in rm
+    void rr(int size, std::initializer_list<uint8_t> op, Reg reg, Reg rm, bool byte_regs = false) {
+        prefix(size);
+        rex(size == 64, reg, 0, rm, byte_regs || needs_byte_rex(size, reg) || needs_byte_rex(size, rm));
+        opcode(op);
+        byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+    }
+
+    // ModRM with a memory operand, always mod = 10 (disp32)
+    void rm(int size, std::initializer_list<uint8_t> op, Reg reg, Mem mem) {
+        prefix(size);
+        rex(size == 64, reg, mem.has_index ? mem.index : 0, mem.base, needs_byte_rex(size, reg));
+        opcode(op);
+        if (mem.has_index) {
+            byte(0x80 | (reg & 7) << 3 | 4);
+            byte((mem.index & 7) << 3 | (mem.base & 7));
+        } else if ((mem.base & 7) == RSP) {
+            byte(0x80 | (reg & 7) << 3 | 4);
+            byte(0x24);
+        } else {
+            byte(0x80 | (reg & 7) << 3 | (mem.base & 7));
+        }
+        dword(static_cast<uint32_t>(mem.disp));
+    }
+
+    std::vector<uint8_t> code_;
+    std::vector<size_t> labels_;
+    std::vector<std::pair<size_t, Label>> fixups_;
+};
+
+#endif
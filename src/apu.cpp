@@ -0,0 +1,483 @@
+#include "../inc/apu.hpp"
+#include "../inc/audio_ring.hpp"
+#include "../inc/save_state.hpp"
+#include "../inc/scheduler.hpp"
+#include <algorithm>
+#include <cstring>
+
+// Bits read back as 1 for each register in FF10-FF2F (write-only or unused bits)
+static const uint8_t REGISTER_READ_MASKS[0x20] = {
+    0x80, 0x3F, 0x00, 0xFF, 0xBF,  // NR10-NR14
+    0xFF, 0x3F, 0x00, 0xFF, 0xBF,  // (unused), NR21-NR24
+    0x7F, 0xFF, 0x9F, 0xFF, 0xBF,  // NR30-NR34
+    0xFF, 0xFF, 0x00, 0x00, 0xBF,  // (unused), NR41-NR44
+    0x00, 0x00, 0x70,              // NR50-NR52
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+// One bit per duty step, 12.5%, 25%, 50% and 75%
+static const uint8_t DUTY_PATTERNS[4] = {0x80, 0x81, 0xE1, 0x7E};
+static const uint8_t WAVE_VOLUME_SHIFTS[4] = {4, 0, 1, 2};
+
+// Largest mix is 4 channels * level 15 * master volume 8
+static const int32_t AMPLITUDE_SCALE = 32;
+static const size_t BLIP_MAX_SAMPLES = 4096;
+
+APU::APU(Scheduler* scheduler)
+    : scheduler_(scheduler)
+    , left_(DMG_CLOCK_SPEED, APU_SAMPLE_RATE, BLIP_MAX_SAMPLES)
+    , right_(DMG_CLOCK_SPEED, APU_SAMPLE_RATE, BLIP_MAX_SAMPLES)
+    , mix_buffer_(BLIP_MAX_SAMPLES * 2) {
+    std::memset(&square1_, 0, sizeof(square1_));
+    std::memset(&square2_, 0, sizeof(square2_));
+    std::memset(&wave_, 0, sizeof(wave_));
+    std::memset(&noise_, 0, sizeof(noise_));
+
+    // Post-boot mixer settings; the boot chime has already finished
+    registers_[NR50_REGISTER_LOCATION - SOUND_REGISTERS_START] = 0x77;
+    registers_[NR51_REGISTER_LOCATION - SOUND_REGISTERS_START] = 0xF3;
+
+    scheduler_->set_handler(EVENT_APU_FLUSH, [this]() { flush(); });
+    scheduler_->schedule(EVENT_APU_FLUSH, APU_FLUSH_CYCLES);
+}
+
+void APU::set_output(AudioRing* ring) {
+    ring_ = ring;
+    restart_output();
+}
+
+void APU::set_output_enabled(bool enabled) {
+    if (enabled == output_enabled_) {
+        return;
+    }
+    output_enabled_ = enabled;
+    if (!enabled || !ring_) {
+        return;
+    }
+    // Muted stretches normally end with a state load back to where output stopped
+    if (current_time_ < output_start_time_
+        || current_time_ - output_start_time_ > left_.max_frame_clocks()) {
+        restart_output();
+    } else {
+        update_output(current_time_);
+    }
+}
+
+void APU::restart_output() {
+    left_.clear();
+    right_.clear();
+    output_start_time_ = current_time_;
+    emitted_left_ = 0;
+    emitted_right_ = 0;
+    update_output(current_time_);
+}
+
+void APU::flush() {
+    run_until(scheduler_->now());
+    scheduler_->schedule(EVENT_APU_FLUSH, APU_FLUSH_CYCLES);
+    if (!ring_ || !output_enabled_) {
+        return;
+    }
+
+    uint32_t duration = static_cast<uint32_t>(current_time_ - output_start_time_);
+    left_.end_frame(duration);
+    right_.end_frame(duration);
+    output_start_time_ = current_time_;
+
+    size_t count = left_.samples_available();
+    left_.read_samples(mix_buffer_.data(), count, 2);
+    right_.read_samples(mix_buffer_.data() + 1, count, 2);
+    ring_->push(mix_buffer_.data(), count);
+    samples_produced_ += count;
+}
+
+void APU::run_until(uint64_t time) {
+    if (!powered_) {
+        current_time_ = std::max(current_time_, time);
+        return;
+    }
+
+    // Jump straight to the next waveform step, frame sequencer tick or the target time
+    while (current_time_ < time) {
+        uint64_t step = std::min<uint64_t>(time - current_time_, frame_sequencer_timer_);
+        if (square1_.enabled) step = std::min<uint64_t>(step, square1_.timer);
+        if (square2_.enabled) step = std::min<uint64_t>(step, square2_.timer);
+        if (wave_.enabled) step = std::min<uint64_t>(step, wave_.timer);
+        if (noise_.enabled) step = std::min<uint64_t>(step, noise_.timer);
+
+        uint32_t elapsed = static_cast<uint32_t>(step);
+        current_time_ += step;
+        frame_sequencer_timer_ -= elapsed;
+        bool changed = false;
+
+        if (square1_.enabled && (square1_.timer -= elapsed) == 0) {
+            square1_.timer = square_period(square1_.frequency);
+            square1_.duty_step = (square1_.duty_step + 1) & 7;
+            changed = true;
+        }
+        if (square2_.enabled && (square2_.timer -= elapsed) == 0) {
+            square2_.timer = square_period(square2_.frequency);
+            square2_.duty_step = (square2_.duty_step + 1) & 7;
+            changed = true;
+        }
+        if (wave_.enabled && (wave_.timer -= elapsed) == 0) {
+            wave_.timer = wave_period(wave_.frequency);
+            wave_.position = (wave_.position + 1) & 31;
+            uint8_t byte = wave_ram_[wave_.position >> 1];
+            wave_.sample = (wave_.position & 1) ? (byte & 0x0F) : (byte >> 4);
+            changed = true;
+        }
+        if (noise_.enabled && (noise_.timer -= elapsed) == 0) {
+            noise_.timer = noise_period();
+            uint16_t feedback = (noise_.lfsr ^ (noise_.lfsr >> 1)) & 1;
+            noise_.lfsr = static_cast<uint16_t>((noise_.lfsr >> 1) | (feedback << 14));
+            if (noise_.narrow) {
+                noise_.lfsr = static_cast<uint16_t>((noise_.lfsr & ~0x40) | (feedback << 6));
+            }
+            changed = true;
+        }
+        if (frame_sequencer_timer_ == 0) {
+            frame_sequencer_timer_ = FRAME_SEQUENCER_CYCLES;
+            clock_frame_sequencer();
+            changed = true;
+        }
+
+        if (changed) {
+            update_output(current_time_);
+        }
+    }
+}
+
+void APU::clock_frame_sequencer() {
+    // Length on even steps, sweep on 2 and 6, envelope on 7
+    if ((frame_sequencer_step_ & 1) == 0) {
+        clock_length(square1_);
+        clock_length(square2_);
+        clock_length(wave_);
+        clock_length(noise_);
+    }
+    if (frame_sequencer_step_ == 2 || frame_sequencer_step_ == 6) {
+        clock_sweep();
+    }
+    if (frame_sequencer_step_ == 7) {
+        clock_envelope(square1_.envelope);
+        clock_envelope(square2_.envelope);
+        clock_envelope(noise_.envelope);
+    }
+    frame_sequencer_step_ = (frame_sequencer_step_ + 1) & 7;
+}
+
+template <typename Channel>
+void APU::clock_length(Channel& channel) {
+    if (channel.length_enabled && channel.length_counter > 0) {
+        if (--channel.length_counter == 0) {
+            channel.enabled = false;
+        }
+    }
+}
+
+void APU::clock_envelope(Envelope& envelope) {
+    if (envelope.period == 0) {
+        return;
+    }
+    if (envelope.timer > 0) {
+        envelope.timer--;
+    }
+    if (envelope.timer == 0) {
+        envelope.timer = envelope.period;
+        if (envelope.increase && envelope.volume < 15) {
+            envelope.volume++;
+        } else if (!envelope.increase && envelope.volume > 0) {
+            envelope.volume--;
+        }
+    }
+}
+
+void APU::load_envelope(Envelope& envelope, uint8_t value) {
+    envelope.initial_volume = value >> 4;
+    envelope.increase = (value & 0x08) != 0;
+    envelope.period = value & 0x07;
+}
+
+uint16_t APU::sweep_target() {
+    uint16_t delta = square1_.shadow_frequency >> square1_.sweep_shift;
+    uint16_t target = square1_.sweep_negate
+        ? static_cast<uint16_t>(square1_.shadow_frequency - delta)
+        : static_cast<uint16_t>(square1_.shadow_frequency + delta);
+    if (target > 2047) {
+        square1_.enabled = false;
+    }
+    return target;
+}
+
+void APU::clock_sweep() {
+    if (square1_.sweep_timer > 0) {
+        square1_.sweep_timer--;
+    }
+    if (square1_.sweep_timer != 0) {
+        return;
+    }
+    square1_.sweep_timer = square1_.sweep_period ? square1_.sweep_period : 8;
+    if (!square1_.sweep_enabled || square1_.sweep_period == 0) {
+        return;
+    }
+    uint16_t target = sweep_target();
+    if (target <= 2047 && square1_.sweep_shift != 0) {
+        square1_.shadow_frequency = target;
+        square1_.frequency = target;
+        // The new frequency is checked again immediately
+        sweep_target();
+    }
+}
+
+uint32_t APU::noise_period() const {
+    uint32_t divisor = noise_.divisor_code == 0 ? 8 : noise_.divisor_code * 16u;
+    return divisor << noise_.clock_shift;
+}
+
+void APU::trigger_square(SquareChannel& channel, bool has_sweep) {
+    channel.enabled = channel.dac_enabled;
+    if (channel.length_counter == 0) {
+        channel.length_counter = 64;
+    }
+    channel.timer = square_period(channel.frequency);
+    channel.envelope.volume = channel.envelope.initial_volume;
+    channel.envelope.timer = channel.envelope.period;
+    if (has_sweep) {
+        channel.shadow_frequency = channel.frequency;
+        channel.sweep_timer = channel.sweep_period ? channel.sweep_period : 8;
+        channel.sweep_enabled = channel.sweep_period != 0 || channel.sweep_shift != 0;
+        if (channel.sweep_shift != 0) {
+            sweep_target();
+        }
+    }
+}
+
+void APU::trigger_wave() {
+    wave_.enabled = wave_.dac_enabled;
+    if (wave_.length_counter == 0) {
+        wave_.length_counter = 256;
+    }
+    wave_.timer = wave_period(wave_.frequency);
+    wave_.position = 0;
+}
+
+void APU::trigger_noise() {
+    noise_.enabled = noise_.dac_enabled;
+    if (noise_.length_counter == 0) {
+        noise_.length_counter = 64;
+    }
+    noise_.timer = noise_period();
+    noise_.envelope.volume = noise_.envelope.initial_volume;
+    noise_.envelope.timer = noise_.envelope.period;
+    noise_.lfsr = 0x7FFF;
+}
+
+void APU::power_off() {
+    registers_.fill(0);
+    std::memset(&square1_, 0, sizeof(square1_));
+    std::memset(&square2_, 0, sizeof(square2_));
+    std::memset(&wave_, 0, sizeof(wave_));
+    std::memset(&noise_, 0, sizeof(noise_));
+    powered_ = false;
+}
+
+uint8_t APU::read_register(uint16_t address) {
+    run_until(scheduler_->now());
+    if (address >= WAVE_RAM_START) {
+        return wave_ram_[address - WAVE_RAM_START];
+    }
+    if (address == NR52_REGISTER_LOCATION) {
+        return (powered_ ? 0x80 : 0x00) | 0x70
+            | (square1_.enabled ? 0x01 : 0x00)
+            | (square2_.enabled ? 0x02 : 0x00)
+            | (wave_.enabled ? 0x04 : 0x00)
+            | (noise_.enabled ? 0x08 : 0x00);
+    }
+    uint16_t index = address - SOUND_REGISTERS_START;
+    return registers_[index] | REGISTER_READ_MASKS[index];
+}
+
+void APU::write_register(uint16_t address, uint8_t value) {
+    run_until(scheduler_->now());
+    if (address >= WAVE_RAM_START) {
+        wave_ram_[address - WAVE_RAM_START] = value;
+        return;
+    }
+    if (address == NR52_REGISTER_LOCATION) {
+        bool power = (value & 0x80) != 0;
+        if (!power && powered_) {
+            power_off();
+        } else if (power && !powered_) {
+            powered_ = true;
+            frame_sequencer_step_ = 0;
+            frame_sequencer_timer_ = FRAME_SEQUENCER_CYCLES;
+        }
+        update_output(current_time_);
+        return;
+    }
+    // Only NR52 and wave RAM are writable while powered off
+    if (!powered_) {
+        return;
+    }
+    registers_[address - SOUND_REGISTERS_START] = value;
+
+    switch (address) {
+        case NR10_REGISTER_LOCATION:
+            square1_.sweep_period = (value >> 4) & 0x07;
+            square1_.sweep_negate = (value & 0x08) != 0;
+            square1_.sweep_shift = value & 0x07;
+            break;
+        case NR11_REGISTER_LOCATION:
+        case NR21_REGISTER_LOCATION: {
+            SquareChannel& channel = address == NR11_REGISTER_LOCATION ? square1_ : square2_;
+            channel.duty = value >> 6;
+            channel.length_counter = 64 - (value & 0x3F);
+            break;
+        }
+        case NR12_REGISTER_LOCATION:
+        case NR22_REGISTER_LOCATION: {
+            SquareChannel& channel = address == NR12_REGISTER_LOCATION ? square1_ : square2_;
+            load_envelope(channel.envelope, value);
+            channel.dac_enabled = (value & 0xF8) != 0;
+            channel.enabled = channel.enabled && channel.dac_enabled;
+            break;
+        }
+        case NR13_REGISTER_LOCATION:
+        case NR23_REGISTER_LOCATION: {
+            SquareChannel& channel = address == NR13_REGISTER_LOCATION ? square1_ : square2_;
+            channel.frequency = (channel.frequency & 0x0700) | value;
+            break;
+        }
+        case NR14_REGISTER_LOCATION:
+        case NR24_REGISTER_LOCATION: {
+            bool first = address == NR14_REGISTER_LOCATION;
+            SquareChannel& channel = first ? square1_ : square2_;
+            channel.frequency = static_cast<uint16_t>((channel.frequency & 0x00FF) | ((value & 0x07) << 8));
+            channel.length_enabled = (value & 0x40) != 0;
+            if (value & 0x80) {
+                trigger_square(channel, first);
+            }
+            break;
+        }
+        case NR30_REGISTER_LOCATION:
+            wave_.dac_enabled = (value & 0x80) != 0;
+            wave_.enabled = wave_.enabled && wave_.dac_enabled;
+            break;
+        case NR31_REGISTER_LOCATION:
+            wave_.length_counter = 256 - value;
+            break;
+        case NR32_REGISTER_LOCATION:
+            wave_.volume_code = (value >> 5) & 0x03;
+            break;
+        case NR33_REGISTER_LOCATION:
+            wave_.frequency = (wave_.frequency & 0x0700) | value;
+            break;
+        case NR34_REGISTER_LOCATION:
+            wave_.frequency = static_cast<uint16_t>((wave_.frequency & 0x00FF) | ((value & 0x07) << 8));
+            wave_.length_enabled = (value & 0x40) != 0;
+            if (value & 0x80) {
+                trigger_wave();
+            }
+            break;
+        case NR41_REGISTER_LOCATION:
+            noise_.length_counter = 64 - (value & 0x3F);
+            break;
+        case NR42_REGISTER_LOCATION:
+            load_envelope(noise_.envelope, value);
+            noise_.dac_enabled = (value & 0xF8) != 0;
+            noise_.enabled = noise_.enabled && noise_.dac_enabled;
+            break;
+        case NR43_REGISTER_LOCATION:
+            noise_.clock_shift = value >> 4;
+            noise_.narrow = (value & 0x08) != 0;
+            noise_.divisor_code = value & 0x07;
+            break;
+        case NR44_REGISTER_LOCATION:
+            noise_.length_enabled = (value & 0x40) != 0;
+            if (value & 0x80) {
+                trigger_noise();
+            }
+            break;
+        default:
+            break;  // NR50, NR51 and unused registers only need read-back
+    }
+    update_output(current_time_);
+}
+
+uint8_t APU::square_level(const SquareChannel& channel) const {
+    if (!channel.enabled) {
+        return 0;
+    }
+    return ((DUTY_PATTERNS[channel.duty] >> channel.duty_step) & 1) ? channel.envelope.volume : 0;
+}
+
+uint8_t APU::wave_level() const {
+    return wave_.enabled ? wave_.sample >> WAVE_VOLUME_SHIFTS[wave_.volume_code] : 0;
+}
+
+uint8_t APU::noise_level() const {
+    return (noise_.enabled && !(noise_.lfsr & 1)) ? noise_.envelope.volume : 0;
+}
+
+void APU::update_output(uint64_t time) {
+    if (!ring_ || !output_enabled_) {
+        return;
+    }
+    uint8_t levels[4] = {square_level(square1_), square_level(square2_), wave_level(), noise_level()};
+    uint8_t panning = registers_[NR51_REGISTER_LOCATION - SOUND_REGISTERS_START];
+    uint8_t volume = registers_[NR50_REGISTER_LOCATION - SOUND_REGISTERS_START];
+
+    int32_t left = 0;
+    int32_t right = 0;
+    for (int i = 0; i < 4; i++) {
+        if (panning & (0x10 << i)) left += levels[i];
+        if (panning & (0x01 << i)) right += levels[i];
+    }
+    left *= (((volume >> 4) & 0x07) + 1) * AMPLITUDE_SCALE;
+    right *= ((volume & 0x07) + 1) * AMPLITUDE_SCALE;
+
+    uint32_t offset = static_cast<uint32_t>(time - output_start_time_);
+    if (left != emitted_left_) {
+        left_.add_delta(offset, left - emitted_left_);
+        emitted_left_ = left;
+    }
+    if (right != emitted_right_) {
+        right_.add_delta(offset, right - emitted_right_);
+        emitted_right_ = right;
+    }
+}
+
+void APU::save_state(StateWriter& writer) const {
+    writer.write(registers_);
+    writer.write(wave_ram_);
+    writer.write(powered_);
+    writer.write(square1_);
+    writer.write(square2_);
+    writer.write(wave_);
+    writer.write(noise_);
+    writer.write(frame_sequencer_step_);
+    writer.write(frame_sequencer_timer_);
+    writer.write(current_time_);
+}
+
+void APU::load_state(StateReader& reader) {
+    reader.read(registers_);
+    reader.read(wave_ram_);
+    reader.read(powered_);
+    reader.read(square1_);
+    reader.read(square2_);
+    reader.read(wave_);
+    reader.read(noise_);
+    reader.read(frame_sequencer_step_);
+    reader.read(frame_sequencer_timer_);
+    reader.read(current_time_);
+
+    // Run-ahead loads land back where output was muted; anything else restarts the stream
+    if (current_time_ < output_start_time_
+        || current_time_ - output_start_time_ > left_.max_frame_clocks()) {
+        restart_output();
+    } else {
+        update_output(current_time_);
+    }
+}
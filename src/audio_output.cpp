@@ -0,0 +1,115 @@
+#include "../inc/audio_output.hpp"
+#include "../inc/constants.hpp"
+#include <algorithm>
+#include <chrono>
+
+static const size_t INPUT_BLOCK_FRAMES = 1024;
+static const size_t OUTPUT_BLOCK_FRAMES = 1024;
+static const auto DRAIN_IDLE_SLEEP = std::chrono::milliseconds(2);
+static const auto DEVICE_PERIOD = std::chrono::milliseconds(2);
+
+// Rate control: the ring fill is smoothed, then a full-scale error changes the
+// ratio by at most MAX_RATE_DEVIATION, which is far below audible pitch shift
+static const double MAX_RATE_DEVIATION = 0.005;
+static const double FILL_SMOOTHING = 0.02;
+
+AudioOutput::AudioOutput(AudioRing* ring, std::unique_ptr<AudioSink> sink, uint32_t output_rate, bool realtime)
+    : ring_(ring)
+    , sink_(std::move(sink))
+    , output_rate_(output_rate)
+    , realtime_(realtime)
+    , target_fill_(std::min(AUDIO_LATENCY_FRAMES, ring->capacity() / 2))
+    , resampler_(APU_SAMPLE_RATE, output_rate)
+    , input_block_(INPUT_BLOCK_FRAMES * 2)
+    , output_block_(OUTPUT_BLOCK_FRAMES * 2) {}
+
+AudioOutput::~AudioOutput() {
+    stop();
+}
+
+void AudioOutput::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    thread_ = std::thread(&AudioOutput::run, this);
+}
+
+void AudioOutput::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    thread_.join();
+    while (ring_->size() > 0 && convert(OUTPUT_BLOCK_FRAMES, false) > 0) {
+    }
+    sink_->close();
+}
+
+size_t AudioOutput::convert(size_t output_frames, bool pad) {
+    size_t written = 0;
+    while (written < output_frames) {
+        size_t chunk = std::min(output_frames - written, OUTPUT_BLOCK_FRAMES);
+        size_t needed = resampler_.input_needed(chunk);
+        while (needed > 0) {
+            size_t count = ring_->pop(input_block_.data(), std::min(needed, INPUT_BLOCK_FRAMES));
+            if (count == 0) {
+                break;
+            }
+            resampler_.push(input_block_.data(), count);
+            needed -= count;
+        }
+
+        size_t produced = resampler_.pull(output_block_.data(), chunk);
+        if (produced < chunk && pad) {
+            // The device clock does not wait, so an empty ring becomes silence
+            std::fill(output_block_.begin() + produced * 2, output_block_.begin() + chunk * 2, 0);
+            underruns_.fetch_add(1, std::memory_order_relaxed);
+            produced = chunk;
+        }
+        if (produced == 0) {
+            break;
+        }
+        sink_->write(output_block_.data(), produced);
+        frames_written_.fetch_add(produced, std::memory_order_relaxed);
+        written += produced;
+    }
+    return written;
+}
+
+void AudioOutput::run() {
+    if (realtime_) {
+        run_realtime();
+        return;
+    }
+    while (running_.load(std::memory_order_acquire)) {
+        if (convert(OUTPUT_BLOCK_FRAMES, false) == 0) {
+            std::this_thread::sleep_for(DRAIN_IDLE_SLEEP);
+        }
+    }
+}
+
+void AudioOutput::run_realtime() {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    uint64_t frames_out = 0;
+    double fill = static_cast<double>(target_fill_);
+
+    while (running_.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(DEVICE_PERIOD);
+
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        uint64_t due = static_cast<uint64_t>(elapsed * output_rate_);
+        if (due - frames_out > output_rate_ / 10) {
+            // The thread was starved for a long time; don't try to catch up in one burst
+            frames_out = due - OUTPUT_BLOCK_FRAMES;
+        }
+
+        fill += (static_cast<double>(ring_->size()) - fill) * FILL_SMOOTHING;
+        double error = (fill - target_fill_) / target_fill_;
+        error = std::max(-1.0, std::min(1.0, error));
+        double adjust = 1.0 + MAX_RATE_DEVIATION * error;
+        resampler_.set_rate_adjust(adjust);
+        rate_adjust_.store(adjust, std::memory_order_relaxed);
+
+        frames_out += convert(static_cast<size_t>(due - frames_out), true);
+    }
+}
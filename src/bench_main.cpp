@@ -0,0 +1,503 @@
+// Benchmark suite for the emulator core, built and run by `make bench`.
+//
+// Micro-benchmarks time one component in isolation: instruction dispatch over
+// a synthetic loop, MMU reads and writes per memory region, MBC bank
+// switching, Timer::update_timer, PPU line rendering, and the per-frame cost
+// of save states and rewind capture and restore. Macro-benchmarks run
+// whole ROMs headless for a fixed number of emulated cycles in each execution
+// mode. Every figure is the best of --repeat runs, and the results are written
+// as one JSON document so they can be compared commit by commit.
+
+#include "../inc/cpu.hpp"
+#include "../inc/game_boy_emulator.hpp"
+#include "../inc/interrupt_controller.hpp"
+#include "../inc/joypad.hpp"
+#include "../inc/mmu.hpp"
+#include "../inc/ppu.hpp"
+#include "../inc/rewind_buffer.hpp"
+#include "../inc/scheduler.hpp"
+#include "../inc/serial.hpp"
+#include "../inc/timer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const uint64_t DEFAULT_MACRO_CYCLES = 100000000;  // ~24 emulated seconds
+static const int DEFAULT_REPEAT = 3;
+
+static const uint64_t DISPATCH_INSTRUCTIONS = 20000000;
+static const uint64_t MMU_ACCESSES = 20000000;
+static const uint64_t BANK_SWITCHES = 10000000;
+static const uint64_t TIMER_UPDATES = 50000000;
+static const uint64_t PPU_LINES = 200000;
+static const uint64_t REWIND_FRAMES = 600;  // States of consecutive frames of the ROM
+
+// Keeps benchmarked reads from being optimized away
+static volatile uint32_t sink;
+
+// The components of one emulator, wired like GameBoyEmulator's
+struct Machine {
+    explicit Machine(const std::string& rom_path)
+        : timer(&interrupt_controller)
+        , joypad(&interrupt_controller)
+        , serial(&interrupt_controller, &scheduler)
+        , ppu(&interrupt_controller)
+        , apu(&scheduler)
+        , mmu(Cartridge::read_rom_file(rom_path), &interrupt_controller, &timer, &joypad, &serial, &ppu, &apu)
+        , cpu(&mmu, &interrupt_controller) {}
+
+    InterruptController interrupt_controller;
+    Scheduler scheduler;
+    Timer timer;
+    Joypad joypad;
+    Serial serial;
+    PPU ppu;
+    APU apu;
+    MMU mmu;
+    CPU cpu;
+};
+
+// Runs CPU::run() for a fixed number of instructions without other components
+class CountingClock : public InstructionClock {
+public:
+    explicit CountingClock(uint64_t instructions) : remaining_(instructions) {}
+    bool tick(uint32_t) override { return --remaining_ > 0; }
+    void advance(uint32_t) override {}
+private:
+    uint64_t remaining_;
+};
+
+struct MicroResult {
+    std::string name;
+    uint64_t operations;
+    double seconds;
+    bool instructions;  // Operations are guest instructions (report MIPS)
+};
+
+struct MacroResult {
+    std::string rom;
+    std::string mode;
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t frames;
+    double seconds;
+};
+
+// Best wall time of `repeat` runs of `body`
+template <typename Body>
+static double best_seconds(int repeat, Body&& body) {
+    double best = 0.0;
+    for (int i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+// 32 KiB ROM-only cartridge: jumps to 0x0150 and loops over a mix of loads,
+// ALU, CB, memory and stack instructions (16 per iteration)
+static bool write_dispatch_rom(const std::string& path) {
+    static const uint8_t ENTRY[] = {0xC3, 0x50, 0x01};  // JP 0x0150
+    static const uint8_t PROGRAM[] = {
+        0x31, 0xFE, 0xDF,  // LD SP,0xDFFE
+        0x21, 0x00, 0xC0,  // LD HL,0xC000
+        // loop:
+        0x78,              // LD A,B
+        0x3C,              // INC A
+        0x81,              // ADD A,C
+        0xAA,              // XOR D
+        0x47,              // LD B,A
+        0x1D,              // DEC E
+        0x77,              // LD (HL),A
+        0x2C,              // INC L
+        0xCB, 0x37,        // SWAP A
+        0xCB, 0x47,        // BIT 0,A
+        0xE6, 0x0F,        // AND 0x0F
+        0xB4,              // OR H
+        0xFE, 0x10,        // CP 0x10
+        0xC5,              // PUSH BC
+        0xC1,              // POP BC
+        0x18, 0xEB         // JR loop
+    };
+    std::vector<uint8_t> rom(2 * SWITCHABLE_ROM_SIZE, 0x00);
+    std::memcpy(&rom[PROGRAM_COUNTER_START], ENTRY, sizeof(ENTRY));
+    std::memcpy(&rom[0x0150], PROGRAM, sizeof(PROGRAM));
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(rom.data()), rom.size());
+    return static_cast<bool>(file);
+}
+
+static void bench_dispatch(int repeat, std::vector<MicroResult>& results) {
+    std::string rom_path = (std::filesystem::temp_directory_path() / "gameboy-bench-dispatch.gb").string();
+    if (!write_dispatch_rom(rom_path)) {
+        std::cerr << "Error: could not write " << rom_path << std::endl;
+        return;
+    }
+
+    struct Variant {
+        const char* name;
+        bool block_cache;
+        bool run_loop;
+    };
+    static const Variant VARIANTS[] = {
+        {"dispatch_decode", false, false},
+        {"dispatch_block_cache", true, false},
+        {"dispatch_run_loop", true, true},
+    };
+    for (const Variant& variant : VARIANTS) {
+        double seconds = best_seconds(repeat, [&] {
+            Machine machine(rom_path);
+            machine.cpu.set_block_cache_enabled(variant.block_cache);
+            if (variant.run_loop) {
+                CountingClock clock(DISPATCH_INSTRUCTIONS);
+                machine.cpu.run(clock);
+            } else {
+                for (uint64_t i = 0; i < DISPATCH_INSTRUCTIONS; i++) {
+                    machine.cpu.execute_next_instruction();
+                }
+            }
+        });
+        results.push_back({variant.name, DISPATCH_INSTRUCTIONS, seconds, true});
+    }
+    std::filesystem::remove(rom_path);
+}
+
+static void bench_mmu(const std::string& rom_path, int repeat, std::vector<MicroResult>& results) {
+    struct Region {
+        const char* name;
+        uint16_t base;
+        uint16_t mask;  // Addresses cycle through base + (i & mask)
+        bool readable;
+        bool writable;
+    };
+    static const Region REGIONS[] = {
+        {"rom0", STATIC_ROM_START, STATIC_ROM_SIZE - 1, true, false},
+        {"romx", SWITCHABLE_ROM_START, SWITCHABLE_ROM_SIZE - 1, true, false},
+        {"vram", VRAM_START, VRAM_SIZE - 1, true, true},
+        {"eram", SWITCHABLE_RAM_START, SWITCHABLE_RAM_SIZE - 1, true, false},
+        {"wram", INTERNAL_RAM_START, INTERNAL_RAM_SIZE - 1, true, true},
+        {"oam", SPRITE_ATTRIBUTES_START, 0x7F, true, true},
+        {"io_lcd", LCDC_REGISTER_LOCATION, 0x07, true, false},  // LCDC..BGP
+        {"io_bgp", BGP_REGISTER_LOCATION, 0x00, false, true},
+        {"hram", HIGH_RAM_START, 0x3F, true, true},
+    };
+    Machine machine(rom_path);
+    for (const Region& region : REGIONS) {
+        if (region.readable) {
+            double seconds = best_seconds(repeat, [&] {
+                uint32_t sum = 0;
+                for (uint64_t i = 0; i < MMU_ACCESSES; i++) {
+                    sum += machine.mmu.read_memory_8(static_cast<uint16_t>(region.base + (i & region.mask)));
+                }
+                sink = sum;
+            });
+            results.push_back({std::string("mmu_read_") + region.name, MMU_ACCESSES, seconds, false});
+        }
+        if (region.writable) {
+            double seconds = best_seconds(repeat, [&] {
+                for (uint64_t i = 0; i < MMU_ACCESSES; i++) {
+                    machine.mmu.write_memory_8(static_cast<uint16_t>(region.base + (i & region.mask)),
+                                               static_cast<uint8_t>(i));
+                }
+            });
+            results.push_back({std::string("mmu_write_") + region.name, MMU_ACCESSES, seconds, false});
+        }
+    }
+}
+
+static void bench_bank_switch(const std::string& rom_path, int repeat, std::vector<MicroResult>& results) {
+    Machine machine(rom_path);
+    size_t banks = std::max<size_t>(machine.mmu.rom_size() / SWITCHABLE_ROM_SIZE, 2);
+    double seconds = best_seconds(repeat, [&] {
+        uint32_t sum = 0;
+        for (uint64_t i = 0; i < BANK_SWITCHES; i++) {
+            machine.mmu.write_memory_8(ROM_BANK_SELECT_START, static_cast<uint8_t>(1 + i % (banks - 1)));
+            sum += machine.mmu.read_memory_8(SWITCHABLE_ROM_START);
+        }
+        sink = sum;
+    });
+    results.push_back({"mbc_bank_switch", BANK_SWITCHES, seconds, false});
+}
+
+static void bench_timer(const std::string& rom_path, int repeat, std::vector<MicroResult>& results) {
+    Machine machine(rom_path);
+    machine.timer.write_timer(TAC_REGISTER_LOCATION, 0x05);  // Enabled, 262144 Hz
+    double seconds = best_seconds(repeat, [&] {
+        for (uint64_t i = 0; i < TIMER_UPDATES; i++) {
+            machine.timer.update_timer(4);
+        }
+    });
+    results.push_back({"timer_update", TIMER_UPDATES, seconds, false});
+}
+
+static void bench_ppu(const std::string& rom_path, int repeat, std::vector<MicroResult>& results) {
+    Machine machine(rom_path);
+    // Patterned tiles, background, window and ten sprites per visible line
+    for (uint16_t addr = VRAM_START; addr <= VRAM_END; addr++) {
+        machine.ppu.write_vram(addr, static_cast<uint8_t>(addr * 7 + (addr >> 8)));
+    }
+    for (uint16_t i = 0; i < SPRITE_ATTRIBUTES_SIZE; i += 4) {
+        machine.ppu.write_oam(SPRITE_ATTRIBUTES_START + i, static_cast<uint8_t>(16 + (i / 4) * 8 % 144));
+        machine.ppu.write_oam(SPRITE_ATTRIBUTES_START + i + 1, static_cast<uint8_t>(8 + i * 4 % 160));
+        machine.ppu.write_oam(SPRITE_ATTRIBUTES_START + i + 2, static_cast<uint8_t>(i));
+        machine.ppu.write_oam(SPRITE_ATTRIBUTES_START + i + 3, static_cast<uint8_t>(i << 3));
+    }
+    machine.ppu.write_register(WY_REGISTER_LOCATION, 72);
+    machine.ppu.write_register(WX_REGISTER_LOCATION, 87);
+    machine.ppu.write_register(LCDC_REGISTER_LOCATION, 0xF3);  // LCD, window, sprites and background on
+    machine.ppu.set_render_interval(1);
+
+    // Stepped one M-cycle at a time like the interpreter does; VBlank lines
+    // are included, so this is the cost of an average line of a full frame
+    double seconds = best_seconds(repeat, [&] {
+        for (uint64_t line = 0; line < PPU_LINES; line++) {
+            for (uint32_t cycles = 0; cycles < LINE_CYCLES; cycles += 4) {
+                machine.ppu.step(4);
+            }
+        }
+        machine.ppu.take_frame_complete();
+    });
+    results.push_back({"ppu_line", PPU_LINES, seconds, false});
+}
+
+static void bench_rewind(const std::string& rom_path, int repeat, std::vector<MicroResult>& results) {
+    // Real states change a little each frame, which is what the deltas rely on
+    GameBoyEmulator emulator(Cartridge::read_rom_file(rom_path));
+    emulator.set_pacing(PacingMode::Uncapped);
+    std::vector<std::vector<uint8_t>> states(REWIND_FRAMES);
+    for (std::vector<uint8_t>& state : states) {
+        emulator.run_frame();
+        emulator.save_state(state);
+    }
+
+    std::vector<uint8_t> state;
+    double seconds = best_seconds(repeat, [&] {
+        for (uint64_t i = 0; i < REWIND_FRAMES; i++) {
+            emulator.save_state(state);
+        }
+    });
+    results.push_back({"state_save", REWIND_FRAMES, seconds, false});
+    seconds = best_seconds(repeat, [&] {
+        for (const std::vector<uint8_t>& frame : states) {
+            emulator.load_state(frame);
+        }
+    });
+    results.push_back({"state_load", REWIND_FRAMES, seconds, false});
+
+    RewindBuffer buffer(REWIND_ARENA_BYTES, REWIND_SECONDS * FRAMES_PER_SECOND, REWIND_KEYFRAME_INTERVAL);
+    seconds = best_seconds(repeat, [&] {
+        buffer.clear();
+        for (const std::vector<uint8_t>& frame : states) {
+            buffer.capture(frame);
+        }
+    });
+    results.push_back({"rewind_capture", REWIND_FRAMES, seconds, false});
+
+    // Restoring pops the ring, so it is refilled outside the timed part
+    double best = 0.0;
+    for (int i = 0; i < repeat; i++) {
+        buffer.clear();
+        for (const std::vector<uint8_t>& frame : states) {
+            buffer.capture(frame);
+        }
+        auto start = std::chrono::steady_clock::now();
+        while (buffer.rewind(state)) {
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = i == 0 ? seconds : std::min(best, seconds);
+    }
+    results.push_back({"rewind_restore", REWIND_FRAMES, best, false});
+}
+
+static void bench_rom(const std::string& rom_path, uint64_t cycles, int repeat, std::vector<MacroResult>& results) {
+    enum class Mode { BlockCache, Decode, Jit, Exact };
+    struct Variant {
+        const char* name;
+        Mode mode;
+    };
+    static const Variant VARIANTS[] = {
+        {"block_cache", Mode::BlockCache},
+        {"decode", Mode::Decode},
+        {"jit", Mode::Jit},
+        {"exact_timing", Mode::Exact},
+    };
+    std::string rom_name = std::filesystem::path(rom_path).filename().string();
+    for (const Variant& variant : VARIANTS) {
+        MacroResult result = {rom_name, variant.name, 0, 0, 0, 0.0};
+        bool available = true;
+        result.seconds = best_seconds(repeat, [&] {
+            GameBoyEmulator emulator(Cartridge::read_rom_file(rom_path));
+            emulator.set_pacing(PacingMode::Uncapped);
+            emulator.set_block_cache(variant.mode != Mode::Decode);
+            emulator.set_exact_timing(variant.mode == Mode::Exact);
+            if (variant.mode == Mode::Jit && !emulator.set_jit(true)) {
+                available = false;
+                return;
+            }
+            uint64_t emulated = 0;
+            uint64_t frames = 0;
+            uint32_t last = emulator.cycles_executed();
+            while (emulated < cycles) {
+                emulator.run_frame();
+                uint32_t now = emulator.cycles_executed();
+                emulated += now - last;
+                last = now;
+                frames++;
+            }
+            result.cycles = emulated;
+            result.instructions = emulator.instructions_executed();
+            result.frames = frames;
+        });
+        if (available) {
+            results.push_back(result);
+        }
+    }
+}
+
+static std::string json_string(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+static void write_json(std::ostream& out, const std::string& label, const std::vector<MicroResult>& micro,
+                       const std::vector<MacroResult>& macro) {
+    out << std::fixed;
+    out << "{\n";
+    out << "  \"label\": " << json_string(label) << ",\n";
+#ifdef THREADED_DISPATCH
+    out << "  \"dispatch\": \"threaded\",\n";
+#else
+    out << "  \"dispatch\": \"call\",\n";
+#endif
+    out << "  \"micro\": [\n";
+    for (size_t i = 0; i < micro.size(); i++) {
+        const MicroResult& r = micro[i];
+        double ns = r.seconds * 1e9 / r.operations;
+        out << "    {\"name\": " << json_string(r.name) << ", \"operations\": " << r.operations
+            << ", \"seconds\": " << std::setprecision(6) << r.seconds
+            << ", \"ns_per_op\": " << std::setprecision(3) << ns;
+        if (r.instructions) {
+            out << ", \"mips\": " << std::setprecision(3) << r.operations / r.seconds / 1e6;
+        }
+        out << "}" << (i + 1 < micro.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"macro\": [\n";
+    for (size_t i = 0; i < macro.size(); i++) {
+        const MacroResult& r = macro[i];
+        double emulated_seconds = static_cast<double>(r.cycles) / DMG_CLOCK_SPEED;
+        out << "    {\"rom\": " << json_string(r.rom) << ", \"mode\": " << json_string(r.mode)
+            << ", \"cycles\": " << r.cycles << ", \"instructions\": " << r.instructions
+            << ", \"frames\": " << r.frames
+            << ", \"seconds\": " << std::setprecision(6) << r.seconds
+            << ", \"mips\": " << std::setprecision(3) << r.instructions / r.seconds / 1e6
+            << ", \"ns_per_instruction\": " << r.seconds * 1e9 / r.instructions
+            << ", \"emulated_seconds_per_wall_second\": " << emulated_seconds / r.seconds
+            << "}" << (i + 1 < macro.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> roms;
+    uint64_t cycles = DEFAULT_MACRO_CYCLES;
+    int repeat = DEFAULT_REPEAT;
+    std::string label;
+    const char* output_path = nullptr;
+    bool run_micro = true;
+    bool run_macro = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--rom") == 0 && i + 1 < argc) {
+            roms.push_back(argv[++i]);
+        } else if (std::strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            label = argv[++i];
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--micro-only") == 0) {
+            run_macro = false;
+        } else if (std::strcmp(argv[i], "--macro-only") == 0) {
+            run_micro = false;
+        } else {
+            std::cout << "Usage: gameboy-bench [options]" << std::endl;
+            std::cout << "  --rom FILE     ROM for the MMU/MBC benchmarks and a macro-benchmark (repeatable)" << std::endl;
+            std::cout << "  --cycles N     Emulated cycles per macro-benchmark run (default "
+                      << DEFAULT_MACRO_CYCLES << ")" << std::endl;
+            std::cout << "  --repeat N     Runs per benchmark, the best is reported (default "
+                      << DEFAULT_REPEAT << ")" << std::endl;
+            std::cout << "  --label TEXT   Recorded in the results, e.g. a commit id" << std::endl;
+            std::cout << "  --output FILE  Write the JSON results to FILE instead of stdout" << std::endl;
+            std::cout << "  --micro-only   Skip the ROM runs" << std::endl;
+            std::cout << "  --macro-only   Skip the component benchmarks" << std::endl;
+            return 1;
+        }
+    }
+    if (roms.empty()) {
+        roms.push_back("cpu_instrs.gb");
+    }
+    for (const std::string& rom : roms) {
+        if (!std::filesystem::is_regular_file(rom)) {
+            std::cerr << "Error: ROM not found: " << rom << std::endl;
+            return 1;
+        }
+        std::vector<uint8_t> image = Cartridge::read_rom_file(rom);
+        if (!Cartridge::is_supported(image.data(), image.size())) {
+            std::cerr << "Error: " << rom << " is not a ROM this emulator can run" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<MicroResult> micro;
+    std::vector<MacroResult> macro;
+    if (run_micro) {
+        std::cerr << "Running micro-benchmarks" << std::endl;
+        bench_dispatch(repeat, micro);
+        bench_mmu(roms[0], repeat, micro);
+        bench_bank_switch(roms[0], repeat, micro);
+        bench_timer(roms[0], repeat, micro);
+        bench_ppu(roms[0], repeat, micro);
+        bench_rewind(roms[0], repeat, micro);
+    }
+    if (run_macro) {
+        for (const std::string& rom : roms) {
+            std::cerr << "Running " << rom << std::endl;
+            bench_rom(rom, cycles, repeat, macro);
+        }
+    }
+
+    if (output_path != nullptr) {
+        std::ofstream file(output_path);
+        write_json(file, label, micro, macro);
+        if (!file) {
+            std::cerr << "Error: could not write " << output_path << std::endl;
+            return 1;
+        }
+        std::cerr << "Results written to " << output_path << std::endl;
+    } else {
+        write_json(std::cout, label, micro, macro);
+    }
+    return 0;
+}
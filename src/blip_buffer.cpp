@@ -0,0 +1,92 @@
+#include "../inc/blip_buffer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+int16_t BlipBuffer::kernel_[BlipBuffer::PHASES][BlipBuffer::KERNEL_WIDTH];
+
+// Kernel taps are 1.15 fixed point and each phase sums to exactly 1.0
+static const int KERNEL_UNITY = 1 << 15;
+static const double KERNEL_CUTOFF = 0.45;  // Fraction of the output rate kept below Nyquist
+
+BlipBuffer::BlipBuffer(uint32_t clock_rate, uint32_t sample_rate, size_t max_samples)
+    : factor_((static_cast<uint64_t>(sample_rate) << FRAC_BITS) / clock_rate)
+    , max_samples_(max_samples)
+    , buffer_(max_samples + KERNEL_WIDTH, 0) {
+    if (sample_rate == 0 || sample_rate > clock_rate) {
+        throw std::runtime_error("Blip buffer needs a sample rate below the clock rate");
+    }
+    static const bool kernel_built = (build_kernel(), true);
+    (void)kernel_built;
+}
+
+void BlipBuffer::build_kernel() {
+    const double pi = std::acos(-1.0);
+    for (int phase = 0; phase < PHASES; phase++) {
+        double fraction = static_cast<double>(phase) / PHASES;
+        double taps[KERNEL_WIDTH];
+        double sum = 0.0;
+        for (int i = 0; i < KERNEL_WIDTH; i++) {
+            // Impulse centered between taps KERNEL_WIDTH/2 - 1 and KERNEL_WIDTH/2
+            double x = i - (KERNEL_WIDTH / 2 - 1) - fraction;
+            double t = 2.0 * KERNEL_CUTOFF * x;
+            double sinc = x == 0.0 ? 1.0 : std::sin(pi * t) / (pi * t);
+            double w = (i + 1 - fraction) / (KERNEL_WIDTH + 1);
+            double window = 0.42 - 0.5 * std::cos(2.0 * pi * w) + 0.08 * std::cos(4.0 * pi * w);
+            taps[i] = sinc * window;
+            sum += taps[i];
+        }
+        int total = 0;
+        int largest = 0;
+        for (int i = 0; i < KERNEL_WIDTH; i++) {
+            kernel_[phase][i] = static_cast<int16_t>(std::lround(taps[i] / sum * KERNEL_UNITY));
+            total += kernel_[phase][i];
+            if (kernel_[phase][i] > kernel_[phase][largest]) {
+                largest = i;
+            }
+        }
+        // Rounding error goes into the largest tap so a step settles exactly
+        kernel_[phase][largest] = static_cast<int16_t>(kernel_[phase][largest] + KERNEL_UNITY - total);
+    }
+}
+
+uint32_t BlipBuffer::max_frame_clocks() const {
+    uint64_t room = static_cast<uint64_t>(max_samples_ - avail_) << FRAC_BITS;
+    return room <= offset_ ? 0 : static_cast<uint32_t>((room - offset_) / factor_);
+}
+
+void BlipBuffer::end_frame(uint32_t clock_duration) {
+    uint64_t position = offset_ + clock_duration * factor_;
+    avail_ += static_cast<size_t>(position >> FRAC_BITS);
+    offset_ = position & ((uint64_t(1) << FRAC_BITS) - 1);
+    if (avail_ > max_samples_) {
+        throw std::runtime_error("Blip buffer frame is too long");
+    }
+}
+
+size_t BlipBuffer::read_samples(int16_t* out, size_t count, size_t stride) {
+    count = std::min(count, avail_);
+    int32_t sum = integrator_;
+    for (size_t i = 0; i < count; i++) {
+        int32_t sample = sum >> 15;
+        sample = std::max(-32768, std::min(32767, sample));
+        out[i * stride] = static_cast<int16_t>(sample);
+        sum += buffer_[i] - (sum >> BASS_SHIFT);
+    }
+    integrator_ = sum;
+
+    // Keep deltas that were added past the samples just read
+    size_t remaining = avail_ - count + KERNEL_WIDTH;
+    std::memmove(buffer_.data(), buffer_.data() + count, remaining * sizeof(int32_t));
+    std::fill(buffer_.begin() + remaining, buffer_.begin() + remaining + count, 0);
+    avail_ -= count;
+    return count;
+}
+
+void BlipBuffer::clear() {
+    std::fill(buffer_.begin(), buffer_.end(), 0);
+    offset_ = 0;
+    avail_ = 0;
+    integrator_ = 0;
+}
@@ -0,0 +1,223 @@
+#include "../inc/block_cache.hpp"
+#include "../inc/cpu.hpp"
+#include "../inc/instruction_decoder.hpp"
+#include "../inc/jit.hpp"
+#include "../inc/mmu.hpp"
+#include <algorithm>
+
+static const uint32_t ADDRESS_SPACE_END = 0x10000;
+static const uint8_t CB_PREFIX = 0xCB;
+
+// Self-modifying code keeps producing new RAM blocks; past this many decoded
+// instructions all RAM blocks are dropped and rebuilt on demand
+static const size_t RAM_OPS_LIMIT = 1 << 16;
+
+BlockCache::BlockCache(CPU* cpu, MMU* mmu)
+    : cpu_(cpu)
+    , mmu_(mmu)
+    , rom_index_(mmu->rom_size(), 0)
+    , ram_index_(ADDRESS_SPACE_END - RAM_BASE, 0) {}
+
+bool BlockCache::enter_block(uint16_t pc) {
+    cursor_ = cursor_end_ = nullptr;
+    lookups_++;
+
+    if (stop_requested_) {
+        stop_requested_ = false;
+        breakpoint_hit_ = true;
+        return false;
+    }
+    if (breakpoint_count_ != 0) {
+        // Any block entry uses up a resume, so it never skips a later hit
+        bool resuming = pc == resume_pc_;
+        resume_pc_ = NO_RESUME;
+        if (!resuming && is_breakpoint(pc)) {
+            breakpoint_hit_ = true;
+            return false;
+        }
+    }
+
+    if (pc <= SWITCHABLE_ROM_END) {
+        size_t offset = mmu_->rom_offset(pc);
+        if (offset >= rom_index_.size()) {
+            misses_++;
+            return false;
+        }
+        uint32_t id = rom_index_[offset];
+        if (id == 0) {
+            misses_++;
+            // Blocks never run across the bank boundary
+            uint16_t limit = pc <= STATIC_ROM_END ? SWITCHABLE_ROM_START : VRAM_START;
+            Block block;
+            if (!decode_block(pc, limit, rom_ops_, block)) {
+                return false;
+            }
+            rom_blocks_.push_back(block);
+            id = static_cast<uint32_t>(rom_blocks_.size());
+            rom_index_[offset] = id;
+        }
+        const Block& block = rom_blocks_[id - 1];
+        cursor_ = rom_ops_.data() + block.first_op;
+        cursor_end_ = cursor_ + block.op_count;
+        cursor_pc_ = pc;
+        return true;
+    }
+
+    uint16_t limit = 0;
+    if (pc >= INTERNAL_RAM_START && pc <= INTERNAL_RAM_END) {
+        limit = INTERNAL_RAM_END + 1;
+    } else if (pc >= HIGH_RAM_START && pc <= HIGH_RAM_END) {
+        limit = HIGH_RAM_END + 1;
+    } else {
+        misses_++;
+        return false;
+    }
+
+    uint32_t id = ram_index_[pc - RAM_BASE];
+    if (id == 0) {
+        misses_++;
+        if (ram_ops_.size() >= RAM_OPS_LIMIT) {
+            flush_ram();
+        }
+        Block block;
+        if (!decode_block(pc, limit, ram_ops_, block)) {
+            return false;
+        }
+        ram_blocks_.push_back(block);
+        id = static_cast<uint32_t>(ram_blocks_.size());
+        ram_index_[pc - RAM_BASE] = id;
+        ram_live_blocks_++;
+        mark_code_pages(block.start, block.end, id);
+    }
+    const Block& block = ram_blocks_[id - 1];
+    cursor_ = ram_ops_.data() + block.first_op;
+    cursor_end_ = cursor_ + block.op_count;
+    cursor_pc_ = pc;
+    return true;
+}
+
+bool BlockCache::decode_block(uint16_t pc, uint16_t limit, std::vector<DecodedOp>& ops, Block& block) {
+    uint32_t addr = pc;
+    size_t first = ops.size();
+
+    while (ops.size() - first < BLOCK_MAX_OPS) {
+        if (ops.size() > first && breakpoint_count_ != 0 && is_breakpoint(static_cast<uint16_t>(addr))) {
+            break;  // Breakpoints are only checked on block entry
+        }
+        uint8_t opcode = mmu_->peek_memory_8(static_cast<uint16_t>(addr));
+        if (!InstructionDecoder::isDefined(opcode)) {
+            break;  // Left to the regular path, which reports it
+        }
+        uint8_t length = 1 + InstructionDecoder::operandBytes(opcode);
+        if (addr + length > limit) {
+            break;
+        }
+
+        DecodedOp op = {};
+        op.length = length;
+        if (opcode == CB_PREFIX) {
+            op.opcode = mmu_->peek_memory_8(static_cast<uint16_t>(addr + 1));
+            op.handler = cpu_->cb_table_[op.opcode];
+            op.prefix = 2;
+        } else {
+            op.opcode = opcode;
+            op.handler = cpu_->op_table_[opcode];
+            op.prefix = 1;
+            for (uint8_t i = 1; i < length; i++) {
+                op.operands[i - 1] = mmu_->peek_memory_8(static_cast<uint16_t>(addr + i));
+            }
+        }
+        ops.push_back(op);
+        addr += length;
+
+        if (InstructionDecoder::endsBlock(opcode)) {
+            break;
+        }
+    }
+
+    if (ops.size() == first) {
+        return false;
+    }
+    block.first_op = static_cast<uint32_t>(first);
+    block.op_count = static_cast<uint16_t>(ops.size() - first);
+    block.start = pc;
+    block.end = static_cast<uint16_t>(addr);
+    return true;
+}
+
+void BlockCache::mark_code_pages(uint16_t start, uint16_t end, uint32_t block_id) {
+    for (uint32_t page = start >> PAGE_SHIFT; page <= static_cast<uint32_t>(end - 1) >> PAGE_SHIFT; page++) {
+        page_blocks_[page].push_back(block_id);
+        code_pages_[page >> 6] |= 1ULL << (page & 63);
+    }
+}
+
+void BlockCache::invalidate(uint16_t addr) {
+    // Data often shares a page with code, so only blocks covering the written
+    // byte are dropped; the bitmap stays set while the page holds any block
+    uint8_t page = addr >> PAGE_SHIFT;
+    std::vector<uint32_t>& blocks = page_blocks_[page];
+    bool hit = false;
+    for (size_t i = 0; i < blocks.size();) {
+        const Block& block = ram_blocks_[blocks[i] - 1];
+        uint32_t& entry = ram_index_[block.start - RAM_BASE];
+        bool live = entry == blocks[i];
+        if (live && (addr < block.start || addr >= block.end)) {
+            i++;
+            continue;
+        }
+        if (live) {
+            entry = 0;
+            ram_live_blocks_--;
+            hit = true;
+            if (jit_) {
+                jit_->invalidate_ram(block.start);
+            }
+        }
+        blocks[i] = blocks.back();
+        blocks.pop_back();
+    }
+    if (blocks.empty()) {
+        code_pages_[page >> 6] &= ~(1ULL << (page & 63));
+    }
+    if (hit) {
+        cursor_ = cursor_end_ = nullptr;
+        invalidations_++;
+    }
+}
+
+void BlockCache::flush_ram() {
+    std::fill(ram_index_.begin(), ram_index_.end(), 0);
+    ram_blocks_.clear();
+    ram_ops_.clear();
+    for (auto& blocks : page_blocks_) {
+        blocks.clear();
+    }
+    code_pages_ = {};
+    ram_live_blocks_ = 0;
+    cursor_ = cursor_end_ = nullptr;
+    if (jit_) {
+        jit_->flush_ram();
+    }
+}
+
+void BlockCache::set_breakpoint(uint16_t addr, bool enabled) {
+    if (is_breakpoint(addr) == enabled) {
+        return;
+    }
+    breakpoints_[addr >> 6] ^= 1ULL << (addr & 63);
+    if (enabled) {
+        breakpoint_count_++;
+    } else {
+        breakpoint_count_--;
+    }
+    // Blocks running through the address have to be split there
+    flush();
+}
+
+void BlockCache::flush() {
+    std::fill(rom_index_.begin(), rom_index_.end(), 0);
+    rom_blocks_.clear();
+    rom_ops_.clear();
+    flush_ram();
+}
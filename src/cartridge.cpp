@@ -1,24 +1,43 @@
 #include "../inc/cartridge.hpp"
+#include "../inc/hash.hpp"
+#include <stdexcept>
 
-Cartridge::Cartridge(std::string path) {
-    load_rom(path);
+Cartridge::Cartridge(std::string path)
+    : Cartridge(read_rom_file(path)) {}
+
+Cartridge::Cartridge(vector<uint8_t> image)
+    : rom(std::move(image)) {
+    if (!is_supported(rom.data(), rom.size())) {
+        throw std::runtime_error("Unsupported cartridge");
+    }
+    hash = fnv1a_64(rom.data(), rom.size());
+    parse_header();
 }
 
-bool Cartridge::load_rom(string path) {
+vector<uint8_t> Cartridge::read_rom_file(const string& path) {
     ifstream file(path, ios::in | ios::binary | ios::ate);
     if (!file.is_open()) {
-        cerr << "Error: could not open ROM";
-        return false;
+        cerr << "Error: could not open ROM " << path << endl;
+        return {};
     }
     streampos fileSize = file.tellg();
     file.seekg(0, ios::beg);
     vector<uint8_t> buffer = vector<uint8_t>(fileSize);
     file.read(reinterpret_cast<char *>(buffer.data()), fileSize);
-    for (int i = 0; i < fileSize; i++) {
-        rom.push_back(buffer[i]);
+    return buffer;
+}
+
+bool Cartridge::is_supported(const uint8_t* image, size_t size) {
+    if (image == nullptr || size < 2 * SWITCHABLE_ROM_SIZE) {
+        return false;
+    }
+    switch (image[HEADER_CARTRIDGE_TYPE_ADDR]) {
+        case 0x00:
+        case 0x01: case 0x02: case 0x03:
+            return true;
+        default:
+            return false;
     }
-    parse_header();
-    return true;
 }
 
 void Cartridge::parse_header() {
@@ -50,7 +69,7 @@ void Cartridge::parse_header() {
         ram.resize(ram_banks * SWITCHABLE_RAM_SIZE);
     }
 
-    cartridge_type = rom[0x0147];
+    cartridge_type = rom[HEADER_CARTRIDGE_TYPE_ADDR];
 
     switch (cartridge_type) {
         case 0x00:
@@ -78,4 +97,12 @@ uint8_t Cartridge::read8(uint16_t addr) const {
 
 void Cartridge::write8(uint16_t addr, uint8_t val) {
     mbc->write(addr, val);
+}
+
+void Cartridge::save_state(StateWriter& writer) const {
+    mbc->save_state(writer);
+}
+
+void Cartridge::load_state(StateReader& reader) {
+    mbc->load_state(reader);
 }
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "../inc/cheats.hpp"
+#include "../inc/cpu.hpp"
+#include "../inc/disassembler.hpp"
+#include "../inc/mmu.hpp"
+#include <algorithm>
+#include <cctype>
+
+static const size_t GAME_GENIE_SHORT_DIGITS = 6;
+static const size_t GAME_SHARK_DIGITS = 8;
+static const size_t GAME_GENIE_DIGITS = 9;
+static const uint8_t GAME_GENIE_COMPARE_XOR = 0xBA;
+
+// Uppercase hex digits without the dashes; false on any other character
+static bool hex_digits(const std::string& code, std::string& digits, std::vector<uint8_t>& values) {
+    for (char c : code) {
+        if (c == '-') {
+            continue;
+        }
+        if (!std::isxdigit(static_cast<unsigned char>(c))) {
+            return false;
+        }
+        char upper = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        digits += upper;
+        values.push_back(static_cast<uint8_t>(upper <= '9' ? upper - '0' : upper - 'A' + 10));
+    }
+    return true;
+}
+
+Cheats::Cheats(CPU* cpu, MMU* mmu, Disassembler* disassembler)
+    : cpu_(cpu)
+    , mmu_(mmu)
+    , disassembler_(disassembler) {}
+
+Cheats::~Cheats() {
+    mmu_->set_cheats(nullptr);
+}
+
+bool Cheats::add(const std::string& code) {
+    std::string digits;
+    std::vector<uint8_t> d;
+    if (!hex_digits(code, digits, d)) {
+        return false;
+    }
+    if (d.size() == GAME_SHARK_DIGITS) {
+        uint8_t type = static_cast<uint8_t>(d[0] << 4 | d[1]);
+        if (type > 0x01 && (type < 0x80 || type > 0x9F)) {
+            return false;
+        }
+        uint8_t value = static_cast<uint8_t>(d[2] << 4 | d[3]);
+        uint16_t address = static_cast<uint16_t>(d[6] << 12 | d[7] << 8 | d[4] << 4 | d[5]);
+        // Writes to ROM would switch banks, and ones to I/O would trigger DMA or sound
+        if (address < VRAM_START || (address >= I_O_START && address < HIGH_RAM_START)) {
+            return false;
+        }
+        ram_writes_.push_back({address, value, digits});
+        return true;
+    }
+    if (d.size() != GAME_GENIE_SHORT_DIGITS && d.size() != GAME_GENIE_DIGITS) {
+        return false;
+    }
+    uint16_t address = static_cast<uint16_t>((d[5] ^ 0xF) << 12 | d[2] << 8 | d[3] << 4 | d[4]);
+    if (address > SWITCHABLE_ROM_END) {
+        return false;
+    }
+    int16_t compare = -1;
+    if (d.size() == GAME_GENIE_DIGITS) {
+        // The seventh and ninth digits hold the compare value, rotated and scrambled; the eighth is unused
+        uint8_t encoded = static_cast<uint8_t>(d[6] << 4 | d[8]);
+        compare = static_cast<uint8_t>((encoded >> 2 | encoded << 6) ^ GAME_GENIE_COMPARE_XOR);
+    }
+    rom_patches_.push_back({address, static_cast<uint8_t>(d[0] << 4 | d[1]), compare, digits});
+    update_pages();
+    return true;
+}
+
+bool Cheats::remove(const std::string& code) {
+    std::string digits;
+    std::vector<uint8_t> values;
+    if (!hex_digits(code, digits, values)) {
+        return false;
+    }
+    size_t patches = rom_patches_.size();
+    size_t writes = ram_writes_.size();
+    auto matches = [&digits](const auto& cheat) { return digits.empty() || cheat.code == digits; };
+    rom_patches_.erase(std::remove_if(rom_patches_.begin(), rom_patches_.end(), matches), rom_patches_.end());
+    ram_writes_.erase(std::remove_if(ram_writes_.begin(), ram_writes_.end(), matches), ram_writes_.end());
+    if (rom_patches_.size() != patches) {
+        update_pages();
+    }
+    return rom_patches_.size() != patches || ram_writes_.size() != writes;
+}
+
+void Cheats::apply_ram_writes() {
+    for (const RamWrite& write : ram_writes_) {
+        mmu_->poke_memory_8(write.address, write.value);
+    }
+}
+
+void Cheats::update_pages() {
+    const uint8_t* rom = mmu_->rom_data();
+    size_t rom_size = mmu_->rom_size();
+    size_t page_count = (rom_size + MMU::PAGE_SIZE - 1) / MMU::PAGE_SIZE;
+    patched_pages_.assign((page_count + 63) / 64, 0);
+    pages_.clear();
+
+    // ROM0 addresses patch bank 0 only, switchable ones every other bank
+    for (const RomPatch& patch : rom_patches_) {
+        bool switchable = patch.address >= SWITCHABLE_ROM_START;
+        size_t first = switchable ? SWITCHABLE_ROM_SIZE : 0;
+        size_t last = switchable ? rom_size : SWITCHABLE_ROM_SIZE;
+        for (size_t bank = first; bank < last; bank += SWITCHABLE_ROM_SIZE) {
+            size_t offset = bank + (patch.address & (SWITCHABLE_ROM_SIZE - 1));
+            if (offset >= rom_size || (patch.compare >= 0 && rom[offset] != patch.compare)) {
+                continue;
+            }
+            size_t page = offset / MMU::PAGE_SIZE;
+            std::vector<uint8_t>& copy = pages_[page];
+            if (copy.empty()) {
+                const uint8_t* source = rom + page * MMU::PAGE_SIZE;
+                copy.assign(source, source + std::min<size_t>(MMU::PAGE_SIZE, rom_size - page * MMU::PAGE_SIZE));
+                copy.resize(MMU::PAGE_SIZE, DEFAULT_READ_RETURN);
+                patched_pages_[page >> 6] |= 1ULL << (page & 63);
+            }
+            copy[offset % MMU::PAGE_SIZE] = patch.value;
+        }
+    }
+
+    // Code decoded from the old bytes has to go
+    mmu_->set_cheats(pages_.empty() ? nullptr : this);
+    cpu_->flush_code();
+    disassembler_->flush();
+}
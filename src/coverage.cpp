@@ -0,0 +1,136 @@
+#include "../inc/coverage.hpp"
+#include <bitset>
+#include <fstream>
+#include <iostream>
+
+template <typename T>
+static void write_field(std::ofstream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool read_field(std::ifstream& file, T& value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+static size_t bitmap_bytes(size_t rom_size) {
+    return (rom_size + 7) / 8;
+}
+
+static bool ends_with(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+Coverage::Coverage(size_t rom_size, uint64_t rom_hash)
+    : rom_size_(rom_size)
+    , rom_hash_(rom_hash) {
+    for (std::vector<uint64_t>& bits : bits_) {
+        bits.assign((rom_size + 63) / 64, 0);
+    }
+}
+
+size_t Coverage::count(Kind kind) const {
+    size_t total = 0;
+    for (uint64_t word : bits_[kind]) {
+        total += std::bitset<64>(word).count();
+    }
+    return total;
+}
+
+size_t Coverage::code_bytes() const {
+    size_t total = 0;
+    for (size_t i = 0; i < bits_[OPCODE].size(); i++) {
+        total += std::bitset<64>(bits_[OPCODE][i] | bits_[OPERAND][i]).count();
+    }
+    return total;
+}
+
+bool Coverage::load(const std::string& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: could not open coverage file " << path << std::endl;
+        return false;
+    }
+    uint32_t magic = 0;
+    uint16_t version = 0;
+    uint64_t rom_hash = 0;
+    uint32_t rom_size = 0;
+    if (!read_field(file, magic) || !read_field(file, version) || !read_field(file, rom_hash) || !read_field(file, rom_size)) {
+        std::cerr << "Error: coverage header is truncated in " << path << std::endl;
+        return false;
+    }
+    if (magic != MAGIC || version != FORMAT_VERSION) {
+        std::cerr << "Error: unsupported coverage format in " << path << std::endl;
+        return false;
+    }
+    bool merging = rom_size_ != 0;
+    if (!merging) {
+        *this = Coverage(rom_size, rom_hash);
+    } else if (rom_hash != rom_hash_ || rom_size != rom_size_) {
+        std::cerr << "Error: " << path << " is coverage of another ROM" << std::endl;
+        return false;
+    }
+
+    // Bitmaps are read straight into the words (little endian), or OR-ed in when merging
+    std::vector<uint64_t> words(bits_[0].size());
+    for (std::vector<uint64_t>& bits : bits_) {
+        std::fill(words.begin(), words.end(), 0);
+        if (!file.read(reinterpret_cast<char*>(words.data()), bitmap_bytes(rom_size_))) {
+            std::cerr << "Error: coverage data is truncated in " << path << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < words.size(); i++) {
+            bits[i] |= words[i];
+        }
+    }
+    return true;
+}
+
+bool Coverage::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: could not write coverage file " << path << std::endl;
+        return false;
+    }
+    write_field(file, MAGIC);
+    write_field(file, FORMAT_VERSION);
+    write_field(file, rom_hash_);
+    write_field(file, static_cast<uint32_t>(rom_size_));
+    for (const std::vector<uint64_t>& bits : bits_) {
+        file.write(reinterpret_cast<const char*>(bits.data()), bitmap_bytes(rom_size_));
+    }
+    return static_cast<bool>(file);
+}
+
+bool Coverage::write_cdl(const std::string& path) const {
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: could not write code/data log " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> log(rom_size_, 0);
+    for (size_t offset = 0; offset < rom_size_; offset++) {
+        if (test(OPCODE, offset) || test(OPERAND, offset)) {
+            log[offset] |= CDL_CODE;
+        }
+        if (test(DATA, offset)) {
+            log[offset] |= CDL_DATA;
+        }
+    }
+    file.write(reinterpret_cast<const char*>(log.data()), log.size());
+    return static_cast<bool>(file);
+}
+
+bool Coverage::merge_files(const std::string& output, const std::vector<std::string>& inputs) {
+    if (inputs.empty()) {
+        std::cerr << "Error: no coverage files to merge" << std::endl;
+        return false;
+    }
+    Coverage merged;
+    for (const std::string& input : inputs) {
+        if (!merged.load(input)) {
+            return false;
+        }
+    }
+    return ends_with(output, ".cdl") ? merged.write_cdl(output) : merged.save(output);
+}
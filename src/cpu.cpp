@@ -3,16 +3,36 @@
 #include "../inc/interrupt_controller.hpp"
 #include "../inc/logger.hpp"
 #include "../inc/mmu.hpp"
+#include "../inc/opcode_table.hpp"
+#include "../inc/profiler.hpp"
+#include "../inc/save_state.hpp"
 #include <iostream>
 #include <stdexcept>
 
+#if defined(THREADED_DISPATCH) && defined(__GNUC__)
+#define CPU_COMPUTED_GOTO
+#endif
+
+// Instrumentation hooks, empty unless built with CPU_STATS
+#ifdef CPU_STATS
+#define CPU_COUNT_INSTRUCTION(cb, opcode, cycles) stats_.count_instruction(cb, opcode, cycles)
+#define CPU_COUNT_ACCESS(addr, write) stats_.count_access(addr, write)
+#define CPU_COUNT_INTERRUPT(vector) stats_.count_interrupt(vector)
+#else
+#define CPU_COUNT_INSTRUCTION(cb, opcode, cycles) ((void)0)
+#define CPU_COUNT_ACCESS(addr, write) ((void)0)
+#define CPU_COUNT_INTERRUPT(vector) ((void)0)
+#endif
+
 // ============================================================================
 // CPU Implementation
 // ============================================================================
 
 CPU::CPU(MMU* mmu, InterruptController* interrupt_controller) 
     : mmu_(mmu)
-    , interrupt_controller_(interrupt_controller) {
+    , interrupt_controller_(interrupt_controller)
+    , block_cache_(this, mmu)
+    , jit_(this, mmu) {
     // Initialize registers (DMG boot state)
     setA(0x01);
     setB(0x00);
@@ -25,77 +45,392 @@ CPU::CPU(MMU* mmu, InterruptController* interrupt_controller)
     sp_ = 0xFFFE;
     
     // Initialize flags
-    setFlagZ(true);
-    setFlagN(false);
-    setFlagH(true);
-    setFlagC(true);
+    set_flags(true, false, true, true);
     
-    InstructionDecoder::initializeHandlers(this);
+    load_dispatch_tables<FastTiming>();
+    mmu_->set_block_cache(&block_cache_);
+    block_cache_.set_jit(&jit_);
+}
+
+void CPU::write_log(const char* func_name, const char* details) {
+    Logger::log(func_name, current_opcode_, af(), bc_, de_, hl_, sp_, pc_, ime_, details);
+}
+
+template <typename Timing>
+void CPU::load_dispatch_tables() {
+    // Resolve the mask patterns once; execution indexes by opcode
+    for (int opcode = 0; opcode < 256; opcode++) {
+        op_table_[opcode] = OpcodeTable<Timing>::base(static_cast<uint8_t>(opcode));
+        cb_table_[opcode] = OpcodeTable<Timing>::cb(static_cast<uint8_t>(opcode));
+    }
 }
 
-void CPU::log(const std::string& func_name, const std::string& details) {
-    Logger::log(func_name, current_opcode_, af_, bc_, de_, hl_, sp_, pc_, ime_, details);
+void CPU::set_exact_timing(bool exact, InstructionClock* clock) {
+    exact_timing_ = exact;
+    clock_ = clock;
+    if (exact) {
+        load_dispatch_tables<ExactTiming>();
+        jit_enabled_ = false;
+    } else {
+        load_dispatch_tables<FastTiming>();
+    }
+    // Pre-decoded blocks hold handlers of the previous mode
+    block_cache_.flush();
 }
 
 uint8_t CPU::execute_next_instruction() {
-    current_opcode_ = fetchOpcode();
+    return exact_timing_ ? execute<ExactTiming>() : execute<FastTiming>();
+}
+
+template <typename Timing>
+uint8_t CPU::execute() {
+    if (halted_) {
+        halted_cycles_ += 4;
+        return 4;
+    }
+    bool enable_ime = ime_pending_;
+    instruction_pc_ = pc_;
+    Handler handler = nullptr;
+    const BlockCache::DecodedOp* op = block_cache_enabled_ ? block_cache_.next(pc_) : nullptr;
+    if (op != nullptr) {
+        current_opcode_ = op->opcode;
+        pc_ += op->prefix;
+        for (uint8_t i = 0; i < op->prefix; i++) {
+            m_cycle<Timing>();  // Opcode (and CB prefix) fetch
+        }
+        operands_ = op->operands;
+        handler = op->handler;
+    } else if (block_cache_.take_breakpoint_hit()) {
+        return 0;
+    } else {
+        current_opcode_ = fetchOpcode<Timing>();
+        handler = op_table_[current_opcode_];
+    }
+    if (coverage_ != nullptr) {
+        cover_instruction();
+    }
     
-    for (auto& [op, handler] : op_handlers_) {
-        if ((current_opcode_ & op.mask) == op.pattern) {
-            return (this->*handler)();
+    if (handler) {
+        uint8_t cycles = (this->*handler)();
+        instructions_++;
+        CPU_COUNT_INSTRUCTION(op != nullptr ? op->prefix == 2 : handler == op_table_[0xCB], current_opcode_, cycles);
+        operands_ = nullptr;
+        if (enable_ime && ime_pending_) {
+            ime_ = true;
+            ime_pending_ = false;
         }
+        return cycles;
     }
     
     std::cout << "Undefined opcode: " << std::hex << static_cast<int>(current_opcode_) << std::endl;
     throw std::runtime_error("Undefined opcode");
 }
 
+#ifdef CPU_COMPUTED_GOTO
+
+// Expands X(hi, lo) for all 256 opcodes
+#define CPU_OPCODE_ROW(X, h)                                                     \
+    X(h, 0) X(h, 1) X(h, 2) X(h, 3) X(h, 4) X(h, 5) X(h, 6) X(h, 7)              \
+    X(h, 8) X(h, 9) X(h, A) X(h, B) X(h, C) X(h, D) X(h, E) X(h, F)
+#define CPU_OPCODES(X)                                                           \
+    CPU_OPCODE_ROW(X, 0) CPU_OPCODE_ROW(X, 1)                                    \
+    CPU_OPCODE_ROW(X, 2) CPU_OPCODE_ROW(X, 3)                                    \
+    CPU_OPCODE_ROW(X, 4) CPU_OPCODE_ROW(X, 5)                                    \
+    CPU_OPCODE_ROW(X, 6) CPU_OPCODE_ROW(X, 7)                                    \
+    CPU_OPCODE_ROW(X, 8) CPU_OPCODE_ROW(X, 9)                                    \
+    CPU_OPCODE_ROW(X, A) CPU_OPCODE_ROW(X, B)                                    \
+    CPU_OPCODE_ROW(X, C) CPU_OPCODE_ROW(X, D)                                    \
+    CPU_OPCODE_ROW(X, E) CPU_OPCODE_ROW(X, F)
+
+#define CPU_BASE_LABEL(h, l) &&base_##h##l,
+#define CPU_CB_LABEL(h, l) &&cb_##h##l,
+
+// Fetches the next instruction, from the block cache when it has it, and
+// jumps straight to its label
+#define CPU_FETCH_AND_JUMP()                                                     \
+    do {                                                                         \
+        if (halted_) {                                                           \
+            goto halted;                                                         \
+        }                                                                        \
+        enable_ime = ime_pending_;                                               \
+        instruction_pc_ = pc_;                                                   \
+        if (coverage_ != nullptr) {                                              \
+            cover_instruction();                                                 \
+        }                                                                        \
+        if (block_cache_enabled_) {                                              \
+            if (const BlockCache::DecodedOp* op = block_cache_.next(pc_)) {      \
+                pc_ += op->prefix;                                               \
+                operands_ = op->operands;                                        \
+                goto *(op->prefix == 2 ? cb_labels : base_labels)[op->opcode];   \
+            }                                                                    \
+        }                                                                        \
+        goto *base_labels[fetchOpcode<FastTiming>()];                            \
+    } while (0)
+
+// Retires the instruction that just ran (the tail of execute_next_instruction
+// plus interrupt dispatch), then dispatches the next one from this body
+#define CPU_DISPATCH()                                                           \
+    do {                                                                         \
+        operands_ = nullptr;                                                     \
+        if (enable_ime && ime_pending_) {                                        \
+            ime_ = true;                                                         \
+            ime_pending_ = false;                                                \
+        }                                                                        \
+        cycles += handle_interrupts();                                           \
+        if (!clock.tick(cycles)) {                                               \
+            return;                                                              \
+        }                                                                        \
+        CPU_FETCH_AND_JUMP();                                                    \
+    } while (0)
+
+// Each body runs the handler the dispatch tables would pick, as a direct call
+#define CPU_BASE_BODY(h, l)                                                      \
+    base_##h##l: {                                                               \
+        constexpr Handler handler = OpcodeTable<FastTiming>::base(0x##h##l);     \
+        current_opcode_ = 0x##h##l;                                              \
+        if constexpr (0x##h##l == 0xCB) {                                        \
+            log("cb_ins_handler");                                               \
+            goto *cb_labels[fetchOpcode<FastTiming>()];                          \
+        } else if constexpr (handler == nullptr) {                               \
+            goto undefined;                                                      \
+        } else {                                                                 \
+            cycles = (this->*handler)();                                         \
+            instructions_++;                                                     \
+            CPU_COUNT_INSTRUCTION(false, 0x##h##l, cycles);                      \
+            CPU_DISPATCH();                                                      \
+        }                                                                        \
+    }
+#define CPU_CB_BODY(h, l)                                                        \
+    cb_##h##l: {                                                                 \
+        constexpr Handler handler = OpcodeTable<FastTiming>::cb(0x##h##l);       \
+        current_opcode_ = 0x##h##l;                                              \
+        cycles = (this->*handler)();                                             \
+        instructions_++;                                                         \
+        CPU_COUNT_INSTRUCTION(true, 0x##h##l, cycles);                           \
+        CPU_DISPATCH();                                                          \
+    }
+
+void CPU::run(InstructionClock& clock) {
+    static void* const base_labels[256] = {CPU_OPCODES(CPU_BASE_LABEL)};
+    static void* const cb_labels[256] = {CPU_OPCODES(CPU_CB_LABEL)};
+    uint32_t cycles = 0;
+    bool enable_ime = false;
+
+    // Enter as if an instruction had just retired, without ticking the clock
+    goto fetch;
+
+halted:
+    cycles = 4;
+    halted_cycles_ += 4;
+    cycles += handle_interrupts();
+    if (!clock.tick(cycles)) {
+        return;
+    }
+fetch:
+    CPU_FETCH_AND_JUMP();
+
+    CPU_OPCODES(CPU_BASE_BODY)
+    CPU_OPCODES(CPU_CB_BODY)
+
+undefined:
+    std::cout << "Undefined opcode: " << std::hex << static_cast<int>(current_opcode_) << std::endl;
+    throw std::runtime_error("Undefined opcode");
+}
+
+#else
+
+void CPU::run(InstructionClock& clock) {
+    while (true) {
+        uint32_t cycles = execute_next_instruction();
+        cycles += handle_interrupts();
+        if (!clock.tick(cycles)) {
+            return;
+        }
+    }
+}
+
+#endif
+
+bool CPU::set_jit_enabled(bool enabled, bool verify) {
+#ifdef CPU_STATS
+    if (enabled) {
+        return false;
+    }
+#endif
+    if (enabled && (!jit_.available() || exact_timing_ || profiler_ != nullptr || coverage_ != nullptr
+                    || block_cache_.has_breakpoints() || !jit_.allocate())) {
+        return false;
+    }
+    jit_enabled_ = enabled;
+    jit_.set_verify(verify);
+    return true;
+}
+
+uint32_t CPU::execute_native(uint32_t budget) {
+    // Blocks hold no EI/RETI/HALT and leave before any I/O access, so they are
+    // only entered where the interpreter would not act on an interrupt either
+    if (ime_ && interrupt_controller_->has_pending_interrupt()) {
+        return 0;
+    }
+    return jit_.run(budget);
+}
+
+void CPU::set_call_profiler(Profiler* profiler) {
+    profiler_ = profiler;
+    if (profiler_ != nullptr) {
+        jit_enabled_ = false;
+    }
+}
+
+void CPU::set_coverage(Coverage* coverage) {
+    coverage_ = coverage;
+    if (coverage_ != nullptr) {
+        jit_enabled_ = false;
+    }
+}
+
+void CPU::cover_instruction() {
+    uint8_t length = 1 + InstructionDecoder::operandBytes(mmu_->peek_memory_8(instruction_pc_));
+    coverage_->mark_instruction(mmu_->mapped_rom_offset(instruction_pc_), length);
+}
+
+void CPU::set_breakpoint(uint16_t addr, bool enabled) {
+    if (enabled) {
+        jit_enabled_ = false;
+        block_cache_enabled_ = true;
+    }
+    block_cache_.set_breakpoint(addr, enabled);
+}
+
+void CPU::request_stop() {
+    block_cache_enabled_ = true;
+    block_cache_.request_stop();
+}
+
 uint8_t CPU::handle_interrupts() {
+    return exact_timing_ ? dispatch_interrupt<ExactTiming>() : dispatch_interrupt<FastTiming>();
+}
+
+template <typename Timing>
+uint8_t CPU::dispatch_interrupt() {
+    // A pending interrupt ends HALT even when IME is off
+    if (!interrupt_controller_->has_pending_interrupt()) {
+        return 0;
+    }
+    halted_ = false;
     if (!ime_) {
         return 0;
     }
     
     uint16_t addr = interrupt_controller_->get_address_of_highest_priority_interrupt();
     if (addr != INTERRUPT_HANDLER_NONE_ADDRESS) {
-        push_to_stack(pc_);
+        // Two internal M-cycles, the pushes, then one more to load PC
+        m_cycle<Timing>();
+        m_cycle<Timing>();
+        push_to_stack<Timing>(pc_);
         pc_ = addr;
         ime_ = false;
-        return 5;
+        CPU_COUNT_INTERRUPT(addr);
+        if (profiler_ != nullptr) {
+            profiler_->on_call(pc_, sp_);
+        }
+        return 20;
     }
     return 0;
 }
 
+void CPU::save_state(StateWriter& writer) const {
+    writer.write(current_opcode_);
+    writer.write(ime_);
+    writer.write(ime_pending_);
+    writer.write(halted_);
+    writer.write(af());
+    writer.write(bc_);
+    writer.write(de_);
+    writer.write(hl_);
+    writer.write(sp_);
+    writer.write(pc_);
+}
+
+void CPU::load_state(StateReader& reader) {
+    reader.read(current_opcode_);
+    reader.read(ime_);
+    reader.read(ime_pending_);
+    reader.read(halted_);
+    uint16_t af = 0;
+    reader.read(af);
+    set_af(af);
+    reader.read(bc_);
+    reader.read(de_);
+    reader.read(hl_);
+    reader.read(sp_);
+    reader.read(pc_);
+    // RAM is about to be replaced as well
+    block_cache_.flush_ram();
+}
+
+template <typename Timing>
+uint8_t CPU::read_memory(uint16_t addr) {
+    m_cycle<Timing>();
+    CPU_COUNT_ACCESS(addr, false);
+    return mmu_->read_memory_8(addr);
+}
+
+template <typename Timing>
+void CPU::write_memory(uint16_t addr, uint8_t value) {
+    m_cycle<Timing>();
+    CPU_COUNT_ACCESS(addr, true);
+    mmu_->write_memory_8(addr, value);
+}
+
+template <typename Timing>
 uint8_t CPU::fetchOpcode() {
-    return mmu_->read_memory_8(pc_++);
+    if (operands_ != nullptr) {
+        m_cycle<Timing>();  // Pre-decoded, but the bus access still takes its M-cycle
+        pc_++;
+        return *operands_++;
+    }
+    m_cycle<Timing>();  // Not a data access, so read_memory() would miscount it
+    return mmu_->peek_memory_8(pc_++);
 }
 
+template <typename Timing>
 uint8_t CPU::cb_ins_handler() {
     log(__func__);
-    current_opcode_ = fetchOpcode();
+    current_opcode_ = fetchOpcode<Timing>();
     
-    for (auto& [op, handler] : cb_handlers_) {
-        if ((current_opcode_ & op.mask) == op.pattern) {
-            return (this->*handler)();
-        }
+    if (Handler handler = cb_table_[current_opcode_]) {
+        return (this->*handler)();
     }
     
     throw std::runtime_error("Undefined CB opcode");
 }
 
+template <typename Timing>
+uint16_t CPU::fetch_imm16() {
+    // Two statements: the operands of one call would be evaluated in unspecified order
+    uint8_t low = fetchOpcode<Timing>();
+    uint8_t high = fetchOpcode<Timing>();
+    return endian_swap(low, high);
+}
+
 uint16_t CPU::endian_swap(uint8_t low, uint8_t high) const {
     return (static_cast<uint16_t>(high) << 8) | static_cast<uint16_t>(low);
 }
 
+template <typename Timing>
 void CPU::push_to_stack(uint16_t value) {
     sp_ -= 2;
-    mmu_->write_memory_8(sp_ + 1, value >> 8);      // HIGH byte
-    mmu_->write_memory_8(sp_, value & 0xFF);        // LOW byte
+    write_memory<Timing>(sp_ + 1, value >> 8);      // HIGH byte
+    write_memory<Timing>(sp_, value & 0xFF);        // LOW byte
 }
 
+template <typename Timing>
 uint16_t CPU::pop_from_stack() {
-    uint16_t value = mmu_->read_memory_8(sp_) | (mmu_->read_memory_8(sp_ + 1) << 8);
+    uint8_t low = read_memory<Timing>(sp_);
+    uint8_t high = read_memory<Timing>(sp_ + 1);
     sp_ += 2;
-    return value;
+    return endian_swap(low, high);
 }
 
 // ============================================================================
@@ -190,7 +525,7 @@ uint16_t CPU::read_register_16_bit_stack(uint8_t reg_num) const {
         case 0: return bc_;
         case 1: return de_;
         case 2: return hl_;
-        case 3: return af_;
+        case 3: return af();
         default: throw std::runtime_error("Invalid register number");
     }
 }
@@ -200,7 +535,7 @@ void CPU::write_register_16_bit_stack(uint8_t reg_num, uint16_t value) {
         case 0: bc_ = value; break;
         case 1: de_ = value; break;
         case 2: hl_ = value; break;
-        case 3: af_ = value; break;
+        case 3: set_af(value); break;
         default: throw std::runtime_error("Invalid register number");
     }
 }
@@ -229,6 +564,7 @@ void CPU::write_register_16_bit_memory(uint8_t reg_num, uint16_t value) {
 // 8-bit Load Instructions
 // ============================================================================
 
+template <typename Timing>
 uint8_t CPU::op_ld_r_r() {
     log(__func__);
     uint8_t src = read_second_register_8_bit_parameter();
@@ -237,562 +573,507 @@ uint8_t CPU::op_ld_r_r() {
     return 4;
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_r_imm() {
     log(__func__);
     uint8_t dst = read_first_register_8_bit_parameter();
-    write_register_8_bit(dst, fetchOpcode());
+    write_register_8_bit(dst, fetchOpcode<Timing>());
     return 8;
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_r_hl_ind() {
     log(__func__);
     uint8_t dst = read_first_register_8_bit_parameter();
-    write_register_8_bit(dst, mmu_->read_memory_8(hl_));
+    write_register_8_bit(dst, read_memory<Timing>(hl_));
     return 8;
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_hl_ind_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
     uint16_t address = hl_;
     uint8_t value = read_register_8_bit(source_register);
-    mmu_->write_memory_8(address, value);
+    write_memory<Timing>(address, value);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_hl_ind_imm() {
     log(__func__);
     uint16_t address = hl_;
-    uint8_t value = fetchOpcode();
-    mmu_->write_memory_8(address, value);
+    uint8_t value = fetchOpcode<Timing>();
+    write_memory<Timing>(address, value);
     return 12; // 12 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_a_bc_ind() {
     log(__func__);
     uint16_t address = bc_;
-    uint8_t value = mmu_->read_memory_8(address);
+    uint8_t value = read_memory<Timing>(address);
     setA(value);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_a_de_ind() {
     log(__func__);
     uint16_t address = de_;
-    uint8_t value = mmu_->read_memory_8(address);
+    uint8_t value = read_memory<Timing>(address);
     setA(value);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_bc_ind_a() {
     log(__func__);
     uint16_t address = bc_;
     uint8_t value = getA();
-    mmu_->write_memory_8(address, value);
+    write_memory<Timing>(address, value);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_de_ind_a() {
     log(__func__);
     uint16_t address = de_;
     uint8_t value = getA();
-    mmu_->write_memory_8(address, value);
+    write_memory<Timing>(address, value);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_a_imm_ind() {
     log(__func__);
-    uint16_t address = endian_swap(fetchOpcode(), fetchOpcode());
-    uint8_t value = mmu_->read_memory_8(address);
+    uint16_t address = fetch_imm16<Timing>();
+    uint8_t value = read_memory<Timing>(address);
     setA(value);
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_imm_ind_a() {
     log(__func__);
-    uint16_t address = endian_swap(fetchOpcode(), fetchOpcode());
+    uint16_t address = fetch_imm16<Timing>();
     uint8_t value = getA();
-    mmu_->write_memory_8(address, value);
+    write_memory<Timing>(address, value);
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ldh_a_c_ind() {
     log(__func__);
     uint16_t address = 0xFF00 + getC();
-    uint8_t value = mmu_->read_memory_8(address);
+    uint8_t value = read_memory<Timing>(address);
     setA(value);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ldh_c_ind_a() {
     log(__func__);
     uint16_t address = 0xFF00 + getC();
     uint8_t value = getA();
-    mmu_->write_memory_8(address, value);
+    write_memory<Timing>(address, value);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ldh_a_imm_ind() {
     log(__func__);
-    uint16_t address = 0xFF00 + fetchOpcode();
-    uint8_t value = mmu_->read_memory_8(address);
+    uint16_t address = 0xFF00 + fetchOpcode<Timing>();
+    uint8_t value = read_memory<Timing>(address);
     setA(value);
     return 12; // 12 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ldh_imm_ind_a() {
     log(__func__);
     uint8_t value = getA();
-    uint16_t address = 0xFF00 + fetchOpcode();
-    mmu_->write_memory_8(address, value);
+    uint16_t address = 0xFF00 + fetchOpcode<Timing>();
+    write_memory<Timing>(address, value);
     return 12; // 12 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_a_hl_ind_dec() {
     log(__func__);
     uint16_t address = hl_;
-    uint8_t value = mmu_->read_memory_8(address);
+    uint8_t value = read_memory<Timing>(address);
     setA(value);
     hl_--;
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_hl_ind_dec_a() {
     log(__func__);
     uint16_t address = hl_;
     uint8_t value = getA();
-    mmu_->write_memory_8(address, value);
+    write_memory<Timing>(address, value);
     hl_--;
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_a_hl_ind_inc() {
     log(__func__);
     uint16_t address = hl_;
-    uint8_t value = mmu_->read_memory_8(address);
+    uint8_t value = read_memory<Timing>(address);
     setA(value);
     hl_++;
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_hl_ind_inc_a() {
     log(__func__);
     uint16_t address = hl_;
     uint8_t value = getA();
-    mmu_->write_memory_8(address, value);
+    write_memory<Timing>(address, value);
     hl_++;
     return 8; // 8 cycles
 }
 
 // 16-bit load instructions
+template <typename Timing>
 uint8_t CPU::op_ld_rr_imm() {
     log(__func__);
     uint8_t register_number = read_first_register_16_bit_parameter();
-    uint16_t value = endian_swap(fetchOpcode(), fetchOpcode());
+    uint16_t value = fetch_imm16<Timing>();
     write_register_16_bit(register_number, value);
     return 12; // 12 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_imm_ind_sp() {
     log(__func__);
-    uint16_t address = endian_swap(fetchOpcode(), fetchOpcode());
-    mmu_->write_memory_8(address, sp_ & 0xFF);
-    mmu_->write_memory_8(address + 1, sp_ >> 8);
-    return 16; // 16 cycles
+    uint16_t address = fetch_imm16<Timing>();
+    write_memory<Timing>(address, sp_ & 0xFF);
+    write_memory<Timing>(address + 1, sp_ >> 8);
+    return 20; // 20 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ld_sp_hl() {
     log(__func__);
     sp_ = hl_;
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_push_rr() {
     log(__func__);
     uint8_t register_number = read_first_register_16_bit_parameter();
-    push_to_stack(read_register_16_bit_stack(register_number));
+    m_cycle<Timing>();  // Internal delay before the writes
+    push_to_stack<Timing>(read_register_16_bit_stack(register_number));
     return 16;
 }
 
+template <typename Timing>
 uint8_t CPU::op_pop_rr() {
     log(__func__);
     uint8_t register_number = read_first_register_16_bit_parameter();
-    write_register_16_bit_stack(register_number, pop_from_stack());
+    write_register_16_bit_stack(register_number, pop_from_stack<Timing>());
     return 12;
 }
 
+uint16_t CPU::add_sp_offset(uint8_t offset) {
+    // H and C come from the unsigned low-byte addition, whatever the offset's sign
+    set_flags(false, false, (sp_ & 0x0F) + (offset & 0x0F) > 0x0F, (sp_ & 0xFF) + offset > 0xFF);
+    return static_cast<uint16_t>(sp_ + static_cast<int8_t>(offset));
+}
+
+template <typename Timing>
 uint8_t CPU::op_ld_hl_sp_e() {
     log(__func__);
-    uint8_t value = fetchOpcode();
-    bool h_bit;
-    bool c_bit;
-    if (value >> 7) {
-        value = ~value + 1;
-        hl_ = sp_ - value;
-        h_bit = (sp_ & 0x0F) < (value & 0x0F);
-        c_bit = (sp_ & 0xFF) < (value & 0xFF);
-    } else {
-        hl_ = sp_ + value;
-        h_bit = (sp_ & 0x0F) + (value & 0x0F) > 0x0F;
-        c_bit = (sp_ & 0xFF) + (value & 0xFF) > 0xFF;
-    }
-    setFlagZ(0);
-    setFlagN(0);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
-    return 8; // 8 cycles
+    hl_ = add_sp_offset(fetchOpcode<Timing>());
+    return 12; // 12 cycles
 }
 
 // 8-bit arithmetic and logical instructions
+template <typename Timing>
 uint8_t CPU::op_add_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
     uint8_t value = read_register_8_bit(source_register);
-    bool h_bit = (getA() & 0x0F) + (value & 0x0F) > 0x0F;
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) + (static_cast<uint16_t>(value) & 0xFF) > 0xFF;
-    setA(getA() + value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint16_t result = getA() + value;
+    record_flags(result, false, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_add_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
-    bool h_bit = (getA() & 0x0F) + (value & 0x0F) > 0x0F;
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) + (static_cast<uint16_t>(value) & 0xFF) > 0xFF;
-    setA(getA() + value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint8_t value = read_memory<Timing>(hl_);
+    uint16_t result = getA() + value;
+    record_flags(result, false, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_add_imm() {
     log(__func__);
-    uint8_t value = fetchOpcode();
-    bool h_bit = (getA() & 0x0F) + (value & 0x0F) > 0x0F;
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) + (static_cast<uint16_t>(value) & 0xFF) > 0xFF;
-    setA(getA() + value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint8_t value = fetchOpcode<Timing>();
+    uint16_t result = getA() + value;
+    record_flags(result, false, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_adc_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
     uint8_t value = read_register_8_bit(source_register);
-    bool h_bit = (getA() & 0x0F) + (value & 0x0F) + getFlagC() > 0x0F;
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) + (static_cast<uint16_t>(value) & 0xFF) + getFlagC() > 0xFF;
-    setA(getA() + value + getFlagC());
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint16_t result = getA() + value + getFlagC();
+    record_flags(result, false, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_adc_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
-    bool h_bit = (getA() & 0x0F) + (value & 0x0F) + getFlagC() > 0x0F;
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) + (static_cast<uint16_t>(value) & 0xFF) + getFlagC() > 0xFF;
-    setA(getA() + value + getFlagC());
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint8_t value = read_memory<Timing>(hl_);
+    uint16_t result = getA() + value + getFlagC();
+    record_flags(result, false, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_adc_imm() {
     log(__func__);
-    uint8_t value = fetchOpcode();
-    bool h_bit = (getA() & 0x0F) + (value & 0x0F) + getFlagC() > 0x0F;
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) + (static_cast<uint16_t>(value) & 0xFF) + getFlagC() > 0xFF;
-    setA(getA() + value + getFlagC());
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint8_t value = fetchOpcode<Timing>();
+    uint16_t result = getA() + value + getFlagC();
+    record_flags(result, false, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_sub_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
     uint8_t value = read_register_8_bit(source_register);
-    bool h_bit = (getA() & 0x0F) < (value & 0x0F);
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) < (static_cast<uint16_t>(value) & 0xFF);
-    setA(getA() - value);
-    setFlagZ(getA() == 0);
-    setFlagN(1);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint16_t result = getA() - value;
+    record_flags(result, true, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_sub_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
-    bool h_bit = (getA() & 0x0F) < (value & 0x0F);
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) < (static_cast<uint16_t>(value) & 0xFF);
-    setA(getA() - value);
-    setFlagZ(getA() == 0);
-    setFlagN(1);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint8_t value = read_memory<Timing>(hl_);
+    uint16_t result = getA() - value;
+    record_flags(result, true, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_sub_imm() {
     log(__func__);
-    uint8_t value = fetchOpcode();
-    bool h_bit = (getA() & 0x0F) < (value & 0x0F);
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) < (static_cast<uint16_t>(value) & 0xFF);
-    setA(getA() - value);
-    setFlagZ(getA() == 0);
-    setFlagN(1);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint8_t value = fetchOpcode<Timing>();
+    uint16_t result = getA() - value;
+    record_flags(result, true, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_sbc_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
     uint8_t value = read_register_8_bit(source_register);
-    bool h_bit = (getA() & 0x0F) < (value & 0x0F) + getFlagC();
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) < (static_cast<uint16_t>(value) & 0xFF) + getFlagC();
-    setA(getA() - value - getFlagC());
-    setFlagZ(getA() == 0);
-    setFlagN(1);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint16_t result = getA() - value - getFlagC();
+    record_flags(result, true, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_sbc_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
-    bool h_bit = (getA() & 0x0F) < (value & 0x0F) + getFlagC();
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) < (static_cast<uint16_t>(value) & 0xFF) + getFlagC();
-    setA(getA() - value - getFlagC());
-    setFlagZ(getA() == 0);
-    setFlagN(1);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint8_t value = read_memory<Timing>(hl_);
+    uint16_t result = getA() - value - getFlagC();
+    record_flags(result, true, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_sbc_imm() {
     log(__func__);
-    uint8_t value = fetchOpcode();
-    bool h_bit = (getA() & 0x0F) < (value & 0x0F) + getFlagC();
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) < (static_cast<uint16_t>(value) & 0xFF) + getFlagC();
-    setA(getA() - value - getFlagC());
-    setFlagZ(getA() == 0);
-    setFlagN(1);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint8_t value = fetchOpcode<Timing>();
+    uint16_t result = getA() - value - getFlagC();
+    record_flags(result, true, getA() ^ value ^ result, result > 0xFF);
+    setA(result);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_cp_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
     uint8_t value = read_register_8_bit(source_register);
-    bool h_bit = (getA() & 0x0F) < (value & 0x0F);
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) < (static_cast<uint16_t>(value) & 0xFF);
-    setFlagZ(getA() == value);
-    setFlagN(1);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint16_t result = getA() - value;
+    record_flags(result, true, getA() ^ value ^ result, result > 0xFF);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_cp_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
-    bool h_bit = (getA() & 0x0F) < (value & 0x0F);
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) < (static_cast<uint16_t>(value) & 0xFF);
-    setFlagZ(getA() == value);
-    setFlagN(1);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint8_t value = read_memory<Timing>(hl_);
+    uint16_t result = getA() - value;
+    record_flags(result, true, getA() ^ value ^ result, result > 0xFF);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_cp_imm() {
     log(__func__);
-    uint8_t value = fetchOpcode();
-    bool h_bit = (getA() & 0x0F) < (value & 0x0F);
-    bool c_bit = (static_cast<uint16_t>(getA()) & 0xFF) < (static_cast<uint16_t>(value) & 0xFF);
-    setFlagZ(getA() == value);
-    setFlagN(1);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint8_t value = fetchOpcode<Timing>();
+    uint16_t result = getA() - value;
+    record_flags(result, true, getA() ^ value ^ result, result > 0xFF);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_inc_r() {
     log(__func__);
     uint8_t destination_register = read_first_register_8_bit_parameter();
     uint8_t value = read_register_8_bit(destination_register);
-    value++;
-    bool h_bit = (value & 0x0F) == 0x0F;
-    write_register_8_bit(destination_register, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(h_bit);
+    uint8_t result = value + 1;
+    write_register_8_bit(destination_register, result);
+    record_flags(result, false, value ^ result, getFlagC());
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_inc_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
-    value++;
-    bool h_bit = (value & 0x0F) == 0x0F;
-    mmu_->write_memory_8(hl_, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(h_bit);
-    return 8; // 8 cycles
+    uint8_t value = read_memory<Timing>(hl_);
+    uint8_t result = value + 1;
+    write_memory<Timing>(hl_, result);
+    record_flags(result, false, value ^ result, getFlagC());
+    return 12; // 12 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_dec_r() {
     log(__func__);
     uint8_t destination_register = read_first_register_8_bit_parameter();
     uint8_t value = read_register_8_bit(destination_register);
-    value--;
-    bool h_bit = (value & 0x0F) == 0x00;
-    write_register_8_bit(destination_register, value);
-    setFlagZ(value == 0);
-    setFlagN(1);
-    setFlagH(h_bit);
+    uint8_t result = value - 1;
+    write_register_8_bit(destination_register, result);
+    record_flags(result, true, value ^ result, getFlagC());
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_dec_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
-    value--;
-    bool h_bit = (value & 0x0F) == 0x00;
-    mmu_->write_memory_8(hl_, value);
-    setFlagZ(value == 0);
-    setFlagN(1);
-    setFlagH(h_bit);
+    uint8_t value = read_memory<Timing>(hl_);
+    uint8_t result = value - 1;
+    write_memory<Timing>(hl_, result);
+    record_flags(result, true, value ^ result, getFlagC());
     return 12; // 12 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_and_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
     uint8_t value = read_register_8_bit(source_register);
     setA(getA() & value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(1);
-    setFlagC(0);
+    record_flags(getA(), false, 0x10, false);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_and_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     setA(getA() & value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(1);
-    setFlagC(0);
+    record_flags(getA(), false, 0x10, false);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_and_imm() {
     log(__func__);
-    uint8_t value = fetchOpcode();
+    uint8_t value = fetchOpcode<Timing>();
     setA(getA() & value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(1);
-    setFlagC(0);
+    record_flags(getA(), false, 0x10, false);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_or_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
     uint8_t value = read_register_8_bit(source_register);
     setA(getA() | value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(0);
+    record_flags(getA(), false, 0, false);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_or_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     setA(getA() | value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(0);
+    record_flags(getA(), false, 0, false);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_or_imm() {
     log(__func__);
-    uint8_t value = fetchOpcode();
+    uint8_t value = fetchOpcode<Timing>();
     setA(getA() | value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(0);
+    record_flags(getA(), false, 0, false);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_xor_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
     uint8_t value = read_register_8_bit(source_register);
     setA(getA() ^ value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(0);
+    record_flags(getA(), false, 0, false);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_xor_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     setA(getA() ^ value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(0);
+    record_flags(getA(), false, 0, false);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_xor_imm() {
     log(__func__);
-    uint8_t value = fetchOpcode();
+    uint8_t value = fetchOpcode<Timing>();
     setA(getA() ^ value);
-    setFlagZ(getA() == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(0);
+    record_flags(getA(), false, 0, false);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ccf() {
     log(__func__);
     setFlagC(!getFlagC());
@@ -801,6 +1082,7 @@ uint8_t CPU::op_ccf() {
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_scf() {
     log(__func__);
     setFlagC(1);
@@ -809,28 +1091,36 @@ uint8_t CPU::op_scf() {
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_daa() {
     log(__func__);
+    // The high digit is checked against the value before the low-digit correction
+    uint8_t value = getA();
+    bool c_bit = getFlagC();
     if (getFlagN() == 0) {
-        if (getFlagH() == 1 || (getA() & 0x0F) > 0x09) {
-            setA(getA() + 0x06);
+        if (c_bit || value > 0x99) {
+            value += 0x60;
+            c_bit = true;
         }
-        if (getFlagC() == 1 || getA() > 0x99) {
-            setA(getA() + 0x60);
+        if (getFlagH() || (value & 0x0F) > 0x09) {
+            value += 0x06;
         }
     } else {
-        if (getFlagH() == 1) {
-            setA(getA() - 0x06);
+        if (c_bit) {
+            value -= 0x60;
         }
-        if (getFlagC() == 1) {
-            setA(getA() - 0x60);
+        if (getFlagH()) {
+            value -= 0x06;
         }
     }
-    setFlagZ(getA() == 0);
+    setA(value);
+    setFlagZ(value == 0);
     setFlagH(0);
+    setFlagC(c_bit);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_cpl() {
     log(__func__);
     setA(~getA());
@@ -840,6 +1130,7 @@ uint8_t CPU::op_cpl() {
 }
 
 // 16-bit arithmetic instructions
+template <typename Timing>
 uint8_t CPU::op_inc_rr() {
     log(__func__);
     uint8_t register_number = read_first_register_16_bit_parameter();
@@ -849,6 +1140,7 @@ uint8_t CPU::op_inc_rr() {
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_dec_rr() {
     log(__func__);
     uint8_t register_number = read_first_register_16_bit_parameter();
@@ -858,95 +1150,74 @@ uint8_t CPU::op_dec_rr() {
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_add_hl_rr() {
     log(__func__);
     uint8_t source_register = read_first_register_16_bit_parameter();
     uint16_t value = read_register_16_bit(source_register);
-    bool h_bit = (hl_ & 0x0F) + (value & 0x0F) > 0x0F;
-    bool c_bit = (hl_ & 0xFF) + (value & 0xFF) > 0xFF;
-    hl_ = hl_ + value;
-    setFlagN(0);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    uint32_t result = hl_ + value;
+    // Z is kept; H is the carry out of bit 11
+    flag_n_ = false;
+    flag_h_bits_ = static_cast<uint8_t>((hl_ ^ value ^ result) >> 8);
+    flag_c_ = result > 0xFFFF;
+    hl_ = static_cast<uint16_t>(result);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_add_sp_e() {
     log(__func__);
-    uint8_t value = fetchOpcode();
-    bool h_bit;
-    bool c_bit;
-    if (value >> 7) {
-        value = ~value + 1;
-        sp_ = sp_ - value;
-        h_bit = (sp_ & 0x0F) < (value & 0x0F);
-        c_bit = (sp_ & 0xFF) < (value & 0xFF);
-    } else {
-        sp_ = sp_ + value;
-        h_bit = (sp_ & 0x0F) + (value & 0x0F) > 0x0F;
-        c_bit = (sp_ & 0xFF) + (value & 0xFF) > 0xFF;
-    }
-    setFlagZ(0);
-    setFlagN(0);
-    setFlagH(h_bit);
-    setFlagC(c_bit);
+    sp_ = add_sp_offset(fetchOpcode<Timing>());
     return 16; // 16 cycles
 }
 
 // Rotate, shift, and bit operation instructions
+template <typename Timing>
 uint8_t CPU::op_rlca() {
     log(__func__);
     uint8_t value = getA();
     bool c_bit = value >> 7;
     value = (value << 1) | c_bit;
     setA(value);
-    setFlagZ(0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    set_flags(false, false, false, c_bit);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_rrca() {
     log(__func__);
     uint8_t value = getA();
     bool c_bit = value & 0x01;
-    value = (value >> 1) | c_bit;
+    value = (value >> 1) | (c_bit << 7);
     setA(value);
-    setFlagZ(0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    set_flags(false, false, false, c_bit);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_rla() {
     log(__func__);
     uint8_t value = getA();
     bool c_bit = value >> 7;
     value = (value << 1) | getFlagC();
     setA(value);
-    setFlagZ(0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    set_flags(false, false, false, c_bit);
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_rra() {
     log(__func__);
     uint8_t value = getA();
     bool c_bit = value & 0x01;
     value = (value >> 1) | (getFlagC() << 7);
     setA(value);
-    setFlagZ(0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    set_flags(false, false, false, c_bit);
     return 4; // 4 cycles
 }
 
 // CB prefix instructions
+template <typename Timing>
 uint8_t CPU::op_rlc_r() {
     log(__func__);
     uint8_t destination_register = read_second_register_8_bit_parameter();
@@ -954,26 +1225,22 @@ uint8_t CPU::op_rlc_r() {
     bool c_bit = value >> 7;
     value = (value << 1) | c_bit;
     write_register_8_bit(destination_register, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    record_flags(value, false, 0, c_bit);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_rlc_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     bool c_bit = value >> 7;
     value = (value << 1) | c_bit;
-    mmu_->write_memory_8(hl_, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    write_memory<Timing>(hl_, value);
+    record_flags(value, false, 0, c_bit);
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_rrc_r() {
     log(__func__);
     uint8_t destination_register = read_second_register_8_bit_parameter();
@@ -981,26 +1248,22 @@ uint8_t CPU::op_rrc_r() {
     bool c_bit = value & 0x01;
     value = (value >> 1) | (c_bit << 7);
     write_register_8_bit(destination_register, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    record_flags(value, false, 0, c_bit);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_rrc_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     bool c_bit = value & 0x01;
     value = (value >> 1) | (c_bit << 7);
-    mmu_->write_memory_8(hl_, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    write_memory<Timing>(hl_, value);
+    record_flags(value, false, 0, c_bit);
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_rl_r() {
     log(__func__);
     uint8_t destination_register = read_second_register_8_bit_parameter();
@@ -1008,26 +1271,22 @@ uint8_t CPU::op_rl_r() {
     bool c_bit = value >> 7;
     value = (value << 1) | getFlagC();
     write_register_8_bit(destination_register, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    record_flags(value, false, 0, c_bit);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_rl_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     bool c_bit = value >> 7;
     value = (value << 1) | getFlagC();
-    mmu_->write_memory_8(hl_, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    write_memory<Timing>(hl_, value);
+    record_flags(value, false, 0, c_bit);
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_rr_r() {
     log(__func__);
     uint8_t destination_register = read_second_register_8_bit_parameter();
@@ -1035,26 +1294,22 @@ uint8_t CPU::op_rr_r() {
     bool c_bit = value & 0x01;
     value = (value >> 1) | (getFlagC() << 7);
     write_register_8_bit(destination_register, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    record_flags(value, false, 0, c_bit);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_rr_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     bool c_bit = value & 0x01;
     value = (value >> 1) | (getFlagC() << 7);
-    mmu_->write_memory_8(hl_, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    write_memory<Timing>(hl_, value);
+    record_flags(value, false, 0, c_bit);
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_sla_r() {
     log(__func__);
     uint8_t destination_register = read_second_register_8_bit_parameter();
@@ -1062,26 +1317,22 @@ uint8_t CPU::op_sla_r() {
     bool c_bit = value >> 7;
     value = value << 1;
     write_register_8_bit(destination_register, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    record_flags(value, false, 0, c_bit);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_sla_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     bool c_bit = value >> 7;
     value = value << 1;
-    mmu_->write_memory_8(hl_, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    write_memory<Timing>(hl_, value);
+    record_flags(value, false, 0, c_bit);
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_sra_r() {
     log(__func__);
     uint8_t destination_register = read_second_register_8_bit_parameter();
@@ -1089,51 +1340,43 @@ uint8_t CPU::op_sra_r() {
     bool c_bit = value & 0x01;
     value = (value >> 1) | (value & 0x80);
     write_register_8_bit(destination_register, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    record_flags(value, false, 0, c_bit);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_sra_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     bool c_bit = value & 0x01;
-    value = value >> 1;
-    mmu_->write_memory_8(hl_, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    value = (value >> 1) | (value & 0x80);
+    write_memory<Timing>(hl_, value);
+    record_flags(value, false, 0, c_bit);
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_swap_r() {
     log(__func__);
     uint8_t destination_register = read_second_register_8_bit_parameter();
     uint8_t value = read_register_8_bit(destination_register);
     value = (value << 4) | (value >> 4);
     write_register_8_bit(destination_register, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(0);
+    record_flags(value, false, 0, false);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_swap_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     value = (value << 4) | (value >> 4);
-    mmu_->write_memory_8(hl_, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(0);
+    write_memory<Timing>(hl_, value);
+    record_flags(value, false, 0, false);
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_srl_r() {
     log(__func__);
     uint8_t destination_register = read_second_register_8_bit_parameter();
@@ -1141,26 +1384,22 @@ uint8_t CPU::op_srl_r() {
     bool c_bit = value & 0x01;
     value = value >> 1;
     write_register_8_bit(destination_register, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    record_flags(value, false, 0, c_bit);
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_srl_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     bool c_bit = value & 0x01;
     value = value >> 1;
-    mmu_->write_memory_8(hl_, value);
-    setFlagZ(value == 0);
-    setFlagN(0);
-    setFlagH(0);
-    setFlagC(c_bit);
+    write_memory<Timing>(hl_, value);
+    record_flags(value, false, 0, c_bit);
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_bit_b_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
@@ -1172,9 +1411,10 @@ uint8_t CPU::op_bit_b_r() {
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_bit_b_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     bool bit = value & (1 << read_bit_argument());
     setFlagZ(bit == 0);
     setFlagN(0);
@@ -1182,6 +1422,7 @@ uint8_t CPU::op_bit_b_hl_ind() {
     return 12; // 12 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_res_b_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
@@ -1191,14 +1432,16 @@ uint8_t CPU::op_res_b_r() {
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_res_b_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     value = value & ~(1 << read_bit_argument());
-    mmu_->write_memory_8(hl_, value);
+    write_memory<Timing>(hl_, value);
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_set_b_r() {
     log(__func__);
     uint8_t source_register = read_second_register_8_bit_parameter();
@@ -1208,32 +1451,36 @@ uint8_t CPU::op_set_b_r() {
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_set_b_hl_ind() {
     log(__func__);
-    uint8_t value = mmu_->read_memory_8(hl_);
+    uint8_t value = read_memory<Timing>(hl_);
     value = value | (1 << read_bit_argument());
-    mmu_->write_memory_8(hl_, value);
+    write_memory<Timing>(hl_, value);
     return 16; // 16 cycles
 }
 
 
 // Control flow instructions
+template <typename Timing>
 uint8_t CPU::op_jp_imm() {
     log(__func__);
-    uint16_t address = endian_swap(fetchOpcode(), fetchOpcode());
+    uint16_t address = fetch_imm16<Timing>();
     pc_ = address;
     return 16; // 16 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_jp_hl() {
     log(__func__);
     pc_ = hl_;
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_jp_cc_imm() {
     log(__func__);
-    uint16_t address = endian_swap(fetchOpcode(), fetchOpcode());
+    uint16_t address = fetch_imm16<Timing>();
     if (read_condition_argument()) {
         pc_ = address;
         return 16; // 16 cycles
@@ -1241,9 +1488,10 @@ uint8_t CPU::op_jp_cc_imm() {
     return 12; // 12 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_jr_e() {
     log(__func__);
-    uint8_t value = fetchOpcode();
+    uint8_t value = fetchOpcode<Timing>();
     if (value >> 7) {
         value = ~value + 1;
         pc_ = pc_ - value;
@@ -1253,9 +1501,10 @@ uint8_t CPU::op_jr_e() {
     return 12; // 12 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_jr_cc_e() {
     log(__func__);
-    uint8_t value = fetchOpcode();
+    uint8_t value = fetchOpcode<Timing>();
     if (read_condition_argument()) {
         if (value >> 7) {
             value = ~value + 1;
@@ -1268,83 +1517,117 @@ uint8_t CPU::op_jr_cc_e() {
     return 8; // 8 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_call_imm() {
     log(__func__);
-    uint16_t address = endian_swap(fetchOpcode(), fetchOpcode());
-    push_to_stack(pc_);
+    uint16_t address = fetch_imm16<Timing>();
+    m_cycle<Timing>();  // Internal delay before the writes
+    push_to_stack<Timing>(pc_);
     pc_ = address;
+    if (profiler_ != nullptr) {
+        profiler_->on_call(pc_, sp_);
+    }
     return 24;
 }
 
+template <typename Timing>
 uint8_t CPU::op_call_cc_imm() {
     log(__func__);
-    uint16_t address = endian_swap(fetchOpcode(), fetchOpcode());
+    uint16_t address = fetch_imm16<Timing>();
     if (read_condition_argument()) {
-        push_to_stack(pc_);
+        m_cycle<Timing>();  // Internal delay before the writes
+        push_to_stack<Timing>(pc_);
         pc_ = address;
+        if (profiler_ != nullptr) {
+            profiler_->on_call(pc_, sp_);
+        }
         return 24;
     }
     return 12;
 }
 
+template <typename Timing>
 uint8_t CPU::op_ret() {
     log(__func__);
-    pc_ = pop_from_stack();
+    pc_ = pop_from_stack<Timing>();
+    if (profiler_ != nullptr) {
+        profiler_->on_return(sp_);
+    }
     return 16;
 }
 
+template <typename Timing>
 uint8_t CPU::op_ret_cc() {
     log(__func__);
+    m_cycle<Timing>();  // Condition check
     if (read_condition_argument()) {
-        pc_ = pop_from_stack();
+        pc_ = pop_from_stack<Timing>();
+        if (profiler_ != nullptr) {
+            profiler_->on_return(sp_);
+        }
         return 20;
     }
     return 8;
 }
 
+template <typename Timing>
 uint8_t CPU::op_reti() {
     log(__func__);
-    pc_ = pop_from_stack();
+    pc_ = pop_from_stack<Timing>();
     ime_ = true;
+    if (profiler_ != nullptr) {
+        profiler_->on_return(sp_);
+    }
     return 16;
 }
 
+template <typename Timing>
 uint8_t CPU::op_rst_imm() {
     log(__func__);
-    push_to_stack(pc_);
+    m_cycle<Timing>();  // Internal delay before the writes
+    push_to_stack<Timing>(pc_);
     pc_ = read_bit_argument() << 3;
+    if (profiler_ != nullptr) {
+        profiler_->on_call(pc_, sp_);
+    }
     return 16;
 }
 
 // Miscellaneous instructions
+template <typename Timing>
 uint8_t CPU::op_halt() {
     log(__func__);
-    // HALT instruction - CPU stops until interrupt
-    // GameBoyEmulator will handle the stop condition
+    // The CPU idles until an interrupt is pending (see handle_interrupts)
+    halted_ = true;
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_stop() {
     log(__func__);
     // STOP instruction - CPU and GPU stop
     // GameBoyEmulator will handle the stop condition
     mmu_->write_memory_8(DIV_REGISTER_LOCATION, 0x00);
+    pc_++;  // STOP is followed by a padding byte
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_di() {
     log(__func__);
     ime_ = false;
-    // TODO: Add interrupt handling
+    ime_pending_ = false;
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_ei() {
     log(__func__);
-    ime_ = true;
+    ime_pending_ = true;
     return 4; // 4 cycles
 }
 
+template <typename Timing>
 uint8_t CPU::op_nop() {
     log(__func__);
     return 4; // 4 cycles
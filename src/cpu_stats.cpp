@@ -0,0 +1,66 @@
+#include "../inc/cpu_stats.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+volatile std::sig_atomic_t CpuStats::report_requested_ = 0;
+
+static const char* const REGION_NAMES[CpuStats::REGION_COUNT] = {
+    "ROM0", "ROMX", "VRAM", "Cart RAM", "WRAM", "Unusable", "OAM", "I/O", "HRAM", "IE"
+};
+static const char* const INTERRUPT_NAMES[CpuStats::INTERRUPT_SOURCES] = {
+    "VBlank", "LCD STAT", "Timer", "Serial", "Joypad"
+};
+
+void CpuStats::write_report(std::ostream& out) const {
+    uint64_t instructions = 0;
+    uint64_t cycles = 0;
+    for (int cb = 0; cb < 2; cb++) {
+        for (int op = 0; op < 256; op++) {
+            instructions += executions_[cb][op];
+            cycles += cycles_[cb][op];
+        }
+    }
+    auto percent = [](uint64_t part, uint64_t whole) { return whole > 0 ? 100.0 * part / whole : 0.0; };
+
+    out << std::fixed << std::setprecision(2);
+    out << "Instructions: " << instructions << ", cycles: " << cycles << std::endl;
+
+    // Most executed first; CB opcodes are shown with their prefix
+    struct Entry {
+        bool cb;
+        uint8_t opcode;
+    };
+    std::vector<Entry> entries;
+    for (int cb = 0; cb < 2; cb++) {
+        for (int op = 0; op < 256; op++) {
+            if (executions_[cb][op] > 0) {
+                entries.push_back({cb != 0, static_cast<uint8_t>(op)});
+            }
+        }
+    }
+    std::stable_sort(entries.begin(), entries.end(), [this](const Entry& a, const Entry& b) {
+        return executions_[a.cb][a.opcode] > executions_[b.cb][b.opcode];
+    });
+    out << std::endl << "Opcode      executions       %           cycles       %" << std::endl;
+    for (const Entry& entry : entries) {
+        uint64_t count = executions_[entry.cb][entry.opcode];
+        uint64_t spent = cycles_[entry.cb][entry.opcode];
+        out << (entry.cb ? "CB " : "   ") << std::hex << std::uppercase << std::setw(2) << std::setfill('0')
+            << static_cast<int>(entry.opcode) << std::dec << std::nouppercase << std::setfill(' ')
+            << std::setw(18) << count << std::setw(8) << percent(count, instructions)
+            << std::setw(17) << spent << std::setw(8) << percent(spent, cycles) << std::endl;
+    }
+
+    out << std::endl << "Region             reads          writes" << std::endl;
+    for (int region = 0; region < REGION_COUNT; region++) {
+        out << std::left << std::setw(9) << REGION_NAMES[region] << std::right
+            << std::setw(15) << accesses_[0][region] << std::setw(16) << accesses_[1][region] << std::endl;
+    }
+
+    out << std::endl << "Interrupt       serviced" << std::endl;
+    for (int source = 0; source < INTERRUPT_SOURCES; source++) {
+        out << std::left << std::setw(9) << INTERRUPT_NAMES[source] << std::right
+            << std::setw(15) << interrupts_[source] << std::endl;
+    }
+}
@@ -0,0 +1,741 @@
+#include "../inc/debugger.hpp"
+#include "../inc/cpu.hpp"
+#include "../inc/disassembler.hpp"
+#include "../inc/mmu.hpp"
+#include "../inc/symbol_table.hpp"
+#include "../inc/watchpoints.hpp"
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+volatile std::sig_atomic_t Debugger::break_requested_ = 0;
+
+static const char* const PROMPT = "(gb) ";
+static const uint32_t DEFAULT_MEMORY_BYTES = 64;
+static const uint32_t DEFAULT_DISASSEMBLY_LINES = 10;
+static const uint32_t DEFAULT_HITS = 10;
+// Long next/finish runs look for Ctrl-C or client input this often
+static const uint32_t STOP_CHECK_INTERVAL = 4096;
+
+static const char* const HELP =
+    "c, continue        Run until a breakpoint, Ctrl-C or (socket) any input\n"
+    "s, step [N]        Execute N instructions (default 1)\n"
+    "n, next            Step, running a CALL or RST until it returns\n"
+    "finish             Run until the current function returns\n"
+    "b, break LOC       Set a breakpoint\n"
+    "d, delete [N]      Delete breakpoint N, or all of them\n"
+    "w, watch RANGE [r|w|rw] [log]\n"
+    "                   Stop after reads and/or writes (default w) in RANGE,\n"
+    "                   or with log only record them\n"
+    "u, unwatch [N]     Delete watchpoint N, or all of them\n"
+    "hits [N]           Show the last N watchpoint hits (default 10)\n"
+    "rewind [N]         Go back to the start of the frame N frames ago\n"
+    "                   (default 1; needs --rewind)\n"
+    "i, info            List breakpoints and watchpoints\n"
+    "r, regs            Show registers\n"
+    "x LOC [N]          Show N bytes of memory (default 64)\n"
+    "l, dis [LOC] [N]   Disassemble N instructions (default 10) from LOC or PC\n"
+    "q, quit            End emulation\n"
+    "LOC is hex (C000, $C000, 0xC000), BB:AAAA (banked), a register or a symbol.\n"
+    "RANGE is LOC, LOC-LOC or LOC+N (N bytes).\n"
+    "An empty line repeats the last command.\n";
+
+static std::vector<std::string> split(const std::string& line) {
+    std::istringstream stream(line);
+    std::vector<std::string> words;
+    std::string word;
+    while (stream >> word) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+static bool parse_hex(const std::string& text, uint32_t limit, uint32_t& value) {
+    std::string digits = text;
+    if (digits.size() > 1 && digits[0] == '$') {
+        digits = digits.substr(1);
+    } else if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+        digits = digits.substr(2);
+    }
+    if (digits.empty() || digits.size() > 8 || digits.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+        return false;
+    }
+    value = static_cast<uint32_t>(std::stoul(digits, nullptr, 16));
+    return value <= limit;
+}
+
+static bool is_call(uint8_t opcode) {
+    return opcode == 0xCD || (opcode & 0xE7) == 0xC4 || (opcode & 0xC7) == 0xC7;  // CALL, CALL cc, RST
+}
+
+static bool is_return(uint8_t opcode) {
+    return opcode == 0xC9 || opcode == 0xD9 || (opcode & 0xE7) == 0xC0;  // RET, RETI, RET cc
+}
+
+Debugger::Debugger(CPU* cpu, const MMU* mmu, Disassembler* disassembler, StepFunction step)
+    : cpu_(cpu)
+    , mmu_(mmu)
+    , disassembler_(disassembler)
+    , step_(std::move(step)) {}
+
+Debugger::~Debugger() {
+#ifndef _WIN32
+    if (socket_) {
+        ::close(input_);
+    }
+#endif
+}
+
+void Debugger::set_symbols(const SymbolTable* symbols) {
+    symbols_ = symbols;
+    disassembler_->set_symbols(symbols);
+}
+
+bool Debugger::open_console() {
+    show_stop("Stopped");
+    return true;
+}
+
+bool Debugger::listen(const std::string& path) {
+#ifdef _WIN32
+    std::cerr << "Error: debugger sockets are not supported on this platform" << std::endl;
+    return false;
+#else
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: debugger socket path too long: " << path << std::endl;
+        return false;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());
+    if (listener < 0 || ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+        || ::listen(listener, 1) < 0) {
+        std::cerr << "Error: could not listen on " << path << ": " << std::strerror(errno) << std::endl;
+    } else {
+        std::cout << "Debugger: waiting for a client on " << path << std::endl;
+        input_ = output_ = ::accept(listener, nullptr, nullptr);
+    }
+    if (listener >= 0) {
+        ::close(listener);
+    }
+    // There is only ever one client, so the path can go now
+    ::unlink(path.c_str());
+    if (input_ < 0) {
+        return false;
+    }
+    socket_ = true;
+    show_stop("Stopped");
+    return true;
+#endif
+}
+
+bool Debugger::read_line(std::string& line) {
+    if (!socket_) {
+        if (!std::getline(std::cin, line)) {
+            return false;
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        return true;
+    }
+#ifdef _WIN32
+    return false;
+#else
+    while (true) {
+        size_t end = buffer_.find('\n');
+        if (end != std::string::npos) {
+            line = buffer_.substr(0, end);
+            buffer_.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            return true;
+        }
+        char chunk[256];
+        ssize_t n = ::read(input_, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buffer_.append(chunk, static_cast<size_t>(n));
+    }
+#endif
+}
+
+void Debugger::write(const std::string& text) {
+    if (!socket_) {
+        std::cout << text << std::flush;
+        return;
+    }
+#ifndef _WIN32
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t n = ::send(output_, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+#endif
+}
+
+bool Debugger::poll() {
+    if (!attached_) {
+        return false;
+    }
+    if (!stopped_ && break_requested_) {
+        stopped_ = true;
+        show_stop("Interrupted");
+    }
+#ifndef _WIN32
+    if (!stopped_ && socket_) {
+        // A client cannot send a signal; any input interrupts and is then run as a command
+        pollfd pending = {input_, POLLIN, 0};
+        if (::poll(&pending, 1, 0) > 0) {
+            stopped_ = true;
+            show_stop("Interrupted");
+        }
+    }
+#endif
+    break_requested_ = 0;
+    return stopped_;
+}
+
+void Debugger::on_breakpoint() {
+    if (watch_hit()) {
+        stopped_ = true;
+        show_stop("Watchpoint");
+        return;
+    }
+    if (!breakpoint_matches(cpu_->pc())) {
+        cpu_->resume_from_breakpoint();
+        return;
+    }
+    stopped_ = true;
+    show_stop("Breakpoint");
+}
+
+bool Debugger::run_commands() {
+    std::string line;
+    while (!session_over_) {
+        write(PROMPT);
+        if (!read_line(line)) {
+            detach();
+            return true;
+        }
+        if (line.find_first_not_of(" \t") == std::string::npos) {
+            line = last_command_;
+        } else {
+            last_command_ = line;
+        }
+        Action action = execute(line);
+        if (action == Action::Quit) {
+            return false;
+        }
+        if (action == Action::Resume) {
+            stopped_ = false;
+            cpu_->resume_from_breakpoint();
+            return true;
+        }
+    }
+    write("Emulation ended\n");
+    return true;
+}
+
+void Debugger::detach() {
+    // Without a console nobody could continue from a breakpoint
+    for (const Breakpoint& breakpoint : breakpoints_) {
+        cpu_->set_breakpoint(breakpoint.address, false);
+    }
+    breakpoints_.clear();
+    if (watchpoints_ != nullptr) {
+        std::vector<Watchpoints::Watchpoint> watched = watchpoints_->watchpoints();
+        for (const Watchpoints::Watchpoint& watchpoint : watched) {
+            if (watchpoint.stop) {
+                watchpoints_->remove(watchpoint.number);
+            }
+        }
+    }
+    attached_ = false;
+    stopped_ = false;
+    std::cerr << "Debugger: console closed, continuing" << std::endl;
+}
+
+Debugger::Action Debugger::execute(const std::string& line) {
+    std::vector<std::string> words = split(line);
+    if (words.empty()) {
+        return Action::Stay;
+    }
+    const std::string& command = words[0];
+    std::string first = words.size() > 1 ? words[1] : "";
+    std::string second = words.size() > 2 ? words[2] : "";
+
+    if (command == "c" || command == "continue") {
+        return Action::Resume;
+    } else if (command == "s" || command == "step") {
+        uint32_t count = first.empty() ? 1 : static_cast<uint32_t>(std::strtoul(first.c_str(), nullptr, 10));
+        step(std::max<uint32_t>(count, 1));
+    } else if (command == "n" || command == "next") {
+        next();
+    } else if (command == "finish") {
+        finish();
+    } else if (command == "b" || command == "break") {
+        add_breakpoint(first);
+    } else if (command == "d" || command == "delete") {
+        delete_breakpoint(first);
+    } else if (command == "w" || command == "watch") {
+        add_watchpoint(first, std::vector<std::string>(words.begin() + std::min<size_t>(words.size(), 2), words.end()));
+    } else if (command == "u" || command == "unwatch") {
+        delete_watchpoint(first);
+    } else if (command == "hits") {
+        show_hits(first);
+    } else if (command == "rewind") {
+        rewind(first);
+    } else if (command == "i" || command == "info") {
+        list_breakpoints();
+    } else if (command == "r" || command == "regs") {
+        show_registers();
+    } else if (command == "x") {
+        show_memory(first, second);
+    } else if (command == "l" || command == "dis") {
+        show_disassembly(first, second);
+    } else if (command == "q" || command == "quit") {
+        return Action::Quit;
+    } else if (command == "h" || command == "help") {
+        write(HELP);
+    } else {
+        write("Unknown command \"" + command + "\", try help\n");
+    }
+    return Action::Stay;
+}
+
+bool Debugger::run_instruction() {
+    cpu_->resume_from_breakpoint();
+    if (!step_()) {
+        session_over_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool Debugger::stop_requested() {
+    if (++steps_since_check_ < STOP_CHECK_INTERVAL) {
+        return false;
+    }
+    steps_since_check_ = 0;
+    if (break_requested_) {
+        break_requested_ = 0;
+        return true;
+    }
+#ifdef _WIN32
+    return false;
+#else
+    pollfd pending = {input_, POLLIN, 0};
+    return socket_ && ::poll(&pending, 1, 0) > 0;
+#endif
+}
+
+void Debugger::step(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (!run_instruction()) {
+            return;
+        }
+        if (watch_hit()) {
+            show_stop("Watchpoint");
+            return;
+        }
+        if (i + 1 < count && breakpoint_matches(cpu_->pc())) {
+            show_stop("Breakpoint");
+            return;
+        }
+    }
+    show_stop("Step");
+}
+
+void Debugger::next() {
+    CPU::Registers start = cpu_->registers();
+    uint8_t opcode = mmu_->peek_memory_8(start.pc);
+    if (start.halted || !is_call(opcode)) {
+        step(1);
+        return;
+    }
+    // Done when execution is back after the call with the return address popped
+    uint16_t return_address = static_cast<uint16_t>(start.pc + Disassembler::length(opcode));
+    while (run_instruction()) {
+        CPU::Registers now = cpu_->registers();
+        if (now.pc == return_address && now.sp == start.sp) {
+            show_stop("Step");
+            return;
+        }
+        if (watch_hit()) {
+            show_stop("Watchpoint");
+            return;
+        }
+        if (breakpoint_matches(now.pc)) {
+            show_stop("Breakpoint");
+            return;
+        }
+        if (stop_requested()) {
+            show_stop("Interrupted");
+            return;
+        }
+    }
+}
+
+void Debugger::finish() {
+    // The function has returned once a return pops a frame at or above the current SP
+    uint16_t start_sp = cpu_->registers().sp;
+    while (true) {
+        CPU::Registers before = cpu_->registers();
+        bool returning = !before.halted && is_return(mmu_->peek_memory_8(before.pc));
+        if (!run_instruction()) {
+            return;
+        }
+        CPU::Registers now = cpu_->registers();
+        if (returning && now.sp > start_sp) {
+            show_stop("Returned");
+            return;
+        }
+        if (watch_hit()) {
+            show_stop("Watchpoint");
+            return;
+        }
+        if (breakpoint_matches(now.pc)) {
+            show_stop("Breakpoint");
+            return;
+        }
+        if (stop_requested()) {
+            show_stop("Interrupted");
+            return;
+        }
+    }
+}
+
+void Debugger::add_breakpoint(const std::string& argument) {
+    uint16_t address = 0;
+    int32_t bank = -1;
+    if (!parse_location(argument, address, bank)) {
+        write("Usage: break LOC\n");
+        return;
+    }
+    cpu_->set_breakpoint(address, true);
+    breakpoints_.push_back({next_breakpoint_++, address, bank});
+    std::ostringstream out;
+    out << "Breakpoint " << breakpoints_.back().number << " at "
+        << (bank >= 0 ? SymbolTable::location(static_cast<uint16_t>(bank), address) : describe(address)) << "\n";
+    write(out.str());
+}
+
+void Debugger::delete_breakpoint(const std::string& argument) {
+    uint32_t number = 0;
+    if (!argument.empty()) {
+        number = static_cast<uint32_t>(std::strtoul(argument.c_str(), nullptr, 10));
+        if (number == 0) {
+            write("Usage: delete [N]\n");
+            return;
+        }
+    }
+    auto removed = std::remove_if(breakpoints_.begin(), breakpoints_.end(), [number](const Breakpoint& breakpoint) {
+        return number == 0 || breakpoint.number == number;
+    });
+    if (removed == breakpoints_.end()) {
+        write("No breakpoint " + argument + "\n");
+        return;
+    }
+    std::vector<Breakpoint> deleted(removed, breakpoints_.end());
+    breakpoints_.erase(removed, breakpoints_.end());
+    // Banked breakpoints may share an address; the flag goes with the last one
+    for (const Breakpoint& breakpoint : deleted) {
+        bool shared = std::any_of(breakpoints_.begin(), breakpoints_.end(), [&](const Breakpoint& other) {
+            return other.address == breakpoint.address;
+        });
+        if (!shared) {
+            cpu_->set_breakpoint(breakpoint.address, false);
+        }
+    }
+}
+
+void Debugger::list_breakpoints() {
+    std::ostringstream out;
+    if (breakpoints_.empty()) {
+        out << "No breakpoints\n";
+    }
+    for (const Breakpoint& breakpoint : breakpoints_) {
+        out << breakpoint.number << "  ";
+        if (breakpoint.bank >= 0) {
+            uint16_t bank = static_cast<uint16_t>(breakpoint.bank);
+            out << SymbolTable::location(bank, breakpoint.address);
+            if (symbols_ != nullptr && symbols_->lookup(bank, breakpoint.address) != nullptr) {
+                out << "  " << symbols_->describe(bank, breakpoint.address);
+            }
+        } else {
+            char address[8];
+            std::snprintf(address, sizeof(address), "%04X", breakpoint.address);
+            out << "   " << address << "  any bank";
+        }
+        out << "\n";
+    }
+    if (watchpoints_ != nullptr && !watchpoints_->watchpoints().empty()) {
+        out << "Watchpoints:\n";
+        for (const Watchpoints::Watchpoint& watchpoint : watchpoints_->watchpoints()) {
+            char text[64];
+            std::snprintf(text, sizeof(text), "%u  %04X-%04X  %s%s%s\n", watchpoint.number, watchpoint.first,
+                          watchpoint.last, watchpoint.access & Watchpoints::READ ? "r" : "",
+                          watchpoint.access & Watchpoints::WRITE ? "w" : "", watchpoint.stop ? "" : "  log");
+            out << text;
+        }
+    }
+    write(out.str());
+}
+
+bool Debugger::breakpoint_matches(uint16_t pc) const {
+    if (!cpu_->has_breakpoint(pc)) {
+        return false;
+    }
+    for (const Breakpoint& breakpoint : breakpoints_) {
+        if (breakpoint.address == pc && (breakpoint.bank < 0 || breakpoint.bank == mmu_->bank_of(pc))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Debugger::add_watchpoint(const std::string& range, const std::vector<std::string>& options) {
+    static const char* const USAGE = "Usage: watch RANGE [r|w|rw] [log]\n";
+    if (watchpoints_ == nullptr) {
+        write("Watchpoints are not available\n");
+        return;
+    }
+    size_t split = range.find_first_of("-+", 1);
+    uint16_t first = 0;
+    uint16_t last = 0;
+    int32_t bank = -1;
+    if (!parse_location(range.substr(0, split), first, bank)) {
+        write(USAGE);
+        return;
+    }
+    last = first;
+    if (split != std::string::npos && range[split] == '+') {
+        uint32_t bytes = static_cast<uint32_t>(std::strtoul(range.c_str() + split + 1, nullptr, 10));
+        if (bytes == 0 || first + bytes - 1 > 0xFFFF) {
+            write(USAGE);
+            return;
+        }
+        last = static_cast<uint16_t>(first + bytes - 1);
+    } else if (split != std::string::npos && !parse_location(range.substr(split + 1), last, bank)) {
+        write(USAGE);
+        return;
+    }
+    uint8_t access = Watchpoints::WRITE;
+    bool stop = true;
+    for (const std::string& option : options) {
+        if (option == "r") {
+            access = Watchpoints::READ;
+        } else if (option == "w") {
+            access = Watchpoints::WRITE;
+        } else if (option == "rw") {
+            access = Watchpoints::READ | Watchpoints::WRITE;
+        } else if (option == "log") {
+            stop = false;
+        } else {
+            write(USAGE);
+            return;
+        }
+    }
+    uint32_t number = watchpoints_->add(first, last, access, stop);
+    char text[64];
+    std::snprintf(text, sizeof(text), "Watchpoint %u on %04X-%04X\n", number, std::min(first, last), std::max(first, last));
+    write(text);
+}
+
+void Debugger::delete_watchpoint(const std::string& argument) {
+    uint32_t number = 0;
+    if (!argument.empty()) {
+        number = static_cast<uint32_t>(std::strtoul(argument.c_str(), nullptr, 10));
+        if (number == 0) {
+            write("Usage: unwatch [N]\n");
+            return;
+        }
+    }
+    if (watchpoints_ == nullptr || !watchpoints_->remove(number)) {
+        write("No watchpoint " + argument + "\n");
+    }
+}
+
+void Debugger::show_hits(const std::string& count) {
+    if (watchpoints_ == nullptr) {
+        write("Watchpoints are not available\n");
+        return;
+    }
+    uint32_t shown = count.empty() ? DEFAULT_HITS : static_cast<uint32_t>(std::strtoul(count.c_str(), nullptr, 10));
+    std::ostringstream out;
+    watchpoints_->write_log(out, symbols_, std::max<uint32_t>(shown, 1));
+    write(out.str());
+}
+
+void Debugger::rewind(const std::string& count) {
+    uint32_t frames = count.empty() ? 1 : static_cast<uint32_t>(std::strtoul(count.c_str(), nullptr, 10));
+    if (!rewind_ || !rewind_(std::max<uint32_t>(frames, 1))) {
+        write("No earlier frame to rewind to (rewind needs --rewind)\n");
+        return;
+    }
+    show_stop("Rewound");
+}
+
+bool Debugger::watch_hit() {
+    Watchpoints::Hit hit;
+    if (watchpoints_ == nullptr || !watchpoints_->take_break(hit)) {
+        return false;
+    }
+    write("Watchpoint " + Watchpoints::describe(hit, symbols_) + "\n");
+    return true;
+}
+
+std::string Debugger::describe(uint16_t address) const {
+    uint16_t bank = mmu_->bank_of(address);
+    std::string text = SymbolTable::location(bank, address);
+    if (symbols_ != nullptr && symbols_->lookup(bank, address) != nullptr) {
+        text += " (" + symbols_->describe(bank, address) + ")";
+    }
+    return text;
+}
+
+void Debugger::show_stop(const char* reason) {
+    write(std::string(reason) + " at " + describe(cpu_->pc()) + "\n" + format_line(disassembler_->decode(cpu_->pc()), true));
+}
+
+void Debugger::show_registers() {
+    CPU::Registers registers = cpu_->registers();
+    uint8_t flags = registers.af & 0xFF;
+    char text[128];
+    std::snprintf(text, sizeof(text),
+                  "AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X PC=%04X  %c%c%c%c  IME=%d%s\n",
+                  registers.af, registers.bc, registers.de, registers.hl, registers.sp, registers.pc,
+                  flags & 0x80 ? 'Z' : '-', flags & 0x40 ? 'N' : '-', flags & 0x20 ? 'H' : '-',
+                  flags & 0x10 ? 'C' : '-', registers.ime ? 1 : 0, registers.halted ? "  HALT" : "");
+    write(text);
+}
+
+void Debugger::show_memory(const std::string& argument, const std::string& count) {
+    uint16_t address = 0;
+    int32_t bank = -1;
+    if (!parse_location(argument, address, bank)) {
+        write("Usage: x LOC [N]\n");
+        return;
+    }
+    uint32_t bytes = count.empty() ? DEFAULT_MEMORY_BYTES : static_cast<uint32_t>(std::strtoul(count.c_str(), nullptr, 10));
+    std::string out;
+    for (uint32_t row = 0; row < bytes; row += 16) {
+        uint16_t base = static_cast<uint16_t>(address + row);
+        char text[8];
+        std::snprintf(text, sizeof(text), "%04X:", base);
+        out += text;
+        std::string ascii;
+        for (uint32_t i = 0; i < 16 && row + i < bytes; i++) {
+            uint8_t value = mmu_->peek_memory_8(static_cast<uint16_t>(base + i));
+            std::snprintf(text, sizeof(text), " %02X", value);
+            out += text;
+            ascii += value >= 0x20 && value < 0x7F ? static_cast<char>(value) : '.';
+        }
+        out += std::string(3 * (16 - ascii.size()), ' ') + "  " + ascii + "\n";
+    }
+    write(out);
+}
+
+void Debugger::show_disassembly(const std::string& argument, const std::string& count) {
+    uint16_t address = cpu_->pc();
+    int32_t bank = -1;
+    if (!argument.empty() && !parse_location(argument, address, bank)) {
+        write("Usage: dis [LOC] [N]\n");
+        return;
+    }
+    uint32_t lines = count.empty() ? DEFAULT_DISASSEMBLY_LINES : static_cast<uint32_t>(std::strtoul(count.c_str(), nullptr, 10));
+    // A banked location lists that bank whatever is mapped now
+    std::string out;
+    for (uint32_t i = 0; i < lines; i++) {
+        Disassembler::Line line = bank >= 0 ? disassembler_->decode(static_cast<uint16_t>(bank), address)
+                                            : disassembler_->decode(address);
+        if (const std::string* label = disassembler_->label(line.bank, address)) {
+            out += *label + ":\n";
+        }
+        out += format_line(line, address == cpu_->pc() && line.bank == mmu_->bank_of(address));
+        address = static_cast<uint16_t>(address + line.length);
+    }
+    write(out);
+}
+
+std::string Debugger::format_line(const Disassembler::Line& line, bool current) const {
+    std::string bytes;
+    for (uint8_t i = 0; i < line.length; i++) {
+        char text[4];
+        std::snprintf(text, sizeof(text), "%02X ", line.bytes[i]);
+        bytes += text;
+    }
+    return std::string(current ? "=> " : "   ") + SymbolTable::location(line.bank, line.address)
+        + "  " + bytes + std::string(10 - bytes.size(), ' ') + line.text + "\n";
+}
+
+bool Debugger::parse_location(const std::string& text, uint16_t& address, int32_t& bank) const {
+    static const struct {
+        const char* name;
+        uint16_t CPU::Registers::*field;
+    } REGISTERS[] = {
+        {"pc", &CPU::Registers::pc}, {"sp", &CPU::Registers::sp}, {"hl", &CPU::Registers::hl},
+        {"de", &CPU::Registers::de}, {"bc", &CPU::Registers::bc},
+    };
+    if (text.empty()) {
+        return false;
+    }
+    bank = -1;
+    std::string lower = text;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (const auto& reg : REGISTERS) {
+        if (lower == reg.name) {
+            address = cpu_->registers().*reg.field;
+            return true;
+        }
+    }
+
+    uint32_t value = 0;
+    size_t colon = text.find(':');
+    if (colon != std::string::npos) {
+        uint32_t bank_number = 0;
+        if (parse_hex(text.substr(0, colon), 0xFFFF, bank_number) && parse_hex(text.substr(colon + 1), 0xFFFF, value)) {
+            address = static_cast<uint16_t>(value);
+            bank = static_cast<int32_t>(bank_number);
+            return true;
+        }
+        return false;
+    }
+    // Names that are also valid hex (e.g. "Add") resolve as symbols first
+    if (symbols_ != nullptr) {
+        if (const SymbolTable::Symbol* symbol = symbols_->find(text)) {
+            address = symbol->address;
+            bank = symbol->bank;
+            return true;
+        }
+    }
+    if (parse_hex(text, 0xFFFF, value)) {
+        address = static_cast<uint16_t>(value);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,152 @@
+#include "../inc/disassembler.hpp"
+#include "../inc/instruction_decoder.hpp"
+#include "../inc/mmu.hpp"
+#include "../inc/symbol_table.hpp"
+#include <cstdio>
+
+static const char* const REGISTERS[8] = {"B", "C", "D", "E", "H", "L", "(HL)", "A"};
+static const uint8_t CB_PREFIX = 0xCB;
+
+Disassembler::Disassembler(const MMU* mmu, const SymbolTable* symbols)
+    : mmu_(mmu)
+    , symbols_(symbols)
+    , rom_lines_((mmu->rom_size() + SWITCHABLE_ROM_SIZE - 1) / SWITCHABLE_ROM_SIZE) {}
+
+void Disassembler::set_symbols(const SymbolTable* symbols) {
+    symbols_ = symbols;
+    flush();
+}
+
+void Disassembler::flush() {
+    for (auto& lines : rom_lines_) {
+        lines.clear();
+    }
+    cached_lines_ = 0;
+}
+
+uint8_t Disassembler::length(uint8_t opcode) {
+    return 1 + InstructionDecoder::operandBytes(opcode);
+}
+
+Disassembler::Line Disassembler::decode(uint16_t address) {
+    return decode(mmu_->bank_of(address), address);
+}
+
+Disassembler::Line Disassembler::decode(uint16_t bank, uint16_t address) {
+    if (address <= STATIC_ROM_END) {
+        bank = 0;
+    }
+    if (address > SWITCHABLE_ROM_END || bank >= rom_lines_.size()) {
+        return decode_line(bank, address);
+    }
+    std::unordered_map<uint16_t, Line>& lines = rom_lines_[bank];
+    auto found = lines.find(address);
+    if (found != lines.end()) {
+        return found->second;
+    }
+    cached_lines_++;
+    return lines.emplace(address, decode_line(bank, address)).first->second;
+}
+
+Disassembler::Line Disassembler::decode_line(uint16_t bank, uint16_t address) const {
+    auto byte_at = [this, bank](uint16_t addr) -> uint8_t {
+        if (addr > SWITCHABLE_ROM_END) {
+            return mmu_->peek_memory_8(addr);
+        }
+        // An instruction running off the end of ROM0 continues in whatever bank is mapped
+        size_t offset = addr <= STATIC_ROM_END ? addr
+            : bank == 0 ? mmu_->rom_offset(addr)
+            : static_cast<size_t>(bank) * SWITCHABLE_ROM_SIZE + (addr - SWITCHABLE_ROM_START);
+        return mmu_->rom_byte(offset);
+    };
+    Line line = {};
+    line.bank = bank;
+    line.address = address;
+    line.bytes[0] = byte_at(address);
+    line.length = length(line.bytes[0]);
+    for (uint8_t i = 1; i < line.length; i++) {
+        line.bytes[i] = byte_at(static_cast<uint16_t>(address + i));
+    }
+    line.text = text(line.bytes, bank, address);
+    return line;
+}
+
+const std::string* Disassembler::label(uint16_t bank, uint16_t address) const {
+    if (symbols_ == nullptr) {
+        return nullptr;
+    }
+    const SymbolTable::Symbol* symbol = symbols_->lookup(bank, address);
+    return symbol != nullptr && symbol->address == address ? &symbol->name : nullptr;
+}
+
+std::string Disassembler::text(const uint8_t* bytes, uint16_t bank, uint16_t address) const {
+    const char* format = InstructionDecoder::info(bytes[0]).format;
+    uint8_t fields = bytes[0];
+    if (format == nullptr) {
+        char undefined[8];
+        std::snprintf(undefined, sizeof(undefined), "DB $%02X", bytes[0]);
+        return undefined;
+    }
+    if (bytes[0] == CB_PREFIX) {
+        format = InstructionDecoder::cbFormat(bytes[1]);
+        fields = bytes[1];
+    }
+    std::string result;
+    for (const char* c = format; *c != '\0'; c++) {
+        if (*c != '%') {
+            result += *c;
+            continue;
+        }
+        switch (*++c) {
+            case 'd':
+                result += REGISTERS[(fields >> 3) & 0x07];
+                break;
+            case 'z':
+                result += REGISTERS[fields & 0x07];
+                break;
+            case 'n':
+                result += static_cast<char>('0' + ((fields >> 3) & 0x07));
+                break;
+            case 'p':
+                break;
+            default:
+                result += operand(*c, bytes, bank, address);
+                break;
+        }
+    }
+    return result;
+}
+
+std::string Disassembler::operand(char placeholder, const uint8_t* bytes, uint16_t bank, uint16_t address) const {
+    char text[16] = "";
+    int8_t offset = static_cast<int8_t>(bytes[1]);
+    switch (placeholder) {
+        case 'b':
+            std::snprintf(text, sizeof(text), "$%02X", bytes[1]);
+            break;
+        case 'w':
+            return address_operand(static_cast<uint16_t>(bytes[1] | bytes[2] << 8), bank, address);
+        case 'h':
+            return address_operand(static_cast<uint16_t>(0xFF00 | bytes[1]), bank, address);
+        case 'r':
+            return address_operand(static_cast<uint16_t>(address + 2 + offset), bank, address);
+        case 's':
+            std::snprintf(text, sizeof(text), "%c$%02X", offset < 0 ? '-' : '+', offset < 0 ? -offset : offset);
+            break;
+    }
+    return text;
+}
+
+std::string Disassembler::address_operand(uint16_t target, uint16_t bank, uint16_t address) const {
+    if (symbols_ != nullptr) {
+        // Code in a ROM bank refers to its own bank; elsewhere, to the one mapped now
+        bool same_bank = target >= SWITCHABLE_ROM_START && target <= SWITCHABLE_ROM_END
+            && address >= SWITCHABLE_ROM_START && address <= SWITCHABLE_ROM_END;
+        if (const std::string* name = label(same_bank ? bank : mmu_->bank_of(target), target)) {
+            return *name;
+        }
+    }
+    char text[8];
+    std::snprintf(text, sizeof(text), "$%04X", target);
+    return text;
+}
@@ -0,0 +1,99 @@
+#include "../inc/frame_pacer.hpp"
+#include "../inc/constants.hpp"
+#include <iostream>
+#include <thread>
+
+// Sleeping is only accurate to roughly a scheduler tick, so spin for the last stretch
+static const std::chrono::microseconds SPIN_MARGIN(1500);
+
+FramePacer::FramePacer()
+    : histogram_(HISTOGRAM_BUCKETS, 0) {
+    configure(PacingMode::RealTime);
+}
+
+void FramePacer::configure(PacingMode mode, double speed) {
+    mode_ = mode;
+    speed_ = (mode == PacingMode::Multiplier && speed > 0.0) ? speed : 1.0;
+    double period_seconds = static_cast<double>(CYCLES_PER_FRAME) / DMG_CLOCK_SPEED / speed_;
+    frame_period_ = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period_seconds));
+}
+
+void FramePacer::start() {
+    start_time_ = Clock::now();
+    last_frame_ = start_time_;
+    next_deadline_ = start_time_ + frame_period_;
+}
+
+void FramePacer::resync() {
+    last_frame_ = Clock::now();
+    next_deadline_ = last_frame_ + frame_period_;
+}
+
+void FramePacer::wait_until(Clock::time_point deadline) const {
+    auto now = Clock::now();
+    if (deadline - now > SPIN_MARGIN) {
+        std::this_thread::sleep_for(deadline - now - SPIN_MARGIN);
+    }
+    while (Clock::now() < deadline) {
+        // Spin
+    }
+}
+
+void FramePacer::frame_done() {
+    // In audio mode the caller has already blocked on the audio ring
+    if (mode_ == PacingMode::RealTime || mode_ == PacingMode::Multiplier) {
+        auto now = Clock::now();
+        if (now > next_deadline_ + frame_period_) {
+            // Too far behind to catch up without a visible burst, so resynchronize
+            next_deadline_ = now;
+        } else {
+            wait_until(next_deadline_);
+        }
+        next_deadline_ += frame_period_;
+    }
+
+    auto now = Clock::now();
+    double frame_us = std::chrono::duration<double, std::micro>(now - last_frame_).count();
+    last_frame_ = now;
+
+    uint32_t bucket = static_cast<uint32_t>(frame_us / HISTOGRAM_BUCKET_US);
+    histogram_[bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1]++;
+    frames_++;
+    if (frame_us > max_frame_us_) {
+        max_frame_us_ = frame_us;
+    }
+}
+
+double FramePacer::percentile_us(double fraction) const {
+    uint64_t target = static_cast<uint64_t>(fraction * frames_);
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram_[i];
+        if (seen > target) {
+            return static_cast<double>(i + 1) * HISTOGRAM_BUCKET_US;
+        }
+    }
+    return max_frame_us_;
+}
+
+void FramePacer::print_report(uint64_t emulated_frames) const {
+    if (frames_ == 0) {
+        return;
+    }
+    double wall_seconds = std::chrono::duration<double>(last_frame_ - start_time_).count();
+    double emulated_seconds = static_cast<double>(emulated_frames) * CYCLES_PER_FRAME / DMG_CLOCK_SPEED;
+
+    const char* mode_name = "uncapped";
+    if (mode_ == PacingMode::RealTime) {
+        mode_name = "real time";
+    } else if (mode_ == PacingMode::Multiplier) {
+        mode_name = "multiplier";
+    } else if (mode_ == PacingMode::Audio) {
+        mode_name = "audio clock";
+    }
+
+    std::cout << "Pacing: " << mode_name << ", " << emulated_frames << " frames in " << wall_seconds
+              << " s, " << (wall_seconds > 0.0 ? emulated_seconds / wall_seconds : 0.0) << "x real time" << std::endl;
+    std::cout << "Pacing: frame time p50 " << percentile_us(0.50) << " us, p90 " << percentile_us(0.90)
+              << " us, p99 " << percentile_us(0.99) << " us, max " << max_frame_us_ << " us" << std::endl;
+}
@@ -1,39 +1,622 @@
 #include "../inc/game_boy_emulator.hpp"
 #include "../inc/cartridge.hpp"
+#include "../inc/hash.hpp"
+#include "../inc/link_port.hpp"
+#include "../inc/save_state.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <stdexcept>
+#include <thread>
 
-GameBoyEmulator* GameBoyEmulator::instance_ = nullptr;
+static const size_t APU_SAMPLES_PER_FRAME = static_cast<size_t>(CYCLES_PER_FRAME) * APU_SAMPLE_RATE / DMG_CLOCK_SPEED;
+static const auto AUDIO_WAIT_SLEEP = std::chrono::microseconds(250);
 
-std::string GameBoyEmulator::filepath_ = "";
-
-GameBoyEmulator::GameBoyEmulator() 
+GameBoyEmulator::GameBoyEmulator(std::vector<uint8_t> rom)
     : interrupt_controller_()
-    , mmu_(filepath_)
+    , scheduler_()
+    , timer_(&interrupt_controller_)
+    , joypad_(&interrupt_controller_)
+    , serial_(&interrupt_controller_, &scheduler_)
+    , ppu_(&interrupt_controller_)
+    , apu_(&scheduler_)
+    , mmu_(std::move(rom), &interrupt_controller_, &timer_, &joypad_, &serial_, &ppu_, &apu_)
     , cpu_(&mmu_, &interrupt_controller_)
-    , timer_(&interrupt_controller_) {}
+    , audio_ring_(AUDIO_RING_FRAMES) {
+    // Scheduled APU catch-up is reported as its own phase in the host metrics
+    Scheduler::Handler flush = scheduler_.handler(EVENT_APU_FLUSH);
+    scheduler_.set_handler(EVENT_APU_FLUSH, [this, flush]() {
+        set_phase(ThreadMetrics::PHASE_APU);
+        flush();
+        set_phase(ThreadMetrics::PHASE_SCHEDULER);
+    });
+}
 
-GameBoyEmulator* GameBoyEmulator::getInstance() {
-    if (instance_ == nullptr) {
-        instance_ = new GameBoyEmulator();
+void GameBoyEmulator::emulate() {
+    
+    if (pacer_.mode() == PacingMode::Audio && !(audio_output_ && audio_output_->realtime())) {
+        std::cerr << "Warning: audio pacing needs a real-time audio output, using real time" << std::endl;
+        pacer_.configure(PacingMode::RealTime);
     }
-    return instance_;
+    pacer_.start();
+
+    // Main emulation loop
+    while (!stop_cpu_) {
+#ifdef CPU_STATS
+        if (CpuStats::take_report_request()) {
+            cpu_.stats().write_report(std::cerr);
+        }
+#endif
+        if (debugger_ && debugger_->poll()) {
+            enter_debugger();
+            continue;
+        }
+        auto frame_start = std::chrono::steady_clock::now();
+        set_phase(ThreadMetrics::PHASE_CPU);
+        run_host_frame();
+        set_phase(ThreadMetrics::PHASE_HOST);
+        if (!stop_cpu_ && frame_cycles_ != 0) {
+            continue;  // Stopped mid-frame by the debugger
+        }
+        if (metrics_enabled_) {
+            record_frame_metrics(std::chrono::steady_clock::now() - frame_start);
+        }
+        if (stop_cpu_) {
+            break;
+        }
+        wait_for_audio();
+        pacer_.frame_done();
+    }
+
+    finish_session();
 }
 
-void GameBoyEmulator::setFilepath(const std::string& filepath) {
-    filepath_ = filepath;
+void GameBoyEmulator::record_frame_metrics(std::chrono::steady_clock::duration time) {
+    ThreadMetrics::Totals totals;
+    totals.instructions = instructions_executed();
+    totals.cycles = total_cycles_;
+    totals.halted_cycles = cpu_.halted_cycles();
+    totals.native_instructions = cpu_.jit().native_instructions();
+    totals.block_lookups = cpu_.block_cache().lookups();
+    totals.block_misses = cpu_.block_cache().misses();
+    totals.jit_side_exits = cpu_.jit().side_exits();
+    metrics_.record_frame(time, totals);
 }
 
-void GameBoyEmulator::emulate() {
+void GameBoyEmulator::start_profiler(uint32_t interval, bool call_stacks) {
+    profiler_ = std::make_unique<Profiler>(&mmu_, call_stacks);
+    profiler_interval_ = std::max<uint32_t>(interval, 1);
+    cpu_.set_call_profiler(call_stacks ? profiler_.get() : nullptr);
+    scheduler_.set_handler(EVENT_PROFILER_SAMPLE, [this]() {
+        profiler_->sample(cpu_.pc());
+        scheduler_.schedule(EVENT_PROFILER_SAMPLE, profiler_interval_);
+    });
+    scheduler_.schedule(EVENT_PROFILER_SAMPLE, profiler_interval_);
+}
+
+void GameBoyEmulator::start_coverage() {
+    coverage_ = std::make_unique<Coverage>(mmu_.rom_size(), mmu_.rom_hash());
+    mmu_.set_coverage(coverage_.get());
+    cpu_.set_coverage(coverage_.get());
+}
+
+bool GameBoyEmulator::start_debugger(const std::string& socket_path, const SymbolTable* symbols) {
+    debugger_ = std::make_unique<Debugger>(&cpu_, &mmu_, &disassembler_, [this]() { return debug_step(); });
+    debugger_->set_symbols(symbols);
+    debugger_->set_watchpoints(&watchpoints());
+    debugger_->set_rewind([this](uint32_t frames) { return rewind(frames); });
+    cpu_.set_jit_enabled(false);
+    bool opened = socket_path.empty() ? debugger_->open_console() : debugger_->listen(socket_path);
+    if (!opened) {
+        debugger_.reset();
+    }
+    return opened;
+}
+
+Watchpoints& GameBoyEmulator::watchpoints() {
+    if (!watchpoints_) {
+        watchpoints_ = std::make_unique<Watchpoints>(&cpu_, &mmu_, &scheduler_);
+        cpu_.set_jit_enabled(false);
+    }
+    return *watchpoints_;
+}
+
+Cheats& GameBoyEmulator::cheats() {
+    if (!cheats_) {
+        cheats_ = std::make_unique<Cheats>(&cpu_, &mmu_, &disassembler_);
+    }
+    return *cheats_;
+}
+
+void GameBoyEmulator::enter_debugger() {
+    if (!debugger_->run_commands()) {
+        stop_cpu_ = true;
+        return;
+    }
+    // Time spent stopped is not emulation falling behind
+    pacer_.resync();
+}
+
+bool GameBoyEmulator::debug_step() {
+    if (stop_cpu_) {
+        return false;
+    }
+    if (frame_cycles_ == 0) {
+        apply_frame_input();
+    }
+    frame_cycles_ += step();
+    if (ppu_.take_frame_complete() || frame_cycles_ >= CYCLES_PER_FRAME) {
+        end_frame();
+    }
+    return !stop_cpu_;
+}
+
+void GameBoyEmulator::set_pacing(PacingMode mode, double speed) {
+    pacer_.configure(mode, speed);
+    present_frames_ = pacer_.presents_frames();
+    update_render_interval();
+}
+
+void GameBoyEmulator::set_render_interval(uint32_t interval) {
+    render_interval_ = interval;
+    update_render_interval();
+}
+
+void GameBoyEmulator::update_render_interval() {
+    ppu_.set_render_interval(present_frames_ ? render_interval_ : 0);
+}
+
+uint64_t GameBoyEmulator::frame_hash() const {
+    return fnv1a_64(ppu_.framebuffer(), SCREEN_WIDTH * SCREEN_HEIGHT);
+}
+
+void GameBoyEmulator::start_audio(std::unique_ptr<AudioSink> sink, bool realtime) {
+    stop_audio();
+    audio_output_ = std::make_unique<AudioOutput>(&audio_ring_, std::move(sink), HOST_SAMPLE_RATE, realtime);
+    audio_output_->start();
+    apu_.set_output(&audio_ring_);
+}
+
+void GameBoyEmulator::stop_audio() {
+    apu_.set_output(nullptr);
+    if (!audio_output_) {
+        return;
+    }
+    audio_output_->stop();
+    std::cout << "Audio: " << audio_output_->frames_written() << " frames at " << HOST_SAMPLE_RATE
+              << " Hz, " << audio_ring_.dropped_frames() << " dropped, "
+              << audio_output_->underruns() << " underruns";
+    if (audio_output_->realtime()) {
+        std::cout << ", rate adjust " << audio_output_->rate_adjust();
+    }
+    std::cout << std::endl;
+    audio_output_.reset();
+}
+
+void GameBoyEmulator::start_audio_capture() {
+    stop_audio();
+    apu_.set_output(&audio_ring_);
+}
+
+void GameBoyEmulator::wait_for_audio() {
+    if (!audio_output_) {
+        return;
+    }
+    size_t limit = 0;
+    if (!audio_output_->realtime()) {
+        // Offline output must be lossless, so never let the ring overflow
+        limit = audio_ring_.capacity() - 2 * APU_SAMPLES_PER_FRAME;
+    } else if (pacer_.mode() == PacingMode::Audio) {
+        // Centre the ring fill on the rate controller's target
+        limit = audio_output_->target_fill() - APU_SAMPLES_PER_FRAME / 2;
+    } else {
+        // The video clock leads and rate control absorbs the drift
+        return;
+    }
+    while (audio_ring_.size() > limit) {
+        std::this_thread::sleep_for(AUDIO_WAIT_SLEEP);
+    }
+}
+
+void GameBoyEmulator::finish_session() {
+    stop_audio();
+    if (LinkPort* link = serial_.link()) {
+        // Let the partner run on without waiting for us
+        link->disconnect();
+        std::cout << "Link: " << link->transfers() << " transfers, " << link->waits()
+                  << " waits, " << link->wait_ms() << " ms waiting" << std::endl;
+    }
+    pacer_.print_report(frames_executed_);
+    print_run_ahead_stats();
+    print_rewind_stats();
+    if (cpu_.jit_enabled()) {
+        const Jit& jit = cpu_.jit();
+        std::cout << "JIT: " << jit.compiled_blocks() << " blocks, " << jit.native_runs() << " native runs, "
+                  << jit.native_instructions() << " instructions, " << jit.side_exits() << " side exits" << std::endl;
+    }
+
+    if (movie_ && movie_recording_) {
+        if (movie_->save(movie_path_)) {
+            std::cout << "Movie: recorded " << movie_->frame_count() << " frames to " << movie_path_ << std::endl;
+        }
+    } else if (movie_) {
+        std::cout << "Replay: " << frames_executed_ << " frames, state hash " << std::hex
+                  << std::setw(16) << std::setfill('0') << state_hash()
+                  << ", frame hash " << std::setw(16) << frame_hash()
+                  << std::dec << std::setfill(' ') << std::endl;
+    }
+}
+
+uint32_t GameBoyEmulator::step() {
+    uint32_t cycles = 0;
+    if (cpu_.native_ready()) {
+        cycles = cpu_.execute_native(native_budget());
+    }
+    if (cycles == 0) {
+        cycles = cpu_.execute_next_instruction();
+        if (cycles == 0) {
+            return 0;  // Stopped in front of a breakpoint
+        }
+    }
+    cycles += cpu_.handle_interrupts();
+    advance(cycles - cpu_.take_bus_cycles());
+    return cycles;
+}
+
+void GameBoyEmulator::advance(uint32_t cycles) {
+    cycles_executed_ += cycles;
     
-    // Main emulation loop
-    while (!stop_cpu_) {
-        uint8_t cycles = cpu_.execute_next_instruction();
-        cycles += cpu_.handle_interrupts();
-        cycles_executed_ += cycles;
-        
-        // Handle timer
-        timer_.update_timer(cycles);
-        
-        // TODO: Handle GPU, Audio, etc.
+    // Handle timer
+    set_phase(ThreadMetrics::PHASE_TIMER);
+    timer_.update_timer(cycles);
+    set_phase(ThreadMetrics::PHASE_PPU);
+    ppu_.step(cycles);
+
+    // Lazily emulated components catch up from the scheduler clock
+    set_phase(ThreadMetrics::PHASE_SCHEDULER);
+    scheduler_.advance(cycles);
+    set_phase(ThreadMetrics::PHASE_CPU);
+}
+
+bool GameBoyEmulator::tick(uint32_t cycles) {
+    advance(cycles);
+    frame_cycles_ += cycles;
+    if (ppu_.take_frame_complete() || frame_cycles_ >= CYCLES_PER_FRAME) {
+        frame_complete_ = true;
+        return false;
+    }
+    return !stop_cpu_;
+}
+
+uint32_t GameBoyEmulator::native_budget() const {
+    // Native code may run up to the first point where a component could raise
+    // an interrupt, change PPU mode, run a scheduled event or end the frame
+    uint64_t budget = CYCLES_PER_FRAME - frame_cycles_;
+    budget = std::min<uint64_t>(budget, ppu_.cycles_until_event());
+    budget = std::min<uint64_t>(budget, timer_.cycles_until_interrupt());
+    budget = std::min<uint64_t>(budget, scheduler_.cycles_until_next_event());
+    return static_cast<uint32_t>(budget);
+}
+
+void GameBoyEmulator::run_frame() {
+    if (frame_cycles_ == 0) {
+        apply_frame_input();
+    }
+    // A frame ends when the PPU enters VBlank, or after a frame's worth of cycles with the LCD off
+#ifdef THREADED_DISPATCH
+    if (!cpu_.jit_enabled() && !cpu_.exact_timing() && !debugger_) {
+        if (stop_cpu_) {
+            return;
+        }
+        frame_complete_ = false;
+        cpu_.run(*this);
+        if (!frame_complete_) {
+            return;  // Stopped
+        }
+    } else
+#endif
+    while (true) {
+        if (stop_cpu_) {
+            return;
+        }
+        uint32_t cycles = step();
+        if (cycles == 0) {
+            // The rest of the frame runs once the debugger resumes
+            debugger_->on_breakpoint();
+            return;
+        }
+        frame_cycles_ += cycles;
+        if (ppu_.take_frame_complete() || frame_cycles_ >= CYCLES_PER_FRAME) {
+            break;
+        }
+    }
+    end_frame();
+}
+
+uint64_t GameBoyEmulator::run_cycles(uint64_t cycles) {
+    uint64_t run = 0;
+    while (run < cycles && !stop_cpu_) {
+        if (frame_cycles_ == 0) {
+            apply_frame_input();
+            if (stop_cpu_) {
+                break;
+            }
+        }
+        uint32_t step_cycles = step();
+        if (step_cycles == 0) {
+            break;  // Stopped in front of a breakpoint
+        }
+        run += step_cycles;
+        frame_cycles_ += step_cycles;
+        if (ppu_.take_frame_complete() || frame_cycles_ >= CYCLES_PER_FRAME) {
+            end_frame();
+        }
+    }
+    return run;
+}
+
+void GameBoyEmulator::end_frame() {
+    total_cycles_ += frame_cycles_;
+    frame_cycles_ = 0;
+    frames_executed_++;
+
+    if (rewind_buffer_ && !speculative_) {
+        auto start = std::chrono::steady_clock::now();
+        save_state(rewind_state_);
+        rewind_buffer_->capture(rewind_state_);
+        double elapsed_us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+        rewind_captures_++;
+        rewind_total_us_ += elapsed_us;
+        rewind_max_us_ = std::max(rewind_max_us_, elapsed_us);
+    }
+    if (stop_on_test_result_ && !speculative_) {
+        check_test_result();
+    }
+    if (!speculative_) {
+        serial_.sync();
+    }
+}
+
+void GameBoyEmulator::check_test_result() {
+    static const char* const PASSED = "Passed";
+    static const char* const FAILED = "Failed";
+    static const size_t OVERLAP = 5;  // A marker may straddle two frames
+
+    const std::string& output = serial_.output();
+    size_t start = serial_scanned_ > OVERLAP ? serial_scanned_ - OVERLAP : 0;
+    if (start > output.size()) {
+        start = 0;
+    }
+    if (output.find(PASSED, start) != std::string::npos) {
+        test_result_ = TestResult::Passed;
+    } else if (output.find(FAILED, start) != std::string::npos) {
+        test_result_ = TestResult::Failed;
+    }
+    serial_scanned_ = output.size();
+    if (test_result_ != TestResult::None) {
+        stop_cpu_ = true;
+    }
+}
+
+void GameBoyEmulator::save_state(std::vector<uint8_t>& buffer) const {
+    StateWriter writer(buffer);
+    writer.write(SAVE_STATE_MAGIC);
+    writer.write(SAVE_STATE_VERSION);
+    writer.write(cycles_executed_);
+    writer.write(frame_cycles_);
+    writer.write(frames_executed_);
+    scheduler_.save_state(writer);
+    cpu_.save_state(writer);
+    interrupt_controller_.save_state(writer);
+    timer_.save_state(writer);
+    joypad_.save_state(writer);
+    serial_.save_state(writer);
+    ppu_.save_state(writer);
+    apu_.save_state(writer);
+    mmu_.save_state(writer);
+}
+
+void GameBoyEmulator::load_state(const std::vector<uint8_t>& buffer) {
+    StateReader reader(buffer);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    reader.read(magic);
+    reader.read(version);
+    if (magic != SAVE_STATE_MAGIC || version != SAVE_STATE_VERSION) {
+        throw std::runtime_error("Unsupported save state");
+    }
+    reader.read(cycles_executed_);
+    reader.read(frame_cycles_);
+    reader.read(frames_executed_);
+    scheduler_.load_state(reader);
+    cpu_.load_state(reader);
+    interrupt_controller_.load_state(reader);
+    timer_.load_state(reader);
+    joypad_.load_state(reader);
+    serial_.load_state(reader);
+    ppu_.load_state(reader);
+    apu_.load_state(reader);
+    mmu_.load_state(reader);
+    if (!reader.at_end()) {
+        throw std::runtime_error("Save state has trailing bytes");
+    }
+}
+
+void GameBoyEmulator::enable_rewind(uint32_t seconds, size_t arena_bytes) {
+    rewind_buffer_ = std::make_unique<RewindBuffer>(
+        arena_bytes, static_cast<size_t>(seconds) * FRAMES_PER_SECOND, REWIND_KEYFRAME_INTERVAL);
+    save_state(rewind_state_);
+    rewind_captures_ = 0;
+    rewind_total_us_ = 0.0;
+    rewind_max_us_ = 0.0;
+}
+
+void GameBoyEmulator::disable_rewind() {
+    rewind_buffer_.reset();
+}
+
+bool GameBoyEmulator::rewind(uint32_t frames) {
+    if (!rewind_buffer_ || frames == 0) {
+        return false;
+    }
+    // The newest snapshot is the current frame, so pop one extra and keep it
+    bool restored = false;
+    for (uint32_t i = 0; i <= frames; i++) {
+        if (!rewind_buffer_->rewind(rewind_state_)) {
+            break;
+        }
+        restored = true;
+    }
+    if (!restored) {
+        return false;
+    }
+    load_state(rewind_state_);
+    rewind_buffer_->capture(rewind_state_);
+    return true;
+}
+
+
+void GameBoyEmulator::set_run_ahead(uint32_t frames) {
+    run_ahead_frames_ = frames;
+    run_ahead_host_frames_ = 0;
+    run_ahead_total_us_ = 0.0;
+    run_ahead_max_us_ = 0.0;
+    if (frames > 0) {
+        // Reserve the snapshot buffer now so per-frame captures never allocate
+        save_state(run_ahead_state_);
+    }
+}
+
+void GameBoyEmulator::run_host_frame() {
+    if (run_ahead_frames_ == 0) {
+        run_frame();
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    save_state(run_ahead_state_);
+    speculative_ = true;
+    apu_.set_output_enabled(false);
+    // Only the last speculative frame is presented; the others and the real frame skip composition
+    ppu_.set_render_interval(0);
+    for (uint32_t i = 0; i < run_ahead_frames_ && !stop_cpu_; i++) {
+        if (i + 1 == run_ahead_frames_ && present_frames_) {
+            ppu_.request_render();
+        }
+        run_frame();
+    }
+    speculative_ = false;
+    load_state(run_ahead_state_);
+    apu_.set_output_enabled(true);
+    run_frame();
+    update_render_interval();
+
+    double elapsed_us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count();
+    run_ahead_host_frames_++;
+    run_ahead_total_us_ += elapsed_us;
+    if (elapsed_us > run_ahead_max_us_) {
+        run_ahead_max_us_ = elapsed_us;
     }
 }
+
+void GameBoyEmulator::print_run_ahead_stats() const {
+    if (run_ahead_frames_ == 0 || run_ahead_host_frames_ == 0) {
+        return;
+    }
+    std::cout << "Run-ahead: " << run_ahead_frames_ << " frame(s), "
+              << run_ahead_host_frames_ << " host frames, avg "
+              << run_ahead_total_us_ / run_ahead_host_frames_ << " us, max "
+              << run_ahead_max_us_ << " us per host frame" << std::endl;
+}
+
+void GameBoyEmulator::print_rewind_stats() const {
+    if (!rewind_buffer_ || rewind_captures_ == 0) {
+        return;
+    }
+    std::cout << "Rewind: " << rewind_buffer_->frames() << " frames in "
+              << rewind_buffer_->used_bytes() / 1024 << " KiB, capture avg "
+              << rewind_total_us_ / rewind_captures_ << " us, max "
+              << rewind_max_us_ << " us" << std::endl;
+}
+
+void GameBoyEmulator::set_buttons(uint8_t buttons) {
+    joypad_.set_buttons(buttons);
+}
+
+bool GameBoyEmulator::start_movie_recording(const std::string& path) {
+    movie_ = std::make_unique<Movie>(mmu_.rom_hash());
+    movie_path_ = path;
+    movie_recording_ = true;
+    return true;
+}
+
+bool GameBoyEmulator::start_movie_playback(const std::string& path) {
+    auto movie = std::make_unique<Movie>();
+    if (!movie->load(path)) {
+        return false;
+    }
+    if (movie->rom_hash() != mmu_.rom_hash()) {
+        std::cerr << "Error: movie was recorded with a different ROM" << std::endl;
+        return false;
+    }
+    if (movie->emulator_version() != EMULATOR_VERSION) {
+        std::cerr << "Warning: movie was recorded with emulator version "
+                  << movie->emulator_version() << std::endl;
+    }
+    movie_ = std::move(movie);
+    movie_path_ = path;
+    movie_recording_ = false;
+    return true;
+}
+
+void GameBoyEmulator::apply_frame_input() {
+    // Speculative frames may run past the end, but only real frames stop the session
+    if (frame_limit_ != 0 && frames_executed_ >= frame_limit_ && !speculative_) {
+        stop_cpu_ = true;
+        return;
+    }
+    // A linked session ends with its partner's
+    if (serial_.link() && !serial_.link()->connected()) {
+        stop_cpu_ = true;
+        return;
+    }
+    if (cheats_) {
+        cheats_->apply_ram_writes();
+    }
+    if (!scheduled_buttons_.empty()) {
+        auto scheduled = scheduled_buttons_.find(frames_executed_);
+        if (scheduled != scheduled_buttons_.end()) {
+            joypad_.set_buttons(scheduled->second);
+        }
+    }
+    if (!movie_) {
+        return;
+    }
+
+    if (movie_recording_) {
+        if (!speculative_) {
+            movie_->record_frame(frames_executed_, joypad_.get_buttons());
+        }
+    } else if (frames_executed_ >= movie_->frame_count()) {
+        if (!speculative_) {
+            stop_cpu_ = true;
+        }
+        joypad_.set_buttons(0x00);
+    } else {
+        joypad_.set_buttons(movie_->input_for_frame(frames_executed_));
+        if (frames_executed_ + 1 == movie_->frame_count()) {
+            // Compose the final frame even when replaying headless so it can be hashed
+            ppu_.request_render();
+        }
+    }
+}
+
+uint64_t GameBoyEmulator::state_hash() const {
+    std::vector<uint8_t> state;
+    save_state(state);
+    return fnv1a_64(state.data(), state.size());
+}
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "../inc/gameboy.hpp"
+#include "../inc/cartridge.hpp"
+#include "../inc/game_boy_emulator.hpp"
+#include <stdexcept>
+
+static_assert(GameBoy::SCREEN_WIDTH == SCREEN_WIDTH && GameBoy::SCREEN_HEIGHT == SCREEN_HEIGHT, "Screen size");
+static_assert(GameBoy::CYCLES_PER_FRAME == CYCLES_PER_FRAME, "Frame length");
+static_assert(GameBoy::AUDIO_SAMPLE_RATE == APU_SAMPLE_RATE, "Audio rate");
+static_assert(GameBoy::BUTTON_RIGHT == JOYPAD_BUTTON_RIGHT && GameBoy::BUTTON_START == JOYPAD_BUTTON_START
+              && GameBoy::BUTTON_A == JOYPAD_BUTTON_A && GameBoy::BUTTON_SELECT == JOYPAD_BUTTON_SELECT,
+              "Button bits");
+static_assert(GameBoy::TEST_NONE == static_cast<int>(TestResult::None)
+              && GameBoy::TEST_PASSED == static_cast<int>(TestResult::Passed)
+              && GameBoy::TEST_FAILED == static_cast<int>(TestResult::Failed),
+              "Test results");
+
+std::unique_ptr<GameBoy> GameBoy::create(const uint8_t* rom, size_t size) {
+    if (!Cartridge::is_supported(rom, size)) {
+        return nullptr;
+    }
+    return create(std::vector<uint8_t>(rom, rom + size));
+}
+
+std::unique_ptr<GameBoy> GameBoy::create(std::vector<uint8_t> rom) {
+    if (!Cartridge::is_supported(rom.data(), rom.size())) {
+        return nullptr;
+    }
+    return std::unique_ptr<GameBoy>(new GameBoy(std::make_unique<GameBoyEmulator>(std::move(rom))));
+}
+
+GameBoy::GameBoy(std::unique_ptr<GameBoyEmulator> emulator)
+    : emulator_(std::move(emulator)) {}
+
+GameBoy::~GameBoy() = default;
+
+void GameBoy::run_frame() {
+    emulator_->run_frame();
+}
+
+uint64_t GameBoy::run_cycles(uint64_t cycles) {
+    return emulator_->run_cycles(cycles);
+}
+
+void GameBoy::set_buttons(uint8_t buttons) {
+    emulator_->set_buttons(buttons);
+}
+
+void GameBoy::schedule_buttons(uint64_t frame, uint8_t buttons) {
+    emulator_->schedule_buttons(frame, buttons);
+}
+
+const uint8_t* GameBoy::framebuffer() const {
+    return emulator_->framebuffer();
+}
+
+void GameBoy::set_audio_enabled(bool enabled) {
+    if (enabled) {
+        emulator_->start_audio_capture();
+    } else {
+        emulator_->stop_audio();
+    }
+}
+
+size_t GameBoy::read_audio(int16_t* frames, size_t max_frames) {
+    return emulator_->read_audio(frames, max_frames);
+}
+
+void GameBoy::save_state(std::vector<uint8_t>& state) const {
+    emulator_->save_state(state);
+}
+
+bool GameBoy::load_state(const uint8_t* data, size_t size) {
+    // A state can turn out to be truncated halfway through loading it
+    std::vector<uint8_t> previous;
+    emulator_->save_state(previous);
+    try {
+        emulator_->load_state(std::vector<uint8_t>(data, data + size));
+        return true;
+    } catch (const std::exception&) {
+        emulator_->load_state(previous);
+        return false;
+    }
+}
+
+void GameBoy::set_rewind(uint32_t seconds) {
+    if (seconds > 0) {
+        emulator_->enable_rewind(seconds);
+    } else {
+        emulator_->disable_rewind();
+    }
+}
+
+bool GameBoy::rewind(uint32_t frames) {
+    return emulator_->rewind(frames);
+}
+
+uint8_t GameBoy::peek(uint16_t address) const {
+    return emulator_->peek_memory(address);
+}
+
+void GameBoy::poke(uint16_t address, uint8_t value) {
+    emulator_->poke_memory(address, value);
+}
+
+void GameBoy::emulate() {
+    emulator_->emulate();
+}
+
+void GameBoy::set_pacing(PacingMode mode, double speed) {
+    emulator_->set_pacing(mode, speed);
+}
+
+void GameBoy::set_frame_limit(uint64_t frames) {
+    emulator_->set_frame_limit(frames);
+}
+
+void GameBoy::set_run_ahead(uint32_t frames) {
+    emulator_->set_run_ahead(frames);
+}
+
+void GameBoy::set_render_interval(uint32_t interval) {
+    emulator_->set_render_interval(interval);
+}
+
+void GameBoy::start_audio(std::unique_ptr<AudioSink> sink, bool realtime) {
+    emulator_->start_audio(std::move(sink), realtime);
+}
+
+void GameBoy::set_block_cache(bool enabled) {
+    emulator_->set_block_cache(enabled);
+}
+
+void GameBoy::set_exact_timing(bool exact) {
+    emulator_->set_exact_timing(exact);
+}
+
+bool GameBoy::set_jit(bool enabled, bool verify) {
+    return emulator_->set_jit(enabled, verify);
+}
+
+bool GameBoy::jit_available() const {
+    return emulator_->jit_available();
+}
+
+bool GameBoy::start_debugger(const std::string& socket_path, const SymbolTable* symbols) {
+    return emulator_->start_debugger(socket_path, symbols);
+}
+
+void GameBoy::start_profiler(uint32_t interval, bool call_stacks) {
+    emulator_->start_profiler(interval, call_stacks);
+}
+
+const Profiler* GameBoy::profiler() const {
+    return emulator_->profiler();
+}
+
+void GameBoy::start_coverage() {
+    emulator_->start_coverage();
+}
+
+const Coverage* GameBoy::coverage() const {
+    return emulator_->coverage();
+}
+
+Disassembler& GameBoy::disassembler() {
+    return emulator_->disassembler();
+}
+
+Watchpoints& GameBoy::watchpoints() {
+    return emulator_->watchpoints();
+}
+
+Cheats& GameBoy::cheats() {
+    return emulator_->cheats();
+}
+
+#ifdef CPU_STATS
+const CpuStats& GameBoy::cpu_stats() const {
+    return emulator_->cpu_stats();
+}
+#endif
+
+bool GameBoy::start_movie_recording(const std::string& path) {
+    return emulator_->start_movie_recording(path);
+}
+
+bool GameBoy::start_movie_playback(const std::string& path) {
+    return emulator_->start_movie_playback(path);
+}
+
+void GameBoy::set_metrics_enabled(bool enabled) {
+    emulator_->set_metrics_enabled(enabled);
+}
+
+const ThreadMetrics& GameBoy::metrics() const {
+    return emulator_->metrics();
+}
+
+void GameBoy::connect_link(LinkPort* link) {
+    emulator_->connect_link(link);
+}
+
+const std::string& GameBoy::serial_output() const {
+    return emulator_->serial_output();
+}
+
+void GameBoy::set_stop_on_test_result(bool stop) {
+    emulator_->set_stop_on_test_result(stop);
+}
+
+GameBoy::TestResult GameBoy::test_result() const {
+    return static_cast<TestResult>(emulator_->test_result());
+}
@@ -0,0 +1,130 @@
+#include "../inc/gameboy.h"
+#include "../inc/gameboy.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+static_assert(GB_SCREEN_WIDTH == GameBoy::SCREEN_WIDTH && GB_SCREEN_HEIGHT == GameBoy::SCREEN_HEIGHT, "Screen size");
+static_assert(GB_CYCLES_PER_FRAME == GameBoy::CYCLES_PER_FRAME, "Frame length");
+static_assert(GB_AUDIO_SAMPLE_RATE == GameBoy::AUDIO_SAMPLE_RATE, "Audio rate");
+static_assert(GB_BUTTON_RIGHT == GameBoy::BUTTON_RIGHT && GB_BUTTON_START == GameBoy::BUTTON_START, "Button bits");
+
+struct gb_instance {
+    std::unique_ptr<GameBoy> core;
+    std::vector<uint8_t> state;  // Reused by every save
+    std::string error;
+};
+
+// No exception may cross the C boundary: `call` failing records the reason
+// in gb_error() and makes the entry point return `failed`
+template <typename T, typename Call>
+static T guarded(gb_instance* gb, T failed, Call call) {
+    gb->error.clear();
+    try {
+        return call();
+    } catch (const std::exception& e) {
+        gb->error = e.what();
+        return failed;
+    }
+}
+
+gb_instance* gb_create(const uint8_t* rom, size_t size) {
+    try {
+        std::unique_ptr<GameBoy> core = GameBoy::create(rom, size);
+        if (!core) {
+            return nullptr;
+        }
+        return new gb_instance{std::move(core), {}, {}};
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+void gb_destroy(gb_instance* gb) {
+    delete gb;
+}
+
+const char* gb_error(const gb_instance* gb) {
+    return gb->error.empty() ? nullptr : gb->error.c_str();
+}
+
+int gb_run_frame(gb_instance* gb) {
+    return guarded(gb, -1, [&] {
+        gb->core->run_frame();
+        return 0;
+    });
+}
+
+uint64_t gb_run_cycles(gb_instance* gb, uint64_t cycles) {
+    return guarded<uint64_t>(gb, 0, [&] { return gb->core->run_cycles(cycles); });
+}
+
+int gb_set_buttons(gb_instance* gb, uint8_t buttons) {
+    return guarded(gb, -1, [&] {
+        gb->core->set_buttons(buttons);
+        return 0;
+    });
+}
+
+const uint8_t* gb_framebuffer(const gb_instance* gb) {
+    return gb->core->framebuffer();
+}
+
+int gb_set_audio_enabled(gb_instance* gb, int enabled) {
+    return guarded(gb, -1, [&] {
+        gb->core->set_audio_enabled(enabled != 0);
+        return 0;
+    });
+}
+
+size_t gb_read_audio(gb_instance* gb, int16_t* frames, size_t max_frames) {
+    return guarded<size_t>(gb, 0, [&] { return gb->core->read_audio(frames, max_frames); });
+}
+
+size_t gb_save_state(gb_instance* gb, uint8_t* buffer, size_t size) {
+    return guarded<size_t>(gb, 0, [&] {
+        gb->core->save_state(gb->state);
+        if (buffer != nullptr && size >= gb->state.size()) {
+            std::memcpy(buffer, gb->state.data(), gb->state.size());
+        }
+        return gb->state.size();
+    });
+}
+
+int gb_load_state(gb_instance* gb, const uint8_t* data, size_t size) {
+    return guarded(gb, -1, [&] {
+        if (!gb->core->load_state(data, size)) {
+            gb->error = "Unsupported, truncated or oversized save state";
+            return -1;
+        }
+        return 0;
+    });
+}
+
+int gb_set_rewind(gb_instance* gb, uint32_t seconds) {
+    return guarded(gb, -1, [&] {
+        gb->core->set_rewind(seconds);
+        return 0;
+    });
+}
+
+int gb_rewind(gb_instance* gb, uint32_t frames) {
+    return guarded(gb, -1, [&] {
+        if (!gb->core->rewind(frames)) {
+            gb->error = "No earlier frame to rewind to";
+            return -1;
+        }
+        return 0;
+    });
+}
+
+uint8_t gb_peek(const gb_instance* gb, uint16_t address) {
+    return gb->core->peek(address);
+}
+
+int gb_poke(gb_instance* gb, uint16_t address, uint8_t value) {
+    return guarded(gb, -1, [&] {
+        gb->core->poke(address, value);
+        return 0;
+    });
+}
@@ -1,4 +1,5 @@
 #include "../inc/interrupt_controller.hpp"
+#include "../inc/save_state.hpp"
 #include <stdexcept>
 
 
@@ -32,7 +33,7 @@ uint8_t InterruptController::read_interrupt(uint16_t address) const {
         case IE_REGISTER_LOCATION:
             return ie_;
         case IF_REGISTER_LOCATION:
-            return if_;
+            return if_ | 0xE0;  // Upper bits are unused and read as 1
         default:
             throw std::runtime_error("Invalid interrupt register address");
     }
@@ -67,4 +68,14 @@ uint16_t InterruptController::get_address_of_highest_priority_interrupt() {
     }
     
     return INTERRUPT_HANDLER_NONE_ADDRESS;
+}
+
+void InterruptController::save_state(StateWriter& writer) const {
+    writer.write(ie_);
+    writer.write(if_);
+}
+
+void InterruptController::load_state(StateReader& reader) {
+    reader.read(ie_);
+    reader.read(if_);
 }
\ No newline at end of file
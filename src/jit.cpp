@@ -0,0 +1,1212 @@
+#include "../inc/jit.hpp"
+#include "../inc/block_cache.hpp"
+#include "../inc/constants_mmu.hpp"
+#include "../inc/cpu.hpp"
+#include "../inc/instruction_decoder.hpp"
+#include "../inc/mmu.hpp"
+#include "../inc/x86_emitter.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+static const uint32_t NOT_COMPILABLE = UINT32_MAX;
+static const size_t JIT_CODE_BYTES = 16 * 1024 * 1024;
+static const uintptr_t JIT_PAGE_MASK = 4095;  // Host pages of 4 KiB
+
+static const uint8_t FLAG_Z = 0x80;
+static const uint8_t FLAG_N = 0x40;
+static const uint8_t FLAG_H = 0x20;
+static const uint8_t FLAG_C = 0x10;
+static const uint8_t FLAGS_ALL = 0xF0;
+static const uint8_t FLAGS_HOST = FLAG_Z | FLAG_H | FLAG_C;  // What the LAHF table provides
+
+static uint8_t read_through_mmu(MMU* mmu, uint32_t addr) {
+    return mmu->read_memory_8(static_cast<uint16_t>(addr));
+}
+
+#ifdef JIT_X86_64
+
+namespace {
+
+using E = X86Emitter;
+
+// Host register assignment, all callee-saved so ROM reads through the MMU keep them
+const E::Reg CTX = E::RBX;
+const E::Reg REG_A = E::R12;
+const E::Reg REG_BC = E::R13;
+const E::Reg REG_DE = E::R14;
+const E::Reg REG_HL = E::R15;
+const E::Reg REG_SP = E::RBP;
+
+E::Mem field(size_t offset) { return E::mem(CTX, static_cast<int32_t>(offset)); }
+#define CTX_FIELD(name) field(offsetof(Jit::Context, name))
+
+struct Insn {
+    uint16_t pc;
+    uint8_t opcode;
+    uint8_t cb_opcode;
+    uint8_t imm8;
+    uint16_t imm16;
+    uint8_t length;
+    uint8_t cycles;       // Not-taken cycles for conditional control flow
+    uint16_t start;       // Cycles before this instruction
+    uint8_t flags_read;
+    uint8_t flags_written;
+    bool may_exit;        // Has a dynamic memory access that can leave the block
+    bool terminator;
+    uint8_t live_out;     // Flags observed after this instruction
+};
+
+// ALU group order as encoded in opcode bits 5-3
+const E::Alu ALU_OPS[8] = {E::ADD, E::ADC, E::SUB, E::SBB, E::AND, E::XOR, E::OR, E::CMP};
+
+bool is_fast_ram(uint16_t addr) {
+    return (addr >= INTERNAL_RAM_START && addr <= INTERNAL_RAM_END)
+        || (addr >= HIGH_RAM_START && addr <= HIGH_RAM_END);
+}
+
+uint8_t condition_flag(uint8_t opcode) {
+    return ((opcode >> 3) & 0x02) ? FLAG_C : FLAG_Z;
+}
+
+// Fills in cycles, flag usage and memory behaviour; false if the instruction
+// is not compiled (the block then ends in front of it)
+bool analyze(Insn& insn) {
+    uint8_t op = insn.opcode;
+    uint8_t r_dst = (op >> 3) & 0x07;
+    uint8_t r_src = op & 0x07;
+    insn.flags_read = 0;
+    insn.flags_written = 0;
+    insn.may_exit = false;
+    insn.terminator = InstructionDecoder::endsBlock(op);
+
+    if (op == 0xCB) {
+        uint8_t cb = insn.cb_opcode;
+        bool memory = (cb & 0x07) == 6;
+        uint8_t group = cb >> 6;
+        insn.may_exit = memory;
+        if (group == 0) {
+            uint8_t kind = (cb >> 3) & 0x07;
+            insn.flags_written = FLAGS_ALL;
+            insn.flags_read = (kind == 2 || kind == 3) ? FLAG_C : 0;
+            insn.cycles = memory ? 16 : 8;
+        } else if (group == 1) {
+            insn.flags_written = FLAG_Z | FLAG_N | FLAG_H;
+            insn.cycles = memory ? 12 : 8;
+        } else {
+            insn.cycles = memory ? 16 : 8;
+        }
+        return true;
+    }
+
+    if (op >= 0x40 && op <= 0x7F) {
+        if (op == 0x76) {
+            return false;  // HALT
+        }
+        insn.may_exit = r_dst == 6 || r_src == 6;
+        insn.cycles = insn.may_exit ? 8 : 4;
+        return true;
+    }
+    if (op >= 0x80 && op <= 0xBF) {
+        uint8_t kind = r_dst;
+        insn.may_exit = r_src == 6;
+        insn.cycles = insn.may_exit ? 8 : 4;
+        insn.flags_written = FLAGS_ALL;
+        insn.flags_read = (kind == 1 || kind == 3) ? FLAG_C : 0;
+        return true;
+    }
+    if ((op & 0xC7) == 0x04 || (op & 0xC7) == 0x05) {   // INC r / DEC r
+        insn.may_exit = r_dst == 6;
+        insn.cycles = insn.may_exit ? 12 : 4;
+        insn.flags_written = FLAG_Z | FLAG_N | FLAG_H;
+        return true;
+    }
+    if ((op & 0xC7) == 0x06) {                          // LD r,n
+        insn.may_exit = r_dst == 6;
+        insn.cycles = insn.may_exit ? 12 : 8;
+        return true;
+    }
+    if ((op & 0xCF) == 0x01) {                          // LD rr,nn
+        insn.cycles = 12;
+        return true;
+    }
+    if ((op & 0xC7) == 0x03) {                          // INC rr / DEC rr
+        insn.cycles = 8;
+        return true;
+    }
+    if ((op & 0xCF) == 0x09) {                          // ADD HL,rr
+        insn.cycles = 8;
+        insn.flags_written = FLAG_N | FLAG_H | FLAG_C;
+        return true;
+    }
+    if ((op & 0xCF) == 0xC1 || (op & 0xCF) == 0xC5) {   // POP / PUSH
+        bool push = (op & 0x04) != 0;
+        bool af = (op & 0x30) == 0x30;
+        insn.may_exit = true;
+        insn.cycles = push ? 16 : 12;
+        if (af) {
+            (push ? insn.flags_read : insn.flags_written) = FLAGS_ALL;
+        }
+        return true;
+    }
+    if ((op & 0xC7) == 0xC6) {                          // ALU A,n
+        insn.cycles = 8;
+        insn.flags_written = FLAGS_ALL;
+        insn.flags_read = (r_dst == 1 || r_dst == 3) ? FLAG_C : 0;
+        return true;
+    }
+    if ((op & 0xC7) == 0xC7) {                          // RST
+        insn.may_exit = true;
+        insn.cycles = 16;
+        return true;
+    }
+
+    switch (op) {
+        case 0x00:
+            insn.cycles = 4;
+            return true;
+        case 0x02: case 0x12: case 0x0A: case 0x1A:
+        case 0x22: case 0x32: case 0x2A: case 0x3A:
+        case 0xE2: case 0xF2:
+            insn.may_exit = true;
+            insn.cycles = 8;
+            return true;
+        case 0x07: case 0x0F:
+            insn.cycles = 4;
+            insn.flags_written = FLAGS_ALL;
+            return true;
+        case 0x17: case 0x1F:
+            insn.cycles = 4;
+            insn.flags_written = FLAGS_ALL;
+            insn.flags_read = FLAG_C;
+            return true;
+        case 0x2F:
+            insn.cycles = 4;
+            insn.flags_written = FLAG_N | FLAG_H;
+            return true;
+        case 0x37:
+            insn.cycles = 4;
+            insn.flags_written = FLAG_N | FLAG_H | FLAG_C;
+            return true;
+        case 0x3F:
+            insn.cycles = 4;
+            insn.flags_written = FLAG_N | FLAG_H | FLAG_C;
+            insn.flags_read = FLAG_C;
+            return true;
+        case 0xE0: case 0xF0: {
+            // Only high RAM; I/O registers stay with the interpreter
+            uint16_t addr = 0xFF00 | insn.imm8;
+            if (addr < HIGH_RAM_START || addr > HIGH_RAM_END) {
+                return false;
+            }
+            insn.may_exit = op == 0xE0;
+            insn.cycles = 12;
+            return true;
+        }
+        case 0xEA:
+            if (!is_fast_ram(insn.imm16)) {
+                return false;
+            }
+            insn.may_exit = true;
+            insn.cycles = 16;
+            return true;
+        case 0xFA:
+            if (!is_fast_ram(insn.imm16) && insn.imm16 > SWITCHABLE_ROM_END) {
+                return false;
+            }
+            insn.cycles = 16;
+            return true;
+        case 0xF9:
+            insn.cycles = 8;
+            return true;
+        case 0x18:
+            insn.cycles = 12;
+            return true;
+        case 0x20: case 0x28: case 0x30: case 0x38:
+            insn.cycles = 8;
+            insn.flags_read = condition_flag(op);
+            return true;
+        case 0xC3:
+            insn.cycles = 16;
+            return true;
+        case 0xC2: case 0xCA: case 0xD2: case 0xDA:
+            insn.cycles = 12;
+            insn.flags_read = condition_flag(op);
+            return true;
+        case 0xE9:
+            insn.cycles = 4;
+            return true;
+        case 0xCD:
+            insn.may_exit = true;
+            insn.cycles = 24;
+            return true;
+        case 0xC4: case 0xCC: case 0xD4: case 0xDC:
+            insn.may_exit = true;
+            insn.cycles = 12;
+            insn.flags_read = condition_flag(op);
+            return true;
+        case 0xC9:
+            insn.may_exit = true;
+            insn.cycles = 16;
+            return true;
+        case 0xC0: case 0xC8: case 0xD0: case 0xD8:
+            insn.may_exit = true;
+            insn.cycles = 8;
+            insn.flags_read = condition_flag(op);
+            return true;
+        default:
+            // EI, DI, RETI, HALT, STOP, DAA, LD (nn),SP, ADD SP,e, LD HL,SP+e
+            return false;
+    }
+}
+
+class BlockCompiler {
+public:
+    explicit BlockCompiler(const std::vector<Insn>& insns) : insns_(insns) {}
+
+    const std::vector<uint8_t>& compile() {
+        exits_.assign(insns_.size(), SIZE_MAX);
+        epilogue_ = e_.new_label();
+
+        prologue();
+        for (index_ = 0; index_ < insns_.size(); index_++) {
+            instruction(insns_[index_]);
+        }
+        const Insn& last = insns_.back();
+        if (!last.terminator) {
+            // Cut short (length limit or an instruction left to the interpreter)
+            index_ = insns_.size() - 1;
+            leave_to(static_cast<uint16_t>(last.pc + last.length), last.start + last.cycles);
+        }
+        side_exits();
+        epilogue();
+        e_.finish();
+        return e_.code();
+    }
+
+private:
+    const Insn& insn() const { return insns_[index_]; }
+    bool flags_live() const { return (insn().live_out & insn().flags_written) != 0; }
+
+    E::Label exit_label() {
+        if (exits_[index_] == SIZE_MAX) {
+            exits_[index_] = e_.new_label();
+        }
+        return exits_[index_];
+    }
+
+    static E::Reg pair(uint8_t index) {
+        static const E::Reg PAIRS[4] = {REG_BC, REG_DE, REG_HL, REG_SP};
+        return PAIRS[index & 0x03];
+    }
+
+    void prologue() {
+        e_.push(E::RBX);
+        e_.push(E::RBP);
+        e_.push(E::R12);
+        e_.push(E::R13);
+        e_.push(E::R14);
+        e_.push(E::R15);
+        e_.push(E::RAX);  // Keeps the stack 16-byte aligned for calls
+        e_.mov(64, CTX, E::RDI);
+        e_.mov(32, REG_A, CTX_FIELD(a));
+        e_.mov(32, REG_BC, CTX_FIELD(bc));
+        e_.mov(32, REG_DE, CTX_FIELD(de));
+        e_.mov(32, REG_HL, CTX_FIELD(hl));
+        e_.mov(32, REG_SP, CTX_FIELD(sp));
+    }
+
+    void epilogue() {
+        e_.bind(epilogue_);
+        e_.mov(32, CTX_FIELD(a), REG_A);
+        e_.mov(32, CTX_FIELD(bc), REG_BC);
+        e_.mov(32, CTX_FIELD(de), REG_DE);
+        e_.mov(32, CTX_FIELD(hl), REG_HL);
+        e_.mov(32, CTX_FIELD(sp), REG_SP);
+        e_.pop(E::RCX);
+        e_.pop(E::R15);
+        e_.pop(E::R14);
+        e_.pop(E::R13);
+        e_.pop(E::R12);
+        e_.pop(E::RBP);
+        e_.pop(E::RBX);
+        e_.ret();
+    }
+
+    // Leave with the PC already stored; `count` instructions completed
+    void leave(uint32_t cycles, uint32_t count) {
+        e_.mov(32, CTX_FIELD(instructions), static_cast<int32_t>(count));
+        e_.mov(E::RAX, cycles);
+        e_.jmp(epilogue_);
+    }
+    void leave_to(uint16_t pc, uint32_t cycles) {
+        e_.mov(32, CTX_FIELD(pc), pc);
+        leave(cycles, static_cast<uint32_t>(index_ + 1));
+    }
+
+    void side_exits() {
+        for (size_t i = 0; i < insns_.size(); i++) {
+            if (exits_[i] == SIZE_MAX) {
+                continue;
+            }
+            e_.bind(exits_[i]);
+            e_.mov(32, CTX_FIELD(pc), insns_[i].pc);
+            e_.mov(32, CTX_FIELD(side_exit), 1);
+            leave(insns_[i].start, static_cast<uint32_t>(i));
+        }
+    }
+
+    // 8-bit registers in opcode order B C D E H L - A; values are zero-extended
+    void load8(E::Reg dst, uint8_t r) {
+        if (r == 7) {
+            e_.mov(32, dst, REG_A);
+        } else if (r & 1) {
+            e_.movzx8(dst, pair(r >> 1));
+        } else {
+            e_.mov(32, dst, pair(r >> 1));
+            e_.shift(E::SHR, 32, dst, 8);
+        }
+    }
+
+    // `src` must hold a zero-extended byte and may be clobbered
+    void store8(uint8_t r, E::Reg src) {
+        if (r == 7) {
+            e_.mov(32, REG_A, src);
+        } else if (r & 1) {
+            e_.mov(8, pair(r >> 1), src);
+        } else {
+            E::Reg reg = pair(r >> 1);
+            e_.alu(E::AND, 32, reg, 0x00FF);
+            e_.shift(E::SHL, 32, src, 8);
+            e_.alu(E::OR, 32, reg, src);
+        }
+    }
+
+    // Host pointer for a work/high RAM address in `addr` (not RCX); anything
+    // else, or a write to a page holding cached code, takes the side exit.
+    // Clobbers RCX.
+    void ram_pointer(E::Reg addr, E::Reg out, bool write) {
+        E::Label exit = exit_label();
+        E::Label high = e_.new_label();
+        E::Label done = e_.new_label();
+        if (write) {
+            e_.mov(32, E::RCX, addr);
+            e_.shift(E::SHR, 32, E::RCX, BlockCache::PAGE_SHIFT);
+            e_.mov64(out, CTX_FIELD(code_pages));
+            e_.bt(E::mem(out), E::RCX);
+            e_.jcc(E::CC_B, exit);
+        }
+        e_.lea(E::RCX, E::mem(addr, -INTERNAL_RAM_START));
+        e_.alu(E::CMP, 32, E::RCX, INTERNAL_RAM_SIZE);
+        e_.jcc(E::CC_AE, high);
+        e_.mov64(out, CTX_FIELD(wram));
+        e_.add64(out, E::RCX);
+        e_.jmp(done);
+        e_.bind(high);
+        e_.lea(E::RCX, E::mem(addr, -HIGH_RAM_START));
+        e_.alu(E::CMP, 32, E::RCX, HIGH_RAM_SIZE);
+        e_.jcc(E::CC_AE, exit);
+        e_.mov64(out, CTX_FIELD(hram));
+        e_.add64(out, E::RCX);
+        e_.bind(done);
+    }
+
+    // Byte at the address in EDX into EAX; ROM goes through the MMU (the
+    // current bank), RAM is read directly. Clobbers all scratch registers.
+    void read(bool rom_possible = true) {
+        E::Label rom = e_.new_label();
+        E::Label done = e_.new_label();
+        if (rom_possible) {
+            e_.alu(E::CMP, 32, E::RDX, VRAM_START);
+            e_.jcc(E::CC_B, rom);
+        }
+        ram_pointer(E::RDX, E::RSI, false);
+        e_.movzx8(E::RAX, E::mem(E::RSI));
+        if (rom_possible) {
+            e_.jmp(done);
+            e_.bind(rom);
+            e_.mov64(E::RDI, CTX_FIELD(mmu));
+            e_.mov(32, E::RSI, E::RDX);
+            e_.call(CTX_FIELD(read));
+            e_.movzx8(E::RAX, E::RAX);
+        }
+        e_.bind(done);
+    }
+
+    // Host flags from the last x86 instruction into EDX, in SM83 positions
+    void capture_flags() {
+        e_.lahf();
+        e_.movzx_ah(E::RDX);
+        e_.movzx8(E::RDX, E::mem(CTX, E::RDX, offsetof(Jit::Context, flag_table)));
+    }
+
+    // F = (F & keep) | (captured & host) | set
+    void merge_flags(uint8_t host, uint8_t keep, uint8_t set) {
+        if (host != FLAGS_HOST) {
+            e_.alu(E::AND, 32, E::RDX, host);
+        }
+        if (keep != 0) {
+            e_.mov(32, E::RCX, CTX_FIELD(f));
+            e_.alu(E::AND, 32, E::RCX, keep);
+            e_.alu(E::OR, 32, E::RDX, E::RCX);
+        }
+        if (set != 0) {
+            e_.alu(E::OR, 32, E::RDX, set);
+        }
+        e_.mov(32, CTX_FIELD(f), E::RDX);
+    }
+
+    // F = (F & keep) | set, without host flags
+    void set_flags(uint8_t keep, uint8_t set) {
+        if (keep == 0) {
+            e_.mov(32, CTX_FIELD(f), set);
+            return;
+        }
+        e_.alu(E::AND, 32, CTX_FIELD(f), keep);
+        if (set != 0) {
+            e_.alu(E::OR, 32, CTX_FIELD(f), set);
+        }
+    }
+
+    void carry_in() { e_.bt(CTX_FIELD(f), 4); }
+
+    // A = A op ECX
+    void alu_a(uint8_t kind) {
+        e_.mov(32, E::RAX, REG_A);
+        if (kind == 1 || kind == 3) {
+            carry_in();
+        }
+        e_.alu(ALU_OPS[kind], 8, E::RAX, E::RCX);
+        bool live = flags_live();
+        if (live) {
+            capture_flags();
+        }
+        if (kind != 7) {
+            e_.movzx8(REG_A, E::RAX);
+        }
+        if (!live) {
+            return;
+        }
+        switch (kind) {
+            case 0: case 1: merge_flags(FLAGS_HOST, 0, 0); break;
+            case 2: case 3: case 7: merge_flags(FLAGS_HOST, 0, FLAG_N); break;
+            case 4: merge_flags(FLAG_Z, 0, FLAG_H); break;
+            default: merge_flags(FLAG_Z, 0, 0); break;
+        }
+    }
+
+    // CB rotate/shift/bit ops on the byte in EAX; the result stays in AL
+    void cb_operation(uint8_t cb) {
+        uint8_t group = cb >> 6;
+        uint8_t kind = (cb >> 3) & 0x07;
+        bool live = flags_live();
+        if (group == 1) {
+            e_.test(8, E::RAX, 1 << kind);
+            if (live) {
+                capture_flags();
+                merge_flags(FLAG_Z, FLAG_C, FLAG_H);
+            }
+            return;
+        }
+        if (group == 2) {
+            e_.alu(E::AND, 32, E::RAX, ~(1 << kind) & 0xFF);
+            return;
+        }
+        if (group == 3) {
+            e_.alu(E::OR, 32, E::RAX, 1 << kind);
+            return;
+        }
+        switch (kind) {
+            case 0: case 1: case 2: case 3: {
+                static const E::Shift ROTATES[4] = {E::ROL, E::ROR, E::RCL, E::RCR};
+                if (kind >= 2) {
+                    carry_in();
+                }
+                e_.shift(ROTATES[kind], 8, E::RAX, 1);
+                if (live) {
+                    // Rotates leave ZF alone, so Z comes from a separate test
+                    e_.setcc(E::CC_B, E::RCX);
+                    e_.test(8, E::RAX, E::RAX);
+                    capture_flags();
+                    e_.movzx8(E::RCX, E::RCX);
+                    e_.shift(E::SHL, 32, E::RCX, 4);
+                    e_.alu(E::AND, 32, E::RDX, FLAG_Z);
+                    e_.alu(E::OR, 32, E::RDX, E::RCX);
+                    e_.mov(32, CTX_FIELD(f), E::RDX);
+                }
+                return;
+            }
+            case 4: case 5: case 7: {
+                static const E::Shift SHIFTS[8] = {E::ROL, E::ROL, E::ROL, E::ROL, E::SHL, E::SAR, E::ROL, E::SHR};
+                e_.shift(SHIFTS[kind], 8, E::RAX, 1);
+                if (live) {
+                    capture_flags();
+                    merge_flags(FLAG_Z | FLAG_C, 0, 0);
+                }
+                return;
+            }
+            default:   // SWAP
+                e_.shift(E::ROL, 8, E::RAX, 4);
+                if (live) {
+                    e_.test(8, E::RAX, E::RAX);
+                    capture_flags();
+                    merge_flags(FLAG_Z, 0, 0);
+                }
+                return;
+        }
+    }
+
+    // Both stack slots are checked before either is written
+    void push(E::Reg value_source, bool af, bool immediate, uint16_t value) {
+        e_.lea(E::RDX, E::mem(REG_SP, -1));
+        e_.movzx16(E::RDX, E::RDX);
+        ram_pointer(E::RDX, E::RDI, true);
+        e_.lea(E::RDX, E::mem(REG_SP, -2));
+        e_.movzx16(E::RDX, E::RDX);
+        ram_pointer(E::RDX, E::RSI, true);
+        if (immediate) {
+            e_.mov(E::RAX, value);
+        } else if (af) {
+            e_.mov(32, E::RAX, REG_A);
+            e_.shift(E::SHL, 32, E::RAX, 8);
+            e_.alu(E::OR, 32, E::RAX, CTX_FIELD(f));
+        } else {
+            e_.mov(32, E::RAX, value_source);
+        }
+        e_.mov(8, E::mem(E::RSI), E::RAX);
+        e_.shift(E::SHR, 32, E::RAX, 8);
+        e_.mov(8, E::mem(E::RDI), E::RAX);
+        e_.alu(E::SUB, 16, REG_SP, 2);
+    }
+
+    // Pops into EAX
+    void pop() {
+        e_.mov(32, E::RDX, REG_SP);
+        ram_pointer(E::RDX, E::RSI, false);
+        e_.lea(E::RDX, E::mem(REG_SP, 1));
+        e_.movzx16(E::RDX, E::RDX);
+        ram_pointer(E::RDX, E::RDI, false);
+        e_.movzx8(E::RAX, E::mem(E::RSI));
+        e_.movzx8(E::RCX, E::mem(E::RDI));
+        e_.shift(E::SHL, 32, E::RCX, 8);
+        e_.alu(E::OR, 32, E::RAX, E::RCX);
+        e_.alu(E::ADD, 16, REG_SP, 2);
+    }
+
+    // Jumps to `taken` when the opcode's condition holds
+    void branch_if(uint8_t opcode, E::Label taken) {
+        uint8_t cond = (opcode >> 3) & 0x03;
+        e_.test8(CTX_FIELD(f), condition_flag(opcode));
+        e_.jcc((cond & 1) ? E::CC_NE : E::CC_E, taken);
+    }
+
+    void instruction(const Insn& in) {
+        uint8_t op = in.opcode;
+        uint8_t r_dst = (op >> 3) & 0x07;
+        uint8_t r_src = op & 0x07;
+        uint16_t next = static_cast<uint16_t>(in.pc + in.length);
+
+        if (op == 0xCB) {
+            uint8_t cb = in.cb_opcode;
+            uint8_t reg = cb & 0x07;
+            bool writes_back = (cb >> 6) != 1;
+            if (reg != 6) {
+                load8(E::RAX, reg);
+                cb_operation(cb);
+                if (writes_back) {
+                    e_.movzx8(E::RAX, E::RAX);
+                    store8(reg, E::RAX);
+                }
+            } else if (!writes_back) {
+                e_.mov(32, E::RDX, REG_HL);
+                read();
+                cb_operation(cb);
+            } else {
+                e_.mov(32, E::RDX, REG_HL);
+                ram_pointer(E::RDX, E::RSI, true);
+                e_.movzx8(E::RAX, E::mem(E::RSI));
+                cb_operation(cb);
+                e_.mov(8, E::mem(E::RSI), E::RAX);
+            }
+            return;
+        }
+
+        if (op >= 0x40 && op <= 0x7F) {                     // LD r,r'
+            if (r_src == 6) {
+                e_.mov(32, E::RDX, REG_HL);
+                read();
+                store8(r_dst, E::RAX);
+            } else if (r_dst == 6) {
+                e_.mov(32, E::RDX, REG_HL);
+                ram_pointer(E::RDX, E::RSI, true);
+                load8(E::RAX, r_src);
+                e_.mov(8, E::mem(E::RSI), E::RAX);
+            } else if (r_src != r_dst) {
+                load8(E::RAX, r_src);
+                store8(r_dst, E::RAX);
+            }
+            return;
+        }
+        if (op >= 0x80 && op <= 0xBF) {                     // ALU A,r
+            if (r_src == 6) {
+                e_.mov(32, E::RDX, REG_HL);
+                read();
+                e_.mov(32, E::RCX, E::RAX);
+            } else {
+                load8(E::RCX, r_src);
+            }
+            alu_a(r_dst);
+            return;
+        }
+        if ((op & 0xC7) == 0xC6) {                          // ALU A,n
+            e_.mov(E::RCX, in.imm8);
+            alu_a(r_dst);
+            return;
+        }
+        if ((op & 0xC6) == 0x04) {                          // INC r / DEC r
+            bool dec = (op & 1) != 0;
+            E::Reg value = E::RAX;
+            if (r_dst == 6) {
+                e_.mov(32, E::RDX, REG_HL);
+                ram_pointer(E::RDX, E::RSI, true);
+                e_.movzx8(value, E::mem(E::RSI));
+            } else {
+                load8(value, r_dst);
+            }
+            if (dec) {
+                e_.dec(8, value);
+            } else {
+                e_.inc(8, value);
+            }
+            bool live = flags_live();
+            if (live) {
+                capture_flags();
+            }
+            if (r_dst == 6) {
+                e_.mov(8, E::mem(E::RSI), value);
+            } else {
+                e_.movzx8(value, value);
+                store8(r_dst, value);
+            }
+            if (live) {
+                merge_flags(FLAG_Z | FLAG_H, FLAG_C, dec ? FLAG_N : 0);
+            }
+            return;
+        }
+        if ((op & 0xC7) == 0x06) {                          // LD r,n
+            if (r_dst == 6) {
+                e_.mov(32, E::RDX, REG_HL);
+                ram_pointer(E::RDX, E::RSI, true);
+                e_.mov(8, E::mem(E::RSI), in.imm8);
+            } else {
+                e_.mov(E::RAX, in.imm8);
+                store8(r_dst, E::RAX);
+            }
+            return;
+        }
+        if ((op & 0xCF) == 0x01) {                          // LD rr,nn
+            e_.mov(pair(op >> 4), in.imm16);
+            return;
+        }
+        if ((op & 0xCF) == 0x03) {                          // INC rr
+            e_.inc(16, pair(op >> 4));
+            return;
+        }
+        if ((op & 0xCF) == 0x0B) {                          // DEC rr
+            e_.dec(16, pair(op >> 4));
+            return;
+        }
+        if ((op & 0xCF) == 0x09) {                          // ADD HL,rr
+            bool live = flags_live();
+            e_.mov(32, E::RDX, pair(op >> 4));
+            if (live) {
+                // H is the carry out of bit 11, which x86 does not report
+                e_.mov(32, E::RCX, REG_HL);
+                e_.alu(E::AND, 32, E::RCX, 0x0FFF);
+                e_.mov(32, E::RAX, E::RDX);
+                e_.alu(E::AND, 32, E::RAX, 0x0FFF);
+                e_.alu(E::ADD, 32, E::RCX, E::RAX);
+            }
+            e_.alu(E::ADD, 32, E::RDX, REG_HL);
+            e_.movzx16(REG_HL, E::RDX);
+            if (live) {
+                e_.shift(E::SHR, 32, E::RCX, 7);
+                e_.alu(E::AND, 32, E::RCX, FLAG_H);
+                e_.shift(E::SHR, 32, E::RDX, 12);
+                e_.alu(E::AND, 32, E::RDX, FLAG_C);
+                e_.alu(E::OR, 32, E::RDX, E::RCX);
+                merge_flags(FLAG_H | FLAG_C, FLAG_Z, 0);
+            }
+            return;
+        }
+        if ((op & 0xCF) == 0xC5) {                          // PUSH rr
+            uint8_t index = (op >> 4) & 0x03;
+            push(pair(index), index == 3, false, 0);
+            return;
+        }
+        if ((op & 0xCF) == 0xC1) {                          // POP rr
+            uint8_t index = (op >> 4) & 0x03;
+            pop();
+            if (index == 3) {
+                e_.mov(32, E::RCX, E::RAX);
+                e_.shift(E::SHR, 32, E::RCX, 8);
+                e_.mov(32, REG_A, E::RCX);
+                e_.alu(E::AND, 32, E::RAX, FLAGS_ALL);
+                e_.mov(32, CTX_FIELD(f), E::RAX);
+            } else {
+                e_.mov(32, pair(index), E::RAX);
+            }
+            return;
+        }
+        if ((op & 0xC7) == 0xC7) {                          // RST
+            push(REG_A, false, true, next);
+            leave_to(op & 0x38, in.start + 16);
+            return;
+        }
+
+        switch (op) {
+            case 0x00:
+                return;
+            case 0x02: case 0x12:                           // LD (BC),A / LD (DE),A
+                e_.mov(32, E::RDX, pair(op >> 4));
+                ram_pointer(E::RDX, E::RSI, true);
+                e_.mov(8, E::mem(E::RSI), REG_A);
+                return;
+            case 0x0A: case 0x1A:                           // LD A,(BC) / LD A,(DE)
+                e_.mov(32, E::RDX, pair(op >> 4));
+                read();
+                e_.mov(32, REG_A, E::RAX);
+                return;
+            case 0x22: case 0x32:                           // LD (HL+/-),A
+                e_.mov(32, E::RDX, REG_HL);
+                ram_pointer(E::RDX, E::RSI, true);
+                e_.mov(8, E::mem(E::RSI), REG_A);
+                if (op == 0x22) {
+                    e_.inc(16, REG_HL);
+                } else {
+                    e_.dec(16, REG_HL);
+                }
+                return;
+            case 0x2A: case 0x3A:                           // LD A,(HL+/-)
+                e_.mov(32, E::RDX, REG_HL);
+                read();
+                e_.mov(32, REG_A, E::RAX);
+                if (op == 0x2A) {
+                    e_.inc(16, REG_HL);
+                } else {
+                    e_.dec(16, REG_HL);
+                }
+                return;
+            case 0xE2:                                      // LD (C),A
+                e_.movzx8(E::RDX, REG_BC);
+                e_.alu(E::OR, 32, E::RDX, 0xFF00);
+                ram_pointer(E::RDX, E::RSI, true);
+                e_.mov(8, E::mem(E::RSI), REG_A);
+                return;
+            case 0xF2:                                      // LD A,(C)
+                e_.movzx8(E::RDX, REG_BC);
+                e_.alu(E::OR, 32, E::RDX, 0xFF00);
+                read(false);
+                e_.mov(32, REG_A, E::RAX);
+                return;
+            case 0xE0: case 0xEA:                           // LDH (n),A / LD (nn),A
+                e_.mov(E::RDX, op == 0xE0 ? 0xFF00 | in.imm8 : in.imm16);
+                ram_pointer(E::RDX, E::RSI, true);
+                e_.mov(8, E::mem(E::RSI), REG_A);
+                return;
+            case 0xF0: case 0xFA:                           // LDH A,(n) / LD A,(nn)
+                e_.mov(E::RDX, op == 0xF0 ? 0xFF00 | in.imm8 : in.imm16);
+                read(op == 0xFA);
+                e_.mov(32, REG_A, E::RAX);
+                return;
+            case 0x07: case 0x0F: case 0x17: case 0x1F: {   // RLCA RRCA RLA RRA
+                static const E::Shift ROTATES[4] = {E::ROL, E::ROR, E::RCL, E::RCR};
+                uint8_t kind = (op >> 3) & 0x03;
+                e_.mov(32, E::RAX, REG_A);
+                if (kind >= 2) {
+                    carry_in();
+                }
+                e_.shift(ROTATES[kind], 8, E::RAX, 1);
+                bool live = flags_live();
+                if (live) {
+                    capture_flags();
+                }
+                e_.movzx8(REG_A, E::RAX);
+                if (live) {
+                    merge_flags(FLAG_C, 0, 0);
+                }
+                return;
+            }
+            case 0x2F:                                      // CPL
+                e_.alu(E::XOR, 32, REG_A, 0xFF);
+                if (flags_live()) {
+                    e_.alu(E::OR, 32, CTX_FIELD(f), FLAG_N | FLAG_H);
+                }
+                return;
+            case 0x37:                                      // SCF
+                if (flags_live()) {
+                    set_flags(FLAG_Z, FLAG_C);
+                }
+                return;
+            case 0x3F:                                      // CCF
+                if (flags_live()) {
+                    e_.mov(32, E::RCX, CTX_FIELD(f));
+                    e_.alu(E::XOR, 32, E::RCX, FLAG_C);
+                    e_.alu(E::AND, 32, E::RCX, FLAG_Z | FLAG_C);
+                    e_.mov(32, CTX_FIELD(f), E::RCX);
+                }
+                return;
+            case 0xF9:                                      // LD SP,HL
+                e_.mov(32, REG_SP, REG_HL);
+                return;
+            case 0x18:                                      // JR e
+                leave_to(static_cast<uint16_t>(next + static_cast<int8_t>(in.imm8)), in.start + 12);
+                return;
+            case 0x20: case 0x28: case 0x30: case 0x38: {   // JR cc,e
+                E::Label taken = e_.new_label();
+                branch_if(op, taken);
+                leave_to(next, in.start + 8);
+                e_.bind(taken);
+                leave_to(static_cast<uint16_t>(next + static_cast<int8_t>(in.imm8)), in.start + 12);
+                return;
+            }
+            case 0xC3:                                      // JP nn
+                leave_to(in.imm16, in.start + 16);
+                return;
+            case 0xC2: case 0xCA: case 0xD2: case 0xDA: {   // JP cc,nn
+                E::Label taken = e_.new_label();
+                branch_if(op, taken);
+                leave_to(next, in.start + 12);
+                e_.bind(taken);
+                leave_to(in.imm16, in.start + 16);
+                return;
+            }
+            case 0xE9:                                      // JP HL
+                e_.mov(32, CTX_FIELD(pc), REG_HL);
+                leave(in.start + 4, static_cast<uint32_t>(index_ + 1));
+                return;
+            case 0xCD:                                      // CALL nn
+                push(REG_A, false, true, next);
+                leave_to(in.imm16, in.start + 24);
+                return;
+            case 0xC4: case 0xCC: case 0xD4: case 0xDC: {   // CALL cc,nn
+                E::Label taken = e_.new_label();
+                branch_if(op, taken);
+                leave_to(next, in.start + 12);
+                e_.bind(taken);
+                push(REG_A, false, true, next);
+                leave_to(in.imm16, in.start + 24);
+                return;
+            }
+            case 0xC9:                                      // RET
+                pop();
+                e_.mov(32, CTX_FIELD(pc), E::RAX);
+                leave(in.start + 16, static_cast<uint32_t>(index_ + 1));
+                return;
+            case 0xC0: case 0xC8: case 0xD0: case 0xD8: {   // RET cc
+                E::Label taken = e_.new_label();
+                branch_if(op, taken);
+                leave_to(next, in.start + 8);
+                e_.bind(taken);
+                pop();
+                e_.mov(32, CTX_FIELD(pc), E::RAX);
+                leave(in.start + 20, static_cast<uint32_t>(index_ + 1));
+                return;
+            }
+            default:
+                throw std::logic_error("JIT: opcode passed analysis but has no translation");
+        }
+    }
+
+    const std::vector<Insn>& insns_;
+    E e_;
+    size_t index_ = 0;
+    std::vector<E::Label> exits_;
+    E::Label epilogue_ = 0;
+};
+
+}  // namespace
+
+#endif  // JIT_X86_64
+
+Jit::Jit(CPU* cpu, MMU* mmu)
+    : cpu_(cpu)
+    , mmu_(mmu) {
+    context_.mmu = mmu;
+    context_.read = &read_through_mmu;
+    context_.code_pages = cpu->block_cache().code_page_bitmap();
+    for (int i = 0; i < 256; i++) {
+        // LAHF: SF ZF - AF - PF - CF
+        context_.flag_table[i] = ((i & 0x40) ? FLAG_Z : 0) | ((i & 0x10) ? FLAG_H : 0) | ((i & 0x01) ? FLAG_C : 0);
+    }
+}
+
+bool Jit::available() const {
+#ifdef JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Jit::allocate() {
+    if (code_ != nullptr) {
+        return true;
+    }
+#ifdef JIT_X86_64
+    void* memory = mmap(nullptr, JIT_CODE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    code_ = static_cast<uint8_t*>(memory);
+    index_.assign(mmu_->rom_size(), 0);
+    heat_.assign(mmu_->rom_size(), 0);
+    ram_index_.assign(0x10000 - BlockCache::RAM_BASE, 0);
+    ram_heat_.assign(0x10000 - BlockCache::RAM_BASE, 0);
+    return true;
+#else
+    return false;
+#endif
+}
+
+Jit::~Jit() {
+#ifdef JIT_X86_64
+    if (code_ != nullptr) {
+        munmap(code_, JIT_CODE_BYTES);
+    }
+#endif
+}
+
+void Jit::flush() {
+    std::fill(index_.begin(), index_.end(), 0);
+    std::fill(heat_.begin(), heat_.end(), 0);
+    flush_ram();
+    blocks_.clear();
+    code_used_ = 0;
+}
+
+void Jit::invalidate_ram(uint16_t start) {
+    if (ram_index_.empty()) {
+        return;
+    }
+    ram_index_[start - BlockCache::RAM_BASE] = 0;
+    ram_heat_[start - BlockCache::RAM_BASE] = 0;
+}
+
+void Jit::flush_ram() {
+    // Code space of dropped blocks is only reclaimed by a full flush
+    std::fill(ram_index_.begin(), ram_index_.end(), 0);
+    std::fill(ram_heat_.begin(), ram_heat_.end(), 0);
+}
+
+uint32_t Jit::run(uint32_t budget) {
+    if (code_ == nullptr) {
+        return 0;
+    }
+    uint16_t pc = cpu_->pc_;
+    uint32_t* slot = nullptr;
+    uint8_t* heat = nullptr;
+    uint32_t limit = 0;
+    if (pc <= SWITCHABLE_ROM_END) {
+        size_t offset = mmu_->rom_offset(pc);
+        if (offset >= index_.size()) {
+            return 0;
+        }
+        slot = &index_[offset];
+        heat = &heat_[offset];
+        // Blocks never run across the bank boundary
+        limit = pc <= STATIC_ROM_END ? SWITCHABLE_ROM_START : VRAM_START;
+    } else if (pc >= INTERNAL_RAM_START && pc <= INTERNAL_RAM_END) {
+        slot = &ram_index_[pc - BlockCache::RAM_BASE];
+        heat = &ram_heat_[pc - BlockCache::RAM_BASE];
+        limit = INTERNAL_RAM_END + 1;
+    } else if (pc >= HIGH_RAM_START && pc <= HIGH_RAM_END) {
+        slot = &ram_index_[pc - BlockCache::RAM_BASE];
+        heat = &ram_heat_[pc - BlockCache::RAM_BASE];
+        limit = HIGH_RAM_END + 1;
+    } else {
+        return 0;
+    }
+
+    uint32_t id = *slot;
+    if (id == 0) {
+        if (*heat < JIT_HOT_THRESHOLD) {
+            ++*heat;
+            return 0;
+        }
+        if (limit > VRAM_START && !cpu_->block_cache_.has_ram_block(pc)) {
+            return 0;  // Not guarded by the code-page bitmap (yet)
+        }
+        id = compile(pc, limit);
+        *slot = id;
+    }
+    if (id == NOT_COMPILABLE) {
+        return 0;
+    }
+    const Block& block = blocks_[id - 1];
+    if (block.last_start >= budget) {
+        return 0;  // An event is due before the block would finish
+    }
+
+    context_.a = cpu_->getA();
+    context_.f = cpu_->getF();
+    context_.bc = cpu_->bc_;
+    context_.de = cpu_->de_;
+    context_.hl = cpu_->hl_;
+    context_.sp = cpu_->sp_;
+    context_.side_exit = 0;
+    context_.wram = mmu_->wram_data();
+    context_.hram = mmu_->hram_data();
+    if (verify_) {
+        saved_wram_.assign(context_.wram, context_.wram + INTERNAL_RAM_SIZE);
+        saved_hram_.assign(context_.hram, context_.hram + HIGH_RAM_SIZE);
+    }
+
+    uint32_t cycles = block.entry(&context_);
+    if (context_.instructions == 0) {
+        return 0;  // Left before the first instruction, nothing changed
+    }
+    native_runs_++;
+    native_instructions_ += context_.instructions;
+    side_exits_ += context_.side_exit;
+
+    if (verify_) {
+        return verify(cycles);
+    }
+    cpu_->setA(static_cast<uint8_t>(context_.a));
+    cpu_->setF(static_cast<uint8_t>(context_.f));
+    cpu_->bc_ = static_cast<uint16_t>(context_.bc);
+    cpu_->de_ = static_cast<uint16_t>(context_.de);
+    cpu_->hl_ = static_cast<uint16_t>(context_.hl);
+    cpu_->sp_ = static_cast<uint16_t>(context_.sp);
+    cpu_->pc_ = static_cast<uint16_t>(context_.pc);
+    return cycles;
+}
+
+uint32_t Jit::verify(uint32_t cycles) {
+    // Replay the same instructions in the interpreter from the saved state
+    uint16_t start_pc = cpu_->pc_;
+    native_wram_.assign(context_.wram, context_.wram + INTERNAL_RAM_SIZE);
+    native_hram_.assign(context_.hram, context_.hram + HIGH_RAM_SIZE);
+    std::copy(saved_wram_.begin(), saved_wram_.end(), context_.wram);
+    std::copy(saved_hram_.begin(), saved_hram_.end(), context_.hram);
+
+    // The replay repeats instructions already counted as native ones
+    uint64_t instructions = cpu_->instructions_;
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < context_.instructions; i++) {
+        expected += cpu_->execute_next_instruction();
+    }
+    cpu_->instructions_ = instructions;
+
+    uint16_t native[6] = {
+        static_cast<uint16_t>(context_.a << 8 | context_.f), static_cast<uint16_t>(context_.bc),
+        static_cast<uint16_t>(context_.de), static_cast<uint16_t>(context_.hl),
+        static_cast<uint16_t>(context_.sp), static_cast<uint16_t>(context_.pc)};
+    uint16_t interpreted[6] = {cpu_->af(), cpu_->bc_, cpu_->de_, cpu_->hl_, cpu_->sp_, cpu_->pc_};
+    bool registers_match = std::equal(native, native + 6, interpreted);
+    bool memory_match = std::equal(native_wram_.begin(), native_wram_.end(), context_.wram)
+        && std::equal(native_hram_.begin(), native_hram_.end(), context_.hram);
+    if (registers_match && memory_match && expected == cycles) {
+        return cycles;
+    }
+
+    static const char* const NAMES[6] = {"AF", "BC", "DE", "HL", "SP", "PC"};
+    std::cerr << std::hex << std::setfill('0') << "JIT mismatch in block at " << std::setw(4) << start_pc
+              << " after " << std::dec << context_.instructions << " instructions" << std::endl;
+    for (int i = 0; i < 6; i++) {
+        std::cerr << "  " << NAMES[i] << " native " << std::hex << std::setw(4) << native[i]
+                  << " interpreter " << std::setw(4) << interpreted[i] << std::endl;
+    }
+    std::cerr << std::dec << std::setfill(' ') << "  cycles native " << cycles << " interpreter " << expected
+              << (memory_match ? "" : ", RAM differs") << std::endl;
+    throw std::runtime_error("JIT verification failed");
+}
+
+uint32_t Jit::compile(uint16_t pc, uint32_t limit) {
+#ifdef JIT_X86_64
+    std::vector<Insn> insns;
+    uint32_t addr = pc;
+    uint16_t cycles = 0;
+    while (insns.size() < BlockCache::BLOCK_MAX_OPS) {
+        Insn insn = {};
+        insn.pc = static_cast<uint16_t>(addr);
+        insn.opcode = mmu_->peek_memory_8(insn.pc);
+        if (!InstructionDecoder::isDefined(insn.opcode)) {
+            break;
+        }
+        insn.length = 1 + InstructionDecoder::operandBytes(insn.opcode);
+        if (addr + insn.length > limit) {
+            break;
+        }
+        if (insn.length > 1) {
+            insn.imm8 = mmu_->peek_memory_8(static_cast<uint16_t>(addr + 1));
+            insn.cb_opcode = insn.imm8;
+        }
+        if (insn.length > 2) {
+            insn.imm16 = static_cast<uint16_t>(insn.imm8 | mmu_->peek_memory_8(static_cast<uint16_t>(addr + 2)) << 8);
+        }
+        if (!analyze(insn)) {
+            break;
+        }
+        insn.start = cycles;
+        cycles += insn.cycles;
+        insns.push_back(insn);
+        addr += insn.length;
+        if (insn.terminator) {
+            break;
+        }
+    }
+    if (insns.empty()) {
+        return NOT_COMPILABLE;
+    }
+
+    // Flag liveness, backwards: everything is live at the block end and in
+    // front of any instruction that may leave the block
+    uint8_t live = FLAGS_ALL;
+    for (size_t i = insns.size(); i-- > 0;) {
+        Insn& insn = insns[i];
+        insn.live_out = live;
+        live = insn.flags_read | (live & ~insn.flags_written);
+        if (insn.may_exit) {
+            live = FLAGS_ALL;
+        }
+    }
+
+    BlockCompiler compiler(insns);
+    const std::vector<uint8_t>& code = compiler.compile();
+    if (code_used_ + code.size() > JIT_CODE_BYTES) {
+        flush();
+    }
+    uint8_t* entry = code_ + code_used_;
+    // W^X: only the pages being written are writable, and only meanwhile
+    uint8_t* first_page = reinterpret_cast<uint8_t*>(reinterpret_cast<uintptr_t>(entry) & ~JIT_PAGE_MASK);
+    size_t span = entry + code.size() - first_page;
+    if (mprotect(first_page, span, PROT_READ | PROT_WRITE) != 0) {
+        return NOT_COMPILABLE;
+    }
+    std::memcpy(entry, code.data(), code.size());
+    if (mprotect(first_page, span, PROT_READ | PROT_EXEC) != 0) {
+        throw std::runtime_error("JIT: could not make code executable");
+    }
+    code_used_ += (code.size() + 15) & ~static_cast<size_t>(15);
+
+    Block block;
+    block.entry = reinterpret_cast<NativeBlock>(entry);
+    block.last_start = insns.back().start;
+    blocks_.push_back(block);
+    return static_cast<uint32_t>(blocks_.size());
+#else
+    (void)pc;
+    (void)limit;
+    return NOT_COMPILABLE;
+#endif
+}
@@ -0,0 +1,45 @@
+#include "../inc/joypad.hpp"
+#include "../inc/interrupt_controller.hpp"
+#include "../inc/save_state.hpp"
+
+
+Joypad::Joypad(InterruptController* interrupt_controller)
+    : interrupt_controller_(interrupt_controller) {}
+
+uint8_t Joypad::selected_lines() const {
+    uint8_t lines = 0x00;
+    if ((select_ & JOYPAD_SELECT_DIRECTIONS) == 0) {
+        lines |= buttons_ & 0x0F;
+    }
+    if ((select_ & JOYPAD_SELECT_ACTIONS) == 0) {
+        lines |= buttons_ >> 4;
+    }
+    return lines;
+}
+
+void Joypad::set_buttons(uint8_t buttons) {
+    uint8_t previous = selected_lines();
+    buttons_ = buttons;
+    // The interrupt fires when a selected line goes from high to low
+    if (selected_lines() & ~previous) {
+        interrupt_controller_->request_interrupt(INTERRUPT_JOYPAD_BIT);
+    }
+}
+
+void Joypad::write_joypad(uint8_t value) {
+    select_ = value & (JOYPAD_SELECT_DIRECTIONS | JOYPAD_SELECT_ACTIONS);
+}
+
+uint8_t Joypad::read_joypad() const {
+    return 0xC0 | select_ | (~selected_lines() & 0x0F);
+}
+
+void Joypad::save_state(StateWriter& writer) const {
+    writer.write(select_);
+    writer.write(buttons_);
+}
+
+void Joypad::load_state(StateReader& reader) {
+    reader.read(select_);
+    reader.read(buttons_);
+}
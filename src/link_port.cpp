@@ -0,0 +1,121 @@
+#include "../inc/link_port.hpp"
+#include "../inc/constants.hpp"
+#include <chrono>
+#include <thread>
+
+static const uint64_t INBOX_VALID = 1 << 8;
+static const int INBOX_TIME_SHIFT = 9;
+static const int STAMP_CLOCK_SHIFT = 16;
+
+template <typename Ready>
+void LinkPort::wait_until(uint64_t now, Ready ready) {
+    if (ready() || !connected()) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    while (!ready() && connected()) {
+        // Bytes we no longer want must not hold up a partner waiting on us
+        if (discard_unwanted_data()) {
+            publish_clock(now);
+        }
+        std::this_thread::yield();
+    }
+    waits_++;
+    wait_us_ += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+void LinkPort::publish_clock(uint64_t now) {
+    uint64_t stamp = (now << STAMP_CLOCK_SHIFT) | received_count_;
+    if (stamp != published_stamp_) {
+        published_stamp_ = stamp;
+        send_clock(stamp);
+    }
+}
+
+bool LinkPort::discard_unwanted_data() {
+    // The partner read our offer just before we withdrew it; the byte is lost
+    // as it would be on hardware, but it still counts as received
+    if (ready_ != NOT_READY || inbox_.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    inbox_.store(0, std::memory_order_relaxed);
+    received_count_++;
+    return true;
+}
+
+void LinkPort::sync(uint64_t now) {
+    if (!connected()) {
+        return;
+    }
+    discard_unwanted_data();
+    publish_clock(now);
+    // A pending byte has to be received before the partner can move on
+    wait_until(now, [&]() {
+        return (peer_stamp_.load(std::memory_order_acquire) >> STAMP_CLOCK_SHIFT) + LINK_MAX_SKEW_CYCLES >= now
+            || inbox_.load(std::memory_order_acquire) != 0;
+    });
+}
+
+uint8_t LinkPort::clock_out(uint8_t byte, uint64_t now) {
+    if (!connected()) {
+        return 0xFF;
+    }
+    discard_unwanted_data();
+    publish_clock(now);
+    wait_until(now, [&]() {
+        uint64_t stamp = peer_stamp_.load(std::memory_order_acquire);
+        return (stamp >> STAMP_CLOCK_SHIFT) >= now && static_cast<uint16_t>(stamp) == sent_count_;
+    });
+
+    int peer_byte = peer_ready_.load(std::memory_order_acquire);
+    if (peer_byte == NOT_READY || !connected()) {
+        return 0xFF;
+    }
+    // Withdraw the offer before handing over our byte: the partner can only
+    // offer again after it has received the byte
+    peer_ready_.store(NOT_READY, std::memory_order_relaxed);
+    send_data(byte, now);
+    sent_count_++;
+    transfers_++;
+    return static_cast<uint8_t>(peer_byte);
+}
+
+void LinkPort::set_ready(int byte) {
+    if (byte != ready_ && connected()) {
+        ready_ = byte;
+        send_ready(byte);
+    }
+}
+
+bool LinkPort::receive(uint64_t now, uint8_t& byte) {
+    uint64_t entry = inbox_.load(std::memory_order_acquire);
+    if (entry == 0 || (entry >> INBOX_TIME_SHIFT) > now) {
+        sync(now);
+        return false;
+    }
+    // The new count is published at the next sync point, once the game has
+    // had a chance to react (usually by offering its next byte)
+    inbox_.store(0, std::memory_order_relaxed);
+    byte = static_cast<uint8_t>(entry);
+    received_count_++;
+    // The partner already dropped our offer when it took it
+    ready_ = NOT_READY;
+    transfers_++;
+    return true;
+}
+
+void LinkPort::on_peer_data(uint8_t byte, uint64_t time) {
+    inbox_.store((time << INBOX_TIME_SHIFT) | INBOX_VALID | byte, std::memory_order_release);
+}
+
+void LinkPort::disconnect() {
+    if (connected()) {
+        send_disconnect();
+        on_peer_disconnect();
+    }
+}
+
+LinkCable::LinkCable() {
+    ends_[0].peer = &ends_[1];
+    ends_[1].peer = &ends_[0];
+}
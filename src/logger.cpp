@@ -22,10 +22,6 @@ void Logger::close() {
     }
 }
 
-bool Logger::isEnabled() {
-    return enabled;
-}
-
 void Logger::log(const std::string& func_name, uint8_t opcode,
                  uint16_t AF, uint16_t BC, uint16_t DE, uint16_t HL,
                  uint16_t SP, uint16_t PC, bool IME,
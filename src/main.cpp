@@ -1,20 +1,244 @@
 #ifndef MAIN_H_
 #define MAIN_H_
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <thread>
+#include <cstdlib>
+#include <csignal>
 #include <cstring>
-#include "../inc/game_boy_emulator.hpp"
+#include <fstream>
+#include <sstream>
+#include "../inc/cartridge.hpp"
+#include "../inc/cheats.hpp"
+#include "../inc/constants.hpp"
+#include "../inc/coverage.hpp"
+#include "../inc/cpu_stats.hpp"
+#include "../inc/debugger.hpp"
+#include "../inc/disassembler.hpp"
+#include "../inc/frame_pacer.hpp"
+#include "../inc/gameboy.hpp"
+#include "../inc/link_port.hpp"
 #include "../inc/logger.hpp"
+#include "../inc/metrics.hpp"
+#include "../inc/pcm_file_sink.hpp"
+#include "../inc/profiler.hpp"
+#include "../inc/symbol_table.hpp"
+#include "../inc/unix_socket_link.hpp"
+#include "../inc/watchpoints.hpp"
+#include <vector>
+
+// "C0A0", "C0A0-C0A3" or "C0A0+4" in hex, optionally with ":r", ":w" or ":rw"
+// (default w); hits are only logged
+static bool add_watchpoint(Watchpoints& watchpoints, const std::string& spec) {
+    size_t colon = spec.find(':');
+    std::string range = spec.substr(0, colon);
+    std::string mode = colon == std::string::npos ? "w" : spec.substr(colon + 1);
+    uint8_t access = mode == "r" ? Watchpoints::READ : mode == "w" ? Watchpoints::WRITE
+        : mode == "rw" ? Watchpoints::READ | Watchpoints::WRITE : 0;
+    char* end = nullptr;
+    unsigned long first = std::strtoul(range.c_str(), &end, 16);
+    unsigned long last = first;
+    if (*end == '-') {
+        last = std::strtoul(end + 1, &end, 16);
+    } else if (*end == '+') {
+        last = first + std::strtoul(end + 1, &end, 16) - 1;
+    }
+    if (access == 0 || range.empty() || *end != '\0' || first > 0xFFFF || last > 0xFFFF || last < first) {
+        return false;
+    }
+    watchpoints.add(static_cast<uint16_t>(first), static_cast<uint16_t>(last), access, false);
+    return true;
+}
+
+// One code per line; blank lines and text after '#' are ignored
+static bool read_cheat_file(const std::string& path, std::vector<std::string>& codes) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cout << "ERROR: Could not open cheat file " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first != std::string::npos) {
+            codes.push_back(line.substr(first, line.find_last_not_of(" \t\r") - first + 1));
+        }
+    }
+    return true;
+}
+
+// "FRAME BUTTON[+BUTTON...]" per line, or "FRAME none" to release them all;
+// blank lines and text after '#' are ignored
+static bool read_input_script(const std::string& path, GameBoy& game_boy) {
+    static const struct { const char* name; uint8_t bit; } BUTTONS[] = {
+        {"RIGHT", GameBoy::BUTTON_RIGHT}, {"LEFT", GameBoy::BUTTON_LEFT},
+        {"UP", GameBoy::BUTTON_UP}, {"DOWN", GameBoy::BUTTON_DOWN},
+        {"A", GameBoy::BUTTON_A}, {"B", GameBoy::BUTTON_B},
+        {"SELECT", GameBoy::BUTTON_SELECT}, {"START", GameBoy::BUTTON_START}
+    };
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cout << "ERROR: Could not open input file " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    for (int number = 1; std::getline(file, line); number++) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string frame;
+        std::string buttons;
+        std::string extra;
+        if (!(fields >> frame)) {
+            continue;
+        }
+        char* end = nullptr;
+        uint64_t first = std::strtoull(frame.c_str(), &end, 10);
+        uint8_t mask = 0;
+        bool valid = *end == '\0' && (fields >> buttons) && !(fields >> extra);
+        if (valid && buttons != "none") {
+            std::istringstream names(buttons);
+            std::string name;
+            while (valid && std::getline(names, name, '+')) {
+                auto button = std::find_if(std::begin(BUTTONS), std::end(BUTTONS),
+                                           [&](const auto& b) { return name == b.name; });
+                valid = button != std::end(BUTTONS);
+                mask |= valid ? button->bit : 0;
+            }
+        }
+        if (!valid) {
+            std::cout << "ERROR: Invalid input at " << path << ":" << number << std::endl;
+            return false;
+        }
+        game_boy.schedule_buttons(first, mask);
+    }
+    return true;
+}
 
 int main(int argc, char* argv[]){
     bool logging_enabled = false;
+    uint32_t run_ahead_frames = 0;
+    uint32_t rewind_seconds = 0;
+    uint64_t frame_limit = 0;
+    const char* record_path = nullptr;
+    const char* replay_path = nullptr;
+    const char* input_path = nullptr;
+    bool pacing_given = false;
+    PacingMode pacing_mode = PacingMode::RealTime;
+    double speed = 1.0;
+    uint32_t render_interval = 1;
+    const char* audio_path = nullptr;
+    bool audio_hash = false;
+    bool audio_realtime = false;
+    bool print_serial = false;
+    bool test_mode = false;
+    bool block_cache = true;
+    bool jit = false;
+    bool jit_verify = false;
+    bool exact_timing = false;
+    const char* profile_path = nullptr;
+    const char* folded_path = nullptr;
+    uint32_t profile_interval = Profiler::DEFAULT_INTERVAL;
+    const char* symbols_path = nullptr;
+    const char* stats_path = nullptr;
+    const char* metrics_file = nullptr;
+    const char* metrics_socket = nullptr;
+    bool debug = false;
+    const char* debug_socket = nullptr;
+    std::vector<std::string> watch_specs;
+    std::vector<std::string> cheat_codes;
+    const char* coverage_path = nullptr;
+    const char* cdl_path = nullptr;
+    const char* link_rom_path = nullptr;
+    const char* link_listen_path = nullptr;
+    const char* link_connect_path = nullptr;
     const char* rom_path = nullptr;
 
     // Parse arguments
     for (int i = 1; i < argc; i++) {
         if (std::strcmp(argv[i], "-l") == 0) {
             logging_enabled = true;
+        } else if (std::strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc) {
+            run_ahead_frames = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--rewind") == 0 && i + 1 < argc) {
+            rewind_seconds = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frame_limit = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            input_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            pacing_given = true;
+            pacing_mode = PacingMode::Multiplier;
+            speed = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--uncapped") == 0) {
+            pacing_given = true;
+            pacing_mode = PacingMode::Uncapped;
+        } else if (std::strcmp(argv[i], "--render-interval") == 0 && i + 1 < argc) {
+            render_interval = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--audio") == 0 && i + 1 < argc) {
+            audio_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--audio-hash") == 0) {
+            audio_hash = true;
+        } else if (std::strcmp(argv[i], "--audio-realtime") == 0) {
+            audio_realtime = true;
+        } else if (std::strcmp(argv[i], "--serial") == 0) {
+            print_serial = true;
+        } else if (std::strcmp(argv[i], "--test") == 0) {
+            test_mode = true;
+        } else if (std::strcmp(argv[i], "--no-block-cache") == 0) {
+            block_cache = false;
+        } else if (std::strcmp(argv[i], "--jit") == 0) {
+            jit = true;
+        } else if (std::strcmp(argv[i], "--jit-verify") == 0) {
+            jit = true;
+            jit_verify = true;
+        } else if (std::strcmp(argv[i], "--exact-timing") == 0) {
+            exact_timing = true;
+        } else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--profile-folded") == 0 && i + 1 < argc) {
+            folded_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--profile-interval") == 0 && i + 1 < argc) {
+            profile_interval = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--symbols") == 0 && i + 1 < argc) {
+            symbols_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            stats_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics-file") == 0 && i + 1 < argc) {
+            metrics_file = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics-socket") == 0 && i + 1 < argc) {
+            metrics_socket = argv[++i];
+        } else if (std::strcmp(argv[i], "--debug") == 0) {
+            debug = true;
+        } else if (std::strcmp(argv[i], "--debug-socket") == 0 && i + 1 < argc) {
+            debug = true;
+            debug_socket = argv[++i];
+        } else if (std::strcmp(argv[i], "--coverage") == 0 && i + 1 < argc) {
+            coverage_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--coverage-cdl") == 0 && i + 1 < argc) {
+            cdl_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--coverage-merge") == 0 && i + 2 < argc) {
+            // Offline: no emulation, the rest of the arguments are the inputs
+            return Coverage::merge_files(argv[i + 1], std::vector<std::string>(argv + i + 2, argv + argc)) ? 0 : 1;
+        } else if (std::strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            watch_specs.push_back(argv[++i]);
+        } else if (std::strcmp(argv[i], "--cheat") == 0 && i + 1 < argc) {
+            cheat_codes.push_back(argv[++i]);
+        } else if (std::strcmp(argv[i], "--cheats") == 0 && i + 1 < argc) {
+            if (!read_cheat_file(argv[++i], cheat_codes)) {
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--link") == 0 && i + 1 < argc) {
+            link_rom_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--link-listen") == 0 && i + 1 < argc) {
+            link_listen_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--link-connect") == 0 && i + 1 < argc) {
+            link_connect_path = argv[++i];
         } else {
             rom_path = argv[i];
         }
@@ -22,26 +246,281 @@ int main(int argc, char* argv[]){
 
     if (rom_path == nullptr) {
         std::cout << "ERROR: Program to execute not given" << std::endl;
-        std::cout << "Usage: gameboy [-l] <rom_file>" << std::endl;
-        std::cout << "  -l    Enable CPU logging to cpu_log.txt" << std::endl;
+        std::cout << "Usage: gameboy [options] <rom_file>" << std::endl;
+        std::cout << "  -l                Enable CPU logging to cpu_log.txt" << std::endl;
+        std::cout << "  --run-ahead N     Run N speculative frames per host frame" << std::endl;
+        std::cout << "  --rewind N        Keep N seconds of per-frame snapshots for the debugger's rewind" << std::endl;
+        std::cout << "  --frames N        Stop after N emulated frames" << std::endl;
+        std::cout << "  --record FILE     Record joypad input (from --input) to a movie file" << std::endl;
+        std::cout << "  --replay FILE     Replay a movie headless and print a state hash" << std::endl;
+        std::cout << "  --input FILE      Press buttons from given frames on (\"120 A+START\", \"130 none\" lines)" << std::endl;
+        std::cout << "  --speed N         Run at N times real time" << std::endl;
+        std::cout << "  --uncapped        Run as fast as possible (default for --replay)" << std::endl;
+        std::cout << "  --render-interval N  Compose only every Nth frame (0 = never)" << std::endl;
+        std::cout << "  --audio FILE      Write audio to a WAV (*.wav) or raw PCM file or pipe" << std::endl;
+        std::cout << "  --audio-hash      Print a hash of every second of audio" << std::endl;
+        std::cout << "  --audio-realtime  Clock audio output like a sound device and pace from it" << std::endl;
+        std::cout << "  --serial          Print bytes sent over the link port when the run ends" << std::endl;
+        std::cout << "  --test            Stop on \"Passed\"/\"Failed\" over serial; exit code 0 on pass" << std::endl;
+        std::cout << "  --no-block-cache  Fetch and decode every instruction instead of running cached blocks" << std::endl;
+        std::cout << "  --jit             Translate hot blocks to native x86-64 code" << std::endl;
+        std::cout << "  --jit-verify      Like --jit, checking every native run against the interpreter" << std::endl;
+        std::cout << "  --exact-timing    Time every memory access to its M-cycle (slower; disables --jit)" << std::endl;
+        std::cout << "  --profile FILE    Sample the guest PC and write a per-function report to FILE" << std::endl;
+        std::cout << "  --profile-folded FILE  Track call stacks and write folded stacks for flame graphs" << std::endl;
+        std::cout << "  --profile-interval N   Cycles between profiler samples (default " << Profiler::DEFAULT_INTERVAL << ")" << std::endl;
+        std::cout << "  --symbols FILE    RGBDS/no$gmb symbol file (default: the ROM's .sym if present)" << std::endl;
+        std::cout << "  --stats FILE      Write instruction counters to FILE (builds with STATS=on)" << std::endl;
+        std::cout << "  --metrics-file F  Rewrite F with a JSON snapshot of host metrics every second" << std::endl;
+        std::cout << "  --metrics-socket P  Serve the latest metrics snapshot to each client of UNIX socket P" << std::endl;
+        std::cout << "  --debug           Start stopped in the debugger, with commands on stdin (help lists them)" << std::endl;
+        std::cout << "  --debug-socket P  Like --debug, with commands from a client of UNIX socket P (not on Windows)" << std::endl;
+        std::cout << "  --coverage FILE   Record per-byte ROM coverage (opcode, operand, data) to FILE" << std::endl;
+        std::cout << "  --coverage-cdl FILE  Record ROM coverage as a code/data log (1 byte per ROM byte)" << std::endl;
+        std::cout << "  --coverage-merge OUT IN...  Merge coverage files into OUT (*.cdl for a code/data log) and exit" << std::endl;
+        std::cout << "  --watch RANGE[:r|w|rw]  Log reads/writes (default w) of RANGE (C0A0, C0A0-C0A3, C0A0+4)" << std::endl;
+        std::cout << "  --cheat CODE      Apply a Game Genie (ABC-DEF[-GHI]) or GameShark (01VVLLHH) code" << std::endl;
+        std::cout << "  --cheats FILE     Apply the codes in FILE, one per line" << std::endl;
+        std::cout << "  --link ROM        Run a second emulator with ROM on its own thread, linked by cable" << std::endl;
+        std::cout << "  --link-listen P   Link with another process through UNIX socket P (listening side; not on Windows)" << std::endl;
+        std::cout << "  --link-connect P  Link with another process through UNIX socket P (connecting side; not on Windows)" << std::endl;
+        return 1;
+    }
+    bool linked = link_rom_path != nullptr || link_listen_path != nullptr || link_connect_path != nullptr;
+    if (linked && run_ahead_frames > 0) {
+        std::cout << "ERROR: Run-ahead cannot be combined with a link cable" << std::endl;
+        return 1;
+    }
+    if (linked && rewind_seconds > 0) {
+        std::cout << "ERROR: Rewind cannot be combined with a link cable" << std::endl;
+        return 1;
+    }
+    if (input_path != nullptr && replay_path != nullptr) {
+        std::cout << "ERROR: Scripted input cannot be combined with a replay" << std::endl;
+        return 1;
+    }
+    if (debug && run_ahead_frames > 0) {
+        std::cout << "ERROR: Run-ahead cannot be combined with the debugger" << std::endl;
         return 1;
     }
 
+#ifdef CPU_STATS
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, [](int) { CpuStats::request_report(); });
+#endif
+#else
+    if (stats_path != nullptr) {
+        std::cerr << "Warning: --stats needs a build with STATS=on, ignored" << std::endl;
+    }
+#endif
+
     // Initialize logger
     Logger::init(logging_enabled);
     if (logging_enabled) {
         std::cout << "Logging enabled -> cpu_log.txt" << std::endl;
     }
 
-    GameBoyEmulator::setFilepath(rom_path);
-    GameBoyEmulator* emulator = GameBoyEmulator::getInstance();
+    // The CLI is a front end of the library like any other
+    std::unique_ptr<GameBoy> game_boy = GameBoy::create(Cartridge::read_rom_file(rom_path));
+    if (!game_boy) {
+        std::cout << "ERROR: " << rom_path << " is not a ROM this emulator can run" << std::endl;
+        return 1;
+    }
+    if (!pacing_given && (replay_path != nullptr || test_mode)) {
+        pacing_mode = PacingMode::Uncapped;
+    }
+    if (audio_path != nullptr || audio_hash) {
+        PcmFileSink::Format format = audio_path != nullptr
+            ? PcmFileSink::format_for_path(audio_path) : PcmFileSink::Format::HashOnly;
+        auto sink = std::make_unique<PcmFileSink>(audio_path ? audio_path : "", format, HOST_SAMPLE_RATE, audio_hash);
+        if (!sink->is_open()) {
+            return 1;
+        }
+        game_boy->start_audio(std::move(sink), audio_realtime);
+        if (audio_realtime && !pacing_given) {
+            pacing_mode = PacingMode::Audio;
+        }
+    }
+    game_boy->set_render_interval(render_interval);
+    game_boy->set_block_cache(block_cache);
+    game_boy->set_exact_timing(exact_timing);
+    if (profile_path != nullptr || folded_path != nullptr) {
+        game_boy->start_profiler(profile_interval, folded_path != nullptr);
+    }
+    if (coverage_path != nullptr || cdl_path != nullptr) {
+        game_boy->start_coverage();
+    }
+    // The ROM's own symbol file (game.gb -> game.sym) is used when present
+    SymbolTable symbols;
+    std::string default_symbols = std::string(rom_path).substr(0, std::string(rom_path).find_last_of('.')) + ".sym";
+    if (symbols_path != nullptr) {
+        symbols.load(symbols_path);
+    } else if (std::ifstream(default_symbols).good()) {
+        symbols.load(default_symbols);
+    }
+    game_boy->disassembler().set_symbols(&symbols);
+
+    for (const std::string& spec : watch_specs) {
+        if (!add_watchpoint(game_boy->watchpoints(), spec)) {
+            std::cout << "ERROR: Invalid watch range " << spec << std::endl;
+            return 1;
+        }
+    }
+
+    for (const std::string& code : cheat_codes) {
+        if (!game_boy->cheats().add(code)) {
+            std::cout << "ERROR: Invalid cheat code " << code << std::endl;
+            return 1;
+        }
+    }
 
-    std::thread runningProgram(&GameBoyEmulator::emulate, emulator);
+    if (jit && exact_timing) {
+        std::cerr << "Warning: --jit is not available with --exact-timing, interpreting" << std::endl;
+    } else if (jit && folded_path != nullptr) {
+        std::cerr << "Warning: --jit is not available while tracking call stacks, interpreting" << std::endl;
+    } else if (jit && debug) {
+        std::cerr << "Warning: --jit is not available with the debugger, interpreting" << std::endl;
+    } else if (jit && game_boy->coverage() != nullptr) {
+        std::cerr << "Warning: --jit is not available while recording coverage, interpreting" << std::endl;
+    } else if (jit && !watch_specs.empty()) {
+        std::cerr << "Warning: --jit is not available with watchpoints, interpreting" << std::endl;
+    } else if (jit && !game_boy->jit_available()) {
+        std::cerr << "Warning: no JIT backend for this host, interpreting" << std::endl;
+    } else if (jit && !game_boy->set_jit(true, jit_verify)) {
+        std::cerr << "Warning: --jit is not available in builds with STATS=on, interpreting" << std::endl;
+    }
+    game_boy->set_pacing(pacing_mode, speed);
+    game_boy->set_run_ahead(run_ahead_frames);
+    game_boy->set_rewind(rewind_seconds);
+    game_boy->set_frame_limit(frame_limit);
+    game_boy->set_stop_on_test_result(test_mode);
+    if (input_path != nullptr && !read_input_script(input_path, *game_boy)) {
+        return 1;
+    }
+    if (record_path != nullptr) {
+        game_boy->start_movie_recording(record_path);
+    }
+    if (replay_path != nullptr && !game_boy->start_movie_playback(replay_path)) {
+        return 1;
+    }
+    if (debug) {
+        // Ctrl-C stops the running game instead of ending the process
+        std::signal(SIGINT, [](int) { Debugger::request_break(); });
+        if (!game_boy->start_debugger(debug_socket != nullptr ? debug_socket : "", &symbols)) {
+            return 1;
+        }
+    }
 
-    runningProgram.join();
+    // Link partner: a second in-process emulator, or another process over a socket
+    LinkCable cable;
+    std::unique_ptr<GameBoy> partner;
+    std::unique_ptr<UnixSocketLink> socket_link;
+    if (link_rom_path != nullptr) {
+        partner = GameBoy::create(Cartridge::read_rom_file(link_rom_path));
+        if (!partner) {
+            std::cout << "ERROR: " << link_rom_path << " is not a ROM this emulator can run" << std::endl;
+            return 1;
+        }
+        partner->set_render_interval(render_interval);
+        partner->set_block_cache(block_cache);
+        partner->set_exact_timing(exact_timing);
+        partner->set_jit(jit, jit_verify);
+        partner->set_pacing(pacing_mode == PacingMode::Audio ? PacingMode::RealTime : pacing_mode, speed);
+        partner->set_frame_limit(frame_limit);
+        game_boy->connect_link(cable.port(0));
+        partner->connect_link(cable.port(1));
+    } else if (link_listen_path != nullptr || link_connect_path != nullptr) {
+        socket_link = link_listen_path != nullptr
+            ? std::make_unique<UnixSocketLink>(link_listen_path, UnixSocketLink::Mode::Listen)
+            : std::make_unique<UnixSocketLink>(link_connect_path, UnixSocketLink::Mode::Connect);
+        if (!socket_link->is_open()) {
+            return 1;
+        }
+        game_boy->connect_link(socket_link.get());
+    }
+
+    // Host metrics cover every emulator thread of this process
+    std::unique_ptr<MetricsPublisher> metrics;
+    if (metrics_file != nullptr || metrics_socket != nullptr) {
+        metrics = metrics_socket != nullptr
+            ? std::make_unique<MetricsPublisher>(metrics_socket, MetricsPublisher::Sink::Socket)
+            : std::make_unique<MetricsPublisher>(metrics_file, MetricsPublisher::Sink::File);
+        if (!metrics->is_open()) {
+            return 1;
+        }
+        game_boy->set_metrics_enabled(true);
+        metrics->attach(&game_boy->metrics());
+        if (partner) {
+            partner->set_metrics_enabled(true);
+            metrics->attach(&partner->metrics());
+        }
+        metrics->start();
+    }
+
+    // Each linked emulator needs its own thread; the main one runs here
+    std::thread partnerProgram;
+    if (partner) {
+        partnerProgram = std::thread(&GameBoy::emulate, partner.get());
+    }
+    game_boy->emulate();
+    if (partnerProgram.joinable()) {
+        partnerProgram.join();
+    }
+    metrics.reset();
 
     Logger::close();
 
+    if (const Profiler* profiler = game_boy->profiler()) {
+        if (profile_path != nullptr) {
+            std::ofstream report(profile_path);
+            profiler->write_report(report, symbols, game_boy->disassembler());
+            std::cout << "Profile (" << profiler->samples() << " samples) -> " << profile_path << std::endl;
+        }
+        if (folded_path != nullptr) {
+            std::ofstream folded(folded_path);
+            profiler->write_folded(folded, symbols);
+            std::cout << "Folded stacks -> " << folded_path << std::endl;
+        }
+    }
+
+    if (!watch_specs.empty()) {
+        game_boy->watchpoints().write_log(std::cout, &symbols);
+    }
+
+    if (const Coverage* coverage = game_boy->coverage()) {
+        double rom_bytes = std::max<size_t>(coverage->rom_size(), 1) / 100.0;
+        std::cout << "Coverage: " << coverage->code_bytes() / rom_bytes << "% of ROM executed, "
+                  << coverage->count(Coverage::DATA) / rom_bytes << "% read as data" << std::endl;
+        if (coverage_path != nullptr && coverage->save(coverage_path)) {
+            std::cout << "Coverage -> " << coverage_path << std::endl;
+        }
+        if (cdl_path != nullptr && coverage->write_cdl(cdl_path)) {
+            std::cout << "Code/data log -> " << cdl_path << std::endl;
+        }
+    }
+
+#ifdef CPU_STATS
+    if (stats_path != nullptr) {
+        std::ofstream stats(stats_path);
+        game_boy->cpu_stats().write_report(stats);
+        std::cout << "CPU stats -> " << stats_path << std::endl;
+    } else {
+        game_boy->cpu_stats().write_report(std::cerr);
+    }
+#endif
+
+    if (print_serial || test_mode) {
+        std::cout << "Serial: " << game_boy->serial_output() << std::endl;
+        if (partner) {
+            std::cout << "Serial (partner): " << partner->serial_output() << std::endl;
+        }
+    }
+    if (test_mode) {
+        GameBoy::TestResult result = game_boy->test_result();
+        std::cout << "Test: " << (result == GameBoy::TEST_PASSED ? "passed"
+                                  : result == GameBoy::TEST_FAILED ? "failed" : "no result") << std::endl;
+        return result == GameBoy::TEST_PASSED ? 0 : 1;
+    }
     return 0;
 
 }
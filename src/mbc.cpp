@@ -1,4 +1,5 @@
 #include "../inc/mbc.hpp"
+#include "../inc/save_state.hpp"
 
 MBC0::MBC0(vector<uint8_t>& rom, vector<uint8_t>& ram) : rom(rom), ram(ram) {}
 
@@ -19,6 +20,10 @@ uint8_t MBC0::read(uint16_t addr) { // 2 ROM banks
     return DEFAULT_READ_RETURN;
 }
 
+size_t MBC0::rom_offset(uint16_t addr) const {
+    return addr < rom.size() ? addr : SIZE_MAX;
+}
+
 void MBC0::write(uint16_t addr, uint8_t val) {
     if (addr >= SWITCHABLE_RAM_START && addr <= SWITCHABLE_RAM_END) {
         size_t offset = addr - SWITCHABLE_RAM_START;
@@ -28,6 +33,14 @@ void MBC0::write(uint16_t addr, uint8_t val) {
     }
 }
 
+void MBC0::save_state(StateWriter& writer) const {
+    writer.write_vector(ram);
+}
+
+void MBC0::load_state(StateReader& reader) {
+    reader.read_vector(ram);
+}
+
 MBC1::MBC1(vector<uint8_t>& rom, vector<uint8_t>& ram) : rom(rom), ram(ram) {
     rom_banks = rom.size() / SWITCHABLE_ROM_SIZE;
     ram_enabled = false;
@@ -79,6 +92,24 @@ uint8_t MBC1::read(uint16_t addr) {
     return DEFAULT_READ_RETURN; 
 }
 
+size_t MBC1::rom_offset(uint16_t addr) const {
+    uint8_t bank = 0;
+    if (addr <= STATIC_ROM_END) {
+        if (banking_mode == 1) {
+            bank = current_rom_bank_high << 5;
+        }
+        bank %= rom_banks;
+    } else {
+        bank = current_rom_bank_high << 5 | current_rom_bank_low;
+        bank %= rom_banks;
+        if ((bank & MBC1_ROM_BANKS_MASK) == 0) {
+            bank += 1;
+        }
+    }
+    size_t offset = bank * SWITCHABLE_ROM_SIZE + (addr & (SWITCHABLE_ROM_SIZE - 1));
+    return offset < rom.size() ? offset : SIZE_MAX;
+}
+
 void MBC1::write(uint16_t addr, uint8_t val) {
     if (addr <= RAM_ENABLE_END) {
         ram_enabled = (val & MBC1_RAM_ENABLE_MASK) == MBC1_RAM_ENABLE_ENABLED;
@@ -102,4 +133,22 @@ void MBC1::write(uint16_t addr, uint8_t val) {
             ram[offset] = val;
         }
     }
+}
+
+void MBC1::save_state(StateWriter& writer) const {
+    writer.write_vector(ram);
+    writer.write(current_rom_bank_low);
+    writer.write(current_rom_bank_high);
+    writer.write(current_ram_bank);
+    writer.write(ram_enabled);
+    writer.write(banking_mode);
+}
+
+void MBC1::load_state(StateReader& reader) {
+    reader.read_vector(ram);
+    reader.read(current_rom_bank_low);
+    reader.read(current_rom_bank_high);
+    reader.read(current_ram_bank);
+    reader.read(ram_enabled);
+    reader.read(banking_mode);
 }
\ No newline at end of file
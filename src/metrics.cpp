@@ -0,0 +1,246 @@
+#include "../inc/metrics.hpp"
+#include "../inc/constants.hpp"
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static const char* const PHASE_NAMES[ThreadMetrics::PHASE_COUNT] = {
+    "host", "cpu", "timer", "ppu", "apu", "scheduler"
+};
+
+void ThreadMetrics::record_frame(std::chrono::steady_clock::duration time, const Totals& totals) {
+    uint64_t us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(time).count());
+    size_t bucket = 0;
+    while (us > FRAME_TIME_BOUNDS_US[bucket]) {
+        bucket++;
+    }
+    bump(frame_times_[bucket], 1);
+    bump(frame_time_us_, us);
+
+    instructions_.store(totals.instructions, std::memory_order_relaxed);
+    cycles_.store(totals.cycles, std::memory_order_relaxed);
+    halted_cycles_.store(totals.halted_cycles, std::memory_order_relaxed);
+    native_instructions_.store(totals.native_instructions, std::memory_order_relaxed);
+    block_lookups_.store(totals.block_lookups, std::memory_order_relaxed);
+    block_misses_.store(totals.block_misses, std::memory_order_relaxed);
+    jit_side_exits_.store(totals.jit_side_exits, std::memory_order_relaxed);
+    // Last, so a reader that sees the frame also sees its totals
+    frames_.store(frames_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+ThreadMetrics::Totals ThreadMetrics::totals() const {
+    Totals totals;
+    totals.instructions = instructions_.load(std::memory_order_relaxed);
+    totals.cycles = cycles_.load(std::memory_order_relaxed);
+    totals.halted_cycles = halted_cycles_.load(std::memory_order_relaxed);
+    totals.native_instructions = native_instructions_.load(std::memory_order_relaxed);
+    totals.block_lookups = block_lookups_.load(std::memory_order_relaxed);
+    totals.block_misses = block_misses_.load(std::memory_order_relaxed);
+    totals.jit_side_exits = jit_side_exits_.load(std::memory_order_relaxed);
+    return totals;
+}
+
+MetricsPublisher::MetricsPublisher(const std::string& path, Sink sink)
+    : path_(path)
+    , sink_(sink) {
+    if (sink_ != Sink::Socket) {
+        return;
+    }
+#ifdef _WIN32
+    // No UNIX sockets: the publisher never opens
+    std::cerr << "Error: metrics sockets are not supported on this platform" << std::endl;
+#else
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: metrics socket path too long: " << path << std::endl;
+        return;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    socket_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());
+    if (socket_ < 0 || ::bind(socket_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+        || ::listen(socket_, 8) < 0 || ::fcntl(socket_, F_SETFL, O_NONBLOCK) < 0) {
+        std::cerr << "Error: could not listen on " << path << ": " << std::strerror(errno) << std::endl;
+        if (socket_ >= 0) {
+            ::close(socket_);
+            socket_ = -1;
+        }
+    }
+#endif
+}
+
+MetricsPublisher::~MetricsPublisher() {
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+#ifndef _WIN32
+    if (socket_ >= 0) {
+        ::close(socket_);
+        ::unlink(path_.c_str());
+    }
+#endif
+}
+
+void MetricsPublisher::attach(const ThreadMetrics* metrics) {
+    Source source = {};
+    source.metrics = metrics;
+    sources_.push_back(source);
+}
+
+void MetricsPublisher::start() {
+    for (Source& source : sources_) {
+        source.last_totals = source.metrics->totals();
+        source.last_frames = source.metrics->frames();
+        source.last_frame_time_us = source.metrics->frame_time_us();
+        for (size_t i = 0; i < source.last_buckets.size(); i++) {
+            source.last_buckets[i] = source.metrics->frame_time_bucket(i);
+        }
+    }
+    thread_ = std::thread(&MetricsPublisher::run, this);
+}
+
+void MetricsPublisher::run() {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point last_publish = Clock::now();
+    std::string latest = snapshot(0.0);
+    while (!stop_) {
+        std::this_thread::sleep_for(PHASE_SAMPLE_INTERVAL);
+        for (Source& source : sources_) {
+            source.phase_samples[source.metrics->phase()]++;
+        }
+        Clock::time_point now = Clock::now();
+        if (now - last_publish >= PUBLISH_INTERVAL) {
+            latest = snapshot(std::chrono::duration<double>(now - last_publish).count());
+            last_publish = now;
+            publish(latest);
+        }
+        if (sink_ == Sink::Socket) {
+            serve_clients(latest);
+        }
+    }
+}
+
+std::string MetricsPublisher::snapshot(double seconds) {
+    uint64_t frames = 0;
+    uint64_t frame_time_us = 0;
+    std::array<uint64_t, ThreadMetrics::FRAME_TIME_BOUNDS_US.size()> buckets = {};
+    ThreadMetrics::Totals delta = {};
+    ThreadMetrics::Totals totals = {};
+    std::array<uint64_t, ThreadMetrics::PHASE_COUNT> phases = {};
+    uint64_t phase_samples = 0;
+
+    for (Source& source : sources_) {
+        uint64_t now_frames = source.metrics->frames();  // Acquire: totals below are at least this recent
+        ThreadMetrics::Totals now = source.metrics->totals();
+        uint64_t now_frame_time = source.metrics->frame_time_us();
+        frames += now_frames - source.last_frames;
+        frame_time_us += now_frame_time - source.last_frame_time_us;
+        for (size_t i = 0; i < buckets.size(); i++) {
+            uint64_t count = source.metrics->frame_time_bucket(i);
+            buckets[i] += count - source.last_buckets[i];
+            source.last_buckets[i] = count;
+        }
+        delta.instructions += now.instructions - source.last_totals.instructions;
+        delta.cycles += now.cycles - source.last_totals.cycles;
+        delta.halted_cycles += now.halted_cycles - source.last_totals.halted_cycles;
+        delta.native_instructions += now.native_instructions - source.last_totals.native_instructions;
+        delta.block_lookups += now.block_lookups - source.last_totals.block_lookups;
+        delta.block_misses += now.block_misses - source.last_totals.block_misses;
+        delta.jit_side_exits += now.jit_side_exits - source.last_totals.jit_side_exits;
+        totals.instructions += now.instructions;
+        totals.cycles += now.cycles;
+        for (size_t i = 0; i < phases.size(); i++) {
+            phases[i] += source.phase_samples[i];
+            phase_samples += source.phase_samples[i];
+        }
+        source.phase_samples = {};
+        source.last_totals = now;
+        source.last_frames = now_frames;
+        source.last_frame_time_us = now_frame_time;
+    }
+
+    auto rate = [seconds](double value) { return seconds > 0.0 ? value / seconds : 0.0; };
+    auto share = [](uint64_t part, uint64_t whole) { return whole > 0 ? static_cast<double>(part) / whole : 0.0; };
+
+    std::ostringstream json;
+    json.precision(4);
+    json << std::fixed;
+    json << "{\"time\": " << static_cast<uint64_t>(std::time(nullptr))
+         << ", \"interval_seconds\": " << seconds
+         << ", \"instances\": " << sources_.size()
+         << ", \"frames_per_second\": " << rate(static_cast<double>(frames))
+         << ", \"emulated_mips\": " << rate(delta.instructions / 1e6)
+         << ", \"emulated_speed\": " << rate(static_cast<double>(delta.cycles) / DMG_CLOCK_SPEED)
+         << ", \"frame_time_us\": {\"average\": " << (frames > 0 ? static_cast<double>(frame_time_us) / frames : 0.0)
+         << ", \"histogram\": [";
+    for (size_t i = 0; i < buckets.size(); i++) {
+        json << (i > 0 ? ", " : "") << "{\"le\": ";
+        if (ThreadMetrics::FRAME_TIME_BOUNDS_US[i] == UINT32_MAX) {
+            json << "\"inf\"";
+        } else {
+            json << ThreadMetrics::FRAME_TIME_BOUNDS_US[i];
+        }
+        json << ", \"count\": " << buckets[i] << "}";
+    }
+    json << "]}, \"time_share\": {";
+    for (size_t i = 0; i < phases.size(); i++) {
+        json << (i > 0 ? ", " : "") << "\"" << PHASE_NAMES[i] << "\": " << share(phases[i], phase_samples);
+    }
+    json << "}, \"halt_idle\": " << share(delta.halted_cycles, delta.cycles)
+         << ", \"block_cache_hit_rate\": " << share(delta.block_lookups - delta.block_misses, delta.block_lookups)
+         << ", \"jit\": {\"native_instruction_share\": " << share(delta.native_instructions, delta.instructions)
+         << ", \"side_exits_per_second\": " << rate(static_cast<double>(delta.jit_side_exits))
+         << "}, \"totals\": {\"instructions\": " << totals.instructions << ", \"cycles\": " << totals.cycles
+         << "}}\n";
+    return json.str();
+}
+
+void MetricsPublisher::publish(const std::string& json) {
+    if (sink_ != Sink::File) {
+        return;
+    }
+    // Readers never see a partly written file
+    std::string temporary = path_ + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::trunc);
+        file << json;
+        if (!file) {
+            return;
+        }
+    }
+    std::rename(temporary.c_str(), path_.c_str());
+}
+
+void MetricsPublisher::serve_clients(const std::string& json) {
+#ifdef _WIN32
+    (void)json;
+#else
+    while (true) {
+        int client = ::accept(socket_, nullptr, nullptr);
+        if (client < 0) {
+            return;  // EAGAIN: nobody waiting
+        }
+        size_t sent = 0;
+        while (sent < json.size()) {
+            ssize_t n = ::send(client, json.data() + sent, json.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        ::close(client);
+    }
+#endif
+}
@@ -1,20 +1,69 @@
 #include "../inc/mmu.hpp"
+#include "../inc/apu.hpp"
+#include "../inc/block_cache.hpp"
+#include "../inc/cheats.hpp"
+#include "../inc/interrupt_controller.hpp"
+#include "../inc/joypad.hpp"
+#include "../inc/ppu.hpp"
+#include "../inc/save_state.hpp"
+#include "../inc/serial.hpp"
+#include "../inc/timer.hpp"
+#include "../inc/watchpoints.hpp"
 
-MMU::MMU(std::string file_path)
-    : cartridge(file_path),
-      vram(VRAM_SIZE, 0),
+MMU::MMU(std::vector<uint8_t> rom, InterruptController* interrupt_controller, Timer* timer, Joypad* joypad, Serial* serial, PPU* ppu, APU* apu)
+    : interrupt_controller(interrupt_controller),
+      timer(timer),
+      joypad(joypad),
+      serial(serial),
+      ppu(ppu),
+      apu(apu),
+      cartridge(std::move(rom)),
       wram(INTERNAL_RAM_SIZE, 0),
-      oam(SPRITE_ATTRIBUTES_SIZE, 0),
-      hram(HIGH_RAM_SIZE, 0)
-    {}
+      hram(HIGH_RAM_SIZE, 0) {
+    map_pages();
+}
 
-uint8_t MMU::read_memory_8(uint16_t addr) const {
-    
+uint8_t MMU::read_slow(uint16_t addr) const {
+    // HRAM shares page FF with I/O, so it is never page-mapped; skip the region walk
+    if (addr >= HIGH_RAM_START && addr <= HIGH_RAM_END && !(watchpoints && is_watched(addr))) {
+        return hram[addr - HIGH_RAM_START];
+    }
+    uint8_t value = read_mapped(addr);
+    if (coverage && addr <= SWITCHABLE_ROM_END) {
+        coverage->mark(Coverage::DATA, mapped_rom_offset(addr));
+    }
+    if (watchpoints && is_watched(addr)) {
+        watchpoints->on_access(addr, value, false);
+    }
+    return value;
+}
+
+void MMU::write_slow(uint16_t addr, uint8_t val) {
+    if (watchpoints && is_watched(addr)) {
+        watchpoints->on_access(addr, val, true);
+    }
+    if (addr >= HIGH_RAM_START && addr <= HIGH_RAM_END) {
+        hram[addr - HIGH_RAM_START] = val;
+        if (block_cache && block_cache->is_code_page(addr)) {
+            block_cache->invalidate(addr);
+        }
+        return;
+    }
+    write_mapped(addr, val);
+}
+
+uint8_t MMU::read_mapped(uint16_t addr) const {
     if (addr <= SWITCHABLE_ROM_END) {
+        if (cheats) {
+            size_t offset = mapped_rom_offset(addr);
+            if (const uint8_t* page = offset != SIZE_MAX ? cheats->patched_page(offset >> PAGE_SHIFT) : nullptr) {
+                return page[addr & (PAGE_SIZE - 1)];
+            }
+        }
         return cartridge.read8(addr);
     }
     else if (addr <= VRAM_END) {
-        return vram[addr - VRAM_START]; // TODO
+        return ppu->read_vram(addr);
     }
     else if (addr <= SWITCHABLE_RAM_END) {
         return cartridge.read8(addr);
@@ -24,54 +73,241 @@ uint8_t MMU::read_memory_8(uint16_t addr) const {
     }
     else if (addr <= SPRITE_ATTRIBUTES_END) {
         if (addr >= SPRITE_ATTRIBUTES_START) {
-            return oam[addr - SPRITE_ATTRIBUTES_START]; // TODO
+            return ppu->read_oam(addr);
         }
     }
     else if (addr <= I_O_END) {
         if (addr >= I_O_START) {
-            // TODO Timer, Interrupt Controller
+            return read_io(addr);
         }
     }
     else if (addr <= HIGH_RAM_END) {
         if (addr >= HIGH_RAM_START) {
-            return hram[addr - HIGH_RAM_START]; // TODO
+            return hram[addr - HIGH_RAM_START];
         }
     }
     else if (addr == INTERRUPT_REGISTER_ADDR) {
-        // TODO
+        return interrupt_controller->read_interrupt(IE_REGISTER_LOCATION);
     }
     return DEFAULT_READ_RETURN;
 }
 
-void MMU::write_memory_8(uint16_t addr, uint8_t val) {
+void MMU::write_mapped(uint16_t addr, uint8_t val) {
     if (addr <= SWITCHABLE_ROM_END) {
         cartridge.write8(addr, val);
+        map_rom_pages(false);
+        if (block_cache) {
+            block_cache->mapping_changed();
+        }
     }
     else if (addr <= VRAM_END) {
-        vram[addr - VRAM_START] = val; // TODO
+        ppu->write_vram(addr, val);
     }
     else if (addr <= SWITCHABLE_RAM_END) {
         cartridge.write8(addr, val);
     }
     else if (addr <= INTERNAL_RAM_END) {
         wram[addr - INTERNAL_RAM_START] = val;
+        if (block_cache && block_cache->is_code_page(addr)) {
+            block_cache->invalidate(addr);
+        }
     }
     else if (addr <= SPRITE_ATTRIBUTES_END) {
         if (addr >= SPRITE_ATTRIBUTES_START) {
-            oam[addr - SPRITE_ATTRIBUTES_START] = val; // TODO
+            ppu->write_oam(addr, val);
         }
     }
     else if (addr <= I_O_END) {
         if (addr >= I_O_START) {
-            // TODO Timer, Interrupt Controller
+            write_io(addr, val);
         }
     }
     else if (addr <= HIGH_RAM_END) {
         if (addr >= HIGH_RAM_START) {
-            hram[addr - HIGH_RAM_START] = val; // TODO
+            hram[addr - HIGH_RAM_START] = val;
+            if (block_cache && block_cache->is_code_page(addr)) {
+                block_cache->invalidate(addr);
+            }
         }
     }
     else if (addr == INTERRUPT_REGISTER_ADDR) {
-        // TODO
+        interrupt_controller->write_interrupt(IE_REGISTER_LOCATION, val);
+    }
+}
+
+uint8_t MMU::read_io(uint16_t addr) const {
+    switch (addr) {
+        case JOYPAD_REGISTER_LOCATION:
+            return joypad->read_joypad();
+        case SB_REGISTER_LOCATION:
+        case SC_REGISTER_LOCATION:
+            return serial->read_register(addr);
+        case DIV_REGISTER_LOCATION:
+        case TIMA_REGISTER_LOCATION:
+        case TMA_REGISTER_LOCATION:
+        case TAC_REGISTER_LOCATION:
+            return timer->read_timer(addr);
+        case IF_REGISTER_LOCATION:
+            return interrupt_controller->read_interrupt(addr);
+        case DMA_REGISTER_LOCATION:
+            return dma_register;
+        case LCDC_REGISTER_LOCATION:
+        case STAT_REGISTER_LOCATION:
+        case SCY_REGISTER_LOCATION:
+        case SCX_REGISTER_LOCATION:
+        case LY_REGISTER_LOCATION:
+        case LYC_REGISTER_LOCATION:
+        case BGP_REGISTER_LOCATION:
+        case OBP0_REGISTER_LOCATION:
+        case OBP1_REGISTER_LOCATION:
+        case WY_REGISTER_LOCATION:
+        case WX_REGISTER_LOCATION:
+            return ppu->read_register(addr);
+        default:
+            if (addr >= SOUND_REGISTERS_START && addr <= WAVE_RAM_END) {
+                return apu->read_register(addr);
+            }
+            return DEFAULT_READ_RETURN;
+    }
+}
+
+void MMU::write_io(uint16_t addr, uint8_t val) {
+    switch (addr) {
+        case JOYPAD_REGISTER_LOCATION:
+            joypad->write_joypad(val);
+            break;
+        case SB_REGISTER_LOCATION:
+        case SC_REGISTER_LOCATION:
+            serial->write_register(addr, val);
+            break;
+        case DIV_REGISTER_LOCATION:
+        case TIMA_REGISTER_LOCATION:
+        case TMA_REGISTER_LOCATION:
+        case TAC_REGISTER_LOCATION:
+            timer->write_timer(addr, val);
+            break;
+        case IF_REGISTER_LOCATION:
+            interrupt_controller->write_interrupt(addr, val);
+            break;
+        case DMA_REGISTER_LOCATION:
+            oam_dma(val);
+            break;
+        case LCDC_REGISTER_LOCATION:
+        case STAT_REGISTER_LOCATION:
+        case SCY_REGISTER_LOCATION:
+        case SCX_REGISTER_LOCATION:
+        case LY_REGISTER_LOCATION:
+        case LYC_REGISTER_LOCATION:
+        case BGP_REGISTER_LOCATION:
+        case OBP0_REGISTER_LOCATION:
+        case OBP1_REGISTER_LOCATION:
+        case WY_REGISTER_LOCATION:
+        case WX_REGISTER_LOCATION:
+            ppu->write_register(addr, val);
+            break;
+        default:
+            if (addr >= SOUND_REGISTERS_START && addr <= WAVE_RAM_END) {
+                apu->write_register(addr, val);
+            }
+            break;
     }
+}
+
+void MMU::oam_dma(uint8_t page) {
+    dma_register = page;
+    uint16_t source = static_cast<uint16_t>(page) << 8;
+    for (uint16_t i = 0; i < SPRITE_ATTRIBUTES_SIZE; i++) {
+        uint16_t addr = static_cast<uint16_t>(source + i);
+        if (coverage && addr <= SWITCHABLE_ROM_END) {
+            coverage->mark(Coverage::DATA, mapped_rom_offset(addr));
+        }
+        ppu->write_oam(SPRITE_ATTRIBUTES_START + i, peek_memory_8(addr));
+    }
+}
+
+void MMU::map_pages() {
+    read_pages.fill(nullptr);
+    write_pages.fill(nullptr);
+    for (uint32_t page = INTERNAL_RAM_START >> PAGE_SHIFT; page <= INTERNAL_RAM_END >> PAGE_SHIFT; page++) {
+        if (!is_watched(static_cast<uint16_t>(page << PAGE_SHIFT))) {
+            uint8_t* data = wram.data() + (page << PAGE_SHIFT) - INTERNAL_RAM_START;
+            read_pages[page] = data;
+            write_pages[page] = data;
+        }
+    }
+    map_rom_pages(true);
+}
+
+void MMU::map_rom_pages(bool all) {
+    // Banks are contiguous in the image, so each half maps from one offset
+    static const uint16_t HALVES[2] = {STATIC_ROM_START, SWITCHABLE_ROM_START};
+    for (size_t half = 0; half < 2; half++) {
+        size_t offset = cartridge.rom_offset(HALVES[half]);
+        if (!all && offset == mapped_rom_offsets[half]) {
+            continue;
+        }
+        mapped_rom_offsets[half] = offset;
+        bool in_image = offset != SIZE_MAX && offset + SWITCHABLE_ROM_SIZE <= cartridge.rom_size();
+        for (uint32_t i = 0; i < SWITCHABLE_ROM_SIZE >> PAGE_SHIFT; i++) {
+            uint16_t addr = static_cast<uint16_t>(HALVES[half] + (i << PAGE_SHIFT));
+            bool mapped = in_image && !coverage && !is_watched(addr);
+            const uint8_t* data = mapped ? cartridge.rom_data() + offset + (i << PAGE_SHIFT) : nullptr;
+            if (mapped && cheats) {
+                if (const uint8_t* patched = cheats->patched_page((offset >> PAGE_SHIFT) + i)) {
+                    data = patched;
+                }
+            }
+            read_pages[addr >> PAGE_SHIFT] = data;
+        }
+    }
+}
+
+void MMU::set_coverage(Coverage* coverage) {
+    this->coverage = coverage;
+    map_pages();
+}
+
+void MMU::set_cheats(const Cheats* cheats) {
+    this->cheats = cheats;
+    map_pages();
+}
+
+void MMU::set_watchpoints(Watchpoints* watchpoints, const std::array<uint64_t, 4>& pages) {
+    this->watchpoints = watchpoints;
+    watched_pages = watchpoints ? pages : std::array<uint64_t, 4>{};
+    map_pages();
+}
+
+uint8_t MMU::rom_byte(size_t offset) const {
+    if (offset >= cartridge.rom_size()) {
+        return DEFAULT_READ_RETURN;
+    }
+    const uint8_t* page = cheats ? cheats->patched_page(offset >> PAGE_SHIFT) : nullptr;
+    return page ? page[offset & (PAGE_SIZE - 1)] : cartridge.rom_data()[offset];
+}
+
+uint16_t MMU::bank_of(uint16_t addr) const {
+    if (addr <= SWITCHABLE_ROM_END) {
+        size_t offset = cartridge.rom_offset(addr);
+        return offset == SIZE_MAX ? 0 : static_cast<uint16_t>(offset / SWITCHABLE_ROM_SIZE);
+    }
+    if (addr >= INTERNAL_RAM_START + INTERNAL_RAM_SIZE / 2 && addr <= INTERNAL_RAM_END) {
+        return 1;
+    }
+    return 0;
+}
+
+void MMU::save_state(StateWriter& writer) const {
+    cartridge.save_state(writer);
+    writer.write_vector(wram);
+    writer.write_vector(hram);
+    writer.write(dma_register);
+}
+
+void MMU::load_state(StateReader& reader) {
+    cartridge.load_state(reader);
+    reader.read_vector(wram);
+    reader.read_vector(hram);
+    reader.read(dma_register);
+    map_pages();
 }
\ No newline at end of file
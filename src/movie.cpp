@@ -0,0 +1,79 @@
+#include "../inc/movie.hpp"
+#include "../inc/constants.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+template <typename T>
+static void write_field(std::ofstream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool read_field(std::ifstream& file, T& value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+Movie::Movie(uint64_t rom_hash)
+    : rom_hash_(rom_hash)
+    , emulator_version_(EMULATOR_VERSION) {}
+
+bool Movie::load(const std::string& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: could not open movie " << path << std::endl;
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint16_t version = 0;
+    char emulator_version[VERSION_FIELD_SIZE] = {};
+    uint32_t frames = 0;
+    if (!read_field(file, magic) || !read_field(file, version)
+        || !file.read(emulator_version, VERSION_FIELD_SIZE)
+        || !read_field(file, rom_hash_) || !read_field(file, frames)) {
+        std::cerr << "Error: movie header is truncated" << std::endl;
+        return false;
+    }
+    if (magic != MAGIC || version != FORMAT_VERSION) {
+        std::cerr << "Error: unsupported movie format" << std::endl;
+        return false;
+    }
+
+    emulator_version_.assign(emulator_version, strnlen(emulator_version, VERSION_FIELD_SIZE));
+    inputs_.resize(frames);
+    if (!file.read(reinterpret_cast<char*>(inputs_.data()), frames)) {
+        std::cerr << "Error: movie input data is truncated" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Movie::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: could not write movie " << path << std::endl;
+        return false;
+    }
+
+    char emulator_version[VERSION_FIELD_SIZE] = {};
+    emulator_version_.copy(emulator_version, VERSION_FIELD_SIZE);
+
+    write_field(file, MAGIC);
+    write_field(file, FORMAT_VERSION);
+    file.write(emulator_version, VERSION_FIELD_SIZE);
+    write_field(file, rom_hash_);
+    write_field(file, static_cast<uint32_t>(inputs_.size()));
+    file.write(reinterpret_cast<const char*>(inputs_.data()), inputs_.size());
+    return static_cast<bool>(file);
+}
+
+uint8_t Movie::input_for_frame(uint64_t frame) const {
+    return frame < inputs_.size() ? inputs_[frame] : 0x00;
+}
+
+void Movie::record_frame(uint64_t frame, uint8_t buttons) {
+    // Rewind may revisit a frame, which discards everything recorded after it
+    inputs_.resize(frame + 1, 0x00);
+    inputs_[frame] = buttons;
+}
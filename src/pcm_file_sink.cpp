@@ -0,0 +1,190 @@
+#include "../inc/pcm_file_sink.hpp"
+#include "../inc/hash.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+static const uint32_t WAV_HEADER_SIZE = 44;
+static const uint16_t PCM_CHANNELS = 2;
+static const uint16_t PCM_BITS = 16;
+static const uint32_t BYTES_PER_FRAME = PCM_CHANNELS * PCM_BITS / 8;
+
+static void put_u16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void put_u32(uint8_t* out, uint32_t value) {
+    put_u16(out, static_cast<uint16_t>(value));
+    put_u16(out + 2, static_cast<uint16_t>(value >> 16));
+}
+
+PcmFileSink::PcmFileSink(const std::string& path, Format format, uint32_t sample_rate, bool print_hashes)
+    : format_(format)
+    , sample_rate_(sample_rate)
+    , print_hashes_(print_hashes)
+    , blocks_(BLOCK_COUNT)
+    , second_hash_(FNV1A_64_OFFSET)
+    , total_hash_(FNV1A_64_OFFSET) {
+    if (format_ != Format::HashOnly) {
+        file_.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file_.is_open()) {
+            std::cerr << "Error: could not open audio output " << path << std::endl;
+        } else if (format_ == Format::Wav) {
+            // Sizes are patched on close; a pipe keeps the streaming placeholder
+            write_wav_header(0xFFFFFFFF - WAV_HEADER_SIZE + 8);
+        }
+    }
+
+    for (size_t i = 0; i < BLOCK_COUNT; i++) {
+        blocks_[i].samples.resize(BLOCK_FRAMES * PCM_CHANNELS);
+        blocks_[i].frames = 0;
+        free_blocks_.push(i);
+    }
+    second_hashes_.reserve(3600);
+    writer_ = std::thread(&PcmFileSink::writer_loop, this);
+}
+
+PcmFileSink::~PcmFileSink() {
+    close();
+}
+
+PcmFileSink::Format PcmFileSink::format_for_path(const std::string& path) {
+    std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".wav" ? Format::Wav : Format::Raw;
+}
+
+void PcmFileSink::write_wav_header(uint32_t data_bytes) {
+    uint8_t header[WAV_HEADER_SIZE];
+    std::memcpy(header, "RIFF", 4);
+    put_u32(header + 4, data_bytes + WAV_HEADER_SIZE - 8);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    put_u32(header + 16, 16);
+    put_u16(header + 20, 1);  // PCM
+    put_u16(header + 22, PCM_CHANNELS);
+    put_u32(header + 24, sample_rate_);
+    put_u32(header + 28, sample_rate_ * BYTES_PER_FRAME);
+    put_u16(header + 32, static_cast<uint16_t>(BYTES_PER_FRAME));
+    put_u16(header + 34, PCM_BITS);
+    std::memcpy(header + 36, "data", 4);
+    put_u32(header + 40, data_bytes);
+    file_.write(reinterpret_cast<const char*>(header), WAV_HEADER_SIZE);
+}
+
+void PcmFileSink::write(const int16_t* frames, size_t count) {
+    while (count > 0) {
+        if (!have_current_) {
+            // Waiting here only holds up the audio thread, never emulation
+            std::unique_lock<std::mutex> lock(mutex_);
+            block_freed_.wait(lock, [this]() { return free_blocks_.size > 0; });
+            current_ = free_blocks_.pop();
+            blocks_[current_].frames = 0;
+            have_current_ = true;
+        }
+        Block& block = blocks_[current_];
+        size_t chunk = std::min(count, BLOCK_FRAMES - block.frames);
+        std::memcpy(&block.samples[block.frames * PCM_CHANNELS], frames, chunk * BYTES_PER_FRAME);
+        block.frames += chunk;
+        frames += chunk * PCM_CHANNELS;
+        count -= chunk;
+        if (block.frames == BLOCK_FRAMES) {
+            submit_current();
+        }
+    }
+}
+
+void PcmFileSink::submit_current() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        full_blocks_.push(current_);
+    }
+    have_current_ = false;
+    block_filled_.notify_one();
+}
+
+void PcmFileSink::writer_loop() {
+    while (true) {
+        size_t index = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            block_filled_.wait(lock, [this]() { return full_blocks_.size > 0 || closing_; });
+            if (full_blocks_.size == 0) {
+                return;
+            }
+            index = full_blocks_.pop();
+        }
+        consume(blocks_[index]);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_blocks_.push(index);
+        }
+        block_freed_.notify_one();
+    }
+}
+
+void PcmFileSink::consume(const Block& block) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(block.samples.data());
+    size_t size = block.frames * BYTES_PER_FRAME;
+    if (file_.is_open()) {
+        file_.write(reinterpret_cast<const char*>(bytes), size);
+        data_bytes_ += size;
+    }
+    total_hash_ = fnv1a_64(bytes, size, total_hash_);
+
+    size_t frames = block.frames;
+    while (frames > 0) {
+        size_t chunk = std::min(frames, sample_rate_ - frames_in_second_);
+        second_hash_ = fnv1a_64(bytes, chunk * BYTES_PER_FRAME, second_hash_);
+        bytes += chunk * BYTES_PER_FRAME;
+        frames -= chunk;
+        frames_in_second_ += chunk;
+        if (frames_in_second_ == sample_rate_) {
+            second_hashes_.push_back(second_hash_);
+            second_hash_ = FNV1A_64_OFFSET;
+            frames_in_second_ = 0;
+        }
+    }
+}
+
+void PcmFileSink::close() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    if (have_current_ && blocks_[current_].frames > 0) {
+        submit_current();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    block_filled_.notify_one();
+    writer_.join();
+
+    if (frames_in_second_ > 0) {
+        second_hashes_.push_back(second_hash_);
+    }
+    if (file_.is_open()) {
+        if (format_ == Format::Wav && data_bytes_ <= 0xFFFFFFFFULL - WAV_HEADER_SIZE) {
+            file_.seekp(0);
+            if (file_) {
+                write_wav_header(static_cast<uint32_t>(data_bytes_));
+            }
+        }
+        file_.close();
+    }
+
+    if (print_hashes_) {
+        std::cout << std::hex << std::setfill('0');
+        for (size_t i = 0; i < second_hashes_.size(); i++) {
+            std::cout << "Audio hash: second " << std::dec << i << std::hex << " "
+                      << std::setw(16) << second_hashes_[i] << std::endl;
+        }
+        std::cout << "Audio hash: total " << std::setw(16) << total_hash_
+                  << std::dec << std::setfill(' ') << std::endl;
+    }
+}
@@ -1 +1,466 @@
-#include "../inc/ppu.hpp"
\ No newline at end of file
+#include "../inc/ppu.hpp"
+#include "../inc/interrupt_controller.hpp"
+#include "../inc/save_state.hpp"
+
+// LCDC bits
+static const uint8_t LCDC_BG_ENABLE = 0x01;
+static const uint8_t LCDC_OBJ_ENABLE = 0x02;
+static const uint8_t LCDC_OBJ_SIZE = 0x04;
+static const uint8_t LCDC_BG_MAP = 0x08;
+static const uint8_t LCDC_TILE_DATA = 0x10;
+static const uint8_t LCDC_WINDOW_ENABLE = 0x20;
+static const uint8_t LCDC_WINDOW_MAP = 0x40;
+static const uint8_t LCDC_LCD_ENABLE = 0x80;
+
+// STAT bits
+static const uint8_t STAT_LYC_FLAG = 0x04;
+static const uint8_t STAT_HBLANK_INTERRUPT = 0x08;
+static const uint8_t STAT_VBLANK_INTERRUPT = 0x10;
+static const uint8_t STAT_OAM_INTERRUPT = 0x20;
+static const uint8_t STAT_LYC_INTERRUPT = 0x40;
+static const uint8_t STAT_WRITABLE_MASK = 0x78;
+
+// Sprite attribute bits
+static const uint8_t SPRITE_BG_PRIORITY = 0x80;
+static const uint8_t SPRITE_Y_FLIP = 0x40;
+static const uint8_t SPRITE_X_FLIP = 0x20;
+static const uint8_t SPRITE_PALETTE = 0x10;
+
+static const uint16_t TILE_MAP_LOW = 0x9800;
+static const uint16_t TILE_MAP_HIGH = 0x9C00;
+static const uint16_t TILE_DATA_UNSIGNED = 0x8000;
+static const uint16_t TILE_DATA_SIGNED = 0x9000;
+
+PPU::PPU(InterruptController* interrupt_controller)
+    : interrupt_controller_(interrupt_controller)
+    , vram_(VRAM_SIZE, 0)
+    , oam_(SPRITE_ATTRIBUTES_SIZE, 0)
+    , framebuffer_(SCREEN_WIDTH * SCREEN_HEIGHT, 0) {}
+
+// ============================================================================
+// Timing
+// ============================================================================
+
+void PPU::step(uint32_t cycles) {
+    if ((lcdc_ & LCDC_LCD_ENABLE) == 0) {
+        return;
+    }
+
+    line_cycles_ += cycles;
+    while (true) {
+        switch (mode_) {
+            case MODE_OAM_SCAN:
+                if (line_cycles_ < OAM_SCAN_CYCLES) {
+                    return;
+                }
+                scan_oam();
+                transfer_length_ = transfer_cycles();
+                set_mode(MODE_TRANSFER);
+                break;
+
+            case MODE_TRANSFER:
+                if (line_cycles_ < OAM_SCAN_CYCLES + transfer_length_) {
+                    return;
+                }
+                if (rendering_) {
+                    render_scanline();
+                }
+                if (window_visible()) {
+                    window_line_++;
+                }
+                set_mode(MODE_HBLANK);
+                break;
+
+            case MODE_HBLANK:
+                if (line_cycles_ < LINE_CYCLES) {
+                    return;
+                }
+                line_cycles_ -= LINE_CYCLES;
+                ly_++;
+                if (ly_ == VBLANK_START_LINE) {
+                    interrupt_controller_->request_interrupt(INTERRUPT_VBLANK_BIT);
+                    frame_complete_ = true;
+                    last_frame_rendered_ = rendering_;
+                    set_mode(MODE_VBLANK);
+                } else {
+                    set_mode(MODE_OAM_SCAN);
+                }
+                break;
+
+            case MODE_VBLANK:
+                if (line_cycles_ < LINE_CYCLES) {
+                    return;
+                }
+                line_cycles_ -= LINE_CYCLES;
+                ly_++;
+                if (ly_ == LINES_PER_FRAME) {
+                    ly_ = 0;
+                    start_frame();
+                    set_mode(MODE_OAM_SCAN);
+                } else {
+                    update_stat_line();
+                }
+                break;
+        }
+    }
+}
+
+uint32_t PPU::cycles_until_event() const {
+    if ((lcdc_ & LCDC_LCD_ENABLE) == 0) {
+        return UINT32_MAX;
+    }
+    // Leaving OAM scan never raises the STAT line, and HBLANK only does with
+    // its source enabled; the transfer length is not known before the scan
+    uint32_t end = LINE_CYCLES;
+    if (stat_ & STAT_HBLANK_INTERRUPT) {
+        if (mode_ == MODE_OAM_SCAN) {
+            end = OAM_SCAN_CYCLES + PIXEL_TRANSFER_MIN_CYCLES;
+        } else if (mode_ == MODE_TRANSFER) {
+            end = OAM_SCAN_CYCLES + transfer_length_;
+        }
+    }
+    return end > line_cycles_ ? end - line_cycles_ : 0;
+}
+
+void PPU::set_mode(Mode mode) {
+    mode_ = mode;
+    update_stat_line();
+}
+
+void PPU::update_stat_line() {
+    // The STAT interrupt fires on the rising edge of the OR of all enabled sources
+    bool line = ((stat_ & STAT_LYC_INTERRUPT) && ly_ == lyc_)
+        || ((stat_ & STAT_HBLANK_INTERRUPT) && mode_ == MODE_HBLANK)
+        || ((stat_ & STAT_VBLANK_INTERRUPT) && mode_ == MODE_VBLANK)
+        || ((stat_ & STAT_OAM_INTERRUPT) && mode_ == MODE_OAM_SCAN);
+    if (line && !stat_line_) {
+        interrupt_controller_->request_interrupt(INTERRUPT_LCD_STAT_BIT);
+    }
+    stat_line_ = line;
+}
+
+void PPU::start_frame() {
+    window_triggered_ = false;
+    window_line_ = 0;
+
+    rendering_ = render_requested_
+        || (render_interval_ != 0 && frame_counter_ % render_interval_ == 0);
+    render_requested_ = false;
+    frame_counter_++;
+}
+
+bool PPU::take_frame_complete() {
+    bool complete = frame_complete_;
+    frame_complete_ = false;
+    return complete;
+}
+
+void PPU::scan_oam() {
+    if (ly_ == wy_) {
+        window_triggered_ = true;
+    }
+
+    line_sprite_count_ = 0;
+    if ((lcdc_ & LCDC_OBJ_ENABLE) == 0) {
+        return;
+    }
+
+    int height = (lcdc_ & LCDC_OBJ_SIZE) ? 16 : 8;
+    for (uint8_t i = 0; i < SPRITE_ATTRIBUTES_SIZE / 4 && line_sprite_count_ < MAX_SPRITES_PER_LINE; i++) {
+        int top = static_cast<int>(oam_[i * 4]) - 16;
+        if (ly_ >= top && ly_ < top + height) {
+            line_sprites_[line_sprite_count_++] = i;
+        }
+    }
+}
+
+uint32_t PPU::transfer_cycles() const {
+    // Approximation of the pixel FIFO stalls: fine scroll, fetched sprites and the window restart
+    uint32_t cycles = PIXEL_TRANSFER_MIN_CYCLES + (scx_ & 0x07);
+    cycles += line_sprite_count_ * SPRITE_PENALTY_CYCLES;
+    if (window_visible()) {
+        cycles += WINDOW_PENALTY_CYCLES;
+    }
+    return cycles;
+}
+
+bool PPU::window_visible() const {
+    return (lcdc_ & LCDC_WINDOW_ENABLE) && (lcdc_ & LCDC_BG_ENABLE) && window_triggered_ && wx_ <= 166;
+}
+
+// ============================================================================
+// Rendering
+// ============================================================================
+
+uint16_t PPU::tile_row(uint16_t tile_data_base, uint8_t tile_index, uint8_t row) const {
+    uint16_t address;
+    if (tile_data_base == TILE_DATA_UNSIGNED) {
+        address = TILE_DATA_UNSIGNED + tile_index * 16;
+    } else {
+        address = TILE_DATA_SIGNED + static_cast<int8_t>(tile_index) * 16;
+    }
+    address += row * 2;
+    return static_cast<uint16_t>(read_vram(address) | (read_vram(address + 1) << 8));
+}
+
+static inline uint8_t pixel_color(uint16_t row, uint8_t bit) {
+    return static_cast<uint8_t>((((row >> 8) >> bit) & 0x01) << 1 | ((row >> bit) & 0x01));
+}
+
+void PPU::render_scanline() {
+    uint8_t* line = &framebuffer_[ly_ * SCREEN_WIDTH];
+    uint8_t color_ids[SCREEN_WIDTH] = {};
+
+    if (lcdc_ & LCDC_BG_ENABLE) {
+        render_background(line, color_ids);
+        if (window_visible()) {
+            render_window(line, color_ids);
+        }
+    } else {
+        for (uint32_t x = 0; x < SCREEN_WIDTH; x++) {
+            line[x] = 0;
+        }
+    }
+
+    if (lcdc_ & LCDC_OBJ_ENABLE) {
+        render_sprites(line, color_ids);
+    }
+}
+
+void PPU::render_background(uint8_t* line, uint8_t* color_ids) {
+    uint16_t map = (lcdc_ & LCDC_BG_MAP) ? TILE_MAP_HIGH : TILE_MAP_LOW;
+    uint16_t tile_data = (lcdc_ & LCDC_TILE_DATA) ? TILE_DATA_UNSIGNED : TILE_DATA_SIGNED;
+    uint8_t y = static_cast<uint8_t>(ly_ + scy_);
+    uint16_t map_row = map + (y / 8) * 32;
+
+    int current_tile = -1;
+    uint16_t row = 0;
+    for (uint32_t x = 0; x < SCREEN_WIDTH; x++) {
+        uint8_t bg_x = static_cast<uint8_t>(x + scx_);
+        if (bg_x / 8 != current_tile) {
+            current_tile = bg_x / 8;
+            row = tile_row(tile_data, read_vram(map_row + current_tile), y % 8);
+        }
+        uint8_t color = pixel_color(row, 7 - (bg_x % 8));
+        color_ids[x] = color;
+        line[x] = (bgp_ >> (color * 2)) & 0x03;
+    }
+}
+
+void PPU::render_window(uint8_t* line, uint8_t* color_ids) {
+    uint16_t map = (lcdc_ & LCDC_WINDOW_MAP) ? TILE_MAP_HIGH : TILE_MAP_LOW;
+    uint16_t tile_data = (lcdc_ & LCDC_TILE_DATA) ? TILE_DATA_UNSIGNED : TILE_DATA_SIGNED;
+    uint16_t map_row = map + (window_line_ / 8) * 32;
+    int start = static_cast<int>(wx_) - 7;
+
+    int current_tile = -1;
+    uint16_t row = 0;
+    for (int x = start < 0 ? 0 : start; x < static_cast<int>(SCREEN_WIDTH); x++) {
+        int window_x = x - start;
+        if (window_x / 8 != current_tile) {
+            current_tile = window_x / 8;
+            row = tile_row(tile_data, read_vram(map_row + current_tile), window_line_ % 8);
+        }
+        uint8_t color = pixel_color(row, 7 - (window_x % 8));
+        color_ids[x] = color;
+        line[x] = (bgp_ >> (color * 2)) & 0x03;
+    }
+}
+
+void PPU::render_sprites(uint8_t* line, const uint8_t* color_ids) {
+    // Lower X wins, then lower OAM index; line_sprites_ is already in OAM order
+    uint8_t order[MAX_SPRITES_PER_LINE];
+    for (uint8_t i = 0; i < line_sprite_count_; i++) {
+        uint8_t sprite = line_sprites_[i];
+        int j = i;
+        while (j > 0 && oam_[order[j - 1] * 4 + 1] > oam_[sprite * 4 + 1]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = sprite;
+    }
+
+    uint8_t sprite_color[SCREEN_WIDTH] = {};
+    uint8_t sprite_attributes[SCREEN_WIDTH] = {};
+    int height = (lcdc_ & LCDC_OBJ_SIZE) ? 16 : 8;
+
+    for (uint8_t i = 0; i < line_sprite_count_; i++) {
+        const uint8_t* sprite = &oam_[order[i] * 4];
+        int top = static_cast<int>(sprite[0]) - 16;
+        int left = static_cast<int>(sprite[1]) - 8;
+        uint8_t tile = sprite[2];
+        uint8_t attributes = sprite[3];
+
+        uint8_t sprite_y = static_cast<uint8_t>(ly_ - top);
+        if (attributes & SPRITE_Y_FLIP) {
+            sprite_y = static_cast<uint8_t>(height - 1 - sprite_y);
+        }
+        if (height == 16) {
+            tile &= 0xFE;
+        }
+        uint16_t row = tile_row(TILE_DATA_UNSIGNED, tile, sprite_y);
+
+        for (int px = 0; px < 8; px++) {
+            int x = left + px;
+            if (x < 0 || x >= static_cast<int>(SCREEN_WIDTH) || sprite_color[x] != 0) {
+                continue;
+            }
+            uint8_t bit = (attributes & SPRITE_X_FLIP) ? px : 7 - px;
+            uint8_t color = pixel_color(row, bit);
+            if (color != 0) {
+                sprite_color[x] = color;
+                sprite_attributes[x] = attributes;
+            }
+        }
+    }
+
+    for (uint32_t x = 0; x < SCREEN_WIDTH; x++) {
+        if (sprite_color[x] == 0) {
+            continue;
+        }
+        if ((sprite_attributes[x] & SPRITE_BG_PRIORITY) && color_ids[x] != 0) {
+            continue;
+        }
+        uint8_t palette = (sprite_attributes[x] & SPRITE_PALETTE) ? obp1_ : obp0_;
+        line[x] = (palette >> (sprite_color[x] * 2)) & 0x03;
+    }
+}
+
+// ============================================================================
+// Registers
+// ============================================================================
+
+uint8_t PPU::read_register(uint16_t address) const {
+    switch (address) {
+        case LCDC_REGISTER_LOCATION:
+            return lcdc_;
+        case STAT_REGISTER_LOCATION: {
+            uint8_t mode = (lcdc_ & LCDC_LCD_ENABLE) ? mode_ : MODE_HBLANK;
+            return 0x80 | stat_ | (ly_ == lyc_ ? STAT_LYC_FLAG : 0x00) | mode;
+        }
+        case SCY_REGISTER_LOCATION:
+            return scy_;
+        case SCX_REGISTER_LOCATION:
+            return scx_;
+        case LY_REGISTER_LOCATION:
+            return ly_;
+        case LYC_REGISTER_LOCATION:
+            return lyc_;
+        case BGP_REGISTER_LOCATION:
+            return bgp_;
+        case OBP0_REGISTER_LOCATION:
+            return obp0_;
+        case OBP1_REGISTER_LOCATION:
+            return obp1_;
+        case WY_REGISTER_LOCATION:
+            return wy_;
+        case WX_REGISTER_LOCATION:
+            return wx_;
+        default:
+            return 0xFF;
+    }
+}
+
+void PPU::write_register(uint16_t address, uint8_t value) {
+    switch (address) {
+        case LCDC_REGISTER_LOCATION: {
+            bool was_enabled = lcdc_ & LCDC_LCD_ENABLE;
+            lcdc_ = value;
+            if (was_enabled && !(value & LCDC_LCD_ENABLE)) {
+                ly_ = 0;
+                line_cycles_ = 0;
+                mode_ = MODE_HBLANK;
+                stat_line_ = false;
+            } else if (!was_enabled && (value & LCDC_LCD_ENABLE)) {
+                start_frame();
+                set_mode(MODE_OAM_SCAN);
+            }
+            break;
+        }
+        case STAT_REGISTER_LOCATION:
+            stat_ = value & STAT_WRITABLE_MASK;
+            update_stat_line();
+            break;
+        case SCY_REGISTER_LOCATION:
+            scy_ = value;
+            break;
+        case SCX_REGISTER_LOCATION:
+            scx_ = value;
+            break;
+        case LYC_REGISTER_LOCATION:
+            lyc_ = value;
+            update_stat_line();
+            break;
+        case BGP_REGISTER_LOCATION:
+            bgp_ = value;
+            break;
+        case OBP0_REGISTER_LOCATION:
+            obp0_ = value;
+            break;
+        case OBP1_REGISTER_LOCATION:
+            obp1_ = value;
+            break;
+        case WY_REGISTER_LOCATION:
+            wy_ = value;
+            break;
+        case WX_REGISTER_LOCATION:
+            wx_ = value;
+            break;
+        default:
+            break; // LY is read only
+    }
+}
+
+// ============================================================================
+// Save states
+// ============================================================================
+
+void PPU::save_state(StateWriter& writer) const {
+    writer.write_vector(vram_);
+    writer.write_vector(oam_);
+    writer.write(lcdc_);
+    writer.write(stat_);
+    writer.write(scy_);
+    writer.write(scx_);
+    writer.write(ly_);
+    writer.write(lyc_);
+    writer.write(bgp_);
+    writer.write(obp0_);
+    writer.write(obp1_);
+    writer.write(wy_);
+    writer.write(wx_);
+    writer.write(mode_);
+    writer.write(line_cycles_);
+    writer.write(transfer_length_);
+    writer.write(stat_line_);
+    writer.write(window_triggered_);
+    writer.write(window_line_);
+    writer.write(line_sprites_);
+    writer.write(line_sprite_count_);
+    writer.write(frame_complete_);
+}
+
+void PPU::load_state(StateReader& reader) {
+    reader.read_vector(vram_);
+    reader.read_vector(oam_);
+    reader.read(lcdc_);
+    reader.read(stat_);
+    reader.read(scy_);
+    reader.read(scx_);
+    reader.read(ly_);
+    reader.read(lyc_);
+    reader.read(bgp_);
+    reader.read(obp0_);
+    reader.read(obp1_);
+    reader.read(wy_);
+    reader.read(wx_);
+    reader.read(mode_);
+    reader.read(line_cycles_);
+    reader.read(transfer_length_);
+    reader.read(stat_line_);
+    reader.read(window_triggered_);
+    reader.read(window_line_);
+    reader.read(line_sprites_);
+    reader.read(line_sprite_count_);
+    reader.read(frame_complete_);
+}
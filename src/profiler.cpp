@@ -0,0 +1,151 @@
+#include "../inc/profiler.hpp"
+#include "../inc/disassembler.hpp"
+#include "../inc/mmu.hpp"
+#include "../inc/symbol_table.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <set>
+
+Profiler::Profiler(const MMU* mmu, bool call_stacks)
+    : mmu_(mmu)
+    , call_stacks_(call_stacks) {
+    nodes_.push_back({ROOT, 0});
+}
+
+uint32_t Profiler::location(uint16_t address) const {
+    return static_cast<uint32_t>(mmu_->bank_of(address)) << 16 | address;
+}
+
+void Profiler::sample(uint16_t pc) {
+    uint32_t at = location(pc);
+    samples_++;
+    pc_samples_[at]++;
+    if (call_stacks_) {
+        uint64_t node = resolve_stack();
+        stack_samples_[node << 32 | at]++;
+    }
+}
+
+uint32_t Profiler::resolve_stack() {
+    // Frames below the first unresolved one were interned by an earlier sample
+    size_t first = frames_.size();
+    while (first > 0 && frames_[first - 1].node == UNRESOLVED) {
+        first--;
+    }
+    uint32_t parent = first > 0 ? frames_[first - 1].node : ROOT;
+    for (size_t i = first; i < frames_.size(); i++) {
+        uint64_t child = static_cast<uint64_t>(parent) << 32 | frames_[i].location;
+        auto [it, inserted] = children_.emplace(child, static_cast<uint32_t>(nodes_.size()));
+        if (inserted) {
+            nodes_.push_back({parent, frames_[i].location});
+        }
+        frames_[i].node = it->second;
+        parent = it->second;
+    }
+    return parent;
+}
+
+std::string Profiler::frame_name(uint32_t location, const SymbolTable& symbols) const {
+    uint16_t bank = static_cast<uint16_t>(location >> 16);
+    uint16_t address = static_cast<uint16_t>(location);
+    const SymbolTable::Symbol* symbol = symbols.lookup(bank, address);
+    return symbol != nullptr ? symbol->name : SymbolTable::location(bank, address);
+}
+
+std::string Profiler::function_name(uint32_t node, uint32_t pc, const SymbolTable& symbols) const {
+    const SymbolTable::Symbol* symbol = symbols.lookup(static_cast<uint16_t>(pc >> 16), static_cast<uint16_t>(pc));
+    if (symbol != nullptr) {
+        return symbol->name;
+    }
+    return frame_name(node != ROOT ? nodes_[node].location : pc, symbols);
+}
+
+std::vector<std::string> Profiler::stack_names(uint32_t node, uint32_t pc, const SymbolTable& symbols) const {
+    std::vector<std::string> names;
+    for (uint32_t n = node; n != ROOT; n = nodes_[n].parent) {
+        names.push_back(frame_name(nodes_[n].location, symbols));
+    }
+    std::reverse(names.begin(), names.end());
+    std::string leaf = function_name(node, pc, symbols);
+    if (names.empty() || names.back() != leaf) {
+        names.push_back(leaf);
+    }
+    return names;
+}
+
+void Profiler::write_report(std::ostream& out, const SymbolTable& symbols, Disassembler& disassembler,
+                            size_t hot_spots) const {
+    std::map<std::string, uint64_t> self;
+    std::map<std::string, uint64_t> total;
+    if (call_stacks_) {
+        for (const auto& [key, count] : stack_samples_) {
+            std::vector<std::string> names = stack_names(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key), symbols);
+            self[names.back()] += count;
+            // Recursive functions count once per sample
+            for (const std::string& name : std::set<std::string>(names.begin(), names.end())) {
+                total[name] += count;
+            }
+        }
+    } else {
+        for (const auto& [pc, count] : pc_samples_) {
+            self[function_name(ROOT, pc, symbols)] += count;
+        }
+    }
+
+    auto percent = [this](uint64_t count) { return samples_ > 0 ? 100.0 * count / samples_ : 0.0; };
+    out << "Samples: " << samples_ << std::endl;
+    out << std::endl << "Functions by self samples:" << std::endl;
+    std::vector<std::pair<std::string, uint64_t>> functions(self.begin(), self.end());
+    std::stable_sort(functions.begin(), functions.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+    out << std::fixed << std::setprecision(2);
+    for (const auto& [name, count] : functions) {
+        out << std::setw(7) << percent(count) << "% " << std::setw(10) << count;
+        if (call_stacks_) {
+            out << "  total " << std::setw(7) << percent(total[name]) << "%";
+        }
+        out << "  " << name << std::endl;
+    }
+
+    out << std::endl << "Hot spots:" << std::endl;
+    std::vector<std::pair<uint32_t, uint64_t>> spots(pc_samples_.begin(), pc_samples_.end());
+    std::sort(spots.begin(), spots.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    spots.resize(std::min(spots.size(), hot_spots));
+    for (const auto& [pc, count] : spots) {
+        uint16_t bank = static_cast<uint16_t>(pc >> 16);
+        uint16_t address = static_cast<uint16_t>(pc);
+        out << std::setw(7) << percent(count) << "% " << std::setw(10) << count
+            << "  " << SymbolTable::location(bank, address) << "  ";
+        std::string instruction = disassembler.decode(bank, address).text;
+        if (symbols.lookup(bank, address) != nullptr) {
+            out << std::left << std::setw(20) << instruction << std::right << "  " << symbols.describe(bank, address);
+        } else {
+            out << instruction;
+        }
+        out << std::endl;
+    }
+}
+
+void Profiler::write_folded(std::ostream& out, const SymbolTable& symbols) const {
+    // Stacks that map to the same names (e.g. several PCs in one function) are merged
+    std::map<std::string, uint64_t> folded;
+    if (call_stacks_) {
+        for (const auto& [key, count] : stack_samples_) {
+            std::string line;
+            for (const std::string& name : stack_names(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key), symbols)) {
+                line += (line.empty() ? "" : ";") + name;
+            }
+            folded[line] += count;
+        }
+    } else {
+        for (const auto& [pc, count] : pc_samples_) {
+            folded[function_name(ROOT, pc, symbols)] += count;
+        }
+    }
+    for (const auto& [line, count] : folded) {
+        out << line << " " << count << "\n";
+    }
+}
@@ -0,0 +1,143 @@
+#include "../inc/resampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define RESAMPLER_SSE 1
+#endif
+
+static const double PASSBAND = 0.90;  // Fraction of the lower Nyquist frequency kept
+static const size_t HISTORY_RESERVE = 8192;
+
+Resampler::Resampler(uint32_t input_rate, uint32_t output_rate)
+    : nominal_step_((static_cast<uint64_t>(input_rate) << FRAC_BITS) / output_rate)
+    , step_(nominal_step_)
+    , kernel_(static_cast<size_t>(PHASES + 1) * TAPS) {
+    if (input_rate == 0 || output_rate == 0) {
+        throw std::runtime_error("Resampler rates must be non-zero");
+    }
+
+    // Cutoff in cycles per input sample; below the output Nyquist when downsampling
+    const double pi = std::acos(-1.0);
+    double cutoff = 0.5 * PASSBAND * std::min(1.0, static_cast<double>(output_rate) / input_rate);
+    for (int phase = 0; phase <= PHASES; phase++) {
+        double fraction = static_cast<double>(phase) / PHASES;
+        float* taps = &kernel_[static_cast<size_t>(phase) * TAPS];
+        double sum = 0.0;
+        for (int i = 0; i < TAPS; i++) {
+            double x = i - (TAPS / 2 - 1) - fraction;
+            double t = 2.0 * cutoff * x;
+            double sinc = x == 0.0 ? 1.0 : std::sin(pi * t) / (pi * t);
+            double w = (i + 1 - fraction) / (TAPS + 1);
+            double window = 0.42 - 0.5 * std::cos(2.0 * pi * w) + 0.08 * std::cos(4.0 * pi * w);
+            taps[i] = static_cast<float>(sinc * window);
+            sum += taps[i];
+        }
+        for (int i = 0; i < TAPS; i++) {
+            taps[i] = static_cast<float>(taps[i] / sum);
+        }
+    }
+
+    left_.reserve(HISTORY_RESERVE);
+    right_.reserve(HISTORY_RESERVE);
+    reset();
+}
+
+void Resampler::set_rate_adjust(double adjust) {
+    adjust_ = adjust;
+    step_ = static_cast<uint64_t>(static_cast<double>(nominal_step_) * adjust);
+}
+
+void Resampler::reset() {
+    // Start with a full window of silence so the first output needs no special case
+    left_.assign(TAPS, 0.0f);
+    right_.assign(TAPS, 0.0f);
+    position_ = 0;
+}
+
+void Resampler::push(const int16_t* frames, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        left_.push_back(frames[i * 2]);
+        right_.push_back(frames[i * 2 + 1]);
+    }
+}
+
+size_t Resampler::input_needed(size_t output_frames) const {
+    if (output_frames == 0) {
+        return 0;
+    }
+    uint64_t last = position_ + (output_frames - 1) * step_;
+    size_t needed = static_cast<size_t>(last >> FRAC_BITS) + TAPS;
+    return needed > left_.size() ? needed - left_.size() : 0;
+}
+
+static inline void dot_product(const float* left, const float* right, const float* taps,
+                               float& out_left, float& out_right) {
+#ifdef RESAMPLER_SSE
+    __m128 sum_left = _mm_setzero_ps();
+    __m128 sum_right = _mm_setzero_ps();
+    for (int i = 0; i < Resampler::TAPS; i += 4) {
+        __m128 k = _mm_loadu_ps(taps + i);
+        sum_left = _mm_add_ps(sum_left, _mm_mul_ps(_mm_loadu_ps(left + i), k));
+        sum_right = _mm_add_ps(sum_right, _mm_mul_ps(_mm_loadu_ps(right + i), k));
+    }
+    alignas(16) float lanes_left[4];
+    alignas(16) float lanes_right[4];
+    _mm_store_ps(lanes_left, sum_left);
+    _mm_store_ps(lanes_right, sum_right);
+    out_left = (lanes_left[0] + lanes_left[1]) + (lanes_left[2] + lanes_left[3]);
+    out_right = (lanes_right[0] + lanes_right[1]) + (lanes_right[2] + lanes_right[3]);
+#else
+    float sum_left = 0.0f;
+    float sum_right = 0.0f;
+    for (int i = 0; i < Resampler::TAPS; i++) {
+        sum_left += left[i] * taps[i];
+        sum_right += right[i] * taps[i];
+    }
+    out_left = sum_left;
+    out_right = sum_right;
+#endif
+}
+
+static inline int16_t to_sample(float value) {
+    long rounded = std::lround(value);
+    return static_cast<int16_t>(std::max(-32768L, std::min(32767L, rounded)));
+}
+
+size_t Resampler::pull(int16_t* out, size_t max_frames) {
+    size_t produced = 0;
+    const uint64_t frac_mask = (uint64_t(1) << FRAC_BITS) - 1;
+    while (produced < max_frames) {
+        size_t index = static_cast<size_t>(position_ >> FRAC_BITS);
+        if (index + TAPS > left_.size()) {
+            break;
+        }
+        uint64_t frac = position_ & frac_mask;
+        uint32_t phase = static_cast<uint32_t>(frac >> (FRAC_BITS - PHASE_BITS));
+        float weight = static_cast<float>(frac & ((uint64_t(1) << (FRAC_BITS - PHASE_BITS)) - 1))
+            / static_cast<float>(uint64_t(1) << (FRAC_BITS - PHASE_BITS));
+
+        float left0, right0, left1, right1;
+        dot_product(&left_[index], &right_[index], &kernel_[phase * TAPS], left0, right0);
+        dot_product(&left_[index], &right_[index], &kernel_[(phase + 1) * TAPS], left1, right1);
+        out[produced * 2] = to_sample(left0 + (left1 - left0) * weight);
+        out[produced * 2 + 1] = to_sample(right0 + (right1 - right0) * weight);
+
+        produced++;
+        position_ += step_;
+    }
+    compact();
+    return produced;
+}
+
+void Resampler::compact() {
+    size_t consumed = static_cast<size_t>(position_ >> FRAC_BITS);
+    consumed = std::min(consumed, left_.size());
+    if (consumed == 0) {
+        return;
+    }
+    left_.erase(left_.begin(), left_.begin() + consumed);
+    right_.erase(right_.begin(), right_.begin() + consumed);
+    position_ -= static_cast<uint64_t>(consumed) << FRAC_BITS;
+}
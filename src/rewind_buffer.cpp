@@ -0,0 +1,227 @@
+#include "../inc/rewind_buffer.hpp"
+#include <cstring>
+#include <stdexcept>
+
+// Token layout of the snapshot codec:
+//   0x00-0x7F  literal run, (token + 1) raw bytes follow
+//   0x80-0xFF  zero run, length = ((token & 0x7F) << 8 | next byte) + 1
+static const size_t MAX_LITERAL_RUN = 0x80;
+static const size_t MAX_ZERO_RUN = 0x8000;
+static const size_t MIN_ZERO_RUN = 3;
+
+RewindBuffer::RewindBuffer(size_t arena_bytes, size_t max_frames, uint32_t keyframe_interval)
+    : arena_(arena_bytes)
+    , entries_(max_frames)
+    , keyframe_interval_(keyframe_interval) {
+    if (max_frames == 0 || keyframe_interval == 0) {
+        throw std::runtime_error("Rewind buffer needs at least one frame and a keyframe interval");
+    }
+}
+
+size_t RewindBuffer::max_compressed_size(size_t size) {
+    return size + size / MAX_LITERAL_RUN + 2;
+}
+
+size_t RewindBuffer::compress(const uint8_t* src, size_t size, uint8_t* dst) {
+    size_t out = 0;
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 0;
+        while (i + run < size && src[i + run] == 0 && run < MAX_ZERO_RUN) {
+            run++;
+        }
+        if (run >= MIN_ZERO_RUN || (run > 0 && i + run == size)) {
+            dst[out++] = 0x80 | static_cast<uint8_t>((run - 1) >> 8);
+            dst[out++] = static_cast<uint8_t>((run - 1) & 0xFF);
+            i += run;
+            continue;
+        }
+
+        size_t start = i;
+        size_t length = 0;
+        while (i < size && length < MAX_LITERAL_RUN) {
+            if (src[i] == 0 && i + 2 < size && src[i + 1] == 0 && src[i + 2] == 0) {
+                break;
+            }
+            i++;
+            length++;
+        }
+        dst[out++] = static_cast<uint8_t>(length - 1);
+        std::memcpy(dst + out, src + start, length);
+        out += length;
+    }
+    return out;
+}
+
+void RewindBuffer::decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t dst_size) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < size) {
+        uint8_t token = src[in++];
+        if (token & 0x80) {
+            if (in >= size) {
+                throw std::runtime_error("Corrupt rewind snapshot");
+            }
+            size_t run = ((static_cast<size_t>(token & 0x7F) << 8) | src[in++]) + 1;
+            if (out + run > dst_size) {
+                throw std::runtime_error("Corrupt rewind snapshot");
+            }
+            std::memset(dst + out, 0, run);
+            out += run;
+        } else {
+            size_t length = static_cast<size_t>(token) + 1;
+            if (out + length > dst_size || in + length > size) {
+                throw std::runtime_error("Corrupt rewind snapshot");
+            }
+            std::memcpy(dst + out, src + in, length);
+            in += length;
+            out += length;
+        }
+    }
+    if (out != dst_size) {
+        throw std::runtime_error("Corrupt rewind snapshot");
+    }
+}
+
+void RewindBuffer::clear() {
+    head_ = 0;
+    count_ = 0;
+    used_bytes_ = 0;
+    frames_since_keyframe_ = 0;
+    keyframe_.clear();
+}
+
+size_t RewindBuffer::find_keyframe(size_t index) {
+    while (!entry_at(index).keyframe) {
+        index--;
+    }
+    return index;
+}
+
+bool RewindBuffer::has_room(size_t size, size_t& offset) const {
+    if (count_ == entries_.size()) {
+        return false;
+    }
+    if (count_ == 0) {
+        offset = 0;
+        return size <= arena_.size();
+    }
+
+    const Entry& oldest = entries_[head_];
+    const Entry& newest = entries_[(head_ + count_ - 1) % entries_.size()];
+    size_t tail = newest.offset + newest.size;
+
+    if (newest.offset >= oldest.offset) {
+        // Free space is [tail, end) followed by [0, oldest)
+        if (tail + size <= arena_.size()) {
+            offset = tail;
+            return true;
+        }
+        offset = 0;
+        return size <= oldest.offset;
+    }
+    // Wrapped: free space is [tail, oldest)
+    offset = tail;
+    return tail + size <= oldest.offset;
+}
+
+void RewindBuffer::evict_oldest_group() {
+    do {
+        used_bytes_ -= entries_[head_].size;
+        head_ = (head_ + 1) % entries_.size();
+        count_--;
+    } while (count_ > 0 && !entries_[head_].keyframe);
+}
+
+void RewindBuffer::push_entry(const uint8_t* data, size_t size, bool keyframe) {
+    size_t offset = 0;
+    while (!has_room(size, offset)) {
+        evict_oldest_group();
+    }
+    std::memcpy(arena_.data() + offset, data, size);
+    Entry& entry = entries_[(head_ + count_) % entries_.size()];
+    entry.offset = offset;
+    entry.size = size;
+    entry.keyframe = keyframe;
+    count_++;
+    used_bytes_ += size;
+}
+
+void RewindBuffer::capture(const std::vector<uint8_t>& state) {
+    size_t size = state.size();
+    if (packed_.size() < max_compressed_size(size)) {
+        packed_.resize(max_compressed_size(size));
+        scratch_.resize(size);
+    }
+
+    bool keyframe = count_ == 0
+        || keyframe_.size() != size
+        || frames_since_keyframe_ >= keyframe_interval_;
+
+    if (!keyframe) {
+        const uint8_t* current = state.data();
+        const uint8_t* base = keyframe_.data();
+        uint8_t* delta = scratch_.data();
+        for (size_t i = 0; i < size; i++) {
+            delta[i] = current[i] ^ base[i];
+        }
+        size_t packed_size = compress(delta, size, packed_.data());
+
+        // A delta is useless if making room for it would evict its own keyframe
+        size_t offset = 0;
+        while (!has_room(packed_size, offset) && find_keyframe(count_ - 1) != 0) {
+            evict_oldest_group();
+        }
+        if (has_room(packed_size, offset)) {
+            push_entry(packed_.data(), packed_size, false);
+            frames_since_keyframe_++;
+            return;
+        }
+    }
+
+    size_t packed_size = compress(state.data(), size, packed_.data());
+    if (packed_size > arena_.size()) {
+        throw std::runtime_error("Rewind arena is smaller than a single snapshot");
+    }
+    push_entry(packed_.data(), packed_size, true);
+    keyframe_.assign(state.begin(), state.end());
+    frames_since_keyframe_ = 1;
+}
+
+bool RewindBuffer::rewind(std::vector<uint8_t>& state) {
+    if (count_ == 0) {
+        return false;
+    }
+
+    size_t size = keyframe_.size();
+    size_t newest = count_ - 1;
+    size_t keyframe_index = find_keyframe(newest);
+
+    state.resize(size);
+    const Entry& base = entry_at(keyframe_index);
+    decompress(arena_.data() + base.offset, base.size, state.data(), size);
+
+    if (keyframe_index != newest) {
+        const Entry& delta = entry_at(newest);
+        decompress(arena_.data() + delta.offset, delta.size, scratch_.data(), size);
+        for (size_t i = 0; i < size; i++) {
+            state[i] ^= scratch_[i];
+        }
+    }
+
+    used_bytes_ -= entry_at(newest).size;
+    count_--;
+
+    if (count_ == 0) {
+        frames_since_keyframe_ = 0;
+    } else if (keyframe_index == newest) {
+        // The dropped entry was a keyframe, so the previous group becomes current
+        size_t previous = find_keyframe(count_ - 1);
+        const Entry& entry = entry_at(previous);
+        decompress(arena_.data() + entry.offset, entry.size, keyframe_.data(), size);
+        frames_since_keyframe_ = static_cast<uint32_t>(count_ - previous);
+    } else {
+        frames_since_keyframe_ = static_cast<uint32_t>(count_ - keyframe_index);
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#include "../inc/scheduler.hpp"
+#include "../inc/save_state.hpp"
+
+Scheduler::Scheduler() {
+    for (Event& event : events_) {
+        event.time = 0;
+        event.active = false;
+    }
+}
+
+void Scheduler::set_handler(SchedulerEvent event, Handler handler) {
+    handlers_[event] = std::move(handler);
+}
+
+void Scheduler::schedule(SchedulerEvent event, uint64_t delay) {
+    schedule_at(event, now_ + delay);
+}
+
+void Scheduler::schedule_at(SchedulerEvent event, uint64_t time) {
+    events_[event].time = time;
+    events_[event].active = true;
+    update_next_event();
+}
+
+void Scheduler::cancel(SchedulerEvent event) {
+    events_[event].active = false;
+    update_next_event();
+}
+
+void Scheduler::update_next_event() {
+    next_event_time_ = UINT64_MAX;
+    for (const Event& event : events_) {
+        if (event.active && event.time < next_event_time_) {
+            next_event_time_ = event.time;
+        }
+    }
+}
+
+void Scheduler::run_due_events() {
+    // Handlers may reschedule themselves, so pick the earliest due event each time
+    while (now_ >= next_event_time_) {
+        uint8_t due = EVENT_COUNT;
+        for (uint8_t i = 0; i < EVENT_COUNT; i++) {
+            if (events_[i].active && events_[i].time == next_event_time_) {
+                due = i;
+                break;
+            }
+        }
+        events_[due].active = false;
+        update_next_event();
+        if (handlers_[due]) {
+            handlers_[due]();
+        }
+    }
+}
+
+void Scheduler::save_state(StateWriter& writer) const {
+    writer.write(now_);
+    for (uint8_t i = 0; i < EVENT_HOST_FIRST; i++) {
+        writer.write(events_[i].time);
+        writer.write(events_[i].active);
+    }
+}
+
+void Scheduler::load_state(StateReader& reader) {
+    // Host events keep the same distance from the restored clock
+    uint64_t previous_now = now_;
+    reader.read(now_);
+    for (uint8_t i = 0; i < EVENT_HOST_FIRST; i++) {
+        reader.read(events_[i].time);
+        reader.read(events_[i].active);
+    }
+    for (uint8_t i = EVENT_HOST_FIRST; i < EVENT_COUNT; i++) {
+        events_[i].time = now_ + (events_[i].time > previous_now ? events_[i].time - previous_now : 0);
+    }
+    update_next_event();
+}
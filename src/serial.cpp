@@ -0,0 +1,99 @@
+#include "../inc/serial.hpp"
+#include "../inc/interrupt_controller.hpp"
+#include "../inc/link_port.hpp"
+#include "../inc/save_state.hpp"
+#include "../inc/scheduler.hpp"
+
+// With no partner attached the input line floats high
+static const uint8_t SERIAL_DISCONNECTED_INPUT = 0xFF;
+
+Serial::Serial(InterruptController* interrupt_controller, Scheduler* scheduler)
+    : interrupt_controller_(interrupt_controller)
+    , scheduler_(scheduler) {
+    output_.reserve(4096);
+    scheduler_->set_handler(EVENT_SERIAL_TRANSFER, [this]() { on_transfer_event(); });
+}
+
+uint8_t Serial::read_register(uint16_t address) const {
+    if (address == SB_REGISTER_LOCATION) {
+        return sb_;
+    }
+    return sc_ | 0x7E;
+}
+
+void Serial::write_register(uint16_t address, uint8_t value) {
+    if (address == SB_REGISTER_LOCATION) {
+        sb_ = value;
+        if (waiting_for_partner()) {
+            link_->set_ready(sb_);
+        }
+        return;
+    }
+    sc_ = value & (SERIAL_TRANSFER_START | SERIAL_INTERNAL_CLOCK);
+    if ((sc_ & SERIAL_TRANSFER_START) && (sc_ & SERIAL_INTERNAL_CLOCK)) {
+        scheduler_->schedule(EVENT_SERIAL_TRANSFER, SERIAL_TRANSFER_CYCLES);
+    } else if (waiting_for_partner()) {
+        scheduler_->schedule(EVENT_SERIAL_TRANSFER, LINK_POLL_CYCLES);
+    } else {
+        scheduler_->cancel(EVENT_SERIAL_TRANSFER);
+    }
+    if (link_) {
+        link_->set_ready(waiting_for_partner() ? sb_ : LinkPort::NOT_READY);
+    }
+}
+
+bool Serial::waiting_for_partner() const {
+    return link_ && link_->connected()
+        && (sc_ & (SERIAL_TRANSFER_START | SERIAL_INTERNAL_CLOCK)) == SERIAL_TRANSFER_START;
+}
+
+void Serial::connect_link(LinkPort* link) {
+    link_ = link;
+}
+
+void Serial::sync() {
+    if (link_) {
+        link_->sync(scheduler_->now());
+    }
+}
+
+void Serial::on_transfer_event() {
+    if (sc_ & SERIAL_INTERNAL_CLOCK) {
+        uint8_t received = link_ ? link_->clock_out(sb_, scheduler_->now()) : SERIAL_DISCONNECTED_INPUT;
+        complete_transfer(received);
+        return;
+    }
+    // External clock: poll the cable until the partner clocks a transfer
+    uint8_t received = 0;
+    if (!link_ || !link_->connected()) {
+        return;
+    }
+    if (link_->receive(scheduler_->now(), received)) {
+        complete_transfer(received);
+    } else {
+        scheduler_->schedule(EVENT_SERIAL_TRANSFER, LINK_POLL_CYCLES);
+    }
+}
+
+void Serial::complete_transfer(uint8_t received) {
+    output_.push_back(static_cast<char>(sb_));
+    sb_ = received;
+    sc_ &= ~SERIAL_TRANSFER_START;
+    interrupt_controller_->request_interrupt(INTERRUPT_SERIAL_BIT);
+}
+
+void Serial::save_state(StateWriter& writer) const {
+    writer.write(sb_);
+    writer.write(sc_);
+    writer.write(static_cast<uint64_t>(output_.size()));
+}
+
+void Serial::load_state(StateReader& reader) {
+    uint64_t output_size = 0;
+    reader.read(sb_);
+    reader.read(sc_);
+    reader.read(output_size);
+    if (output_size < output_.size()) {
+        output_.resize(output_size);
+    }
+}
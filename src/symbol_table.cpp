@@ -0,0 +1,92 @@
+#include "../inc/symbol_table.hpp"
+#include "../inc/constants_mmu.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Start of the memory region holding address; symbols never cover an
+// address in a different region
+static uint16_t region_start(uint16_t address) {
+    static const uint16_t STARTS[] = {
+        HIGH_RAM_START, I_O_START, SPRITE_ATTRIBUTES_START,
+        INTERNAL_RAM_START + INTERNAL_RAM_SIZE / 2, INTERNAL_RAM_START,
+        SWITCHABLE_RAM_START, VRAM_START, SWITCHABLE_ROM_START, STATIC_ROM_START
+    };
+    for (uint16_t start : STARTS) {
+        if (address >= start) {
+            return start;
+        }
+    }
+    return STATIC_ROM_START;
+}
+
+bool SymbolTable::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: could not open symbol file " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        line = line.substr(0, line.find(';'));
+        std::istringstream fields(line);
+        std::string location;
+        std::string name;
+        if (!(fields >> location)) {
+            continue;  // Blank or comment
+        }
+        unsigned int bank = 0;
+        unsigned int address = 0;
+        char end = 0;
+        if (!(fields >> name) || std::sscanf(location.c_str(), "%x:%x%c", &bank, &address, &end) != 2
+            || bank > 0xFFFF || address > 0xFFFF) {
+            std::cerr << "Warning: " << path << ":" << line_number << ": not a symbol, skipped" << std::endl;
+            continue;
+        }
+        uint32_t k = key(static_cast<uint16_t>(bank), static_cast<uint16_t>(address));
+        symbols_[k] = {static_cast<uint16_t>(bank), static_cast<uint16_t>(address), name};
+        by_name_.emplace(name, k);
+    }
+    return true;
+}
+
+const SymbolTable::Symbol* SymbolTable::lookup(uint16_t bank, uint16_t address) const {
+    auto it = symbols_.upper_bound(key(bank, address));
+    if (it == symbols_.begin()) {
+        return nullptr;
+    }
+    --it;
+    const Symbol& symbol = it->second;
+    if (symbol.bank != bank || region_start(symbol.address) != region_start(address)) {
+        return nullptr;
+    }
+    return &symbol;
+}
+
+const SymbolTable::Symbol* SymbolTable::find(const std::string& name) const {
+    auto it = by_name_.find(name);
+    return it != by_name_.end() ? &symbols_.at(it->second) : nullptr;
+}
+
+std::string SymbolTable::describe(uint16_t bank, uint16_t address) const {
+    const Symbol* symbol = lookup(bank, address);
+    if (symbol == nullptr) {
+        return location(bank, address);
+    }
+    if (symbol->address == address) {
+        return symbol->name;
+    }
+    char offset[8];
+    std::snprintf(offset, sizeof(offset), "+0x%X", address - symbol->address);
+    return symbol->name + offset;
+}
+
+std::string SymbolTable::location(uint16_t bank, uint16_t address) {
+    char text[12];
+    std::snprintf(text, sizeof(text), "%02X:%04X", bank, address);
+    return text;
+}
@@ -1,5 +1,6 @@
 #include "../inc/timer.hpp"
 #include "../inc/interrupt_controller.hpp"
+#include "../inc/save_state.hpp"
 
 
 Timer::Timer(InterruptController* interrupt_controller) 
@@ -29,6 +30,15 @@ void Timer::update_timer(uint32_t cycles) {
     update_div();
 }
 
+uint32_t Timer::cycles_until_interrupt() const {
+    if ((tac_register_ & 0x04) == 0x00) {
+        return UINT32_MAX;
+    }
+    int64_t period = DMG_CLOCK_SPEED / TAC_FREQUENCIES[tac_register_ & 0x03];
+    int64_t remaining = period * (0x100 - tima_register_) - cycles_since_last_update_tima_;
+    return remaining > 0 ? static_cast<uint32_t>(remaining) : 0;
+}
+
 void Timer::update_tima() {
     while (has_enough_cycles_passed_tima()) {
         tima_register_++;
@@ -77,4 +87,22 @@ uint8_t Timer::read_timer(uint16_t address) const {
         default:
             return 0x00;
     }
+}
+
+void Timer::save_state(StateWriter& writer) const {
+    writer.write(div_register_);
+    writer.write(tima_register_);
+    writer.write(tma_register_);
+    writer.write(tac_register_);
+    writer.write(cycles_since_last_update_tima_);
+    writer.write(cycles_since_last_update_div_);
+}
+
+void Timer::load_state(StateReader& reader) {
+    reader.read(div_register_);
+    reader.read(tima_register_);
+    reader.read(tma_register_);
+    reader.read(tac_register_);
+    reader.read(cycles_since_last_update_tima_);
+    reader.read(cycles_since_last_update_div_);
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "../inc/unix_socket_link.hpp"
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+static const uint8_t MESSAGE_CLOCK = 0;
+static const uint8_t MESSAGE_READY = 1;
+static const uint8_t MESSAGE_NOT_READY = 2;
+static const uint8_t MESSAGE_DATA = 3;
+static const uint8_t MESSAGE_DISCONNECT = 4;
+
+// The listening side may be started a little after the connecting one
+static const auto CONNECT_TIMEOUT = std::chrono::seconds(10);
+static const auto CONNECT_RETRY = std::chrono::milliseconds(50);
+
+#ifdef _WIN32
+
+// No UNIX sockets: the link never opens and stays disconnected
+UnixSocketLink::UnixSocketLink(const std::string& path, Mode mode)
+    : path_(path)
+    , mode_(mode) {
+    std::cerr << "Error: link sockets are not supported on this platform" << std::endl;
+    on_peer_disconnect();
+}
+
+UnixSocketLink::~UnixSocketLink() = default;
+
+void UnixSocketLink::send_message(uint8_t, uint8_t, uint64_t) {}
+
+void UnixSocketLink::reader_loop() {}
+
+#else
+
+UnixSocketLink::UnixSocketLink(const std::string& path, Mode mode)
+    : path_(path)
+    , mode_(mode) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: link socket path too long: " << path << std::endl;
+        return;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    const sockaddr* generic = reinterpret_cast<const sockaddr*>(&address);
+
+    if (mode_ == Mode::Listen) {
+        int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        ::unlink(path.c_str());
+        if (listener < 0 || ::bind(listener, generic, sizeof(address)) < 0 || ::listen(listener, 1) < 0) {
+            std::cerr << "Error: could not listen on " << path << ": " << std::strerror(errno) << std::endl;
+        } else {
+            std::cout << "Link: waiting for a partner on " << path << std::endl;
+            socket_ = ::accept(listener, nullptr, nullptr);
+        }
+        if (listener >= 0) {
+            ::close(listener);
+        }
+    } else {
+        auto deadline = std::chrono::steady_clock::now() + CONNECT_TIMEOUT;
+        while (socket_ < 0 && std::chrono::steady_clock::now() < deadline) {
+            socket_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (::connect(socket_, generic, sizeof(address)) < 0) {
+                ::close(socket_);
+                socket_ = -1;
+                std::this_thread::sleep_for(CONNECT_RETRY);
+            }
+        }
+        if (socket_ < 0) {
+            std::cerr << "Error: could not connect to " << path << std::endl;
+        }
+    }
+
+    if (socket_ < 0) {
+        on_peer_disconnect();
+        return;
+    }
+    reader_ = std::thread(&UnixSocketLink::reader_loop, this);
+}
+
+UnixSocketLink::~UnixSocketLink() {
+    disconnect();
+    if (socket_ >= 0) {
+        ::shutdown(socket_, SHUT_RDWR);
+    }
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+    if (socket_ >= 0) {
+        ::close(socket_);
+    }
+    if (mode_ == Mode::Listen) {
+        ::unlink(path_.c_str());
+    }
+}
+
+void UnixSocketLink::send_message(uint8_t type, uint8_t byte, uint64_t value) {
+    Message message = {};
+    message.type = type;
+    message.byte = byte;
+    message.value = value;
+    const char* data = reinterpret_cast<const char*>(&message);
+    size_t sent = 0;
+    while (sent < sizeof(message)) {
+        ssize_t result = ::send(socket_, data + sent, sizeof(message) - sent, MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            on_peer_disconnect();
+            return;
+        }
+        sent += static_cast<size_t>(result);
+    }
+}
+
+void UnixSocketLink::reader_loop() {
+    Message message;
+    char* data = reinterpret_cast<char*>(&message);
+    while (true) {
+        size_t received = 0;
+        while (received < sizeof(message)) {
+            ssize_t result = ::recv(socket_, data + received, sizeof(message) - received, 0);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                on_peer_disconnect();
+                return;
+            }
+            received += static_cast<size_t>(result);
+        }
+
+        switch (message.type) {
+            case MESSAGE_CLOCK: on_peer_clock(message.value); break;
+            case MESSAGE_READY: on_peer_ready(message.byte); break;
+            case MESSAGE_NOT_READY: on_peer_ready(NOT_READY); break;
+            case MESSAGE_DATA: on_peer_data(message.byte, message.value); break;
+            default:
+                on_peer_disconnect();
+                return;
+        }
+    }
+}
+
+#endif
+
+void UnixSocketLink::send_clock(uint64_t stamp) {
+    send_message(MESSAGE_CLOCK, 0, stamp);
+}
+
+void UnixSocketLink::send_ready(int byte) {
+    if (byte == NOT_READY) {
+        send_message(MESSAGE_NOT_READY, 0, 0);
+    } else {
+        send_message(MESSAGE_READY, static_cast<uint8_t>(byte), 0);
+    }
+}
+
+void UnixSocketLink::send_data(uint8_t byte, uint64_t time) {
+    send_message(MESSAGE_DATA, byte, time);
+}
+
+void UnixSocketLink::send_disconnect() {
+    send_message(MESSAGE_DISCONNECT, 0, 0);
+}
@@ -0,0 +1,121 @@
+#include "../inc/watchpoints.hpp"
+#include "../inc/cpu.hpp"
+#include "../inc/mmu.hpp"
+#include "../inc/scheduler.hpp"
+#include "../inc/symbol_table.hpp"
+#include <algorithm>
+#include <cstdio>
+
+Watchpoints::Watchpoints(CPU* cpu, MMU* mmu, const Scheduler* scheduler)
+    : cpu_(cpu)
+    , mmu_(mmu)
+    , scheduler_(scheduler) {}
+
+Watchpoints::~Watchpoints() {
+    mmu_->set_watchpoints(nullptr, {});
+}
+
+uint32_t Watchpoints::add(uint16_t first, uint16_t last, uint8_t access, bool stop) {
+    if (last < first) {
+        std::swap(first, last);
+    }
+    watchpoints_.push_back({next_number_++, first, last, access, stop});
+    update_pages();
+    return watchpoints_.back().number;
+}
+
+bool Watchpoints::remove(uint32_t number) {
+    auto removed = std::remove_if(watchpoints_.begin(), watchpoints_.end(), [number](const Watchpoint& watchpoint) {
+        return number == 0 || watchpoint.number == number;
+    });
+    if (removed == watchpoints_.end()) {
+        return false;
+    }
+    watchpoints_.erase(removed, watchpoints_.end());
+    update_pages();
+    return true;
+}
+
+void Watchpoints::update_pages() {
+    std::array<uint64_t, 4> pages = {};
+    for (const Watchpoint& watchpoint : watchpoints_) {
+        for (uint32_t page = watchpoint.first >> MMU::PAGE_SHIFT; page <= watchpoint.last >> MMU::PAGE_SHIFT; page++) {
+            pages[page >> 6] |= 1ULL << (page & 63);
+        }
+    }
+    mmu_->set_watchpoints(watchpoints_.empty() ? nullptr : this, pages);
+}
+
+void Watchpoints::on_access(uint16_t address, uint8_t value, bool write) {
+    uint8_t access = write ? WRITE : READ;
+    for (const Watchpoint& watchpoint : watchpoints_) {
+        if (address < watchpoint.first || address > watchpoint.last || !(watchpoint.access & access)) {
+            continue;
+        }
+        uint16_t pc = cpu_->instruction_address();
+        Hit hit = {watchpoint.number, pc, mmu_->bank_of(pc), address, value, write, scheduler_->now()};
+        if (log_.size() < HIT_LOG_SIZE) {
+            log_.push_back(hit);
+        } else {
+            log_[log_next_] = hit;
+        }
+        log_next_ = (log_next_ + 1) % HIT_LOG_SIZE;
+        hit_count_++;
+        // The first breaking hit of an instruction is the one reported
+        if (watchpoint.stop && !break_pending_) {
+            break_hit_ = hit;
+            break_pending_ = true;
+            cpu_->request_stop();
+        }
+        return;
+    }
+}
+
+bool Watchpoints::take_break(Hit& hit) {
+    if (!break_pending_) {
+        return false;
+    }
+    hit = break_hit_;
+    break_pending_ = false;
+    cpu_->cancel_stop();
+    return true;
+}
+
+std::vector<Watchpoints::Hit> Watchpoints::hits(size_t count) const {
+    size_t kept = log_.size();
+    if (count == 0 || count > kept) {
+        count = kept;
+    }
+    // The oldest entry is at 0 until the ring is full, then at the write position
+    size_t oldest = kept < HIT_LOG_SIZE ? 0 : log_next_;
+    std::vector<Hit> result;
+    result.reserve(count);
+    for (size_t i = kept - count; i < kept; i++) {
+        result.push_back(log_[(oldest + i) % kept]);
+    }
+    return result;
+}
+
+std::string Watchpoints::describe(const Hit& hit, const SymbolTable* symbols) {
+    char text[64];
+    std::snprintf(text, sizeof(text), "#%u %s %04X %s %02X by ", hit.number, hit.write ? "write" : "read ",
+                  hit.address, hit.write ? "<-" : "->", hit.value);
+    std::string result = text;
+    result += SymbolTable::location(hit.bank, hit.pc);
+    if (symbols != nullptr && symbols->lookup(hit.bank, hit.pc) != nullptr) {
+        result += " (" + symbols->describe(hit.bank, hit.pc) + ")";
+    }
+    return result + ", cycle " + std::to_string(hit.cycle);
+}
+
+void Watchpoints::write_log(std::ostream& out, const SymbolTable* symbols, size_t count) const {
+    std::vector<Hit> shown = hits(count);
+    out << "Watchpoint hits: " << hit_count_;
+    if (shown.size() < hit_count_) {
+        out << " (last " << shown.size() << " shown)";
+    }
+    out << "\n";
+    for (const Hit& hit : shown) {
+        out << "  " << describe(hit, symbols) << "\n";
+    }
+}